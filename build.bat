@@ -4,13 +4,28 @@ REM gcc src/*.c -std=c17 -g -Iinclude -Llib -lmingw32 -lSDL2main -lSDL2 -lSDL2_i
 @echo off
 set project_name=pacman
 
-set args= -GR- -EHa -nologo -Zi -experimental:external -external:anglebrackets -DDEBUG
+set args= -GR- -EHa -nologo -Zi -experimental:external -external:anglebrackets -DDEBUG -DPROFILE
+REM -DHASH_CHECK checks the incremental state hash against a full recomputation every tick
 set include_path=-external:I ..\include\ 
 
 set linker_options=-link -SUBSYSTEM:WINDOWS -LIBPATH:..\lib 
-set libs=SDL2main.lib SDL2.lib SDL2_ttf.lib SDL2_image.lib SDL2_mixer.lib Shell32.lib
+set libs=SDL2main.lib SDL2.lib SDL2_ttf.lib SDL2_image.lib Shell32.lib Ws2_32.lib
 
 pushd bin
 cl %args% -Fe%project_name% %include_path% ../src/*.c %linker_options% %libs%
+
+REM Asset pack, mapped at startup by src/pack.c
+set tool_linker_options=-link -SUBSYSTEM:CONSOLE -LIBPATH:..\lib
+cl %args% -Fepacker %include_path% ../tools/packer.c %tool_linker_options% SDL2main.lib SDL2.lib SDL2_image.lib Shell32.lib
+packer -rgba resources.pak ..\resources ghost.png pac_man.png walls.png unifont.ttf audio/intro.wav audio/death.wav audio/waka.wav
+
+REM Reads the metrics published by running instances
+cl %args% -Femetrics_cli %include_path% ../tools/metrics_cli.c ../src/metrics.c %tool_linker_options% SDL2main.lib SDL2.lib Shell32.lib
+
+REM Example ghost brain plugin for --ghost-brain
+cl %args% -LD -Febrain_ambush ../tools/brain_ambush.c
+
+REM Writes generated mazes for --maze-bench
+cl %args% -Femazegen %include_path% ../tools/mazegen.c ../src/maze.c ../src/debug.c %tool_linker_options% SDL2main.lib SDL2.lib Shell32.lib
 popd
 echo Build completed!
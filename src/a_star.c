@@ -4,231 +4,244 @@
 #include <stdlib.h>
 
 #include "debug.h"
+#include "metrics.h"
+#include "profiler.h"
 #include "utils.h"
 
-struct Node {
-	SDL_Point pos;
-	int f;
+/*
+ * Searches run on a per thread scratch grid and write into the caller's path, nothing is allocated
+ * for the shipped maze. Bigger generated mazes grow a heap grid kept until a_star_free_scratch().
+ * Nodes are stamped with the search generation instead of being cleared between searches.
+ */
+
+typedef struct Node {
 	int g;
 	int h;
-	struct Node *parent;
-} typedef Node;
+	int parent;
+	Uint32 open_generation;
+	Uint32 closed_generation;
+} Node;
 
-struct Vector {
-	int length;
-	Node **list;
-} typedef Vector;
-
-Vector *create_vector() {
-	return calloc(1, sizeof(Vector));
+typedef struct HeapEntry {
+	int f;
+	int h;
+	int index;
+} HeapEntry;
+
+typedef struct Scratch {
+	Node *nodes; // default_nodes unless a bigger map was searched
+	HeapEntry *heap; // A node is pushed at most once per neighbour, 4 entries per tile
+	int capacity; // Tiles
+	int width; // Of the map being searched
+	int heap_length;
+	Uint32 generation;
+	Node default_nodes[MAP_SIZE];
+	HeapEntry default_heap[MAP_SIZE * 4];
+} Scratch;
+
+static THREAD_LOCAL Scratch scratch;
+static THREAD_LOCAL Uint64 total_expanded;
+
+static bool heap_less(const HeapEntry *a, const HeapEntry *b) {
+	if (a->f != b->f)
+		return a->f < b->f;
+	return a->h < b->h;
 }
 
-void vector_push_back(Vector *vector, Node *node) {
-	vector->length++;
-	if (vector->length == 1) {
-		vector->list = malloc(sizeof(Node *));
-	} else {
-		vector->list = realloc(vector->list, sizeof(Node *) * (vector->length));
+static void heap_push(int f, int h, int index) {
+	int i = scratch.heap_length++;
+	HeapEntry entry = { f, h, index };
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+		if (!heap_less(&entry, &scratch.heap[parent]))
+			break;
+		scratch.heap[i] = scratch.heap[parent];
+		i = parent;
 	}
-
-	vector->list[vector->length - 1] = node;
+	scratch.heap[i] = entry;
 }
 
-void vector_remove(Vector *vector, const int index) {
-	for (int i = index; i < vector->length - 1; i++) {
-		vector->list[i] = vector->list[i + 1];
+static HeapEntry heap_pop() {
+	HeapEntry top = scratch.heap[0];
+	HeapEntry last = scratch.heap[--scratch.heap_length];
+	int i = 0;
+	for (;;) {
+		int child = i * 2 + 1;
+		if (child >= scratch.heap_length)
+			break;
+		if (child + 1 < scratch.heap_length && heap_less(&scratch.heap[child + 1], &scratch.heap[child]))
+			child++;
+		if (!heap_less(&scratch.heap[child], &last))
+			break;
+		scratch.heap[i] = scratch.heap[child];
+		i = child;
 	}
-
-	vector->length--;
-	if (vector->length == 0)
-		free(vector->list);
-	else
-		vector->list = realloc(vector->list, sizeof(Node *) * (vector->length));
+	scratch.heap[i] = last;
+	return top;
 }
 
-void vector_free(Vector *vector) {
-	for (int i = 0; i < vector->length; i++) {
-		free(vector->list[i]);
+static void fit_scratch(const Map *map) {
+	if (scratch.nodes == NULL) {
+		scratch.nodes = scratch.default_nodes;
+		scratch.heap = scratch.default_heap;
+		scratch.capacity = MAP_SIZE;
 	}
-	if (vector->length > 0)
-		free(vector->list);
-	free(vector);
-}
-
-bool vector_has(const Vector *vec, Node *node, int *index) {
-	for (int i = 0; i < vec->length; i++) {
-		if (vec->list[i] == node)
-			SDL_Log("Pointer is equal you can optimize your code dude!");
 
-		if (vec->list[i]->pos.x == node->pos.x && vec->list[i]->pos.y == node->pos.y) {
-			if (index != NULL)
-				*index = i;
-			return true;
-		}
+	int size = map_get_width(map) * map_get_height(map);
+	if (size > scratch.capacity) {
+		a_star_free_scratch();
+		// Zeroed stamps are older than any generation
+		scratch.nodes = calloc(size, sizeof(Node));
+		scratch.heap = malloc(size * 4 * sizeof(HeapEntry));
+		scratch.capacity = size;
 	}
-	return false;
+	scratch.width = map_get_width(map);
 }
 
-void a_star(const Map *map, const SDL_Point *start, const SDL_Point *end, SDL_Point **path, int *length) {
-	Vector *open_list = create_vector();
-	Vector *closed_list = create_vector();
-
-	Node *start_node = calloc(1, sizeof(Node));
-	start_node->pos = *start;
-
-	vector_push_back(open_list, start_node);
+static void begin_search(const Map *map, const SDL_Point *start, int h) {
+	fit_scratch(map);
+	scratch.generation++;
+	scratch.heap_length = 0;
+
+	int index = start->x + start->y * scratch.width;
+	Node *node = &scratch.nodes[index];
+	node->g = 0;
+	node->h = h;
+	node->parent = -1;
+	node->open_generation = scratch.generation;
+	heap_push(h, h, index);
+}
 
-	while (open_list->length > 0) {
-		Node *current_node = open_list->list[0];
-		int index_to_delete = 0;
-		for (int i = 0; i < open_list->length; i++) {
-			if (current_node->f > open_list->list[i]->f) {
-				current_node = open_list->list[i];
-				index_to_delete = i;
-			}
+static void build_path(int index, PathNode *path, int *length) {
+	int count = 0;
+	for (int i = index; i >= 0; i = scratch.nodes[i].parent) {
+		count++;
+	}
+	// Keeps the start of an overlong path, the ghost searches again once it gets there
+	*length = SDL_min(count, A_STAR_MAX_PATH);
+	int x = count;
+	for (int i = index; i >= 0; i = scratch.nodes[i].parent) {
+		x--;
+		if (x < A_STAR_MAX_PATH) {
+			path[x].x = (Sint16)(i % scratch.width);
+			path[x].y = (Sint16)(i / scratch.width);
 		}
+	}
+	metrics_record(METRIC_PATH_LENGTH, count);
+}
 
-		vector_push_back(closed_list, current_node);
-		vector_remove(open_list, index_to_delete);
+static bool is_on_map(const Map *map, const SDL_Point *p) {
+	return p->x >= 0 && p->x < map_get_width(map) && p->y >= 0 && p->y < map_get_height(map);
+}
 
-		if (current_node->pos.x == end->x && current_node->pos.y == end->y) {
-			*length = current_node->g + 1;
-			*path = realloc(*path, *length * sizeof(SDL_Point));
-			int x = *length;
-			for (Node *node = current_node; node != NULL; node = node->parent) {
-				x--;
-				(*path)[x] = node->pos;
-			}
-			break;
-		}
+// Pops the best open node, returns -1 when the open list is empty
+static int next_node() {
+	while (scratch.heap_length > 0) {
+		HeapEntry entry = heap_pop();
+		Node *node = &scratch.nodes[entry.index];
+		// Stale entries left behind when a node was reopened with a lower g
+		if (node->closed_generation == scratch.generation || entry.f != node->g + node->h)
+			continue;
+		node->closed_generation = scratch.generation;
+		return entry.index;
+	}
+	return -1;
+}
 
-		// Add adjacent nodes
-		Node **children = calloc(4, sizeof(Node *));
-		for (int i = 0; i < 4; i++) {
-			children[i] = malloc(sizeof(Node));
-			children[i]->pos = current_node->pos;
-			children[i]->parent = current_node;
-		}
+static void open_neighbours(const Map *map, int index, const SDL_Point *target, int h_sign) {
+	static const SDL_Point offsets[4] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+	const Node *current = &scratch.nodes[index];
+
+	for (int i = 0; i < 4; i++) {
+		SDL_Point pos = { index % scratch.width + offsets[i].x, index / scratch.width + offsets[i].y };
+		if (map_get_collision(map, pos.x, pos.y, COLLISION_GHOST))
+			continue;
+
+		int child_index = pos.x + pos.y * scratch.width;
+		Node *child = &scratch.nodes[child_index];
+		if (child->closed_generation == scratch.generation)
+			continue;
+
+		int g = current->g + 1;
+		if (child->open_generation == scratch.generation && g >= child->g)
+			continue;
+
+		child->g = g;
+		child->h = h_sign * (int)SDL_Point_Distance(&pos, target);
+		child->parent = index;
+		child->open_generation = scratch.generation;
+		heap_push(g + child->h, child->h, child_index);
+	}
+}
 
-		children[0]->pos.x--;
-		children[1]->pos.x++;
-		children[2]->pos.y--;
-		children[3]->pos.y++;
+int a_star(const Map *map, const SDL_Point *start, const SDL_Point *end, PathNode *path, int *length) {
+	PROFILE_BEGIN("a_star");
+	int expanded = 0;
 
-		// For each adjacent node
-		for (int i = 0; i < 4; i++) {
-			if (vector_has(closed_list, children[i], NULL)) {
-				free(children[i]);
-				continue;
-			}
-			if (map_get_collision(map, children[i]->pos.x, children[i]->pos.y, COLLISION_GHOST)) {
-				free(children[i]);
-				continue;
-			}
+	if (is_on_map(map, start)) {
+		begin_search(map, start, SDL_Point_Distance(start, end));
 
-			children[i]->g = current_node->g + 1;
-			children[i]->h = SDL_Point_Distance(&children[i]->pos, end);
-			children[i]->f = children[i]->g + children[i]->h;
-			int index = 0;
-			if (vector_has(open_list, children[i], &index)) {
-				if (children[i]->g > open_list->list[index]->g) {
-					free(children[i]);
-					continue;
-				}
+		int index;
+		while ((index = next_node()) >= 0) {
+			expanded++;
+			if (index % scratch.width == end->x && index / scratch.width == end->y) {
+				build_path(index, path, length);
+				break;
 			}
-			vector_push_back(open_list, children[i]);
+			open_neighbours(map, index, end, 1);
 		}
-
-		free(children);
 	}
-	vector_free(open_list);
-	vector_free(closed_list);
-}
-
-void reverse_a_star(const Map *map, const SDL_Point *start, const SDL_Point *place_to_flee, const int max_distance, SDL_Point **path, int *length) {
-	Vector *open_list = create_vector();
-	Vector *closed_list = create_vector();
 
-	Node *start_node = calloc(1, sizeof(Node));
-	start_node->pos = *start;
-
-	int starting_distance = SDL_Point_Distance(start, place_to_flee);
-
-	vector_push_back(open_list, start_node);
-	int current_iteration = 0;
+	total_expanded += expanded;
+	metrics_count(METRIC_SEARCHES, 1);
+	metrics_record(METRIC_SEARCH_NODES, expanded);
+	PROFILE_END();
+	return expanded;
+}
 
-	while (open_list->length > 0) {
-		Node *current_node = open_list->list[0];
-		int index_to_delete = 0;
-		// Pick node to work on
-		for (int i = 0; i < open_list->length; i++) {
-			if (current_node->f > open_list->list[i]->f) {
-				current_node = open_list->list[i];
-				index_to_delete = i;
-			}
-		}
+int reverse_a_star(const Map *map, const SDL_Point *start, const SDL_Point *place_to_flee, const int max_distance, PathNode *path, int *length) {
+	PROFILE_BEGIN("reverse_a_star");
+	int expanded = 0;
 
-		vector_push_back(closed_list, current_node);
-		vector_remove(open_list, index_to_delete);
+	if (is_on_map(map, start)) {
+		int starting_distance = SDL_Point_Distance(start, place_to_flee);
+		begin_search(map, start, 0);
 
-		if (current_node->h <= -max_distance - starting_distance) { // Exit point
-			*length = current_node->g + 1;
-			*path = realloc(*path, *length * sizeof(SDL_Point));
-			int x = *length;
-			for (Node *node = current_node; node != NULL; node = node->parent) {
-				x--;
-				(*path)[x] = node->pos;
+		int index;
+		while ((index = next_node()) >= 0) {
+			expanded++;
+			if (scratch.nodes[index].h <= -max_distance - starting_distance) { // Exit point
+				build_path(index, path, length);
+				break;
 			}
-			break; // while
-		}
-		current_iteration++;
-
-		// Add adjacent nodes
-		Node **children = calloc(4, sizeof(Node *));
-		for (int i = 0; i < 4; i++) {
-			children[i] = malloc(sizeof(Node));
-			children[i]->pos = current_node->pos;
-			children[i]->parent = current_node;
+			open_neighbours(map, index, place_to_flee, -1);
 		}
+	}
 
-		children[0]->pos.x--;
-		children[1]->pos.x++;
-		children[2]->pos.y--;
-		children[3]->pos.y++;
-
-		// For each adjacent node
-		for (int i = 0; i < 4; i++) {
-			if (vector_has(closed_list, children[i], NULL)) {
-				free(children[i]);
-				continue;
-			}
-			if (map_get_collision(map, children[i]->pos.x, children[i]->pos.y, COLLISION_GHOST)) {
-				free(children[i]);
-				continue;
-			}
+	total_expanded += expanded;
+	metrics_count(METRIC_SEARCHES, 1);
+	metrics_record(METRIC_SEARCH_NODES, expanded);
+	PROFILE_END();
+	return expanded;
+}
 
-			children[i]->g = current_node->g + 1;
-			children[i]->h = -SDL_Point_Distance(&children[i]->pos, place_to_flee);
-			children[i]->f = children[i]->g + children[i]->h;
-			int index = 0;
-			if (vector_has(open_list, children[i], &index)) {
-				if (children[i]->g > open_list->list[index]->g) {
-					free(children[i]);
-					continue;
-				}
-			}
-			vector_push_back(open_list, children[i]);
-		}
+Uint64 a_star_get_expanded() {
+	return total_expanded;
+}
 
-		free(children);
+void a_star_free_scratch() {
+	if (scratch.nodes != scratch.default_nodes) {
+		free(scratch.nodes);
+		free(scratch.heap);
 	}
-	vector_free(open_list);
-	vector_free(closed_list);
+	scratch.nodes = NULL;
+	scratch.heap = NULL;
+	scratch.capacity = 0;
 }
 
-void dbg_draw_a_star(SDL_Renderer *renderer, const SDL_Point *path, const int length, SDL_Point cam_offset) {
+void dbg_draw_a_star(SDL_Renderer *renderer, const PathNode *path, const int length, SDL_Point cam_offset) {
 	for (int i = 0; i < length; i++) {
 		SDL_Rect dst = { (path[i].x * 16) + cam_offset.x, (path[i].y * 16) + cam_offset.y, 16, 16 };
 		SDL_RenderDrawRect(renderer, &dst);
 	}
-}
\ No newline at end of file
+}
@@ -5,8 +5,21 @@
 #include "game.h"
 #include "map.h"
 
-void a_star(const Map *map, const SDL_Point *start, const SDL_Point *end, SDL_Point **path, int *length);
-void reverse_a_star(const Map *map, const SDL_Point *start, const SDL_Point *place_to_flee, const int max_distance, SDL_Point **path, int *length);
-void dbg_draw_a_star(SDL_Renderer *renderer, const SDL_Point *path, const int length, SDL_Point cam_offset);
+#define A_STAR_MAX_PATH 64 // The maze is 53 steps across, longer paths are cut short
+
+typedef struct PathNode {
+	Sint16 x; // Generated mazes go past 127 tiles
+	Sint16 y;
+} PathNode;
+
+// Paths are written to a caller buffer of A_STAR_MAX_PATH nodes, left untouched when the end can't be reached.
+// Both return the nodes expanded
+int a_star(const Map *map, const SDL_Point *start, const SDL_Point *end, PathNode *path, int *length);
+int reverse_a_star(const Map *map, const SDL_Point *start, const SDL_Point *place_to_flee, const int max_distance, PathNode *path, int *length);
+// Nodes every search on the calling thread expanded so far
+Uint64 a_star_get_expanded();
+// Releases the calling thread's grid for maps bigger than the shipped one, if it grew one
+void a_star_free_scratch();
+void dbg_draw_a_star(SDL_Renderer *renderer, const PathNode *path, const int length, SDL_Point cam_offset);
 
 #endif
\ No newline at end of file
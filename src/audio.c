@@ -0,0 +1,323 @@
+#include "audio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "debug.h"
+#include "pack.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AUDIO_SSE2
+#include <emmintrin.h>
+#endif
+
+#define FRAME_BYTES (AUDIO_CHANNELS * sizeof(Sint16))
+#define QUEUE_MASK (AUDIO_QUEUE_SIZE - 1)
+
+struct AudioSound {
+	Sint16 *samples; // Interleaved, frame_count * AUDIO_CHANNELS
+	int frame_count;
+};
+
+typedef struct AudioCommand {
+	const AudioSound *sound; // NULL stops the voice
+	int voice;
+	Uint64 trigger_time; // Performance counter
+} AudioCommand;
+
+typedef struct Voice {
+	const AudioSound *sound; // NULL when idle
+	int position; // In frames
+} Voice;
+
+static struct {
+	SDL_AudioDeviceID device;
+	int buffer_frames;
+
+	// Written by the game thread up to head, read by the callback up to tail
+	AudioCommand queue[AUDIO_QUEUE_SIZE];
+	SDL_atomic_t head;
+	SDL_atomic_t tail;
+	int dropped; // Game thread only
+
+	// Callback only, read under SDL_LockAudioDevice
+	Voice voices[AUDIO_MAX_VOICES];
+	int callbacks;
+	int triggers;
+	int voices_stolen;
+	Uint64 latency_sum;
+	Uint64 latency_max;
+	Uint64 callback_sum;
+} audio;
+
+/*
+ * CALLBACK
+ */
+
+// dst += src with saturation, count samples
+static void mix_samples(Sint16 *dst, const Sint16 *src, int count) {
+	int i = 0;
+#ifdef AUDIO_SSE2
+	for (; i + 8 <= count; i += 8) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_adds_epi16(a, b));
+	}
+#endif
+	for (; i < count; i++) {
+		int sum = dst[i] + src[i];
+		dst[i] = (Sint16)SDL_clamp(sum, -32768, 32767);
+	}
+}
+
+static int pick_voice() {
+	int oldest = AUDIO_RESERVED_VOICES;
+	for (int i = AUDIO_RESERVED_VOICES; i < AUDIO_MAX_VOICES; i++) {
+		if (audio.voices[i].sound == NULL)
+			return i;
+		if (audio.voices[i].position > audio.voices[oldest].position)
+			oldest = i;
+	}
+	audio.voices_stolen++;
+	return oldest;
+}
+
+static void drain_commands(Uint64 now) {
+	int tail = SDL_AtomicGet(&audio.tail);
+	int head = SDL_AtomicGet(&audio.head);
+	SDL_MemoryBarrierAcquire();
+	for (; tail != head; tail++) {
+		const AudioCommand *command = &audio.queue[tail & QUEUE_MASK];
+		// Sounds freed while queued are cleared to NULL, those only stop a voice they named
+		if (command->sound != NULL || command->voice != AUDIO_ANY_VOICE) {
+			int voice = command->voice == AUDIO_ANY_VOICE ? pick_voice() : command->voice;
+			audio.voices[voice].sound = command->sound;
+			audio.voices[voice].position = 0;
+		}
+
+		Uint64 latency = now - command->trigger_time;
+		audio.latency_sum += latency;
+		audio.latency_max = SDL_max(audio.latency_max, latency);
+		audio.triggers++;
+	}
+	SDL_AtomicSet(&audio.tail, tail);
+}
+
+static void SDLCALL mix(void *userdata, Uint8 *stream, int length) {
+	(void)userdata;
+	Uint64 start = SDL_GetPerformanceCounter();
+	drain_commands(start);
+
+	Sint16 *out = (Sint16 *)stream;
+	int frames = length / FRAME_BYTES;
+	SDL_memset(stream, 0, length);
+	for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+		Voice *voice = &audio.voices[i];
+		if (voice->sound == NULL)
+			continue;
+		int count = SDL_min(frames, voice->sound->frame_count - voice->position);
+		mix_samples(out, voice->sound->samples + voice->position * AUDIO_CHANNELS, count * AUDIO_CHANNELS);
+		voice->position += count;
+		if (voice->position >= voice->sound->frame_count)
+			voice->sound = NULL;
+	}
+
+	audio.callbacks++;
+	audio.callback_sum += SDL_GetPerformanceCounter() - start;
+}
+
+/*
+ * GAME THREAD
+ */
+
+void audio_default_options(AudioOptions *options) {
+	options->buffer_frames = AUDIO_DEFAULT_BUFFER_FRAMES;
+}
+
+bool audio_open(const AudioOptions *options) {
+	SDL_zero(audio);
+	audio.buffer_frames = options->buffer_frames;
+
+	SDL_AudioSpec desired;
+	SDL_zero(desired);
+	desired.freq = AUDIO_FREQUENCY;
+	desired.format = AUDIO_FORMAT;
+	desired.channels = AUDIO_CHANNELS;
+	desired.samples = (Uint16)options->buffer_frames;
+	desired.callback = mix;
+
+	// No changes allowed, SDL converts behind the callback if the hardware wants something else
+	audio.device = SDL_OpenAudioDevice(NULL, 0, &desired, NULL, 0);
+	if (audio.device == 0) {
+		SDL_Log("Unable to open audio: %s", SDL_GetError());
+		return false;
+	}
+	SDL_PauseAudioDevice(audio.device, 0);
+	return true;
+}
+
+void audio_close() {
+	if (audio.device != 0)
+		SDL_CloseAudioDevice(audio.device);
+	audio.device = 0;
+}
+
+AudioSound *audio_load_sound(const char *name) {
+	SDL_RWops *rw = pack_open_rw(name);
+	if (rw == NULL)
+		return NULL;
+
+	SDL_AudioSpec spec;
+	Uint8 *buffer;
+	Uint32 length;
+	if (SDL_LoadWAV_RW(rw, 1, &spec, &buffer, &length) == NULL) {
+		SDL_Log("Unable to load %s: %s", name, SDL_GetError());
+		return NULL;
+	}
+
+	SDL_AudioCVT cvt;
+	if (SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq, AUDIO_FORMAT, AUDIO_CHANNELS, AUDIO_FREQUENCY) < 0) {
+		SDL_Log("Unable to convert %s: %s", name, SDL_GetError());
+		SDL_FreeWAV(buffer);
+		return NULL;
+	}
+	cvt.len = length;
+	cvt.buf = malloc(length * cvt.len_mult);
+	SDL_memcpy(cvt.buf, buffer, length);
+	SDL_FreeWAV(buffer);
+	SDL_ConvertAudio(&cvt);
+
+	AudioSound *sound = malloc(sizeof(AudioSound));
+	sound->samples = (Sint16 *)cvt.buf;
+	sound->frame_count = cvt.len_cvt / FRAME_BYTES;
+	return sound;
+}
+
+AudioSound *audio_create_sound(const Sint16 *frames, const int frame_count) {
+	AudioSound *sound = malloc(sizeof(AudioSound));
+	sound->samples = malloc(frame_count * FRAME_BYTES);
+	SDL_memcpy(sound->samples, frames, frame_count * FRAME_BYTES);
+	sound->frame_count = frame_count;
+	return sound;
+}
+
+void audio_free_sound(AudioSound *sound) {
+	if (sound == NULL)
+		return;
+
+	// The callback runs under the device lock, nothing can pick the sound up meanwhile
+	if (audio.device != 0) {
+		SDL_LockAudioDevice(audio.device);
+		for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+			if (audio.voices[i].sound == sound)
+				audio.voices[i].sound = NULL;
+		}
+		int head = SDL_AtomicGet(&audio.head);
+		for (int i = SDL_AtomicGet(&audio.tail); i != head; i++) {
+			if (audio.queue[i & QUEUE_MASK].sound == sound)
+				audio.queue[i & QUEUE_MASK].sound = NULL;
+		}
+		SDL_UnlockAudioDevice(audio.device);
+	}
+	free(sound->samples);
+	free(sound);
+}
+
+void audio_play(const AudioSound *sound, const int voice) {
+	if (audio.device == 0 || sound == NULL)
+		return;
+
+	int head = SDL_AtomicGet(&audio.head);
+	if (head - SDL_AtomicGet(&audio.tail) >= AUDIO_QUEUE_SIZE) {
+		audio.dropped++;
+		return;
+	}
+	AudioCommand *command = &audio.queue[head & QUEUE_MASK];
+	command->sound = sound;
+	command->voice = voice;
+	command->trigger_time = SDL_GetPerformanceCounter();
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&audio.head, head + 1);
+}
+
+AudioStats audio_get_stats() {
+	AudioStats stats;
+	SDL_zero(stats);
+	stats.buffer_frames = audio.buffer_frames;
+	stats.dropped = audio.dropped;
+	if (audio.device == 0)
+		return stats;
+
+	SDL_LockAudioDevice(audio.device);
+	double to_ms = 1000.0 / SDL_GetPerformanceFrequency();
+	stats.callbacks = audio.callbacks;
+	stats.triggers = audio.triggers;
+	stats.voices_stolen = audio.voices_stolen;
+	stats.mean_latency_ms = audio.triggers > 0 ? audio.latency_sum * to_ms / audio.triggers : 0.0;
+	stats.max_latency_ms = audio.latency_max * to_ms;
+	stats.mean_callback_ms = audio.callbacks > 0 ? audio.callback_sum * to_ms / audio.callbacks : 0.0;
+	SDL_UnlockAudioDevice(audio.device);
+	return stats;
+}
+
+void audio_log_stats(const AudioStats *stats) {
+	double buffer_ms = stats->buffer_frames * 1000.0 / AUDIO_FREQUENCY;
+	SDL_Log("Audio: %d frame buffers (%.1fms), %d sounds, %d dropped, %d voices stolen",
+			stats->buffer_frames, buffer_ms, stats->triggers, stats->dropped, stats->voices_stolen);
+	SDL_Log("Audio latency: trigger to callback %.2fms mean, %.2fms worst, heard one buffer later. Mixing %.3fms per callback",
+			stats->mean_latency_ms, stats->max_latency_ms, stats->mean_callback_ms);
+}
+
+/*
+ * BENCHMARK
+ */
+
+int audio_bench_run() {
+	static const int buffer_sizes[] = { 256, 512, 1024, 4096 };
+	const int triggers = 100;
+	const int interval_ms = 7; // Not a multiple of any buffer length
+
+	// A 50ms beep, only the timing matters
+	const int frame_count = AUDIO_FREQUENCY / 20;
+	Sint16 *frames = malloc(frame_count * FRAME_BYTES);
+	for (int i = 0; i < frame_count; i++) {
+		Sint16 sample = (Sint16)(8000.0 * SDL_sin(2.0 * M_PI * 880.0 * i / AUDIO_FREQUENCY));
+		frames[i * 2] = sample;
+		frames[i * 2 + 1] = sample;
+	}
+	AudioSound *beep = audio_create_sound(frames, frame_count);
+	free(frames);
+
+	printf("%d sounds every %dms per buffer size\n", triggers, interval_ms);
+	printf("%8s %10s %14s %14s %12s %10s\n", "frames", "buffer ms", "mean latency", "worst latency", "mix ms", "callbacks");
+	int exit_code = 0;
+	for (int i = 0; i < (int)SDL_arraysize(buffer_sizes); i++) {
+		AudioOptions options = { buffer_sizes[i] };
+		if (!audio_open(&options)) {
+			exit_code = 1;
+			break;
+		}
+		if (i == 0)
+			printf("Driver: %s\n", SDL_GetCurrentAudioDriver());
+
+		for (int t = 0; t < triggers; t++) {
+			audio_play(beep, AUDIO_ANY_VOICE);
+			SDL_Delay(interval_ms);
+		}
+		// Lets the last commands reach a callback
+		double buffer_ms = options.buffer_frames * 1000.0 / AUDIO_FREQUENCY;
+		SDL_Delay((Uint32)(buffer_ms * 2) + 10);
+
+		AudioStats stats = audio_get_stats();
+		audio_close();
+		printf("%8d %10.1f %14.2f %14.2f %12.4f %10d\n", options.buffer_frames, buffer_ms, stats.mean_latency_ms,
+				stats.max_latency_ms, stats.mean_callback_ms, stats.callbacks);
+		if (stats.triggers != triggers) {
+			printf("Only %d of %d sounds reached the callback\n", stats.triggers, triggers);
+			exit_code = 1;
+		}
+	}
+
+	audio_free_sound(beep);
+	return exit_code;
+}
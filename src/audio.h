@@ -0,0 +1,66 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include "SDL2/SDL.h"
+
+#include "utils.h"
+
+/*
+ * Low latency sound effects. Sounds are converted to the device format once at load time. The
+ * game thread pushes play commands into a single producer, single consumer ring that the SDL
+ * audio callback drains at the start of every buffer before mixing the active voices. Nothing
+ * on the game thread waits on the audio thread.
+ *
+ * Every command is stamped when it's pushed and the callback measures how long it waited, that
+ * plus one buffer is what the player hears. Runs under any SDL audio driver, SDL_AUDIODRIVER=disk
+ * or dummy included.
+ */
+
+#define AUDIO_FREQUENCY 44100
+#define AUDIO_CHANNELS 2
+#define AUDIO_FORMAT AUDIO_S16SYS
+#define AUDIO_DEFAULT_BUFFER_FRAMES 512 // ~12ms at 44.1kHz
+#define AUDIO_MAX_VOICES 16
+#define AUDIO_RESERVED_VOICES 4 // Only played on when asked for by number, AUDIO_ANY_VOICE picks from the others
+#define AUDIO_ANY_VOICE -1
+#define AUDIO_QUEUE_SIZE 64 // A power of two
+
+struct AudioSound;
+typedef struct AudioSound AudioSound;
+
+typedef struct AudioOptions {
+	int buffer_frames; // Per callback
+} AudioOptions;
+
+typedef struct AudioStats {
+	int buffer_frames;
+	int callbacks;
+	int triggers; // Commands the callback picked up
+	int dropped; // Commands lost to a full queue
+	int voices_stolen; // AUDIO_ANY_VOICE with every voice busy
+	double mean_latency_ms; // From audio_play() to the callback that starts the sound
+	double max_latency_ms;
+	double mean_callback_ms; // Time spent mixing
+} AudioStats;
+
+void audio_default_options(AudioOptions *options);
+// Plays silence when the device can't be opened, audio_play() then does nothing
+bool audio_open(const AudioOptions *options);
+void audio_close();
+
+// A WAV from the pack, converted to the device format
+AudioSound *audio_load_sound(const char *name);
+// Interleaved stereo frames in the device format, copied
+AudioSound *audio_create_sound(const Sint16 *frames, const int frame_count);
+void audio_free_sound(AudioSound *sound);
+
+// Starts sound from the beginning on voice, replacing whatever it played. One thread only, the main thread for the game
+void audio_play(const AudioSound *sound, const int voice);
+
+AudioStats audio_get_stats();
+void audio_log_stats(const AudioStats *stats);
+
+// Measures trigger to callback latency for a few buffer sizes, returns the exit code
+int audio_bench_run();
+
+#endif
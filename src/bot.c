@@ -0,0 +1,179 @@
+#include "bot.h"
+
+#include "ghost.h"
+#include "map.h"
+#include "player.h"
+
+static const SDL_Point direction_offsets[4] = {
+	[EAST] = { 1, 0 },
+	[SOUTH] = { 0, 1 },
+	[WEST] = { -1, 0 },
+	[NORTH] = { 0, -1 },
+};
+
+Uint32 bot_random(Uint32 *state) {
+	// xorshift32, zero is a fixed point
+	Uint32 x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+void bot_init(Bot *this, Uint32 seed, float randomness) {
+	this->rng_state = seed != 0 ? seed : 0x9E3779B9;
+	this->randomness = randomness;
+	this->last_tile.x = -1;
+	this->last_tile.y = -1;
+	this->think_timer = 0;
+	this->direction = WEST;
+}
+
+static SDL_Point step(SDL_Point tile, Direction direction) {
+	tile.x += direction_offsets[direction].x;
+	tile.y += direction_offsets[direction].y;
+	// The tunnel wraps around horizontally
+	if (tile.x < 0)
+		tile.x = MAP_WIDTH - 1;
+	else if (tile.x >= MAP_WIDTH)
+		tile.x = 0;
+	return tile;
+}
+
+static bool is_open(const Map *map, SDL_Point tile) {
+	return !map_get_collision(map, tile.x, tile.y, COLLISION_PLAYER);
+}
+
+static void mark_danger(Game *game, bool *danger) {
+	SDL_memset(danger, 0, MAP_SIZE * sizeof(bool));
+	if (game_is_powered_up(game))
+		return;
+
+	for (int i = 0; i < GHOST_AMT; i++) {
+		Ghost *ghost = game_get_ghost(game, i);
+		GhostState state = ghost_get_state(ghost);
+		if (state != ATTACKING && state != WAITING)
+			continue;
+		const FixedPoint *pos = ghost_get_pos(ghost);
+		int gx = FIXED_TO_INT(pos->x + FIXED_HALF);
+		int gy = FIXED_TO_INT(pos->y + FIXED_HALF);
+		for (int y = gy - BOT_DANGER_RADIUS; y <= gy + BOT_DANGER_RADIUS; y++) {
+			for (int x = gx - BOT_DANGER_RADIUS; x <= gx + BOT_DANGER_RADIUS; x++) {
+				if (x >= 0 && x < MAP_WIDTH && y >= 0 && y < MAP_HEIGHT && SDL_abs(x - gx) + SDL_abs(y - gy) <= BOT_DANGER_RADIUS)
+					danger[x + y * MAP_WIDTH] = true;
+			}
+		}
+	}
+}
+
+// First direction of the shortest path to the nearest pellet, NONE when nothing is reachable
+static Direction plan(Game *game, SDL_Point start, const bool *danger, int *distance) {
+	const Map *map = game_get_map(game);
+	Sint16 queue[MAP_SIZE];
+	Sint8 first_direction[MAP_SIZE];
+	Sint16 steps[MAP_SIZE];
+	SDL_memset(first_direction, -1, sizeof(first_direction));
+
+	int head = 0;
+	int tail = 0;
+	int start_index = start.x + start.y * MAP_WIDTH;
+	first_direction[start_index] = NONE;
+	steps[start_index] = 0;
+	queue[tail++] = start_index;
+
+	while (head < tail) {
+		int index = queue[head++];
+		SDL_Point tile = { index % MAP_WIDTH, index / MAP_WIDTH };
+		Tile content = map_get_tile(map, tile.x, tile.y);
+		if (index != start_index && (content == PAC || content == POWERUP)) {
+			if (distance != NULL)
+				*distance = steps[index];
+			return (Direction)first_direction[index];
+		}
+
+		for (int d = 0; d < 4; d++) {
+			SDL_Point next = step(tile, d);
+			int next_index = next.x + next.y * MAP_WIDTH;
+			if (first_direction[next_index] != -1 || !is_open(map, next) || danger[next_index])
+				continue;
+			first_direction[next_index] = index == start_index ? d : first_direction[index];
+			steps[next_index] = steps[index] + 1;
+			queue[tail++] = next_index;
+		}
+	}
+	if (distance != NULL)
+		*distance = -1;
+	return NONE;
+}
+
+bool bot_get_player_tile(Game *game, SDL_Point *tile) {
+	const FixedPoint *pos = player_get_pos(game_get_player(game));
+	tile->x = FIXED_TO_INT(pos->x + FIXED_HALF);
+	tile->y = FIXED_TO_INT(pos->y + FIXED_HALF);
+	return tile->x >= 0 && tile->x < MAP_WIDTH && tile->y >= 0 && tile->y < MAP_HEIGHT;
+}
+
+int bot_get_open_directions(Game *game, Direction *directions) {
+	SDL_Point tile;
+	if (!bot_get_player_tile(game, &tile))
+		return 0;
+	const Map *map = game_get_map(game);
+	int count = 0;
+	for (int d = 0; d < 4; d++) {
+		if (is_open(map, step(tile, d)))
+			directions[count++] = d;
+	}
+	return count;
+}
+
+int bot_get_pellet_distance(Game *game) {
+	SDL_Point tile;
+	if (!bot_get_player_tile(game, &tile))
+		return -1;
+	bool danger[MAP_SIZE];
+	SDL_memset(danger, 0, sizeof(danger));
+	int distance;
+	plan(game, tile, danger, &distance);
+	return distance;
+}
+
+void bot_update(Bot *this, Game *game) {
+	// Nothing to steer, and thinking would draw random numbers that fast forwarding skips
+	if (!game_is_in_play(game))
+		return;
+	SDL_Point tile;
+	if (!bot_get_player_tile(game, &tile))
+		return;
+
+	// Decisions are only worth revisiting on a new tile, or when stuck for a while
+	if (SDL_Point_Equals(&tile, &this->last_tile) && --this->think_timer > 0)
+		return;
+	this->last_tile = tile;
+	this->think_timer = BOT_THINK_INTERVAL;
+
+	Direction direction = NONE;
+
+	if (this->randomness > 0.0f && (bot_random(&this->rng_state) & 0xFFFF) < this->randomness * 0x10000) {
+		Direction open[4];
+		int open_count = bot_get_open_directions(game, open);
+		if (open_count > 0)
+			direction = open[bot_random(&this->rng_state) % open_count];
+	}
+
+	if (direction == NONE) {
+		bool danger[MAP_SIZE];
+		mark_danger(game, danger);
+		direction = plan(game, tile, danger, NULL);
+		// Cornered, go for the pellets anyway
+		if (direction == NONE) {
+			SDL_memset(danger, 0, sizeof(danger));
+			direction = plan(game, tile, danger, NULL);
+		}
+	}
+
+	if (direction != NONE) {
+		this->direction = direction;
+		game_set_player_direction(game, direction);
+	}
+}
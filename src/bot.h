@@ -0,0 +1,36 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include "SDL2/SDL.h"
+
+#include "game.h"
+#include "utils.h"
+
+/*
+ * Scripted player for headless games. Walks a breadth first search toward the nearest pellet
+ * and treats tiles next to dangerous ghosts as walls. Seeded, so a game replays identically.
+ */
+
+#define BOT_DANGER_RADIUS 2
+#define BOT_THINK_INTERVAL 8 // Ticks between decisions on the same tile
+
+typedef struct Bot {
+	Uint32 rng_state;
+	float randomness; // Chance of picking a random open direction instead of the planned one
+	SDL_Point last_tile;
+	int think_timer;
+	Direction direction;
+} Bot;
+
+void bot_init(Bot *bot, Uint32 seed, float randomness);
+// Call before every game_update(), does nothing while the player can't steer
+void bot_update(Bot *bot, Game *game);
+
+Uint32 bot_random(Uint32 *state);
+// Tile helpers shared with the search based autopilot
+bool bot_get_player_tile(Game *game, SDL_Point *tile);
+int bot_get_open_directions(Game *game, Direction *directions);
+// Steps to the nearest pellet, -1 when none is reachable
+int bot_get_pellet_distance(Game *game);
+
+#endif
@@ -0,0 +1,115 @@
+#include "brain_host.h"
+
+#include <stdlib.h>
+
+#include "debug.h"
+
+struct BrainPlugin {
+	void *object;
+	const GhostBrain *brain;
+	char path[256];
+
+	SDL_SpinLock lock; // Slots of games on other threads detach concurrently
+	BrainStats stats;
+};
+
+BrainPlugin *brain_load(const char *path) {
+	void *object = SDL_LoadObject(path);
+	if (object == NULL) {
+		SDL_Log("Unable to load brain %s: %s", path, SDL_GetError());
+		return NULL;
+	}
+	GhostBrainEntry entry = (GhostBrainEntry)SDL_LoadFunction(object, GHOST_BRAIN_ENTRY);
+	const GhostBrain *brain = entry != NULL ? entry() : NULL;
+	if (brain == NULL || brain->think == NULL) {
+		SDL_Log("%s exports no %s", path, GHOST_BRAIN_ENTRY);
+		SDL_UnloadObject(object);
+		return NULL;
+	}
+	if (brain->abi_version != GHOST_BRAIN_ABI_VERSION) {
+		SDL_Log("%s was built for brain ABI %d, the game speaks %d", path, brain->abi_version, GHOST_BRAIN_ABI_VERSION);
+		SDL_UnloadObject(object);
+		return NULL;
+	}
+
+	BrainPlugin *this = calloc(1, sizeof(BrainPlugin));
+	this->object = object;
+	this->brain = brain;
+	SDL_strlcpy(this->path, path, sizeof(this->path));
+	return this;
+}
+
+void brain_unload(BrainPlugin *this) {
+	SDL_UnloadObject(this->object);
+	free(this);
+}
+
+const char *brain_get_name(const BrainPlugin *this) {
+	return this->brain->name != NULL ? this->brain->name : this->path;
+}
+
+BrainStats brain_get_stats(BrainPlugin *this) {
+	SDL_AtomicLock(&this->lock);
+	BrainStats stats = this->stats;
+	SDL_AtomicUnlock(&this->lock);
+	return stats;
+}
+
+void brain_log_stats(BrainPlugin *this) {
+	BrainStats stats = brain_get_stats(this);
+	if (stats.calls == 0) {
+		SDL_Log("Brain %s: never asked", brain_get_name(this));
+		return;
+	}
+	SDL_Log("Brain %s: %llu calls, mean %.2fus, max %.2fus, %d over budget, %d ticks on the built-in brain", brain_get_name(this),
+			(unsigned long long)stats.calls, stats.total_us / stats.calls, stats.max_us, stats.overruns, stats.fallback_ticks);
+}
+
+void brain_attach(BrainSlot *slot, BrainPlugin *plugin, const int ghost) {
+	SDL_zero(*slot);
+	slot->plugin = plugin;
+	if (plugin != NULL && plugin->brain->create != NULL)
+		slot->state = plugin->brain->create(ghost);
+}
+
+void brain_detach(BrainSlot *slot) {
+	BrainPlugin *plugin = slot->plugin;
+	if (plugin == NULL)
+		return;
+	if (plugin->brain->destroy != NULL)
+		plugin->brain->destroy(slot->state);
+
+	SDL_AtomicLock(&plugin->lock);
+	plugin->stats.calls += slot->stats.calls;
+	plugin->stats.total_us += slot->stats.total_us;
+	plugin->stats.max_us = SDL_max(plugin->stats.max_us, slot->stats.max_us);
+	plugin->stats.overruns += slot->stats.overruns;
+	plugin->stats.fallback_ticks += slot->stats.fallback_ticks;
+	SDL_AtomicUnlock(&plugin->lock);
+	SDL_zero(*slot);
+}
+
+bool brain_think(BrainSlot *slot, const GhostBrainView *view, const int budget_us, Direction *direction) {
+	if (slot->bench_ticks > 0) {
+		slot->bench_ticks--;
+		slot->stats.fallback_ticks++;
+		return false;
+	}
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	Sint32 answer = slot->plugin->brain->think(slot->state, view);
+	double us = (SDL_GetPerformanceCounter() - start) * 1000000.0 / SDL_GetPerformanceFrequency();
+
+	slot->stats.calls++;
+	slot->stats.total_us += us;
+	slot->stats.max_us = SDL_max(slot->stats.max_us, us);
+	if (us > budget_us) {
+		slot->stats.overruns++;
+		slot->stats.fallback_ticks++;
+		slot->bench_ticks = BRAIN_BENCH_TICKS;
+		return false;
+	}
+	// Anything out of range keeps going too
+	*direction = answer >= GHOST_BRAIN_EAST && answer <= GHOST_BRAIN_NORTH ? (Direction)answer : NONE;
+	return true;
+}
@@ -0,0 +1,55 @@
+#ifndef BRAIN_HOST_H
+#define BRAIN_HOST_H
+
+#include "SDL2/SDL.h"
+
+#include "ghost_brain.h"
+#include "utils.h"
+
+/*
+ * Loads ghost brain plugins (see src/ghost_brain.h) and runs them on a time budget. Every
+ * think() call is timed. A call over the budget can't be interrupted, but its answer is
+ * dropped and the ghost goes back to the built-in brain for BRAIN_BENCH_TICKS ticks, so a
+ * slow brain costs at most one late call per bench period.
+ *
+ * The budget makes a game with plugin brains depend on the machine's speed: it doesn't replay
+ * and can't be used for netplay.
+ */
+
+#define BRAIN_DEFAULT_BUDGET_US 200 // Per ghost per tick
+#define BRAIN_BENCH_TICKS 60
+
+typedef struct BrainStats {
+	Uint64 calls;
+	double total_us;
+	double max_us;
+	int overruns; // Calls over the budget
+	int fallback_ticks; // Spent on the built-in brain afterwards
+} BrainStats;
+
+struct BrainPlugin;
+typedef struct BrainPlugin BrainPlugin;
+
+// One ghost of one game driven by a plugin
+typedef struct BrainSlot {
+	BrainPlugin *plugin; // NULL for the built-in brain
+	void *state;
+	int bench_ticks;
+	BrainStats stats; // Merged into the plugin's when detached
+} BrainSlot;
+
+// NULL, after logging why, when the file can't be loaded or doesn't match GHOST_BRAIN_ABI_VERSION
+BrainPlugin *brain_load(const char *path);
+// After every slot using it was detached
+void brain_unload(BrainPlugin *plugin);
+const char *brain_get_name(const BrainPlugin *plugin);
+// Every slot detached so far
+BrainStats brain_get_stats(BrainPlugin *plugin);
+void brain_log_stats(BrainPlugin *plugin);
+
+void brain_attach(BrainSlot *slot, BrainPlugin *plugin, const int ghost);
+void brain_detach(BrainSlot *slot);
+// False when the built-in brain steers this tick, benched or over budget
+bool brain_think(BrainSlot *slot, const GhostBrainView *view, const int budget_us, Direction *direction);
+
+#endif
@@ -2,6 +2,10 @@
 
 #include <stdio.h>
 
+#include "SDL2/SDL.h"
+
+#include "utils.h"
+
 #undef malloc
 #undef calloc
 #undef realloc
@@ -21,8 +25,13 @@ typedef struct MemoryLeak {
 
 static MemoryLeak *array_start = NULL;
 static MemoryLeak *array_end = NULL;
+static SDL_atomic_t allocation_count; // Read without the lock
+static THREAD_LOCAL unsigned int thread_allocation_count;
+static SDL_SpinLock lock = 0; // Headless runs allocate from several threads
 
 static void add_memory_info(void *ptr, size_t size, char *filename, int line) {
+	SDL_AtomicAdd(&allocation_count, 1);
+	thread_allocation_count++;
 	MemoryLeak *leak = (MemoryLeak *)malloc(sizeof(MemoryLeak));
 
 	leak->info.ptr = ptr;
@@ -83,7 +92,9 @@ static void clear_array() {
 void *DBG_malloc(size_t size, char *filename, int line) {
 	void *ptr = malloc(size);
 	if (ptr != NULL) {
+		SDL_AtomicLock(&lock);
 		add_memory_info(ptr, size, filename, line);
+		SDL_AtomicUnlock(&lock);
 	}
 	return ptr;
 }
@@ -91,7 +102,9 @@ void *DBG_malloc(size_t size, char *filename, int line) {
 void *DBG_calloc(size_t num, size_t size, char *filename, int line) {
 	void *ptr = calloc(num, size);
 	if (ptr != NULL) {
+		SDL_AtomicLock(&lock);
 		add_memory_info(ptr, num * size, filename, line);
+		SDL_AtomicUnlock(&lock);
 	}
 	return ptr;
 }
@@ -99,16 +112,22 @@ void *DBG_calloc(size_t num, size_t size, char *filename, int line) {
 void *DBG_realloc(void *ptr, size_t new_size, char *filename, int line) {
 	void *new_ptr = realloc(ptr, new_size);
 	if (new_ptr != NULL) {
+		SDL_AtomicLock(&lock);
 		if (ptr != NULL)
 			delete_memory_info(ptr);
 
 		add_memory_info(new_ptr, new_size, filename, line);
+		SDL_AtomicUnlock(&lock);
 	}
 	return new_ptr;
 }
 
 void DBG_free(void *ptr) {
+	if (ptr == NULL)
+		return;
+	SDL_AtomicLock(&lock);
 	delete_memory_info(ptr);
+	SDL_AtomicUnlock(&lock);
 	free(ptr);
 }
 
@@ -128,3 +147,11 @@ void DBG_dump_memory_leaks() {
 	printf("==================================================================\n\n");
 	clear_array();
 }
+
+unsigned int DBG_allocation_count() {
+	return (unsigned int)SDL_AtomicGet(&allocation_count);
+}
+
+unsigned int DBG_thread_allocation_count() {
+	return thread_allocation_count;
+}
@@ -8,6 +8,10 @@ void *DBG_calloc(size_t num, size_t size, char *filename, int line);
 void *DBG_realloc(void *ptr, size_t new_size, char *filename, int line);
 void DBG_free(void *ptr);
 void DBG_dump_memory_leaks();
+// Wraps, only differences are meaningful
+unsigned int DBG_allocation_count();
+// The calling thread's allocations only, wraps too
+unsigned int DBG_thread_allocation_count();
 
 #define malloc(size) DBG_malloc(size, __FILE__, __LINE__)
 #define calloc(num, size) DBG_calloc(num, size, __FILE__, __LINE__)
@@ -0,0 +1,78 @@
+#include "event_bus.h"
+
+#include <stdlib.h>
+
+#include "debug.h"
+
+// Sequence 2n + 1 while event n is written into the slot, 2n + 2 once it's published
+typedef struct EventSlot {
+	SDL_atomic_t sequence;
+	GameEvent event;
+} EventSlot;
+
+struct EventBus {
+	EventSlot *slots;
+	Uint32 mask;
+	SDL_atomic_t head; // Next event to claim
+};
+
+EventBus *event_bus_create(int size) {
+	Uint32 capacity = 2;
+	while (capacity < (Uint32)size) {
+		capacity *= 2;
+	}
+	EventBus *this = calloc(1, sizeof(EventBus));
+	this->slots = calloc(capacity, sizeof(EventSlot));
+	this->mask = capacity - 1;
+	return this;
+}
+
+void event_bus_destroy(EventBus *this) {
+	free(this->slots);
+	free(this);
+}
+
+void event_bus_publish(EventBus *this, const GameEvent *event) {
+	Uint32 n = (Uint32)SDL_AtomicAdd(&this->head, 1);
+	EventSlot *slot = &this->slots[n & this->mask];
+	SDL_AtomicSet(&slot->sequence, (int)(2 * n + 1));
+	slot->event = *event;
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&slot->sequence, (int)(2 * n + 2));
+}
+
+void event_bus_subscribe(EventBus *this, EventCursor *cursor) {
+	cursor->next = (Uint32)SDL_AtomicGet(&this->head);
+	cursor->dropped = 0;
+}
+
+bool event_bus_poll(EventBus *this, EventCursor *cursor, GameEvent *event) {
+	for (;;) {
+		Uint32 n = cursor->next;
+		EventSlot *slot = &this->slots[n & this->mask];
+		Uint32 published = 2 * n + 2;
+		Sint32 ahead = (Sint32)((Uint32)SDL_AtomicGet(&slot->sequence) - published);
+		// Still the event a lap earlier, or being written
+		if (ahead < 0)
+			return false;
+		if (ahead == 0) {
+			GameEvent copy = slot->event;
+			SDL_MemoryBarrierAcquire();
+			if ((Uint32)SDL_AtomicGet(&slot->sequence) == published) {
+				*event = copy;
+				cursor->next++;
+				return true;
+			}
+		}
+
+		// Lapped, on to the oldest event the ring still holds
+		Uint32 oldest = (Uint32)SDL_AtomicGet(&this->head) - (this->mask + 1);
+		Uint32 skip = (Sint32)(oldest - n) > 0 ? oldest - n : 1;
+		cursor->next += skip;
+		cursor->dropped += skip;
+	}
+}
+
+Uint32 event_bus_get_published(EventBus *this) {
+	return (Uint32)SDL_AtomicGet(&this->head);
+}
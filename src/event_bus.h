@@ -0,0 +1,60 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include "SDL2/SDL.h"
+
+#include "utils.h"
+
+/*
+ * What happened in the game, for whoever wants to react to it: sound, logs, metrics, spectators.
+ * The simulation publishes typed events stamped with their tick into a fixed size ring and never
+ * waits or does I/O for them. Every consumer owns an EventCursor and reads every event at its own
+ * pace, on its own thread if it likes, so adding one doesn't touch the game.
+ *
+ * Any number of threads publish and poll without locks. Each slot carries a sequence number: a
+ * publisher claims the next one with an atomic add, marks the slot as being written, fills it and
+ * marks it published. A reader copies the slot and keeps the copy only if the sequence didn't move
+ * meanwhile. A consumer more than a ring behind loses the oldest events, counted in its cursor,
+ * rather than ever holding the simulation back.
+ */
+
+#define EVENT_BUS_DEFAULT_SIZE 1024 // A power of two
+
+enum GameEventType {
+	GAME_EVENT_PELLET_EATEN, // value: points scored
+	GAME_EVENT_POWER_UP,
+	GAME_EVENT_GHOST_EATEN, // value: points scored
+	GAME_EVENT_DEATH, // ghost: the one that caught the player
+	GAME_EVENT_LEVEL_CLEAR, // value: the level cleared
+	GAME_EVENT_EXTRA_LIFE, // value: lives now
+	GAME_EVENT_STATE_CHANGE, // value: the new state, named by game_state_name()
+	GAME_EVENT_TYPE_COUNT
+} typedef GameEventType;
+
+typedef struct GameEvent {
+	int tick;
+	GameEventType type;
+	int ghost; // -1 when no ghost is involved
+	int value;
+} GameEvent;
+
+// One consumer's place in the ring, owned by a single thread
+typedef struct EventCursor {
+	Uint32 next;
+	Uint32 dropped; // Events overwritten before this consumer got to them
+} EventCursor;
+
+struct EventBus;
+typedef struct EventBus EventBus;
+
+// size is rounded up to a power of two
+EventBus *event_bus_create(int size);
+void event_bus_destroy(EventBus *bus);
+void event_bus_publish(EventBus *bus, const GameEvent *event);
+// Events published from now on
+void event_bus_subscribe(EventBus *bus, EventCursor *cursor);
+// The next event in publishing order, false when the cursor caught up
+bool event_bus_poll(EventBus *bus, EventCursor *cursor, GameEvent *event);
+Uint32 event_bus_get_published(EventBus *bus);
+
+#endif
@@ -1,5 +1,13 @@
 #include "game.h"
 
+#include "audio.h"
+#include "brain_host.h"
+#include "event_bus.h"
+#include "mcts.h"
+#include "rollback.h"
+#include "soft_render.h"
+#include "spectate.h"
+
 /*
  * DECLARATIONS
  */
@@ -39,12 +47,36 @@ typedef struct GameState {
 	};
 } GameState;
 
+// Loaded once per window, headless games have none
+typedef struct GameAssets {
+	TTF_Font *font;
+	RenderQueue *render_queue;
+	SDL_Texture *player_texture;
+	SDL_Texture *ghost_texture; // Shared by every ghost so they batch together
+	SDL_Texture *walls_texture;
+	bool dirty_rects; // The render queue clears what it repaints
+	SoftRenderer *soft_renderer; // Draws instead of the renderer when set, not owned
+
+	AudioSound *intro_bgm;
+	AudioSound *death_sfx;
+	AudioSound *waka_sfx;
+} GameAssets;
+
+// Voices 0 and 1 restart their sound, the death jingle takes any free voice
+#define VOICE_WAKA 0
+#define VOICE_MUSIC 1
+
 typedef struct Game {
 	GameState state;
+	GameConfig config;
+	GameAssets *assets; // NULL when headless
+	EventBus *events; // Stays with the game like the assets, NULL publishes nothing
+	bool is_silent; // Publishes nothing, for resimulated ticks
+	int ticks;
+	int deaths_by_ghost[GHOST_AMT];
     
 	Player *player;
 	Map *map;
-	TTF_Font *font;
     
 	bool is_running;
     
@@ -58,24 +90,53 @@ typedef struct Game {
 	int pac_left;
     
 	bool is_powered_up;
-    
-	Mix_Music *intro_bgm;
-	Mix_Chunk *death_sfx;
-	Mix_Chunk *waka_sfx;
+
+	// Zobrist hash of the game state and the entities, kept up to date as they change. The map
+	// hashes its own pellets and the counters are folded in by game_get_hash()
+	Uint64 hash;
+	SDL_Point hashed_tiles[1 + GHOST_AMT]; // The player, then the ghosts
+	GhostState hashed_ghost_states[GHOST_AMT];
+
+	// Plugin brains stay with the game like the assets, game_copy() leaves them out
+	BrainSlot brains[GHOST_AMT];
+	Uint8 *brain_walls; // The maze as brains see it, built with the first one
+	int brain_budget_us;
     
 } Game;
 
 static void switch_state(Game *game, State new_state);
 static void init_level(Game *game);
+static void hash_entities(Game *game);
+
+static const char *state_names[] = {
+	[STATE_NEW_GAME] = "NEW_GAME",
+	[STATE_START_LEVEL] = "START",
+	[STATE_WAIT] = "WAIT",
+	[STATE_DEATH] = "DEATH",
+	[STATE_NORMAL] = "NORMAL",
+	[STATE_WIN] = "WIN",
+	[STATE_GAMEOVER] = "GAMEOVER",
+};
 
 /*
  *  UPDATE
  */
 
+// Sound, logs and metrics happen in whatever reads the bus, the tick itself only records what happened
+static void emit(Game *game, const GameEventType type, const int ghost, const int value) {
+	if (game->events == NULL || game->is_silent)
+		return;
+	GameEvent event = { game->ticks, type, ghost, value };
+	event_bus_publish(game->events, &event);
+}
+
 static void switch_state(Game *game, State new_state) {
-	game->state.state = new_state; 
+	game->hash ^= zobrist_key(ZOBRIST_GAME_STATE, 0, game->state.state) ^ zobrist_key(ZOBRIST_GAME_STATE, 0, new_state);
+	game->state.state = new_state;
+	emit(game, GAME_EVENT_STATE_CHANGE, -1, new_state);
 	switch (new_state) {
 		case STATE_NEW_GAME: {
+			game->level = 1;
 			game->score = 0;
 			game->new_life_pts = PTS_FOR_NEW_LIFE;
 			game->lives = STARTING_LIVES;
@@ -85,45 +146,40 @@ static void switch_state(Game *game, State new_state) {
 		} break;
         
 		case STATE_START_LEVEL: {
-			SDL_Log("State changed to START");
 			init_level(game);
-			Mix_PlayMusic(game->intro_bgm, 1);
 			switch_state(game, STATE_WAIT);
 		} break;
         
 		case STATE_WAIT: {
-			SDL_Log("State changed to WAIT");
 			game->state.wait_state_data.timer = 5500;
             
 			player_reset(game->player);
             
-			float ghost_speed = 2.0f + game->level * 0.5f;
+			float ghost_speed = game->config.ghost_base_speed + game->level * game->config.ghost_speed_per_level;
 			for (int i = 0; i < GHOST_AMT; i++) {
 				ghost_reset(game->ghosts[i], ghost_speed);
 			}
 			map_reset_color(game->map);
+			hash_entities(game);
 		} break;
         
 		case STATE_NORMAL: {
-			SDL_Log("State changed to NORMAL");
 			game->state.normal_state_data.blink_timer = 0;
 			game->state.normal_state_data.power_up_timer = 0;
 		} break;
         
 		case STATE_DEATH: {
 			game->state.kill_state_data.kill_timer = 2000;
-            Mix_PlayChannel(-1, game->death_sfx, 0);
 			player_kill(game->player);
 		} break;
         
 		case STATE_WIN: {
-			SDL_Log("WIN!");
+			emit(game, GAME_EVENT_LEVEL_CLEAR, -1, game->level);
 			game->level++;
 			switch_state(game, STATE_START_LEVEL);
 		} break;
         
 		case STATE_GAMEOVER: {
-			SDL_Log("GAMEOVER!");
 			//game->is_running = false;
 		}
 	}
@@ -142,20 +198,97 @@ static void input(SDL_Event *e, Game *game, Player *player) {
 	}
 }
 
-static bool intersect_sprites(const SDL_FPoint *a, const SDL_FPoint *b) {
-	if (a->x + 1.0f >= b->x && a->x + 1.0f <= b->x + 1.0f && a->y + 1.0f >= b->y && a->y + 1.0f <= b->y + 1.0f)
+static bool intersect_sprites(const FixedPoint *a, const FixedPoint *b) {
+	const Fixed one = FIXED_ONE;
+	if (a->x + one >= b->x && a->x + one <= b->x + one && a->y + one >= b->y && a->y + one <= b->y + one)
 		return true;
-	if (a->x + 1.0f <= b->x && a->x + 1.0f >= b->x + 1.0f && a->y >= b->y && a->y <= b->y + 1.0f)
+	if (a->x + one <= b->x && a->x + one >= b->x + one && a->y >= b->y && a->y <= b->y + one)
 		return true;
-	if (a->x >= b->x && a->x <= b->x + 1.0f && a->y >= b->y && a->y <= b->y + 1.0f)
+	if (a->x >= b->x && a->x <= b->x + one && a->y >= b->y && a->y <= b->y + one)
 		return true;
-	if (a->x >= b->x && a->x <= b->x + 1.0f && a->y + 1.0f >= b->y && a->y + 1.0f <= b->y + 1.0f)
+	if (a->x >= b->x && a->x <= b->x + one && a->y + one >= b->y && a->y + one <= b->y + one)
 		return true;
     
 	return false;
 }
 
+static SDL_Point entity_tile(Game *game, const int slot) {
+	const FixedPoint *pos = slot == 0 ? player_get_pos(game->player) : ghost_get_pos(game->ghosts[slot - 1]);
+	SDL_Point tile = { FIXED_TO_INT(pos->x + FIXED_HALF), FIXED_TO_INT(pos->y + FIXED_HALF) };
+	return tile;
+}
+
+// Swaps the keys of entities that crossed into another tile or changed state since the last call
+static void hash_entities(Game *game) {
+	for (int i = 0; i < 1 + GHOST_AMT; i++) {
+		SDL_Point tile = entity_tile(game, i);
+		if (!SDL_Point_Equals(&tile, &game->hashed_tiles[i])) {
+			SDL_Point *old = &game->hashed_tiles[i];
+			game->hash ^= zobrist_key(ZOBRIST_ENTITY_TILE, i, zobrist_tile(old->x, old->y)) ^ zobrist_key(ZOBRIST_ENTITY_TILE, i, zobrist_tile(tile.x, tile.y));
+			*old = tile;
+		}
+	}
+	for (int i = 0; i < GHOST_AMT; i++) {
+		GhostState state = ghost_get_state(game->ghosts[i]);
+		if (state != game->hashed_ghost_states[i]) {
+			game->hash ^= zobrist_key(ZOBRIST_GHOST_STATE, i, game->hashed_ghost_states[i]) ^ zobrist_key(ZOBRIST_GHOST_STATE, i, state);
+			game->hashed_ghost_states[i] = state;
+		}
+	}
+}
+
+// game->hash from scratch, what the incremental updates must always match
+static Uint64 compute_hash(Game *game) {
+	Uint64 hash = zobrist_key(ZOBRIST_GAME_STATE, 0, game->state.state);
+	for (int i = 0; i < 1 + GHOST_AMT; i++) {
+		SDL_Point tile = entity_tile(game, i);
+		hash ^= zobrist_key(ZOBRIST_ENTITY_TILE, i, zobrist_tile(tile.x, tile.y));
+	}
+	for (int i = 0; i < GHOST_AMT; i++) {
+		hash ^= zobrist_key(ZOBRIST_GHOST_STATE, i, ghost_get_state(game->ghosts[i]));
+	}
+	return hash;
+}
+
+static void fill_brain_entity(GhostBrainEntity *entity, const FixedPoint *pos, const Direction direction, const GhostState state) {
+	entity->x = pos->x;
+	entity->y = pos->y;
+	entity->direction = direction;
+	entity->state = state;
+}
+
+// Plugin brains pick the direction of the ghosts they steer, before the ghosts move
+static void think_brains(Game *game) {
+	GhostBrainView view;
+	SDL_zero(view);
+	view.size = sizeof(view);
+	view.width = map_get_width(game->map);
+	view.height = map_get_height(game->map);
+	view.walls = game->brain_walls;
+	view.tick = game->ticks;
+	view.level = game->level;
+	fill_brain_entity(&view.player, player_get_pos(game->player), player_get_direction(game->player), 0);
+	for (int i = 0; i < GHOST_AMT; i++) {
+		Ghost *ghost = game->ghosts[i];
+		fill_brain_entity(&view.ghosts[i], ghost_get_pos(ghost), ghost_get_direction(ghost), ghost_get_state(ghost));
+	}
+
+	for (int i = 0; i < GHOST_AMT; i++) {
+		BrainSlot *slot = &game->brains[i];
+		GhostState state = ghost_get_state(game->ghosts[i]);
+		if (slot->plugin == NULL || (state != ATTACKING && state != FLEEING))
+			continue;
+		view.self = i;
+		Direction direction = NONE;
+		bool is_steering = brain_think(slot, &view, game->brain_budget_us, &direction);
+		ghost_set_controlled(game->ghosts[i], is_steering);
+		ghost_set_input(game->ghosts[i], direction);
+	}
+}
+
 static void update(const int delta_time, Game *game) {
+	PROFILE_BEGIN("update");
+	game->ticks++;
 	switch (game->state.state) {
 		case STATE_WAIT: {
 			WaitStateData *data = &game->state.wait_state_data;
@@ -168,23 +301,27 @@ static void update(const int delta_time, Game *game) {
             
 		} break;
 		case STATE_NORMAL: {
+			if (game->brain_walls != NULL)
+				think_brains(game);
 			for (int i = 0; i < GHOST_AMT; i++) {
 				update_ghost(game->ghosts[i], delta_time, player_get_pos(game->player), game->map);
 			}
             
 			player_update(game->player, delta_time, game->map, game->camera_position.x, game->camera_position.x + MAP_WIDTH);
             
-			switch (map_eat_at(game->map, player_get_pos(game->player)->x + 0.5f, player_get_pos(game->player)->y + 0.5f)) {
+			const FixedPoint *player_pos = player_get_pos(game->player);
+			switch (map_eat_at(game->map, FIXED_TO_INT(player_pos->x + FIXED_HALF), FIXED_TO_INT(player_pos->y + FIXED_HALF))) {
 				case PAC:
-                Mix_PlayChannel(0, game->waka_sfx, 0);
+                emit(game, GAME_EVENT_PELLET_EATEN, -1, 100);
                 game->score += 100;
                 game->new_life_pts -= 100;
                 game->pac_left--;
                 break;
 				case POWERUP:
                 game->is_powered_up = true;
-                game->state.normal_state_data.power_up_timer = POWERUP_MAX_TIME;
+                game->state.normal_state_data.power_up_timer = game->config.power_up_time;
                 game->state.normal_state_data.blink_timer = 200;
+                emit(game, GAME_EVENT_POWER_UP, -1, 0);
                 for (int i = 0; i < GHOST_AMT; i++) {
                     ghost_switch_state(game->ghosts[i], FLEEING);
                 }
@@ -196,6 +333,7 @@ static void update(const int delta_time, Game *game) {
 			if (game->new_life_pts <= 0) {
 				game->lives++;
 				game->new_life_pts += 100000;
+				emit(game, GAME_EVENT_EXTRA_LIFE, -1, game->lives);
 			}
 			if (game->is_powered_up) {
 				NormalStateData *data = &game->state.normal_state_data;
@@ -227,8 +365,12 @@ static void update(const int delta_time, Game *game) {
 					if (game->is_powered_up) {
 						ghost_kill(game->ghosts[i]);
 						game->score += 1000;
+						emit(game, GAME_EVENT_GHOST_EATEN, i, 1000);
 					} else {
-						switch_state(game, DEAD);
+						game->deaths_by_ghost[i]++;
+						emit(game, GAME_EVENT_DEATH, i, 0);
+						switch_state(game, STATE_DEATH);
+						break;
 					}
 				}
 			}
@@ -247,6 +389,51 @@ static void update(const int delta_time, Game *game) {
 			}
 		}
 	}
+	hash_entities(game);
+#ifdef HASH_CHECK
+	SDL_assert(game->hash == compute_hash(game));
+	SDL_assert(map_get_hash(game->map) == map_compute_hash(game->map));
+#endif
+	PROFILE_END();
+}
+
+// Ticks for which update() does nothing but count a timer down, the tick that acts on the timer is not idle
+static int idle_ticks(const Game *game, const int delta_time) {
+	if (delta_time <= 0)
+		return 0;
+	switch (game->state.state) {
+		case STATE_WAIT: {
+			int timer = game->state.wait_state_data.timer;
+			return timer > 0 ? (timer + delta_time - 1) / delta_time : 0;
+		}
+		case STATE_DEATH: {
+			// The death animation runs alongside, player_skip_death_animation() catches it up
+			int timer = game->state.kill_state_data.kill_timer;
+			return timer > 0 ? (timer + delta_time - 1) / delta_time : 0;
+		}
+		case STATE_GAMEOVER:
+			return SDL_MAX_SINT32;
+	}
+	// Ghosts leaving the house, power ups and path refreshes all happen while the player moves
+	return 0;
+}
+
+static int fast_forward(Game *game, const int delta_time, const int max_ticks) {
+	int ticks = SDL_min(idle_ticks(game, delta_time), max_ticks);
+	if (ticks <= 0)
+		return 0;
+
+	switch (game->state.state) {
+		case STATE_WAIT: {
+			game->state.wait_state_data.timer -= ticks * delta_time;
+		} break;
+		case STATE_DEATH: {
+			player_skip_death_animation(game->player, delta_time, ticks);
+			game->state.kill_state_data.kill_timer -= ticks * delta_time;
+		} break;
+	}
+	game->ticks += ticks;
+	return ticks;
 }
 
 /*
@@ -282,90 +469,138 @@ int draw_text(SDL_Renderer *renderer, TTF_Font *font, char *text, const SDL_Poin
 	return w + src->x;
 }
 
-static void draw_ui(SDL_Renderer *renderer, SDL_Window *window, Game *game) {
+static void draw_ui(GameAssets *assets, Game *game) {
+	RenderQueue *queue = assets->render_queue;
 	SDL_Point place = { 0, 0 };
     
 	// Score
 	char score_str[16];
-	sprintf_s(score_str, 16 * sizeof(char), "Score : %06d", game->score);
-	place.x = draw_text(renderer, game->font, score_str, &place, ALIGN_LEFT);
+	SDL_snprintf(score_str, sizeof(score_str), "Score : %06d", game->score);
+	place.x = render_queue_text(queue, RENDER_LAYER_UI, score_str, &place, ALIGN_LEFT);
     
 	place.x += 16;
     
 	char new_life_str[16];
-	sprintf_s(new_life_str, 16 * sizeof(char), "1UP : %06d", game->new_life_pts);
-	place.x = draw_text(renderer, game->font, new_life_str, &place, ALIGN_LEFT);
+	SDL_snprintf(new_life_str, sizeof(new_life_str), "1UP : %06d", game->new_life_pts);
+	place.x = render_queue_text(queue, RENDER_LAYER_UI, new_life_str, &place, ALIGN_LEFT);
     
 	place.x += 16;
     
 	// Lives
+	SDL_Color white = { 255, 255, 255, 255 };
 	for (int i = 0; i < game->lives; i++) {
 		SDL_Rect src = { 0, 0, 16, 16 };
 		SDL_Rect dst = { place.x, 0, 16, 16 };
 		place.x += 16;
-		SDL_RenderCopy(renderer, player_get_texture(game->player), &src, &dst);
+		render_queue_sprite(queue, RENDER_LAYER_UI, assets->player_texture, &src, &dst, 0, white);
 	}
     
 	place.x += 16;
     
 	// Level
-	char level_str[10];
+	char level_str[16];
 	int w = 0;
-	SDL_GetWindowSize(window, &w, NULL);
+	render_queue_get_size(queue, &w, NULL);
 	place.x = w;
-	sprintf_s(level_str, 16 * sizeof(char), "Level : %03d", game->level);
-	place.x = draw_text(renderer, game->font, level_str, &place, ALIGN_RIGHT);
+	SDL_snprintf(level_str, sizeof(level_str), "Level : %03d", game->level);
+	place.x = render_queue_text(queue, RENDER_LAYER_UI, level_str, &place, ALIGN_RIGHT);
     
 	if (game->state.state == STATE_WAIT) {
 		SDL_Point ready_pos = { 14.5f * 16.0f, 18.5f * 16.0f };
-		draw_text(renderer, game->font, "GET READY !", &ready_pos, ALIGN_CENTERED);
+		render_queue_text(queue, RENDER_LAYER_UI, "GET READY !", &ready_pos, ALIGN_CENTERED);
 	}
 	if (game->state.state == STATE_GAMEOVER) {
 		SDL_Point game_over_pos = { 14.5f * 16.0f, 18.5f * 16.0f };
-		draw_text(renderer, game->font, "GAME OVER !", &game_over_pos, ALIGN_CENTERED);
+		render_queue_text(queue, RENDER_LAYER_UI, "GAME OVER !", &game_over_pos, ALIGN_CENTERED);
 	}
 }
 
-static void draw(SDL_Renderer *renderer, SDL_Window *window, Game *game) {
-	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
-	SDL_RenderClear(renderer);
+// Snapshots drawn by run() have no assets of their own
+static void draw(SDL_Renderer *renderer, GameAssets *assets, Game *game) {
+	SoftRenderer *soft = assets->soft_renderer;
+	if (!assets->dirty_rects && soft != NULL) {
+		SDL_Color black = { 0, 0, 0, 0 };
+		soft_renderer_fill(soft, NULL, black);
+	} else if (!assets->dirty_rects) {
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+		SDL_RenderClear(renderer);
+	}
     
-	map_draw(game->map, renderer, &game->camera_position);
-	player_draw(game->player, renderer, &game->camera_position);
+	PROFILE_BEGIN("map_draw");
+	map_draw(game->map, assets->walls_texture, assets->render_queue, &game->camera_position);
+	PROFILE_END();
+	player_draw(game->player, assets->player_texture, assets->render_queue, &game->camera_position);
     
 	for (int i = 0; i < GHOST_AMT; i++) {
-		draw_ghost(renderer, game->ghosts[i], &game->camera_position);
-		//dbg_draw_ghost(game->ghosts[i], renderer, game->font, &game->camera_position);
+		draw_ghost(assets->render_queue, assets->ghost_texture, game->ghosts[i], &game->camera_position);
 	}
     
-	draw_ui(renderer, window, game);
-    
+	PROFILE_BEGIN("draw_ui");
+	draw_ui(assets, game);
+	PROFILE_END();
+
+	PROFILE_BEGIN("render_queue_flush");
+	render_queue_flush(assets->render_queue);
+	PROFILE_END();
+
+	if (soft != NULL) {
+		PROFILE_BEGIN("soft_renderer_present");
+		int count = 0;
+		const SDL_Rect *rects = render_queue_get_dirty_rects(assets->render_queue, &count);
+		soft_renderer_present(soft, renderer, rects, count);
+		PROFILE_END();
+	}
+
+	// Immediate mode debug drawing goes on top of the batches
+	//for (int i = 0; i < GHOST_AMT; i++)
+	//	dbg_draw_ghost(game->ghosts[i], renderer, assets->font, &game->camera_position);
+	PROFILE_DRAW_OVERLAY(renderer, assets->font);
+
+	PROFILE_BEGIN("SDL_RenderPresent");
 	SDL_RenderPresent(renderer);
+	PROFILE_END();
 }
 
 /* 
  * CORE
  */
 
-static Game *load_resources(SDL_Renderer *renderer) {
-	Game *game = malloc(sizeof(Game));
+static Game *load_resources(SDL_Renderer *renderer, const GameConfig *config) {
+	Game *game = calloc(1, sizeof(Game));
     
 	game->is_running = true;
+	if (config != NULL)
+		game->config = *config;
+	else
+		game_default_config(&game->config);
     
-	game->font = TTF_OpenFont("resources/unifont.ttf", 16);
+	if (renderer != NULL) {
+		GameAssets *assets = calloc(1, sizeof(GameAssets));
+		assets->font = pack_load_font("unifont.ttf", 16);
+		assets->render_queue = render_queue_create(renderer, assets->font);
+		assets->player_texture = pack_load_texture(renderer, "pac_man.png");
+		assets->ghost_texture = pack_load_texture(renderer, "ghost.png");
+		assets->walls_texture = pack_load_texture(renderer, "walls.png");
+		assets->intro_bgm = audio_load_sound("audio/intro.wav");
+		assets->death_sfx = audio_load_sound("audio/death.wav");
+		assets->waka_sfx = audio_load_sound("audio/waka.wav");
+		game->assets = assets;
+	}
     
-	game->player = player_load(renderer);
+	game->player = player_load();
+	player_set_speed(game->player, game->config.player_speed);
     
-	game->map = map_load(renderer);
+	game->map = map_load();
     
 	game->camera_position.x = 0;
 	game->camera_position.y = 16;
     
-	game->ghosts[0] = create_ghost(renderer, 13.5f, 11, 0, 0, 0);
+	const int *exit_times = game->config.ghost_exit_times;
+	game->ghosts[0] = create_ghost(13.5f, 11, exit_times[0], 0, 0);
     
-	game->ghosts[1] = create_ghost(renderer, 11.5f, 14, 5000, 0, 16);
-	game->ghosts[2] = create_ghost(renderer, 13.5f, 14, 10000, 16, 0);
-	game->ghosts[3] = create_ghost(renderer, 15.5f, 14, 15000, 16, 16);
+	game->ghosts[1] = create_ghost(11.5f, 14, exit_times[1], 0, 16);
+	game->ghosts[2] = create_ghost(13.5f, 14, exit_times[2], 16, 0);
+	game->ghosts[3] = create_ghost(15.5f, 14, exit_times[3], 16, 16);
     
 	game->level = 1;
 	game->score = 0;
@@ -373,10 +608,14 @@ static Game *load_resources(SDL_Renderer *renderer) {
 	game->lives = STARTING_LIVES;
 	game->new_life_pts = PTS_FOR_NEW_LIFE;
 	game->pac_left = PAC_AMOUNT;
-    
-	game->intro_bgm = Mix_LoadMUS("resources/audio/intro.wav");
-	game->death_sfx = Mix_LoadWAV("resources/audio/death.wav");
-	game->waka_sfx = Mix_LoadWAV("resources/audio/waka.wav");
+
+	for (int i = 0; i < 1 + GHOST_AMT; i++) {
+		game->hashed_tiles[i] = entity_tile(game, i);
+	}
+	for (int i = 0; i < GHOST_AMT; i++) {
+		game->hashed_ghost_states[i] = ghost_get_state(game->ghosts[i]);
+	}
+	game->hash = compute_hash(game);
     
 	return game;
 }
@@ -389,47 +628,634 @@ static void init_level(Game *game) {
 
 static void destroy_game(Game *game) {
 	for (int i = 0; i < GHOST_AMT; i++) {
+		brain_detach(&game->brains[i]);
 		destroy_ghost(game->ghosts[i]);
 	}
+	free(game->brain_walls);
     
 	player_free(game->player);
+	map_free(game->map);
     
-	Mix_FreeMusic(game->intro_bgm);
-	Mix_FreeChunk(game->death_sfx);
-	Mix_FreeChunk(game->waka_sfx);
-    
-	TTF_CloseFont(game->font);
+	GameAssets *assets = game->assets;
+	if (assets != NULL) {
+		SDL_DestroyTexture(assets->player_texture);
+		SDL_DestroyTexture(assets->ghost_texture);
+		SDL_DestroyTexture(assets->walls_texture);
+
+		audio_free_sound(assets->intro_bgm);
+		audio_free_sound(assets->death_sfx);
+		audio_free_sound(assets->waka_sfx);
+
+		render_queue_destroy(assets->render_queue);
+		TTF_CloseFont(assets->font);
+		free(assets);
+	}
     
 	free(game);
 }
 
-void run(SDL_Renderer *renderer, SDL_Window *window) {
-	Game *game = load_resources(renderer);
-    
+void game_default_config(GameConfig *config) {
+	config->player_speed = PLAYER_SPEED;
+	config->ghost_base_speed = GHOST_BASE_SPEED;
+	config->ghost_speed_per_level = GHOST_SPEED_PER_LEVEL;
+	config->power_up_time = POWERUP_MAX_TIME;
+	for (int i = 0; i < GHOST_AMT; i++) {
+		config->ghost_exit_times[i] = i * 5000;
+	}
+}
+
+Game *game_create(SDL_Renderer *renderer, const GameConfig *config) {
+	Game *game = load_resources(renderer, config);
 	switch_state(game, STATE_NEW_GAME);
-    
-	int last_time = 0;
-    
-	while (game->is_running) {
-		int time = SDL_GetTicks();
-		int delta_time = time - last_time;
-        
-		if (delta_time >= FRAME_TIME) {
-			last_time = time;
-            
-			SDL_Event e;
-			if (SDL_PollEvent(&e)) {
-				if (e.type == SDL_QUIT) {
-					game->is_running = false;
-				}
-                
-				input(&e, game, game->player);
+	return game;
+}
+
+void game_destroy(Game *game) {
+	destroy_game(game);
+}
+
+void game_copy(Game *dst, const Game *src) {
+	dst->state = src->state;
+	dst->config = src->config;
+	dst->ticks = src->ticks;
+	for (int i = 0; i < GHOST_AMT; i++) {
+		dst->deaths_by_ghost[i] = src->deaths_by_ghost[i];
+		ghost_copy(dst->ghosts[i], src->ghosts[i]);
+	}
+	player_copy(dst->player, src->player);
+	map_copy(dst->map, src->map);
+
+	dst->is_running = src->is_running;
+	dst->camera_position = src->camera_position;
+	dst->level = src->level;
+	dst->lives = src->lives;
+	dst->score = src->score;
+	dst->new_life_pts = src->new_life_pts;
+	dst->pac_left = src->pac_left;
+	dst->is_powered_up = src->is_powered_up;
+
+	dst->hash = src->hash;
+	for (int i = 0; i < 1 + GHOST_AMT; i++) {
+		dst->hashed_tiles[i] = src->hashed_tiles[i];
+	}
+	for (int i = 0; i < GHOST_AMT; i++) {
+		dst->hashed_ghost_states[i] = src->hashed_ghost_states[i];
+	}
+}
+
+void game_input(Game *game, SDL_Event *e) {
+	input(e, game, game->player);
+}
+
+void game_update(Game *game, const int delta_time) {
+	update(delta_time, game);
+}
+
+int game_idle_ticks(const Game *game, const int delta_time) {
+	return idle_ticks(game, delta_time);
+}
+
+int game_fast_forward(Game *game, const int delta_time, const int max_ticks) {
+	return fast_forward(game, delta_time, max_ticks);
+}
+
+void game_draw(Game *game, SDL_Renderer *renderer) {
+	draw(renderer, game->assets, game);
+}
+
+RenderQueueStats game_get_render_stats(const Game *game) {
+	return render_queue_get_stats(game->assets->render_queue);
+}
+
+void game_set_dirty_rects(Game *game, const bool is_enabled) {
+	game->assets->dirty_rects = is_enabled;
+	render_queue_set_dirty_tracking(game->assets->render_queue, is_enabled);
+}
+
+void game_set_soft_renderer(Game *game, SoftRenderer *soft) {
+	GameAssets *assets = game->assets;
+	assets->soft_renderer = soft;
+	if (soft != NULL) {
+		const char *names[] = { "pac_man.png", "ghost.png", "walls.png" };
+		SDL_Texture *textures[] = { assets->player_texture, assets->ghost_texture, assets->walls_texture };
+		for (int i = 0; i < (int)SDL_arraysize(names); i++) {
+			SDL_Surface *surface = pack_load_surface(names[i]);
+			soft_renderer_add_texture(soft, textures[i], surface);
+			SDL_FreeSurface(surface);
+		}
+	}
+	render_queue_set_soft_renderer(assets->render_queue, soft);
+}
+
+const SDL_Rect *game_get_dirty_rects(const Game *game, int *count) {
+	return render_queue_get_dirty_rects(game->assets->render_queue, count);
+}
+
+void game_set_silent(Game *game, const bool is_silent) {
+	game->is_silent = is_silent;
+}
+
+void game_set_event_bus(Game *game, EventBus *bus) {
+	game->events = bus;
+}
+
+const char *game_state_name(const int state) {
+	return state >= 0 && state < (int)SDL_arraysize(state_names) ? state_names[state] : "?";
+}
+
+void game_set_versus(Game *game, const bool is_versus) {
+	ghost_set_controlled(game->ghosts[VERSUS_GHOST], is_versus);
+}
+
+void game_apply_input(Game *game, const GameInput *input) {
+	if (game->state.state != STATE_NORMAL)
+		return;
+	if (input->player != NONE)
+		player_set_direction(game->player, input->player);
+	ghost_set_input(game->ghosts[VERSUS_GHOST], input->ghost);
+}
+
+void game_restart(Game *game) {
+	switch_state(game, STATE_NEW_GAME);
+}
+
+bool game_is_over(const Game *game) {
+	return game->state.state == STATE_GAMEOVER;
+}
+
+bool game_is_player_alive(const Game *game) {
+	return game->state.state != STATE_DEATH && game->state.state != STATE_GAMEOVER;
+}
+
+bool game_is_in_play(const Game *game) {
+	return game->state.state == STATE_NORMAL;
+}
+
+bool game_is_powered_up(const Game *game) {
+	return game->is_powered_up;
+}
+
+void game_set_player_direction(Game *game, const Direction direction) {
+	// Same rule as keyboard input
+	if (game->state.state == STATE_NORMAL)
+		player_set_direction(game->player, direction);
+}
+
+Player *game_get_player(Game *game) {
+	return game->player;
+}
+
+Map *game_get_map(Game *game) {
+	return game->map;
+}
+
+struct Ghost *game_get_ghost(Game *game, const int index) {
+	return game->ghosts[index];
+}
+
+void game_set_ghost_brain(Game *game, const int index, BrainPlugin *plugin, const int budget_us) {
+	brain_detach(&game->brains[index]);
+	brain_attach(&game->brains[index], plugin, index);
+	game->brain_budget_us = budget_us;
+	ghost_set_controlled(game->ghosts[index], false);
+
+	if (plugin != NULL && game->brain_walls == NULL) {
+		int width = map_get_width(game->map);
+		int height = map_get_height(game->map);
+		game->brain_walls = malloc(width * height);
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				game->brain_walls[x + y * width] = map_get_collision(game->map, x, y, COLLISION_GHOST);
 			}
-            
-			update(delta_time, game);
-			draw(renderer, window, game);
 		}
 	}
-    
+}
+
+static void get_spectate_entity(SpectateEntity *entity, const FixedPoint *pos) {
+	// Sixteenths of a tile, a pixel, all draw() can show
+	entity->x = (Sint16)(pos->x >> (FIXED_SHIFT - 4));
+	entity->y = (Sint16)(pos->y >> (FIXED_SHIFT - 4));
+}
+
+static FixedPoint spectate_pos(const SpectateEntity *entity) {
+	FixedPoint pos = { (Fixed)entity->x << (FIXED_SHIFT - 4), (Fixed)entity->y << (FIXED_SHIFT - 4) };
+	return pos;
+}
+
+void game_get_spectate_frame(Game *game, SpectateFrame *frame) {
+	SDL_zero(*frame);
+	frame->tick = game->ticks;
+	frame->state = game->state.state;
+	frame->lives = (Uint8)SDL_clamp(game->lives, 0, 255);
+	frame->is_blinking = map_is_blinking(game->map);
+	frame->level = (Uint16)game->level;
+	frame->score = game->score;
+	frame->new_life_pts = game->new_life_pts;
+
+	get_spectate_entity(&frame->player, player_get_pos(game->player));
+	frame->player.direction = player_get_direction(game->player);
+	frame->player.frame = player_get_frame(game->player);
+	frame->player.state = player_is_dead(game->player);
+	for (int i = 0; i < GHOST_AMT; i++) {
+		get_spectate_entity(&frame->ghosts[i], ghost_get_pos(game->ghosts[i]));
+		frame->ghosts[i].state = ghost_get_state(game->ghosts[i]);
+	}
+
+	int words = SDL_min(map_get_pellet_words(game->map), SPECTATE_PELLET_WORDS);
+	SDL_memcpy(frame->pellets, map_get_pellet_bits(game->map), words * sizeof(Uint32));
+}
+
+void game_apply_spectate_frame(Game *game, const SpectateFrame *frame) {
+	game->ticks = frame->tick;
+	game->state.state = frame->state;
+	game->lives = frame->lives;
+	game->level = frame->level;
+	game->score = frame->score;
+	game->new_life_pts = frame->new_life_pts;
+
+	map_reset_color(game->map);
+	if (frame->is_blinking)
+		map_toggle_color(game->map);
+	map_set_pellet_bits(game->map, frame->pellets);
+
+	FixedPoint pos = spectate_pos(&frame->player);
+	player_set_pose(game->player, &pos, frame->player.direction, frame->player.frame, frame->player.state);
+	for (int i = 0; i < GHOST_AMT; i++) {
+		pos = spectate_pos(&frame->ghosts[i]);
+		ghost_set_pose(game->ghosts[i], &pos, frame->ghosts[i].state);
+	}
+}
+
+// Slots of the ZOBRIST_COUNTER keys
+enum HashCounter {
+	HASH_SCORE,
+	HASH_LIVES,
+	HASH_LEVEL,
+	HASH_POWERED_UP
+} typedef HashCounter;
+
+Uint64 game_get_hash(const Game *game) {
+	return game->hash ^ map_get_hash(game->map) ^ zobrist_key(ZOBRIST_COUNTER, HASH_SCORE, game->score) ^
+			zobrist_key(ZOBRIST_COUNTER, HASH_LIVES, game->lives) ^ zobrist_key(ZOBRIST_COUNTER, HASH_LEVEL, game->level) ^
+			zobrist_key(ZOBRIST_COUNTER, HASH_POWERED_UP, game->is_powered_up);
+}
+
+GameStats game_get_stats(const Game *game) {
+	GameStats stats;
+	stats.ticks = game->ticks;
+	stats.score = game->score;
+	stats.level = game->level;
+	stats.lives = game->lives;
+	stats.pellets_left = game->pac_left;
+	for (int i = 0; i < GHOST_AMT; i++) {
+		stats.deaths_by_ghost[i] = game->deaths_by_ghost[i];
+	}
+	return stats;
+}
+
+/*
+ * RUN
+ */
+
+#define INPUT_QUEUE_SIZE 64 // A power of two
+#define SNAPSHOT_FRESH 4 // Set on the middle index when the simulation published since the main thread last took it
+#define MAX_TICKS_BEHIND 8 // Further behind and the simulation drops the ticks instead of catching up
+
+// Intervals between ticks or frames, both aim for TICK_TIME
+typedef struct Jitter {
+	int count;
+	double sum_ms;
+	double sum_squares;
+	double max_ms;
+	int late; // Over twice TICK_TIME
+} Jitter;
+
+// What the main thread and the simulation thread share in run()
+typedef struct RunThreads {
+	Game *game; // The simulation thread's once it started, the main thread only uses the assets
+	Mcts *mcts;
+	RollbackSession *session;
+	SpectateServer *spectators;
+	SDL_atomic_t is_running;
+
+	// Single producer, single consumer ring of key presses, from the main thread to the simulation
+	SDL_Event inputs[INPUT_QUEUE_SIZE];
+	SDL_atomic_t input_head;
+	SDL_atomic_t input_tail;
+	int dropped_inputs;
+
+	// Triple buffered copies of the game. The simulation fills back and swaps it for middle, the main thread
+	// swaps front for middle when it's fresh. Neither side ever waits for the other
+	Game *snapshots[3];
+	int back;
+	SDL_atomic_t middle;
+	int front;
+
+	Jitter ticks; // Simulation thread
+	Jitter frames; // Main thread
+} RunThreads;
+
+static void jitter_add(Jitter *this, const Uint64 interval) {
+	double ms = interval * 1000.0 / SDL_GetPerformanceFrequency();
+	this->count++;
+	this->sum_ms += ms;
+	this->sum_squares += ms * ms;
+	this->max_ms = SDL_max(this->max_ms, ms);
+	if (ms > 2 * TICK_TIME)
+		this->late++;
+}
+
+static void jitter_log(const char *name, const Jitter *this) {
+	if (this->count == 0)
+		return;
+	double mean = this->sum_ms / this->count;
+	double deviation = SDL_sqrt(SDL_max(this->sum_squares / this->count - mean * mean, 0.0));
+	SDL_Log("%s: %d intervals, mean %.2fms, standard deviation %.2fms, max %.2fms, %d over %dms", name, this->count, mean,
+			deviation, this->max_ms, this->late, 2 * TICK_TIME);
+}
+
+// Main thread, dropped when the simulation is that far behind
+static void push_input(RunThreads *this, const SDL_Event *e) {
+	int head = SDL_AtomicGet(&this->input_head);
+	if (head - SDL_AtomicGet(&this->input_tail) >= INPUT_QUEUE_SIZE) {
+		this->dropped_inputs++;
+		return;
+	}
+	this->inputs[head & (INPUT_QUEUE_SIZE - 1)] = *e;
+	SDL_AtomicSet(&this->input_head, head + 1);
+}
+
+static void apply_inputs(RunThreads *this) {
+	int head = SDL_AtomicGet(&this->input_head);
+	int tail = SDL_AtomicGet(&this->input_tail);
+	for (; tail != head; tail++) {
+		SDL_Event *e = &this->inputs[tail & (INPUT_QUEUE_SIZE - 1)];
+		// Netplay ticks with the inputs of both sides, never straight from the keyboard
+		if (this->session != NULL)
+			rollback_set_local_input(this->session, player_input_direction(e));
+		else
+			input(e, this->game, this->game->player);
+	}
+	SDL_AtomicSet(&this->input_tail, tail);
+}
+
+static void publish_snapshot(RunThreads *this) {
+	game_copy(this->snapshots[this->back], this->game);
+	this->back = SDL_AtomicSet(&this->middle, this->back | SNAPSHOT_FRESH) & ~SNAPSHOT_FRESH;
+}
+
+// The latest tick, NULL when it was already drawn
+static Game *take_snapshot(RunThreads *this) {
+	if (!(SDL_AtomicGet(&this->middle) & SNAPSHOT_FRESH))
+		return NULL;
+	this->front = SDL_AtomicSet(&this->middle, this->front) & ~SNAPSHOT_FRESH;
+	return this->snapshots[this->front];
+}
+
+// Fixed rate ticks until the main thread stops it
+static int simulate(void *data) {
+	RunThreads *this = data;
+	Game *game = this->game;
+	metrics_add_thread();
+
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	Uint64 period = frequency * TICK_TIME / 1000;
+	Uint64 next_tick = SDL_GetPerformanceCounter();
+	Uint64 last_tick = 0;
+	while (SDL_AtomicGet(&this->is_running)) {
+		// SDL_Delay() oversleeps, the last millisecond is spent polling the clock
+		Uint64 now = SDL_GetPerformanceCounter();
+		while (now < next_tick) {
+			Uint32 ms = (Uint32)((next_tick - now) * 1000 / frequency);
+			if (ms > 1)
+				SDL_Delay(ms - 1);
+			now = SDL_GetPerformanceCounter();
+		}
+		if (last_tick != 0) {
+			jitter_add(&this->ticks, now - last_tick);
+			metrics_record(METRIC_TICK_INTERVAL_US, (now - last_tick) * 1000000 / frequency);
+		}
+		last_tick = now;
+		next_tick += period;
+		if (now > next_tick + MAX_TICKS_BEHIND * period)
+			next_tick = now + period;
+
+		apply_inputs(this);
+		if (this->mcts != NULL)
+			mcts_update(this->mcts, game);
+
+		Uint64 update_start = SDL_GetPerformanceCounter();
+		// The main thread allocates while drawing, only this thread's count is the tick's
+		unsigned int allocations = DBG_thread_allocation_count();
+		if (this->session != NULL)
+			rollback_advance(this->session);
+		else
+			update(TICK_TIME, game);
+		Uint64 update_end = SDL_GetPerformanceCounter();
+		allocations = DBG_thread_allocation_count() - allocations;
+		metrics_record(METRIC_UPDATE_TIME_US, (update_end - update_start) * 1000000 / frequency);
+		metrics_record(METRIC_ALLOCATIONS_PER_TICK, allocations);
+		metrics_count(METRIC_ALLOCATIONS, allocations);
+		metrics_count(METRIC_TICKS, 1);
+
+		if (this->spectators != NULL)
+			spectate_server_push(this->spectators, game);
+		publish_snapshot(this);
+	}
+	return 0;
+}
+
+/*
+ * EVENT CONSUMERS
+ */
+
+// Main thread, the only one pushing to the audio queue
+static void play_events(const GameAssets *assets, EventBus *bus, EventCursor *cursor) {
+	GameEvent event;
+	while (event_bus_poll(bus, cursor, &event)) {
+		switch (event.type) {
+			case GAME_EVENT_PELLET_EATEN: {
+				audio_play(assets->waka_sfx, VOICE_WAKA);
+			} break;
+			case GAME_EVENT_DEATH: {
+				audio_play(assets->death_sfx, AUDIO_ANY_VOICE);
+			} break;
+			case GAME_EVENT_STATE_CHANGE: {
+				if (event.value == STATE_START_LEVEL)
+					audio_play(assets->intro_bgm, VOICE_MUSIC);
+			} break;
+		}
+	}
+}
+
+static void log_events(EventBus *bus, EventCursor *cursor) {
+	GameEvent event;
+	while (event_bus_poll(bus, cursor, &event)) {
+		if (event.type == GAME_EVENT_STATE_CHANGE)
+			SDL_Log("Tick %d: state changed to %s", event.tick, game_state_name(event.value));
+		else if (event.type == GAME_EVENT_LEVEL_CLEAR)
+			SDL_Log("Tick %d: level %d cleared", event.tick, event.value);
+	}
+}
+
+static void count_events(EventBus *bus, EventCursor *cursor) {
+	GameEvent event;
+	while (event_bus_poll(bus, cursor, &event)) {
+		if (event.type == GAME_EVENT_PELLET_EATEN)
+			metrics_count(METRIC_PELLETS_EATEN, 1);
+		else if (event.type == GAME_EVENT_STATE_CHANGE)
+			metrics_count(METRIC_STATE_TRANSITIONS + event.value, 1);
+	}
+}
+
+static void log_dropped_events(const char *consumer, const EventCursor *cursor) {
+	if (cursor->dropped > 0)
+		SDL_Log("%u game events overwritten before %s read them", cursor->dropped, consumer);
+}
+
+void run(SDL_Renderer *renderer, SDL_Window *window, const RunOptions *options) {
+	Game *game = game_create(renderer, NULL);
+	EventBus *events = event_bus_create(EVENT_BUS_DEFAULT_SIZE);
+	EventCursor sound_cursor;
+	EventCursor log_cursor;
+	EventCursor metrics_cursor;
+	event_bus_subscribe(events, &sound_cursor);
+	event_bus_subscribe(events, &log_cursor);
+	event_bus_subscribe(events, &metrics_cursor);
+	game_set_event_bus(game, events);
+	// Once more with the bus listening, for the intro
+	game_restart(game);
+	if (options->dirty_rects)
+		game_set_dirty_rects(game, true);
+	SoftRenderer *soft = NULL;
+	if (options->soft_render) {
+		SDL_Surface *screen = SDL_GetWindowSurface(window);
+		soft = soft_renderer_create(screen->w, screen->h, 1, screen);
+		game_set_soft_renderer(game, soft);
+		SDL_Log("Drawing with the %s software kernels", soft_renderer_kernels_name(soft_renderer_best_kernels()));
+	}
+	for (int i = 0; i < GHOST_AMT; i++) {
+		if (options->brains[i] == NULL)
+			continue;
+		// Timing dependent, the two sides would drift apart
+		if (options->versus != NULL)
+			SDL_Log("Brain %s ignored in versus mode", brain_get_name(options->brains[i]));
+		else
+			game_set_ghost_brain(game, i, options->brains[i], options->brain_budget_us);
+	}
+
+	RunThreads threads;
+	SDL_zero(threads);
+	threads.game = game;
+	if (options->autopilot) {
+		MctsOptions mcts_options;
+		mcts_default_options(&mcts_options);
+		threads.mcts = mcts_create(&mcts_options);
+	}
+	if (options->versus != NULL) {
+		threads.session = rollback_create(game, options->versus);
+		if (threads.session == NULL) {
+			SDL_Log("Unable to open UDP port %d", options->versus->local_port);
+			game->is_running = false;
+		}
+	}
+	if (options->broadcast_port != 0) {
+		threads.spectators = spectate_server_create(options->broadcast_port, SPECTATE_CLIENT_BUFFER);
+		if (threads.spectators == NULL)
+			SDL_Log("Unable to broadcast on TCP port %d", options->broadcast_port);
+	}
+
+	for (int i = 0; i < 3; i++) {
+		threads.snapshots[i] = game_create(NULL, NULL);
+	}
+	threads.back = 0;
+	SDL_AtomicSet(&threads.middle, 1);
+	threads.front = 2;
+	SDL_AtomicSet(&threads.is_running, game->is_running);
+	SDL_Thread *simulation = SDL_CreateThread(simulate, "simulation", &threads);
+
+	Uint64 last_frame_end = 0;
+	while (SDL_AtomicGet(&threads.is_running)) {
+		SDL_Event e;
+		while (SDL_PollEvent(&e)) {
+			if (e.type == SDL_QUIT)
+				SDL_AtomicSet(&threads.is_running, false);
+			// The window surface lost its pixels
+			if (e.type == SDL_WINDOWEVENT)
+				render_queue_invalidate(game->assets->render_queue);
+#ifdef PROFILE
+			if (e.type == SDL_KEYDOWN && e.key.keysym.scancode == SDL_SCANCODE_F1) {
+				profiler_toggle_overlay();
+				render_queue_invalidate(game->assets->render_queue);
+			}
+			if (e.type == SDL_KEYDOWN && e.key.keysym.scancode == SDL_SCANCODE_F2)
+				profiler_dump_trace(PROFILER_TRACE_FILE);
+#endif
+			if (e.type == SDL_KEYDOWN)
+				push_input(&threads, &e);
+		}
+		play_events(game->assets, events, &sound_cursor);
+		log_events(events, &log_cursor);
+		count_events(events, &metrics_cursor);
+
+		Game *snapshot = take_snapshot(&threads);
+		if (snapshot == NULL) {
+			SDL_Delay(1);
+			continue;
+		}
+
+#ifdef PROFILE
+		// The overlay is drawn outside the queue, only a full repaint picks it up
+		if (profiler_is_overlay_visible())
+			render_queue_invalidate(game->assets->render_queue);
+#endif
+		draw(renderer, game->assets, snapshot);
+		if (options->dirty_rects) {
+			int count = 0;
+			const SDL_Rect *rects = game_get_dirty_rects(game, &count);
+			if (count > 0)
+				SDL_UpdateWindowSurfaceRects(window, rects, count);
+		} else if (options->soft_render) {
+			SDL_UpdateWindowSurface(window);
+		}
+		PROFILE_FRAME_END();
+
+		Uint64 frame_end = SDL_GetPerformanceCounter();
+		if (last_frame_end != 0) {
+			jitter_add(&threads.frames, frame_end - last_frame_end);
+			metrics_record(METRIC_FRAME_TIME_US, (frame_end - last_frame_end) * 1000000 / SDL_GetPerformanceFrequency());
+		}
+		last_frame_end = frame_end;
+		metrics_count(METRIC_FRAMES, 1);
+		metrics_tick();
+	}
+	SDL_WaitThread(simulation, NULL);
+
+	jitter_log("Simulation ticks", &threads.ticks);
+	jitter_log("Rendered frames", &threads.frames);
+	if (threads.dropped_inputs > 0)
+		SDL_Log("%d key presses dropped, the simulation fell behind", threads.dropped_inputs);
+	log_dropped_events("the sound", &sound_cursor);
+	log_dropped_events("the log", &log_cursor);
+	log_dropped_events("the metrics", &metrics_cursor);
+
+	if (threads.mcts != NULL)
+		mcts_destroy(threads.mcts);
+	if (threads.session != NULL) {
+		RollbackStats stats = rollback_get_stats(threads.session);
+		rollback_log_stats(&stats);
+		rollback_destroy(threads.session);
+	}
+	if (threads.spectators != NULL) {
+		SpectateStats stats = spectate_server_get_stats(threads.spectators);
+		spectate_log_stats(&stats);
+		spectate_server_destroy(threads.spectators);
+	}
+	for (int i = 0; i < 3; i++) {
+		destroy_game(threads.snapshots[i]);
+	}
 	destroy_game(game);
+	if (soft != NULL)
+		soft_renderer_destroy(soft);
+	event_bus_destroy(events);
 }
@@ -5,7 +5,6 @@
 
 #include "SDL2/SDL.h"
 #include "SDL2/SDL_image.h"
-#include "SDL2/SDL_mixer.h"
 #include "SDL2/SDL_ttf.h"
 
 #include "debug.h"
@@ -14,10 +13,13 @@
 #include "a_star.h"
 #include "ghost.h"
 #include "map.h"
+#include "metrics.h"
+#include "pack.h"
 #include "player.h"
+#include "profiler.h"
+#include "render_queue.h"
 
 #define FPS 60
-#define FRAME_TIME 1.0f / (float)FPS
 
 #define POWERUP_MAX_TIME 10000
 #define PAC_AMOUNT 240
@@ -26,18 +28,125 @@
 #define STARTING_LIVES 2
 
 #define GHOST_AMT 4
+#define VERSUS_GHOST 0 // The ghost a second player steers in versus mode
+#define GHOST_BASE_SPEED 2.0f // Tiles per second
+#define GHOST_SPEED_PER_LEVEL 0.5f
 
-void run(SDL_Renderer *renderer, SDL_Window *window);
+#define TICK_TIME 16 // MS, fixed step of every simulation, run() included
+
+struct Game;
+typedef struct Game Game;
+
+// Balance parameters, game_default_config() gives the shipped values
+typedef struct GameConfig {
+	float player_speed; // Tiles per second
+	float ghost_base_speed;
+	float ghost_speed_per_level;
+	int power_up_time; // MS
+	int ghost_exit_times[GHOST_AMT]; // MS before each ghost leaves the house
+} GameConfig;
+
+typedef struct GameStats {
+	int ticks;
+	int score;
+	int level;
+	int lives;
+	int pellets_left;
+	int deaths_by_ghost[GHOST_AMT];
+} GameStats;
+
+// One tick of input from both sides, NONE keeps the current direction
+typedef struct GameInput {
+	Direction player;
+	Direction ghost;
+} GameInput;
+
+void game_default_config(GameConfig *config);
+
+// Without a renderer the game is headless: no assets. Either way it plays no sound and logs nothing
+// itself, it only publishes what happens to the bus given to game_set_event_bus()
+Game *game_create(SDL_Renderer *renderer, const GameConfig *config);
+void game_destroy(Game *game);
+// Copies the whole simulation state, assets and sound stay with dst. For search rollouts and rollback snapshots
+void game_copy(Game *dst, const Game *src);
+void game_input(Game *game, SDL_Event *e);
+void game_update(Game *game, const int delta_time);
+// Countdowns (get ready, death animation, game over) where game_update() only moves a timer
+int game_idle_ticks(const Game *game, const int delta_time);
+// Jumps over up to max_ticks idle ticks at once, ending in the same state as calling game_update() for each.
+// Returns the ticks skipped. Non-interactive drivers only, whatever steers the game must also idle meanwhile
+int game_fast_forward(Game *game, const int delta_time, const int max_ticks);
+void game_draw(Game *game, SDL_Renderer *renderer);
+RenderQueueStats game_get_render_stats(const Game *game);
+// Only what changed since the last frame is repainted, the renderer's target must keep its pixels
+void game_set_dirty_rects(Game *game, const bool is_enabled);
+// What the last game_draw() repainted
+const SDL_Rect *game_get_dirty_rects(const Game *game, int *count);
+struct SoftRenderer;
+// Draws with soft instead of the renderer and presents through it, NULL goes back. soft must outlive the game
+void game_set_soft_renderer(Game *game, struct SoftRenderer *soft);
+
+struct BrainPlugin;
+struct EventBus;
+
+// Every tick publishes its events to bus, see src/event_bus.h. NULL, the default, publishes nothing
+void game_set_event_bus(Game *game, struct EventBus *bus);
+// For GAME_EVENT_STATE_CHANGE
+const char *game_state_name(const int state);
+
+// A plugin brain steers the ghost while it hunts or flees, NULL gives it back to the built-in one. See src/brain_host.h
+void game_set_ghost_brain(Game *game, const int index, struct BrainPlugin *plugin, const int budget_us);
+
+// Versus mode and netplay
+// No events while set, for resimulated ticks
+void game_set_silent(Game *game, const bool is_silent);
+void game_set_versus(Game *game, const bool is_versus);
+void game_apply_input(Game *game, const GameInput *input);
+
+// Headless drivers
+// Back to level 1 with a full maze, as a key press after the game over
+void game_restart(Game *game);
+bool game_is_over(const Game *game);
+bool game_is_player_alive(const Game *game);
+// The player is alive and can steer
+bool game_is_in_play(const Game *game);
+bool game_is_powered_up(const Game *game);
+void game_set_player_direction(Game *game, const Direction direction);
+Player *game_get_player(Game *game);
+Map *game_get_map(Game *game);
+struct Ghost *game_get_ghost(Game *game, const int index); // ghost.h includes this header
+GameStats game_get_stats(const Game *game);
+// 64 bit Zobrist hash of the simulation state, equal states hash equal on every machine. Kept up to date as
+// pellets are eaten, entities cross tiles and states change, so reading it is O(1). Positions count by tile
+// and timers are left out. Building with HASH_CHECK checks it against a full recomputation every tick
+Uint64 game_get_hash(const Game *game);
+
+struct SpectateFrame;
+
+// What draw() needs, for spectators. See src/spectate.h
+void game_get_spectate_frame(Game *game, struct SpectateFrame *frame);
+// Only for drawing, the game can't be updated afterwards
+void game_apply_spectate_frame(Game *game, const struct SpectateFrame *frame);
+
+struct RollbackOptions;
+
+typedef struct RunOptions {
+	bool autopilot; // The search based bot plays instead of the keyboard
+	const struct RollbackOptions *versus; // Against another process, NULL for single player
+	bool dirty_rects; // The renderer draws into the window surface, only changed rects are pushed
+	bool soft_render; // Drawn by src/soft_render.c into the window surface, the renderer must draw there too
+	struct BrainPlugin *brains[GHOST_AMT]; // NULL for the built-in brain, ignored in versus mode
+	int brain_budget_us;
+	Uint16 broadcast_port; // Spectators can watch on it, 0 for none
+} RunOptions;
+
+// The game ticks every TICK_TIME on a thread of its own and publishes a copy of itself after each tick,
+// the calling thread only polls events, plays the sounds the game published and draws the latest copy
+void run(SDL_Renderer *renderer, SDL_Window *window, const RunOptions *options);
 
 struct GraphMap;
 typedef struct GraphMap GraphMap;
 
-enum Alignement {
-	ALIGN_LEFT = 0,
-	ALIGN_CENTERED,
-	ALIGN_RIGHT
-} typedef Alignement;
-
 int draw_text(SDL_Renderer *renderer, TTF_Font *font, char *text, const SDL_Point *src, Alignement align);
 static void next_level();
 
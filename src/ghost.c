@@ -1,6 +1,5 @@
 #include "ghost.h"
 
-#include <math.h>
 #include <stdio.h>
 
 #include "SDL2/SDL.h"
@@ -9,20 +8,20 @@
 
 #include "a_star.h"
 #include "debug.h"
+#include "profiler.h"
 #include "utils.h"
 
 struct Ghost {
-	SDL_Texture *texture;
-	SDL_FPoint starting_position;
+	FixedPoint starting_position;
 
-	SDL_FPoint position;
+	FixedPoint position;
 
 	Direction current_direction;
 
-	SDL_Point *path;
+	PathNode path[A_STAR_MAX_PATH];
 	int path_length;
 	int update_path_timer;
-	float current_position_in_path;
+	int current_position_in_path;
 
 	SDL_Rect sprite;
 
@@ -30,7 +29,13 @@ struct Ghost {
 	int initial_wait_time;
 	int exit_timer;
 
-	float speed;
+	Fixed speed; // Per second
+
+	// Steered by a second player instead of pathfinding while hunting or fleeing
+	bool is_controlled;
+	Direction input_direction;
+
+	int banked_time; // MS a far ghost has not been simulated for yet, see update_ghost_lod()
 };
 
 void ghost_reset(Ghost *this, const float speed) {
@@ -39,13 +44,13 @@ void ghost_reset(Ghost *this, const float speed) {
 	this->current_direction = NORTH;
 
 	// Pathfinding
-	this->path = NULL;
 	this->path_length = 0;
-	this->current_position_in_path = 0.0f;
+	this->current_position_in_path = 0;
 
 	this->state = WAITING;
-	this->speed = speed;
+	this->speed = FIXED_FROM_FLOAT(speed);
 	this->exit_timer = this->initial_wait_time;
+	this->banked_time = 0;
 }
 
 void ghost_switch_state(Ghost *this, const GhostState state) {
@@ -63,24 +68,38 @@ void ghost_switch_state(Ghost *this, const GhostState state) {
 	}
 }
 
-SDL_FPoint *ghost_get_pos(Ghost *this) {
+const FixedPoint *ghost_get_pos(Ghost *this) {
 	return &this->position;
 }
 
-Ghost *create_ghost(SDL_Renderer *renderer, const float x, const float y, const int wait_time, const int sprite_x, const int sprite_y) {
+GhostState ghost_get_state(const Ghost *this) {
+	return this->state;
+}
+
+Direction ghost_get_direction(const Ghost *this) {
+	return this->current_direction;
+}
+
+void ghost_set_pose(Ghost *this, const FixedPoint *pos, const GhostState state) {
+	this->position = *pos;
+	this->state = state;
+}
+
+Ghost *create_ghost(const float x, const float y, const int wait_time, const int sprite_x, const int sprite_y) {
 	Ghost *this = malloc(sizeof(Ghost));
 
-	SDL_Surface *surf = IMG_Load("resources/ghost.png");
-	this->texture = SDL_CreateTextureFromSurface(renderer, surf);
-	SDL_FreeSurface(surf);
+	this->path_length = 0;
+	this->is_controlled = false;
+	this->input_direction = NONE;
+	this->banked_time = 0;
 
 	this->sprite.x = sprite_x;
 	this->sprite.y = sprite_y;
 	this->sprite.w = 16;
 	this->sprite.h = 16;
 
-	this->starting_position.x = x;
-	this->starting_position.y = y;
+	this->starting_position.x = FIXED_FROM_FLOAT(x);
+	this->starting_position.y = FIXED_FROM_FLOAT(y);
 	this->initial_wait_time = wait_time;
 	this->exit_timer = wait_time;
 
@@ -88,92 +107,236 @@ Ghost *create_ghost(SDL_Renderer *renderer, const float x, const float y, const
 }
 
 void destroy_ghost(Ghost *ghost) {
-	SDL_DestroyTexture(ghost->texture);
-	free(ghost->path);
 	free(ghost);
 }
 
-static void update_path(Ghost *this, const SDL_FPoint *player_pos, Map *map) {
-	SDL_Point a = { round(this->position.x), round(this->position.y) };
-	SDL_Point b = { (int)player_pos->x, (int)player_pos->y };
-	a_star(map, &a, &b, &this->path, &this->path_length);
+void ghost_copy(Ghost *dst, const Ghost *src) {
+	*dst = *src;
+}
+
+void ghost_set_controlled(Ghost *this, const bool is_controlled) {
+	if (this->is_controlled == is_controlled)
+		return;
+	this->is_controlled = is_controlled;
+	this->input_direction = NONE;
+	// The path is stale once pathfinding takes over again
+	this->update_path_timer = 0;
+}
+
+void ghost_set_input(Ghost *this, const Direction direction) {
+	if (direction != NONE)
+		this->input_direction = direction;
+}
+
+static void update_path(Ghost *this, const FixedPoint *player_pos, Map *map) {
+	SDL_Point a = { FIXED_TO_INT(this->position.x + FIXED_HALF), FIXED_TO_INT(this->position.y + FIXED_HALF) };
+	SDL_Point b = { FIXED_TO_INT(player_pos->x), FIXED_TO_INT(player_pos->y) };
+	a_star(map, &a, &b, this->path, &this->path_length);
 	this->current_position_in_path = 0;
 }
 
-static void update_flee_path(Ghost *this, const SDL_FPoint *player_pos, Map *map) {
-	SDL_Point a = { round(this->position.x), round(this->position.y) };
-	SDL_Point b = { (int)player_pos->x, (int)player_pos->y };
-	reverse_a_star(map, &a, &b, 4, &this->path, &this->path_length);
+static void update_flee_path(Ghost *this, const FixedPoint *player_pos, Map *map) {
+	SDL_Point a = { FIXED_TO_INT(this->position.x + FIXED_HALF), FIXED_TO_INT(this->position.y + FIXED_HALF) };
+	SDL_Point b = { FIXED_TO_INT(player_pos->x), FIXED_TO_INT(player_pos->y) };
+	reverse_a_star(map, &a, &b, 4, this->path, &this->path_length);
 	this->current_position_in_path = 0;
 }
 
-void move_ghost(Ghost *this, int delta_time, Map *map) {
-	if (this->path_length <= 0)
-		return;
+static Fixed approach(Fixed from, Fixed to, Fixed *budget) {
+	Fixed delta = SDL_clamp(to - from, -*budget, *budget);
+	*budget -= SDL_abs(delta);
+	return from + delta;
+}
 
-	SDL_FPoint dir = {
-		this->path[(int)this->current_position_in_path + 1].x - this->position.x,
-		this->path[(int)this->current_position_in_path + 1].y - this->position.y
-	};
+// Returns the MS left when the path ended first
+static int move_ghost(Ghost *this, int delta_time, Map *map) {
+	// Walks the path node by node, the distance left after reaching one carries over to the next
+	Fixed budget = fixed_step(this->speed, delta_time);
+	while (budget > 0 && this->current_position_in_path + 1 < this->path_length) {
+		const PathNode *next = &this->path[this->current_position_in_path + 1];
+		FixedPoint target = { FIXED_FROM_INT(next->x), FIXED_FROM_INT(next->y) };
+
+		// Off grid ghosts, leaving the house, line up horizontally first
+		this->position.x = approach(this->position.x, target.x, &budget);
+		this->position.y = approach(this->position.y, target.y, &budget);
+
+		if (this->position.x == target.x && this->position.y == target.y)
+			this->current_position_in_path++;
+	}
+	return this->speed > 0 ? (int)((Sint64)budget * 1000 / this->speed) : 0;
+}
 
-	SDL_FPoint_Normalize(&dir);
+static const SDL_Point direction_offsets[4] = {
+	[EAST] = { 1, 0 },
+	[SOUTH] = { 0, 1 },
+	[WEST] = { -1, 0 },
+	[NORTH] = { 0, -1 },
+};
 
-	float speed = this->speed * delta_time / 1000.0f;
-	SDL_FPoint new_pos = this->position;
+static bool is_open(const Map *map, int x, int y, Direction direction) {
+	return !map_get_collision(map, x + direction_offsets[direction].x, y + direction_offsets[direction].y, COLLISION_GHOST);
+}
 
-	new_pos.x = this->position.x + speed * dir.x;
-	new_pos.y = this->position.y + speed * dir.y;
+// Tile center to walk to next, the nearest one may be behind
+static FixedPoint next_center(const FixedPoint *position, Direction direction) {
+	FixedPoint target = { FIXED_ROUND(position->x), FIXED_ROUND(position->y) };
+	if (target.x == position->x && target.y == position->y) {
+		target.x += FIXED_FROM_INT(direction_offsets[direction].x);
+		target.y += FIXED_FROM_INT(direction_offsets[direction].y);
+		return target;
+	}
+	if (direction == EAST && target.x < position->x)
+		target.x += FIXED_ONE;
+	else if (direction == WEST && target.x > position->x)
+		target.x -= FIXED_ONE;
+	else if (direction == SOUTH && target.y < position->y)
+		target.y += FIXED_ONE;
+	else if (direction == NORTH && target.y > position->y)
+		target.y -= FIXED_ONE;
+	return target;
+}
 
-	this->position = new_pos;
+// Turns are taken on tile centers, turning back is allowed anywhere
+static void move_controlled(Ghost *this, int delta_time, Map *map) {
+	Fixed budget = fixed_step(this->speed, delta_time);
+	Direction input = this->input_direction;
+	while (budget > 0) {
+		bool is_centered = this->position.x % FIXED_ONE == 0 && this->position.y % FIXED_ONE == 0;
+		if (is_centered) {
+			int x = FIXED_TO_INT(this->position.x);
+			int y = FIXED_TO_INT(this->position.y);
+			if (input != NONE && is_open(map, x, y, input))
+				this->current_direction = input;
+			if (!is_open(map, x, y, this->current_direction))
+				break;
+		} else if (input != NONE && input == (this->current_direction + 2) % 4) {
+			this->current_direction = input;
+		}
 
-	if (SDL_1FPoint_Distance(&this->path[(int)this->current_position_in_path + 1], &this->position) <= speed)
-		this->current_position_in_path++;
+		FixedPoint target = next_center(&this->position, this->current_direction);
+		this->position.x = approach(this->position.x, target.x, &budget);
+		this->position.y = approach(this->position.y, target.y, &budget);
+	}
 }
 
-void update_ghost(Ghost *this, int delta_time, const SDL_FPoint *player_pos, Map *map) {
+// Returns the MS left when the ghost reached the end of its path first, update_ghost() drops them
+static int step_ghost(Ghost *this, int delta_time, const FixedPoint *player_pos, Map *map, const int path_update_time) {
+	int time_left = 0;
 	switch (this->state) {
 		case WAITING: {
 			this->exit_timer -= delta_time;
-			if (this->position.y <= 13.0f) {
+			if (this->position.y <= FIXED_FROM_INT(13)) {
 				this->current_direction = SOUTH;
-			} else if (this->position.y >= 15.0f) {
+			} else if (this->position.y >= FIXED_FROM_INT(15)) {
 				this->current_direction = NORTH;
 			}
 			if (this->current_direction == NORTH)
-				this->position.y -= this->speed * delta_time / 1000.0f;
+				this->position.y -= fixed_step(this->speed, delta_time);
 			else if (this->current_direction == SOUTH)
-				this->position.y += this->speed * delta_time / 1000.0f;
+				this->position.y += fixed_step(this->speed, delta_time);
 			if (this->exit_timer <= 0)
 				this->state = ATTACKING;
 		} break;
 		case ATTACKING: {
+			if (this->is_controlled) {
+				move_controlled(this, delta_time, map);
+				break;
+			}
 			this->update_path_timer -= delta_time;
 			if (this->update_path_timer <= 0 || this->current_position_in_path + 1 >= this->path_length) {
-				this->update_path_timer = PATH_UPDATE_FREQ;
+				this->update_path_timer = path_update_time;
 				update_path(this, player_pos, map);
 			}
-			move_ghost(this, delta_time, map);
+			time_left = move_ghost(this, delta_time, map);
 		} break;
 		case FLEEING: {
+			if (this->is_controlled) {
+				move_controlled(this, delta_time, map);
+				break;
+			}
 			this->update_path_timer -= delta_time;
 			if (this->update_path_timer <= 0 || this->current_position_in_path + 1 >= this->path_length) {
-				this->update_path_timer = PATH_UPDATE_FREQ;
+				this->update_path_timer = path_update_time;
 				update_flee_path(this, player_pos, map);
 			}
-			move_ghost(this, delta_time, map);
+			time_left = move_ghost(this, delta_time, map);
 		} break;
 		case DEAD: {
 			this->update_path_timer -= delta_time;
 			if (this->update_path_timer <= 0) {
-				this->update_path_timer = PATH_UPDATE_FREQ;
+				this->update_path_timer = path_update_time;
 				update_path(this, &this->starting_position, map);
 			}
-			move_ghost(this, delta_time, map);
+			time_left = move_ghost(this, delta_time, map);
 			if (this->current_position_in_path + 1 >= this->path_length) {
 				ghost_switch_state(this, ATTACKING);
 			}
 		} break;
 	}
+	return time_left;
+}
+
+void update_ghost(Ghost *this, int delta_time, const FixedPoint *player_pos, Map *map) {
+	PROFILE_BEGIN("update_ghost");
+	step_ghost(this, delta_time, player_pos, map, PATH_UPDATE_FREQ);
+	PROFILE_END();
+}
+
+void ghost_default_lod(GhostLod *lod) {
+	SDL_zero(*lod);
+	lod->near_tiles = GHOST_LOD_NEAR_TILES;
+	lod->view_margin = GHOST_LOD_VIEW_MARGIN;
+	lod->far_interval = GHOST_LOD_FAR_INTERVAL;
+	lod->far_path_update = GHOST_LOD_FAR_PATH_UPDATE;
+}
+
+bool ghost_is_near(const Ghost *this, const FixedPoint *player_pos, const GhostLod *lod) {
+	SDL_Point tile = { FIXED_TO_INT(this->position.x + FIXED_HALF), FIXED_TO_INT(this->position.y + FIXED_HALF) };
+	SDL_Point player = { FIXED_TO_INT(player_pos->x + FIXED_HALF), FIXED_TO_INT(player_pos->y + FIXED_HALF) };
+	if (SDL_Point_Distance(&tile, &player) <= (unsigned int)lod->near_tiles)
+		return true;
+	const SDL_Rect *view = &lod->view;
+	return tile.x >= view->x - lod->view_margin && tile.x < view->x + view->w + lod->view_margin &&
+			tile.y >= view->y - lod->view_margin && tile.y < view->y + view->h + lod->view_margin;
+}
+
+// time in one go, the way the ticks it stands for would have moved the ghost
+static void step_banked(Ghost *this, int delta_time, int time, const FixedPoint *player_pos, Map *map, const int path_update_time) {
+	// The bob turns at its bounds once per step, a longer one would overshoot them. It's cheap
+	while (this->state == WAITING && time > 0) {
+		int step = SDL_min(time, delta_time);
+		step_ghost(this, step, player_pos, map, path_update_time);
+		time -= step;
+	}
+	// A path can end before the time does, the rest walks the next one
+	for (int i = 0; i < GHOST_LOD_MAX_PATHS && time > 0; i++) {
+		time = step_ghost(this, time, player_pos, map, path_update_time);
+	}
+}
+
+bool update_ghost_lod(Ghost *this, int delta_time, const FixedPoint *player_pos, Map *map, const GhostLod *lod) {
+	if (ghost_is_near(this, player_pos, lod) || this->is_controlled) {
+		if (this->banked_time == 0) {
+			update_ghost(this, delta_time, player_pos, map);
+			return true;
+		}
+		// Catches up on what it banked while far, still outside the view thanks to the margin
+		this->update_path_timer = SDL_min(this->update_path_timer, PATH_UPDATE_FREQ);
+		PROFILE_BEGIN("update_ghost");
+		step_banked(this, delta_time, delta_time + this->banked_time, player_pos, map, PATH_UPDATE_FREQ);
+		PROFILE_END();
+		this->banked_time = 0;
+		return true;
+	}
+
+	this->banked_time += delta_time;
+	if (this->banked_time < lod->far_interval * delta_time)
+		return false;
+	PROFILE_BEGIN("update_ghost_far");
+	step_banked(this, delta_time, this->banked_time, player_pos, map, lod->far_path_update);
+	this->banked_time = 0;
+	PROFILE_END();
+	return true;
 }
 
 void ghost_kill(Ghost *this) {
@@ -181,15 +344,16 @@ void ghost_kill(Ghost *this) {
 	this->update_path_timer = 0;
 }
 
-void draw_ghost(SDL_Renderer *renderer, const Ghost *ghost, const SDL_Point *camera_offset) {
-	SDL_Rect dst = { camera_offset->x + (ghost->position.x) * 16, camera_offset->y + (ghost->position.y) * 16, 16, 16 };
+void draw_ghost(RenderQueue *queue, SDL_Texture *texture, const Ghost *ghost, const SDL_Point *camera_offset) {
+	SDL_Rect dst = { camera_offset->x + (int)FIXED_TO_INT((Sint64)ghost->position.x * 16), camera_offset->y + (int)FIXED_TO_INT((Sint64)ghost->position.y * 16), 16, 16 };
 	SDL_Rect src = ghost->sprite;
 	if (ghost->state == DEAD || ghost->state == FLEEING) {
 		src.x = 32;
 		src.y = 0;
 	}
 
-	SDL_RenderCopy(renderer, ghost->texture, &src, &dst);
+	SDL_Color white = { 255, 255, 255, 255 };
+	render_queue_sprite(queue, RENDER_LAYER_GHOSTS, texture, &src, &dst, 0, white);
 }
 
 void dbg_draw_ghost(Ghost *this, SDL_Renderer *renderer, TTF_Font *font, const SDL_Point *camera_offset) {
@@ -203,12 +367,12 @@ void dbg_draw_ghost(Ghost *this, SDL_Renderer *renderer, TTF_Font *font, const S
 		SDL_Rect dst = { this->path[i].x * 16 + camera_offset->x, this->path[i].y * 16 + camera_offset->y, 16, 16 };
 		SDL_RenderDrawRect(renderer, &dst);
 	}
-	if (this->path != NULL) {
+	if (this->path_length > 0) {
 		SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
-		SDL_Rect dst = { this->path[(int)this->current_position_in_path + 1].x * 16 + camera_offset->x, this->path[(int)this->current_position_in_path + 1].y * 16 + camera_offset->y, 16, 16 };
+		SDL_Rect dst = { this->path[this->current_position_in_path + 1].x * 16 + camera_offset->x, this->path[this->current_position_in_path + 1].y * 16 + camera_offset->y, 16, 16 };
 		//SDL_RenderDrawRect(renderer, &dst);
 
-		SDL_RenderDrawLine(renderer, this->position.x * 16 + camera_offset->x, this->position.y * 16 + camera_offset->y, this->path[(int)this->current_position_in_path + 1].x * 16 + camera_offset->x, this->path[(int)this->current_position_in_path + 1].y * 16 + camera_offset->y);
+		SDL_RenderDrawLine(renderer, (int)FIXED_TO_INT((Sint64)this->position.x * 16) + camera_offset->x, (int)FIXED_TO_INT((Sint64)this->position.y * 16) + camera_offset->y, this->path[this->current_position_in_path + 1].x * 16 + camera_offset->x, this->path[this->current_position_in_path + 1].y * 16 + camera_offset->y);
 	}
 }
 
@@ -5,6 +5,7 @@
 
 #include "game.h"
 #include "map.h"
+#include "render_queue.h"
 
 #define PATH_UPDATE_FREQ 2000
 
@@ -20,12 +21,49 @@ enum GhostState {
 
 void ghost_reset(Ghost *ghost, const float speed);
 void ghost_switch_state(Ghost *ghost, const GhostState state);
-SDL_FPoint *ghost_get_pos(Ghost *ghost);
+const FixedPoint *ghost_get_pos(Ghost *ghost);
+GhostState ghost_get_state(const Ghost *ghost);
+Direction ghost_get_direction(const Ghost *ghost);
+// Spectators draw the ghost as the broadcasting game did, nothing else changes
+void ghost_set_pose(Ghost *ghost, const FixedPoint *pos, const GhostState state);
 
-Ghost *create_ghost(SDL_Renderer *renderer, const float x, const float y, const int wait_time, const int sprite_x, const int sprite_y);
+Ghost *create_ghost(const float x, const float y, const int wait_time, const int sprite_x, const int sprite_y);
 void destroy_ghost(Ghost *ghost);
-void update_ghost(Ghost *ghost, int delta_time, const SDL_FPoint *player_pos, Map *map);
-void draw_ghost(SDL_Renderer *renderer, const Ghost *ghost, const SDL_Point *camera_offset);
+// Ghosts hold no pointers, their path included, a copy is a plain struct copy
+void ghost_copy(Ghost *dst, const Ghost *src);
+void ghost_set_controlled(Ghost *ghost, const bool is_controlled);
+// NONE keeps the last direction
+void ghost_set_input(Ghost *ghost, const Direction direction);
+void update_ghost(Ghost *ghost, int delta_time, const FixedPoint *player_pos, Map *map);
+
+/*
+ * Level of detail for big mazes. Ghosts near the player or around the view are simulated every
+ * tick. Far ones bank their time and move it all at once every far_interval ticks, walking the
+ * same path node by node, and replan every far_path_update MS instead of PATH_UPDATE_FREQ. Time
+ * left when a path ends walks a new one, up to GHOST_LOD_MAX_PATHS of them, and ghosts waiting in
+ * the house still bob one tick at a time. A ghost coming near first catches up on its banked
+ * time, which the view margin keeps off screen.
+ */
+#define GHOST_LOD_NEAR_TILES 12
+#define GHOST_LOD_VIEW_MARGIN 2
+#define GHOST_LOD_FAR_INTERVAL 8
+#define GHOST_LOD_FAR_PATH_UPDATE 8000
+#define GHOST_LOD_MAX_PATHS 4 // Per banked step, more only when paths come out a node or two long
+
+typedef struct GhostLod {
+	int near_tiles; // Distance from the player, in tiles along the axes
+	SDL_Rect view; // Tiles on screen
+	int view_margin;
+	int far_interval; // Ticks
+	int far_path_update; // MS
+} GhostLod;
+
+void ghost_default_lod(GhostLod *lod);
+bool ghost_is_near(const Ghost *ghost, const FixedPoint *player_pos, const GhostLod *lod);
+// update_ghost() with the level of detail, returns false when the ghost only banked the tick
+bool update_ghost_lod(Ghost *ghost, int delta_time, const FixedPoint *player_pos, Map *map, const GhostLod *lod);
+// Every ghost draws from the same texture so they batch together
+void draw_ghost(RenderQueue *queue, SDL_Texture *texture, const Ghost *ghost, const SDL_Point *camera_offset);
 void dbg_draw_ghost(Ghost *ghost, SDL_Renderer *renderer, TTF_Font *font, const SDL_Point *camera_offset);
 void ghost_kill(Ghost *ghost);
 #endif
\ No newline at end of file
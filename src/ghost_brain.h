@@ -0,0 +1,82 @@
+#ifndef GHOST_BRAIN_H
+#define GHOST_BRAIN_H
+
+#include <stdint.h>
+
+/*
+ * The plugin ABI for ghost brains, the only header a plugin needs. A brain is a shared object
+ * exporting GHOST_BRAIN_ENTRY, which returns a GhostBrain describing it. While its ghost hunts or
+ * flees, the game calls think() once per tick with a read-only view of the maze and the entities,
+ * and the ghost turns toward the returned direction at the next tile center. Waiting in the house
+ * and returning to it as eyes stay with the built-in brain.
+ *
+ * A think() call over the game's microsecond budget is ignored and the brain sits out a while
+ * on the built-in brain, see src/brain_host.h. One brain can steer several ghosts of several
+ * games on different threads at once, so anything it keeps belongs in the state create() returns.
+ *
+ * Only fixed size types cross the boundary. Fields are only ever appended, a brain built against
+ * an older header keeps working as long as abi_version matches.
+ */
+
+#define GHOST_BRAIN_ABI_VERSION 1
+#define GHOST_BRAIN_ENTRY "ghost_brain_entry"
+#define GHOST_BRAIN_GHOSTS 4
+
+#ifdef _WIN32
+#define GHOST_BRAIN_EXPORT __declspec(dllexport)
+#else
+#define GHOST_BRAIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+// Same values as the game's Direction
+enum GhostBrainDirection {
+	GHOST_BRAIN_EAST = 0,
+	GHOST_BRAIN_SOUTH = 1,
+	GHOST_BRAIN_WEST = 2,
+	GHOST_BRAIN_NORTH = 3,
+	GHOST_BRAIN_KEEP = 4 // Keeps the last direction asked for
+};
+
+// Same values as the game's GhostState
+enum GhostBrainGhostState {
+	GHOST_BRAIN_WAITING = 0,
+	GHOST_BRAIN_ATTACKING = 1,
+	GHOST_BRAIN_FLEEING = 2,
+	GHOST_BRAIN_DEAD = 3
+};
+
+typedef struct GhostBrainEntity {
+	int32_t x; // 16.16 fixed point tiles, 65536 is one tile
+	int32_t y;
+	// GhostBrainDirection. For ghosts, their current direction, read every tick: the last one steered or the
+	// bob while waiting. Steps along an A* path don't change it, so it lags for pathfinding ghosts
+	int32_t direction;
+	int32_t state; // GhostBrainGhostState, 0 for the player
+} GhostBrainEntity;
+
+typedef struct GhostBrainView {
+	int32_t size; // sizeof(GhostBrainView) on the game's side
+	int32_t width;
+	int32_t height;
+	const uint8_t *walls; // width * height, row major, 1 where ghosts can't walk
+	int32_t tick;
+	int32_t level;
+	int32_t self; // Index of the ghost being steered in ghosts[]
+	GhostBrainEntity player;
+	GhostBrainEntity ghosts[GHOST_BRAIN_GHOSTS];
+} GhostBrainView;
+
+typedef struct GhostBrain {
+	int32_t abi_version; // GHOST_BRAIN_ABI_VERSION
+	const char *name;
+	// Both optional. State for one ghost of one game, passed back to think()
+	void *(*create)(int32_t ghost);
+	void (*destroy)(void *state);
+	// Returns a GhostBrainDirection
+	int32_t (*think)(void *state, const GhostBrainView *view);
+} GhostBrain;
+
+// The type of GHOST_BRAIN_ENTRY
+typedef const GhostBrain *(*GhostBrainEntry)(void);
+
+#endif
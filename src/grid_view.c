@@ -0,0 +1,460 @@
+#include "grid_view.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "debug.h"
+
+#include "bot.h"
+#include "game.h"
+#include "ghost.h"
+#include "map.h"
+#include "pack.h"
+#include "player.h"
+#include "render_queue.h"
+#include "spectate.h"
+
+#define FRAME_FRESH 4 // Set on the middle index when the worker published since the viewer last took it
+#define MAX_TICKS_BEHIND 8 // As run(), further behind and a worker drops the ticks instead of catching up
+#define MAZE_W (MAP_WIDTH * 16)
+#define MAZE_H (MAP_HEIGHT * 16)
+
+typedef struct GridGame {
+	Game *game;
+	Bot bot;
+	int index;
+	int played; // Games over so far, the worker's
+
+	// Triple buffered as run() does its snapshots, neither side ever waits for the other
+	SpectateFrame frames[3];
+	int back; // The worker's
+	SDL_atomic_t middle;
+	int front; // The viewer's
+
+	SDL_atomic_t ticks; // Wraps, only differences are read
+	SDL_atomic_t games_over;
+} GridGame;
+
+struct GridView;
+
+typedef struct GridWorker {
+	struct GridView *view;
+	int first; // Ticks games first, first + stride...
+	int stride;
+	SDL_Thread *thread;
+} GridWorker;
+
+typedef struct GridView {
+	const GridViewOptions *options;
+	GridGame *games;
+	int count;
+	GridWorker *workers;
+	int worker_count;
+	SDL_atomic_t is_running;
+
+	// Viewer
+	RenderQueue *queue;
+	TTF_Font *font;
+	SDL_Texture *player_texture;
+	SDL_Texture *ghost_texture;
+	SDL_Texture *walls_texture; // Baked, the whole maze
+	int caption_height;
+	Game *drawn; // Each frame is applied to it in turn and drawn from it
+} GridView;
+
+typedef struct GridLayout {
+	int columns;
+	float scale; // Of the mazes
+	float x; // Of the first cell, the grid is centered
+	float y;
+	float cell_w;
+	float cell_h;
+	bool has_captions;
+} GridLayout;
+
+void grid_view_default_options(GridViewOptions *options) {
+	options->games = GRID_VIEW_DEFAULT_GAMES;
+	options->threads = 0;
+	options->seed = 1;
+	options->randomness = 0.05f;
+	options->speed = 1.0f;
+	options->bench_frames = GRID_VIEW_DEFAULT_BENCH_FRAMES;
+}
+
+/*
+ * SIMULATION
+ */
+
+static Uint32 game_seed(Uint32 seed, int game) {
+	// Spread consecutive games over the whole seed space, as sweep does
+	Uint32 x = seed ^ ((Uint32)game * 0x9E3779B9);
+	x ^= x >> 16;
+	x *= 0x85EBCA6B;
+	x ^= x >> 13;
+	return x;
+}
+
+static void publish_frame(GridGame *this) {
+	game_get_spectate_frame(this->game, &this->frames[this->back]);
+	this->back = SDL_AtomicSet(&this->middle, this->back | FRAME_FRESH) & ~FRAME_FRESH;
+}
+
+// The latest frame, the one drawn last when there's none newer
+static const SpectateFrame *take_frame(GridGame *this) {
+	if (SDL_AtomicGet(&this->middle) & FRAME_FRESH)
+		this->front = SDL_AtomicSet(&this->middle, this->front) & ~FRAME_FRESH;
+	return &this->frames[this->front];
+}
+
+static void step_game(GridView *view, GridGame *this) {
+	bot_update(&this->bot, this->game);
+	game_update(this->game, TICK_TIME);
+	if (game_is_over(this->game)) {
+		this->played++;
+		SDL_AtomicAdd(&this->games_over, 1);
+		game_restart(this->game);
+		bot_init(&this->bot, game_seed(view->options->seed, this->played * view->count + this->index), view->options->randomness);
+	}
+	SDL_AtomicAdd(&this->ticks, 1);
+	publish_frame(this);
+}
+
+static int simulate(void *data) {
+	GridWorker *this = data;
+	GridView *view = this->view;
+
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	Uint64 period = view->options->speed > 0 ? (Uint64)(frequency * TICK_TIME / 1000 / view->options->speed) : 0;
+	Uint64 next_tick = SDL_GetPerformanceCounter();
+	while (SDL_AtomicGet(&view->is_running)) {
+		if (period != 0) {
+			// SDL_Delay() oversleeps, the last millisecond is spent polling the clock
+			Uint64 now = SDL_GetPerformanceCounter();
+			while (now < next_tick) {
+				Uint32 ms = (Uint32)((next_tick - now) * 1000 / frequency);
+				if (ms > 1)
+					SDL_Delay(ms - 1);
+				now = SDL_GetPerformanceCounter();
+			}
+			next_tick += period;
+			if (now > next_tick + MAX_TICKS_BEHIND * period)
+				next_tick = now + period;
+		}
+		for (int i = this->first; i < view->count; i += this->stride) {
+			step_game(view, &view->games[i]);
+		}
+	}
+	return 0;
+}
+
+/*
+ * SETUP
+ */
+
+static GridView *grid_create(const GridViewOptions *options) {
+	GridView *this = calloc(1, sizeof(GridView));
+	this->options = options;
+	this->count = options->games > 0 ? options->games : 1;
+	this->games = calloc(this->count, sizeof(GridGame));
+	for (int i = 0; i < this->count; i++) {
+		GridGame *game = &this->games[i];
+		game->game = game_create(NULL, NULL);
+		game->index = i;
+		bot_init(&game->bot, game_seed(options->seed, i), options->randomness);
+		// Something to draw before the first tick
+		game_get_spectate_frame(game->game, &game->frames[0]);
+		game->frames[1] = game->frames[0];
+		game->frames[2] = game->frames[0];
+		game->back = 0;
+		SDL_AtomicSet(&game->middle, 1);
+		game->front = 2;
+	}
+	this->drawn = game_create(NULL, NULL);
+	SDL_AtomicSet(&this->is_running, 1);
+	return this;
+}
+
+static bool load_assets(GridView *this, SDL_Renderer *renderer) {
+	SDL_Surface *walls = pack_load_surface("walls.png");
+	if (walls == NULL) {
+		SDL_Log("Couldn't load walls.png");
+		return false;
+	}
+	SDL_Surface *baked = map_bake_walls(game_get_map(this->drawn), walls);
+	SDL_FreeSurface(walls);
+	if (baked == NULL)
+		return false;
+	this->walls_texture = SDL_CreateTextureFromSurface(renderer, baked);
+	SDL_SetTextureBlendMode(this->walls_texture, SDL_BLENDMODE_BLEND);
+	SDL_FreeSurface(baked);
+
+	this->font = pack_load_font("unifont.ttf", 16);
+	this->queue = render_queue_create(renderer, this->font);
+	this->player_texture = pack_load_texture(renderer, "pac_man.png");
+	this->ghost_texture = pack_load_texture(renderer, "ghost.png");
+	this->caption_height = this->font != NULL ? TTF_FontHeight(this->font) : 0;
+	return true;
+}
+
+static void start_workers(GridView *this) {
+	int threads = this->options->threads;
+	if (threads <= 0)
+		threads = SDL_max(SDL_GetCPUCount() - 1, 1);
+	this->worker_count = SDL_min(threads, this->count);
+	this->workers = calloc(this->worker_count, sizeof(GridWorker));
+	for (int i = 0; i < this->worker_count; i++) {
+		GridWorker *worker = &this->workers[i];
+		worker->view = this;
+		worker->first = i;
+		worker->stride = this->worker_count;
+		worker->thread = SDL_CreateThread(simulate, "grid", worker);
+	}
+}
+
+static void stop_workers(GridView *this) {
+	SDL_AtomicSet(&this->is_running, 0);
+	for (int i = 0; i < this->worker_count; i++) {
+		SDL_WaitThread(this->workers[i].thread, NULL);
+	}
+	free(this->workers);
+	this->workers = NULL;
+	this->worker_count = 0;
+}
+
+static void grid_destroy(GridView *this) {
+	if (this->walls_texture != NULL)
+		SDL_DestroyTexture(this->walls_texture);
+	if (this->player_texture != NULL)
+		SDL_DestroyTexture(this->player_texture);
+	if (this->ghost_texture != NULL)
+		SDL_DestroyTexture(this->ghost_texture);
+	if (this->queue != NULL)
+		render_queue_destroy(this->queue);
+	if (this->font != NULL)
+		TTF_CloseFont(this->font);
+	for (int i = 0; i < this->count; i++) {
+		game_destroy(this->games[i].game);
+	}
+	game_destroy(this->drawn);
+	free(this->games);
+	free(this);
+}
+
+/*
+ * DRAWING
+ */
+
+static float fit_scale(int count, int columns, int w, int h, int caption_height) {
+	int rows = (count + columns - 1) / columns;
+	float scale_x = (float)w / columns / MAZE_W;
+	float scale_y = ((float)h / rows - caption_height) / MAZE_H;
+	return SDL_min(scale_x, scale_y);
+}
+
+// The column count leaving the mazes biggest
+static GridLayout layout_grid(const GridView *this, int w, int h) {
+	GridLayout layout;
+	layout.has_captions = true;
+	for (int pass = 0; pass < 2; pass++) {
+		int caption_height = layout.has_captions ? this->caption_height : 0;
+		layout.columns = 1;
+		layout.scale = 0;
+		for (int columns = 1; columns <= this->count; columns++) {
+			float scale = fit_scale(this->count, columns, w, h, caption_height);
+			if (scale > layout.scale) {
+				layout.columns = columns;
+				layout.scale = scale;
+			}
+		}
+		layout.cell_w = MAZE_W * layout.scale;
+		layout.cell_h = MAZE_H * layout.scale + caption_height;
+		if (layout.cell_w >= GRID_VIEW_MIN_CAPTION_WIDTH || caption_height == 0)
+			break;
+		layout.has_captions = false;
+	}
+	int rows = (this->count + layout.columns - 1) / layout.columns;
+	layout.x = (w - layout.columns * layout.cell_w) / 2;
+	layout.y = (h - rows * layout.cell_h) / 2;
+	return layout;
+}
+
+// Every game in its cell, through one queue
+static void draw_grid(GridView *this, const GridLayout *layout) {
+	RenderQueue *queue = this->queue;
+	Game *drawn = this->drawn;
+	Map *map = game_get_map(drawn);
+	SDL_Point origin = { 0, 0 };
+	SDL_Rect maze = { 0, 0, MAZE_W, MAZE_H };
+
+	for (int i = 0; i < this->count; i++) {
+		const SpectateFrame *frame = take_frame(&this->games[i]);
+		game_apply_spectate_frame(drawn, frame);
+		float x = layout->x + (i % layout->columns) * layout->cell_w;
+		float y = layout->y + (i / layout->columns) * layout->cell_h;
+
+		if (layout->has_captions) {
+			char caption[32];
+			SDL_snprintf(caption, sizeof(caption), "%06d L%d", frame->score, frame->level);
+			render_queue_set_transform(queue, x, y, 1.0f);
+			render_queue_text(queue, RENDER_LAYER_UI, caption, &origin, ALIGN_LEFT);
+			y += this->caption_height;
+		}
+
+		render_queue_set_transform(queue, x, y, layout->scale);
+		render_queue_sprite(queue, RENDER_LAYER_MAP, this->walls_texture, &maze, &maze, 0, map_get_color(map));
+		map_draw_pellets(map, queue, &origin);
+		player_draw(game_get_player(drawn), this->player_texture, queue, &origin);
+		for (int g = 0; g < GHOST_AMT; g++) {
+			draw_ghost(queue, this->ghost_texture, game_get_ghost(drawn, g), &origin);
+		}
+	}
+	render_queue_set_transform(queue, 0, 0, 1.0f);
+	render_queue_flush(queue);
+}
+
+/*
+ * VIEWER
+ */
+
+static Uint32 sum_ticks(GridView *this) {
+	Uint32 ticks = 0;
+	for (int i = 0; i < this->count; i++) {
+		ticks += (Uint32)SDL_AtomicGet(&this->games[i].ticks);
+	}
+	return ticks;
+}
+
+static int sum_games_over(GridView *this) {
+	int games = 0;
+	for (int i = 0; i < this->count; i++) {
+		games += SDL_AtomicGet(&this->games[i].games_over);
+	}
+	return games;
+}
+
+int grid_view_run(SDL_Renderer *renderer, SDL_Window *window, const GridViewOptions *options) {
+	GridView *this = grid_create(options);
+	if (!load_assets(this, renderer)) {
+		grid_destroy(this);
+		return 1;
+	}
+	start_workers(this);
+	SDL_Log("%d games on %d threads", this->count, this->worker_count);
+
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	Uint64 start = SDL_GetPerformanceCounter();
+	Uint64 last_title = start;
+	Uint32 last_ticks = sum_ticks(this);
+	Uint64 total_ticks = 0;
+	bool is_running = true;
+	while (is_running) {
+		Uint64 frame_start = SDL_GetPerformanceCounter();
+		SDL_Event e;
+		while (SDL_PollEvent(&e)) {
+			if (e.type == SDL_QUIT)
+				is_running = false;
+		}
+
+		int w = 0, h = 0;
+		render_queue_get_size(this->queue, &w, &h);
+		GridLayout layout = layout_grid(this, w, h);
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+		SDL_RenderClear(renderer);
+		draw_grid(this, &layout);
+		SDL_RenderPresent(renderer);
+
+		Uint64 now = SDL_GetPerformanceCounter();
+		if (now - last_title >= frequency) {
+			Uint32 ticks = sum_ticks(this);
+			total_ticks += ticks - last_ticks;
+			double ticks_per_sec = (ticks - last_ticks) * (double)frequency / (now - last_title);
+			RenderQueueStats stats = render_queue_get_stats(this->queue);
+			char title[128];
+			SDL_snprintf(title, sizeof(title), "Pacman grid: %d games, %.0f ticks/sec, %d played, %d batches",
+					this->count, ticks_per_sec, sum_games_over(this), stats.batches);
+			SDL_SetWindowTitle(window, title);
+			last_title = now;
+			last_ticks = ticks;
+		}
+
+		// No point drawing faster than the games tick in real time
+		Uint32 elapsed_ms = (Uint32)((now - frame_start) * 1000 / frequency);
+		if (elapsed_ms < TICK_TIME)
+			SDL_Delay(TICK_TIME - elapsed_ms);
+	}
+
+	stop_workers(this);
+	total_ticks += sum_ticks(this) - last_ticks;
+	double seconds = (double)(SDL_GetPerformanceCounter() - start) / frequency;
+	SDL_Log("%llu ticks in %.1f s, %.0f ticks/sec, %d games played", (unsigned long long)total_ticks, seconds,
+			total_ticks / seconds, sum_games_over(this));
+	grid_destroy(this);
+	return 0;
+}
+
+/*
+ * BENCH
+ */
+
+int grid_view_bench_run(const GridViewOptions *options) {
+	SDL_Surface *target = SDL_CreateRGBSurfaceWithFormat(0, GRID_VIEW_DEFAULT_WIDTH, GRID_VIEW_DEFAULT_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+	SDL_Renderer *renderer = SDL_CreateSoftwareRenderer(target);
+	// The way without the grid: every game applied to one drawable game and drawn by draw()
+	Game *reference = game_create(renderer, NULL);
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	int frames = options->bench_frames > 0 ? options->bench_frames : 1;
+
+	printf("Grid of %dx%d, %d frames per count, software renderer\n", GRID_VIEW_DEFAULT_WIDTH, GRID_VIEW_DEFAULT_HEIGHT, frames);
+	printf("%6s %10s %8s %12s %10s %8s\n", "games", "grid ms", "batches", "draw() ms", "batches", "speedup");
+	int max_games = options->games > 0 ? options->games : 1;
+	for (int count = 1;; count = SDL_min(count * 4, max_games)) {
+		GridViewOptions count_options = *options;
+		count_options.games = count;
+		GridView *view = grid_create(&count_options);
+		if (!load_assets(view, renderer)) {
+			grid_destroy(view);
+			break;
+		}
+		int w = 0, h = 0;
+		render_queue_get_size(view->queue, &w, &h);
+		GridLayout layout = layout_grid(view, w, h);
+
+		Uint64 grid_time = 0, draw_time = 0;
+		int grid_batches = 0, draw_batches = 0;
+		for (int f = 0; f < frames; f++) {
+			// Ticked inline, the frames are the same whatever the machine
+			for (int i = 0; i < view->count; i++) {
+				step_game(view, &view->games[i]);
+			}
+
+			Uint64 grid_start = SDL_GetPerformanceCounter();
+			SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+			SDL_RenderClear(renderer);
+			draw_grid(view, &layout);
+			SDL_RenderPresent(renderer);
+			Uint64 draw_start = SDL_GetPerformanceCounter();
+			grid_time += draw_start - grid_start;
+			grid_batches += render_queue_get_stats(view->queue).batches;
+
+			for (int i = 0; i < view->count; i++) {
+				game_apply_spectate_frame(reference, &view->games[i].frames[view->games[i].front]);
+				game_draw(reference, renderer);
+				draw_batches += game_get_render_stats(reference).batches;
+			}
+			draw_time += SDL_GetPerformanceCounter() - draw_start;
+		}
+
+		double grid_ms = grid_time * 1000.0 / frequency / frames;
+		double draw_ms = draw_time * 1000.0 / frequency / frames;
+		printf("%6d %10.3f %8.1f %12.3f %10.1f %7.1fx\n", count, grid_ms, (double)grid_batches / frames, draw_ms,
+				(double)draw_batches / frames, grid_ms > 0 ? draw_ms / grid_ms : 0.0);
+		grid_destroy(view);
+		if (count == max_games)
+			break;
+	}
+
+	game_destroy(reference);
+	SDL_DestroyRenderer(renderer);
+	SDL_FreeSurface(target);
+	return 0;
+}
@@ -0,0 +1,45 @@
+#ifndef GRID_VIEW_H
+#define GRID_VIEW_H
+
+#include "SDL2/SDL.h"
+
+#include "utils.h"
+
+/*
+ * Batch simulations watched live: N bot games laid out in a grid in one window, each scaled down
+ * into its own cell with its score above it.
+ *
+ * Worker threads each tick their share of the games, at TICK_TIME times the speed or as fast as
+ * they can. After every tick a game's SpectateFrame is written to a triple buffer and the worker
+ * goes on, it never waits for the viewer. The main thread samples the latest frame of each game,
+ * the last one it drew when there's nothing new, and draws them all through one render queue
+ * moved and scaled for each cell. A game over starts the next game at once with a new seed.
+ *
+ * Every game shares the sprite sheets and one texture of the maze walls baked at startup, so a
+ * cell is one wall quad, its pellets and five sprites instead of the 868 tiles draw() pushes.
+ * The queue sorts all of it into a handful of SDL_RenderGeometry calls whatever the number of
+ * games: walls, pellets, the player, the ghosts and the captions.
+ */
+
+#define GRID_VIEW_DEFAULT_GAMES 16
+#define GRID_VIEW_DEFAULT_WIDTH 1280
+#define GRID_VIEW_DEFAULT_HEIGHT 720
+#define GRID_VIEW_DEFAULT_BENCH_FRAMES 120
+#define GRID_VIEW_MIN_CAPTION_WIDTH 64 // Narrower cells go without
+
+typedef struct GridViewOptions {
+	int games;
+	int threads; // 0 for every core but the viewer's
+	Uint32 seed; // Of the first games, the next ones are derived from it
+	float randomness; // Of the bots, as bot_init()
+	float speed; // 1 plays in real time, 0 as fast as the threads go
+	int bench_frames; // Per game count, for grid_view_bench_run()
+} GridViewOptions;
+
+void grid_view_default_options(GridViewOptions *options);
+// Draws the games on renderer until the window is closed, the title shows ticks/sec and games played
+int grid_view_run(SDL_Renderer *renderer, SDL_Window *window, const GridViewOptions *options);
+// Headless, software renderer: time of one grid frame against one draw() per game, counts 1, 4, 16... up to games
+int grid_view_bench_run(const GridViewOptions *options);
+
+#endif
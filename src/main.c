@@ -1,12 +1,24 @@
 #include "SDL2/SDL.h"
 #include "SDL2/SDL_image.h"
-#include "SDL2/SDL_mixer.h"
 #include "SDL2/SDL_ttf.h"
 
 #include "debug.h"
 #include "utils.h"
 
+#include "audio.h"
+#include "brain_host.h"
 #include "game.h"
+#include "grid_view.h"
+#include "maze_bench.h"
+#include "mcts.h"
+#include "pack.h"
+#include "regress.h"
+#include "render_bench.h"
+#include "rollback.h"
+#include "spectate.h"
+#include "sweep.h"
+#include "vec_env.h"
+#include "video_export.h"
 
 /*
 	Fix the mem leaks
@@ -20,28 +32,363 @@
 		Eye srpite
 */
 
+enum Mode {
+	MODE_PLAY,
+	MODE_RENDER_BENCH,
+	MODE_SWEEP,
+	MODE_MCTS_BENCH,
+	MODE_ROLLBACK_BENCH,
+	MODE_AUDIO_BENCH,
+	MODE_MAZE_BENCH,
+	MODE_VIDEO_EXPORT,
+	MODE_ENV_BENCH,
+	MODE_SPECTATE,
+	MODE_SPECTATE_BENCH,
+	MODE_REGRESS,
+	MODE_REGRESS_RECORD,
+	MODE_SOFT_RENDER_BENCH,
+	MODE_GRID,
+	MODE_GRID_BENCH
+} typedef Mode;
+
+static void parse_tick_list(const char *list, RenderBenchOptions *options) {
+	options->golden_tick_count = 0;
+	while (*list != '\0' && options->golden_tick_count < RENDER_BENCH_MAX_GOLDEN_TICKS) {
+		char *end = NULL;
+		options->golden_ticks[options->golden_tick_count++] = SDL_strtol(list, &end, 10);
+		list = *end == ',' ? end + 1 : end;
+	}
+}
+
 int main(int argc, char *args[]) {
+	Mode mode = MODE_PLAY;
+	RenderBenchOptions bench_options;
+	render_bench_default_options(&bench_options);
+	SweepOptions sweep_options;
+	sweep_default_options(&sweep_options);
+	MctsBenchOptions mcts_options;
+	mcts_bench_default_options(&mcts_options);
+	RunOptions run_options;
+	SDL_zero(run_options);
+	run_options.brain_budget_us = BRAIN_DEFAULT_BUDGET_US;
+	const char *brain_paths[GHOST_AMT] = { NULL };
+	RollbackOptions versus_options;
+	rollback_default_options(&versus_options);
+	AudioOptions audio_options;
+	audio_default_options(&audio_options);
+	MazeBenchOptions maze_options;
+	maze_bench_default_options(&maze_options);
+	VideoExportOptions video_options;
+	video_export_default_options(&video_options);
+	VecEnvBenchOptions env_options;
+	vec_env_bench_default_options(&env_options);
+	Uint16 spectate_port = SPECTATE_DEFAULT_PORT;
+	SpectateBenchOptions spectate_options;
+	spectate_bench_default_options(&spectate_options);
+	RegressOptions regress_options;
+	regress_default_options(&regress_options);
+	const char *record_path = NULL;
+	GridViewOptions grid_options;
+	grid_view_default_options(&grid_options);
+
+	for (int i = 1; i < argc; i++) {
+		bool has_value = i + 1 < argc;
+		if (SDL_strcmp(args[i], "--render-bench") == 0) {
+			mode = MODE_RENDER_BENCH;
+		} else if (SDL_strcmp(args[i], "--golden-write") == 0 && has_value) {
+			mode = MODE_RENDER_BENCH;
+			bench_options.golden_mode = GOLDEN_WRITE;
+			bench_options.golden_dir = args[++i];
+		} else if (SDL_strcmp(args[i], "--golden-check") == 0 && has_value) {
+			mode = MODE_RENDER_BENCH;
+			bench_options.golden_mode = GOLDEN_CHECK;
+			bench_options.golden_dir = args[++i];
+		} else if (SDL_strcmp(args[i], "--golden-ticks") == 0 && has_value) {
+			parse_tick_list(args[++i], &bench_options);
+		} else if (SDL_strcmp(args[i], "--ticks") == 0 && has_value) {
+			bench_options.ticks = SDL_atoi(args[++i]);
+			video_options.ticks = bench_options.ticks;
+			spectate_options.ticks = bench_options.ticks;
+		} else if (SDL_strcmp(args[i], "--tolerance") == 0 && has_value) {
+			bench_options.tolerance = SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--dirty-rects") == 0) {
+			run_options.dirty_rects = true;
+			bench_options.dirty_rects = true;
+		} else if (SDL_strcmp(args[i], "--soft-render") == 0) {
+			run_options.soft_render = true;
+			bench_options.soft_render = true;
+		} else if (SDL_strcmp(args[i], "--soft-render-bench") == 0) {
+			mode = MODE_SOFT_RENDER_BENCH;
+		} else if (SDL_strcmp(args[i], "--sweep") == 0 && has_value) {
+			mode = MODE_SWEEP;
+			if (!sweep_parse(&sweep_options, args[++i])) {
+				SDL_Log("Invalid sweep %s", args[i]);
+				return 1;
+			}
+		} else if (SDL_strcmp(args[i], "--autopilot") == 0) {
+			run_options.autopilot = true;
+		} else if (SDL_strcmp(args[i], "--ghost-brain") == 0 && has_value) {
+			// --ghost-brain <ghost>:<path>
+			char *end = NULL;
+			int ghost = SDL_strtol(args[++i], &end, 10);
+			if (*end != ':' || ghost < 0 || ghost >= GHOST_AMT) {
+				SDL_Log("Invalid ghost brain %s", args[i]);
+				return 1;
+			}
+			brain_paths[ghost] = end + 1;
+		} else if (SDL_strcmp(args[i], "--brain-budget") == 0 && has_value) {
+			run_options.brain_budget_us = SDL_atoi(args[++i]);
+			sweep_options.brain_budget_us = run_options.brain_budget_us;
+		} else if (SDL_strcmp(args[i], "--mcts-bench") == 0) {
+			mode = MODE_MCTS_BENCH;
+		} else if (SDL_strcmp(args[i], "--versus") == 0 && i + 3 < argc) {
+			// --versus pacman|ghost <local port> <remote port>
+			run_options.versus = &versus_options;
+			versus_options.side = SDL_strcmp(args[++i], "ghost") == 0 ? SIDE_GHOST : SIDE_PLAYER;
+			versus_options.local_port = (Uint16)SDL_atoi(args[++i]);
+			versus_options.remote_port = (Uint16)SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--input-delay") == 0 && has_value) {
+			versus_options.input_delay = SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--rollback") == 0 && has_value) {
+			versus_options.max_rollback = SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--latency") == 0 && has_value) {
+			versus_options.conditions.latency_ms = SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--jitter") == 0 && has_value) {
+			versus_options.conditions.jitter_ms = SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--loss") == 0 && has_value) {
+			versus_options.conditions.loss_percent = SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--rollback-bench") == 0) {
+			mode = MODE_ROLLBACK_BENCH;
+		} else if (SDL_strcmp(args[i], "--audio-frames") == 0 && has_value) {
+			audio_options.buffer_frames = SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--audio-bench") == 0) {
+			mode = MODE_AUDIO_BENCH;
+		} else if (SDL_strcmp(args[i], "--maze-bench") == 0) {
+			mode = MODE_MAZE_BENCH;
+		} else if (SDL_strcmp(args[i], "--maze-sizes") == 0 && has_value) {
+			mode = MODE_MAZE_BENCH;
+			if (!maze_bench_parse_sizes(&maze_options, args[++i])) {
+				SDL_Log("Invalid maze sizes %s", args[i]);
+				return 1;
+			}
+		} else if (SDL_strcmp(args[i], "--maze-file") == 0 && has_value) {
+			mode = MODE_MAZE_BENCH;
+			if (maze_options.file_count < MAZE_BENCH_MAX_FILES)
+				maze_options.files[maze_options.file_count++] = args[++i];
+			else
+				SDL_Log("Too many maze files, %s skipped", args[++i]);
+		} else if (SDL_strcmp(args[i], "--video") == 0 && has_value) {
+			mode = MODE_VIDEO_EXPORT;
+			video_options.out_path = args[++i];
+		} else if (SDL_strcmp(args[i], "--video-queue") == 0 && has_value) {
+			video_options.queue_frames = SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--video-serial") == 0) {
+			video_options.is_serial = true;
+		} else if (SDL_strcmp(args[i], "--env-bench") == 0) {
+			mode = MODE_ENV_BENCH;
+		} else if (SDL_strcmp(args[i], "--envs") == 0 && has_value) {
+			env_options.env.envs = SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--env-steps") == 0 && has_value) {
+			env_options.steps = SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--ticks-per-step") == 0 && has_value) {
+			env_options.env.ticks_per_step = SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--no-observations") == 0) {
+			env_options.observe = false;
+		} else if (SDL_strcmp(args[i], "--broadcast") == 0 && has_value) {
+			run_options.broadcast_port = (Uint16)SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--spectate") == 0 && has_value) {
+			mode = MODE_SPECTATE;
+			spectate_port = (Uint16)SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--spectate-bench") == 0) {
+			mode = MODE_SPECTATE_BENCH;
+		} else if (SDL_strcmp(args[i], "--spectators") == 0 && has_value) {
+			spectate_options.max_viewers = SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--regress") == 0 && has_value) {
+			mode = MODE_REGRESS;
+			regress_options.suite_path = args[++i];
+		} else if (SDL_strcmp(args[i], "--regress-baseline") == 0 && has_value) {
+			regress_options.baseline_path = args[++i];
+		} else if (SDL_strcmp(args[i], "--regress-tolerance") == 0 && has_value) {
+			regress_options.tolerance = (float)SDL_atof(args[++i]);
+		} else if (SDL_strcmp(args[i], "--regress-runs") == 0 && has_value) {
+			regress_options.runs = SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--regress-update") == 0) {
+			regress_options.update = true;
+		} else if (SDL_strcmp(args[i], "--regress-record") == 0 && has_value) {
+			mode = MODE_REGRESS_RECORD;
+			record_path = args[++i];
+		} else if (SDL_strcmp(args[i], "--grid") == 0 && has_value) {
+			mode = MODE_GRID;
+			grid_options.games = SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--grid-speed") == 0 && has_value) {
+			grid_options.speed = (float)SDL_atof(args[++i]);
+		} else if (SDL_strcmp(args[i], "--grid-bench") == 0 && has_value) {
+			mode = MODE_GRID_BENCH;
+			grid_options.games = SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--rollouts") == 0 && has_value) {
+			mcts_options.rollouts = SDL_atoi(args[++i]);
+		} else if (SDL_strcmp(args[i], "--games") == 0 && has_value) {
+			sweep_options.games = SDL_atoi(args[++i]);
+			mcts_options.games = sweep_options.games;
+		} else if (SDL_strcmp(args[i], "--threads") == 0 && has_value) {
+			sweep_options.threads = SDL_atoi(args[++i]);
+			video_options.threads = sweep_options.threads;
+			env_options.env.threads = sweep_options.threads;
+			grid_options.threads = sweep_options.threads;
+		} else if (SDL_strcmp(args[i], "--max-ticks") == 0 && has_value) {
+			sweep_options.max_ticks = SDL_atoi(args[++i]);
+			mcts_options.max_ticks = sweep_options.max_ticks;
+		} else if (SDL_strcmp(args[i], "--seed") == 0 && has_value) {
+			sweep_options.seed = (Uint32)SDL_strtoul(args[++i], NULL, 10);
+			mcts_options.seed = sweep_options.seed;
+			maze_options.seed = sweep_options.seed;
+			video_options.seed = sweep_options.seed;
+			env_options.seed = sweep_options.seed;
+			spectate_options.seed = sweep_options.seed;
+			grid_options.seed = sweep_options.seed;
+		} else if (SDL_strcmp(args[i], "--randomness") == 0 && has_value) {
+			sweep_options.randomness = (float)SDL_atof(args[++i]);
+			video_options.randomness = sweep_options.randomness;
+			grid_options.randomness = sweep_options.randomness;
+		} else if (SDL_strcmp(args[i], "--no-fast-forward") == 0) {
+			sweep_options.fast_forward = false;
+		} else if (SDL_strcmp(args[i], "--out") == 0 && has_value) {
+			sweep_options.out_path = args[++i];
+		} else {
+			SDL_Log("Unknown argument %s", args[i]);
+		}
+	}
+
+	if (mode != MODE_PLAY && mode != MODE_SPECTATE && mode != MODE_GRID) {
+		// No window, no sound card
+		SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+		SDL_SetHint(SDL_HINT_AUDIODRIVER, "dummy");
+	}
+
+	BrainPlugin *brains[GHOST_AMT] = { NULL };
+	for (int i = 0; i < GHOST_AMT; i++) {
+		if (brain_paths[i] == NULL)
+			continue;
+		brains[i] = brain_load(brain_paths[i]);
+		if (brains[i] == NULL)
+			return 1;
+		run_options.brains[i] = brains[i];
+		sweep_options.brains[i] = brains[i];
+	}
+
 	SDL_Init(SDL_INIT_EVERYTHING);
 	IMG_Init(IMG_INIT_PNG);
 	TTF_Init();
-	Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 4096);
-    
-	SDL_Window *window = NULL;
-	window = SDL_CreateWindow("Pacman", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 16 * 28, 16 * 32, 0);
-    
-	SDL_Renderer *renderer = NULL;
-	renderer = SDL_CreateRenderer(window, -1, 0);
-    
-	run(renderer, window);
-    
-	SDL_DestroyRenderer(renderer);
-	SDL_DestroyWindow(window);
-    
-	Mix_CloseAudio();
+	pack_open(PACK_FILE_NAME);
+	metrics_init();
+
+	int exit_code = 0;
+	switch (mode) {
+		case MODE_PLAY: {
+			SDL_Window *window = NULL;
+			window = SDL_CreateWindow("Pacman", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 16 * 28, 16 * 32, 0);
+
+			SDL_Renderer *renderer = NULL;
+			if (run_options.dirty_rects || run_options.soft_render) {
+				// Drawn straight into the window surface, run() presents the changed parts of it
+				renderer = SDL_CreateSoftwareRenderer(SDL_GetWindowSurface(window));
+			} else {
+				renderer = SDL_CreateRenderer(window, -1, 0);
+			}
+
+			audio_open(&audio_options);
+			run(renderer, window, &run_options);
+			AudioStats audio_stats = audio_get_stats();
+			audio_log_stats(&audio_stats);
+			audio_close();
+
+			SDL_DestroyRenderer(renderer);
+			SDL_DestroyWindow(window);
+		} break;
+
+		case MODE_SPECTATE: {
+			SDL_Window *window = SDL_CreateWindow("Pacman spectator", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 16 * 28, 16 * 32, 0);
+			SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, 0);
+			exit_code = spectate_run(renderer, spectate_port);
+			SDL_DestroyRenderer(renderer);
+			SDL_DestroyWindow(window);
+		} break;
+
+		case MODE_GRID: {
+			SDL_Window *window = SDL_CreateWindow("Pacman grid", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, GRID_VIEW_DEFAULT_WIDTH, GRID_VIEW_DEFAULT_HEIGHT, SDL_WINDOW_RESIZABLE);
+			SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, 0);
+			exit_code = grid_view_run(renderer, window, &grid_options);
+			SDL_DestroyRenderer(renderer);
+			SDL_DestroyWindow(window);
+		} break;
+
+		case MODE_GRID_BENCH: {
+			exit_code = grid_view_bench_run(&grid_options);
+		} break;
+
+		case MODE_RENDER_BENCH: {
+			exit_code = render_bench_run(&bench_options);
+		} break;
+
+		case MODE_SOFT_RENDER_BENCH: {
+			exit_code = render_bench_compare(&bench_options);
+		} break;
+
+		case MODE_SWEEP: {
+			exit_code = sweep_run(&sweep_options);
+		} break;
+
+		case MODE_MCTS_BENCH: {
+			exit_code = mcts_bench_run(&mcts_options);
+		} break;
+
+		case MODE_ROLLBACK_BENCH: {
+			exit_code = rollback_bench_run();
+		} break;
+
+		case MODE_AUDIO_BENCH: {
+			exit_code = audio_bench_run();
+		} break;
+
+		case MODE_MAZE_BENCH: {
+			exit_code = maze_bench_run(&maze_options);
+		} break;
+
+		case MODE_VIDEO_EXPORT: {
+			exit_code = video_export_run(&video_options);
+		} break;
+
+		case MODE_ENV_BENCH: {
+			exit_code = vec_env_bench_run(&env_options);
+		} break;
+
+		case MODE_SPECTATE_BENCH: {
+			exit_code = spectate_bench_run(&spectate_options);
+		} break;
+
+		case MODE_REGRESS: {
+			exit_code = regress_run(&regress_options);
+		} break;
+
+		case MODE_REGRESS_RECORD: {
+			exit_code = regress_record(record_path);
+		} break;
+	}
+
+	for (int i = 0; i < GHOST_AMT; i++) {
+		if (brains[i] == NULL)
+			continue;
+		brain_log_stats(brains[i]);
+		brain_unload(brains[i]);
+	}
+
+	pack_close();
+	metrics_shutdown();
 	TTF_Quit();
 	IMG_Quit();
 	SDL_Quit();
-    
+
+	PROFILE_SHUTDOWN();
 	DBG_dump_memory_leaks();
-	return 0;
-}
\ No newline at end of file
+	return exit_code;
+}
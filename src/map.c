@@ -1,171 +1,291 @@
 #include "map.h"
 
-typedef Tile TileMap[MAP_SIZE];
-typedef int CollisionMap[MAP_SIZE];
+/*
+ * The layout, walls, pellets and collisions, is shared read only by every map. A map only
+ * carries which pellets are left and the wall color, so thousands of games fit in cache.
+ * The pellet bits follow the header in the same allocation, sized for the layout.
+ * The map keeps the Zobrist hash of its pellets up to date as they are eaten.
+ */
+
+#define PELLET_WORDS(tiles) (((tiles) + 31) / 32)
 
 struct Map_ {
-	TileMap tile_map;
-	CollisionMap collision_map;
-	SDL_Texture *texture;
-	SDL_Rect rect;
+	const MapLayout *layout;
+	SDL_Color color;
+	Uint64 hash; // XOR of the ZOBRIST_PELLET keys of the pellets left
+	Uint32 pellets[]; // One bit per tile, set while its pellet or power up is uneaten
+};
+
+static const SDL_Color wall_color = { 0, 0, 255, 255 };
+static const SDL_Color blink_color = { 255, 255, 255, 255 };
+static const SDL_Color pellet_color = { 255, 255, 255, 255 };
+
+static const Sint8 default_tiles[MAP_SIZE] = {
+	00, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 01, 00, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 01,
+	05, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, 05, 05, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, 05,
+	05, -2, 00, 02, 02, 01, -2, 00, 02, 02, 02, 01, -2, 05, 05, -2, 00, 02, 02, 02, 01, -2, 00, 02, 02, 01, -2, 05,
+	05, -3, 05, -1, -1, 05, -2, 05, -1, -1, -1, 05, -2, 05, 05, -2, 05, -1, -1, -1, 05, -2, 05, -1, -1, 05, -3, 05,
+	05, -2, 03, 02, 02, 04, -2, 03, 02, 02, 02, 04, -2, 03, 04, -2, 03, 02, 02, 02, 04, -2, 03, 02, 02, 04, -2, 05,
+	05, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, 05,
+	05, -2, 00, 02, 02, 01, -2, 00, 01, -2, 00, 02, 02, 02, 02, 02, 02, 01, -2, 00, 01, -2, 00, 02, 02, 01, -2, 05,
+	05, -2, 03, 02, 02, 04, -2, 05, 05, -2, 03, 02, 02, 01, 00, 02, 02, 04, -2, 05, 05, -2, 03, 02, 02, 04, -2, 05,
+	05, -2, -2, -2, -2, -2, -2, 05, 05, -2, -2, -2, -2, 05, 05, -2, -2, -2, -2, 05, 05, -2, -2, -2, -2, -2, -2, 05,
+	03, 02, 02, 02, 02, 01, -2, 05, 03, 02, 02, 01, -1, 05, 05, -1, 00, 02, 02, 04, 05, -2, 00, 02, 02, 02, 02, 04,
+	-1, -1, -1, -1, -1, 05, -2, 05, 00, 02, 02, 04, -1, 03, 04, -1, 03, 02, 02, 01, 05, -2, 05, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, 05, -2, 05, 05, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 05, 05, -2, 05, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, 05, -2, 05, 05, -1, 00, 02, 02, 02, 02, 02, 02, 01, -1, 05, 05, -2, 05, -1, -1, -1, -1, -1,
+	02, 02, 02, 02, 02, 04, -2, 03, 04, -1, 05, -1, -1, -1, -1, -1, -1, 05, -1, 03, 04, -2, 03, 02, 02, 02, 02, 02,
+	-1, -1, -1, -1, -1, -1, -2, -1, -1, -1, 05, -1, -1, -1, -1, -1, -1, 05, -1, -1, -1, -2, -1, -1, -1, -1, -1, -1,
+	02, 02, 02, 02, 02, 01, -2, 00, 01, -1, 05, -1, -1, -1, -1, -1, -1, 05, -1, 00, 01, -2, 00, 02, 02, 02, 02, 02,
+	-1, -1, -1, -1, -1, 05, -2, 05, 05, -1, 03, 02, 02, 02, 02, 02, 02, 04, -1, 05, 05, -2, 05, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, 05, -2, 05, 05, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 05, 05, -2, 05, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, 05, -2, 05, 05, -1, 00, 02, 02, 02, 02, 02, 02, 01, -1, 05, 05, -2, 05, -1, -1, -1, -1, -1,
+	00, 02, 02, 02, 02, 04, -2, 03, 04, -1, 03, 02, 02, 01, 00, 02, 02, 04, -1, 03, 04, -2, 03, 02, 02, 02, 02, 01,
+	05, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, 05, 05, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, 05,
+	05, -2, 00, 02, 02, 01, -2, 00, 02, 02, 02, 01, -2, 05, 05, -2, 00, 02, 02, 02, 01, -2, 00, 02, 02, 01, -2, 05,
+	05, -2, 03, 02, 01, 05, -2, 03, 02, 02, 02, 04, -2, 03, 04, -2, 03, 02, 02, 02, 04, -2, 05, 00, 02, 04, -2, 05,
+	05, -3, -2, -2, 05, 05, -2, -2, -2, -2, -2, -2, -2, -1, -1, -2, -2, -2, -2, -2, -2, -2, 05, 05, -2, -2, -3, 05,
+	03, 02, 01, -2, 05, 05, -2, 00, 01, -2, 00, 02, 02, 02, 02, 02, 02, 01, -2, 00, 01, -2, 05, 05, -2, 00, 02, 04,
+	00, 02, 04, -2, 03, 04, -2, 05, 05, -2, 03, 02, 02, 01, 00, 02, 02, 04, -2, 05, 05, -2, 03, 04, -2, 03, 02, 01,
+	05, -2, -2, -2, -2, -2, -2, 05, 05, -2, -2, -2, -2, 05, 05, -2, -2, -2, -2, 05, 05, -2, -2, -2, -2, -2, -2, 05,
+	05, -2, 00, 02, 02, 02, 02, 04, 03, 02, 02, 01, -2, 05, 05, -2, 00, 02, 02, 04, 03, 02, 02, 02, 02, 01, -2, 05,
+	05, -2, 03, 02, 02, 02, 02, 02, 02, 02, 02, 04, -2, 03, 04, -2, 03, 02, 02, 02, 02, 02, 02, 02, 02, 04, -2, 05,
+	05, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, 05,
+	03, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 04
 };
 
-Map *map_load(SDL_Renderer *renderer) {
-	Map *this = calloc(1, sizeof(Map));
-	this->texture = IMG_LoadTexture(renderer, "resources/walls.png");
-	SDL_SetTextureColorMod(this->texture, 0, 0, 255);
-	this->rect.x = 16;
-	this->rect.y = 16;
-	this->rect.w = MAP_WIDTH;
-	this->rect.h = MAP_HEIGHT;
-
-	// Bit map of collision
-	// First bit is player, second is ghost
-	// 1 = solid
-	CollisionMap collmap2 = {
-		3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
-		3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3,
-		3, 0, 3, 3, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 3, 3, 0, 3,
-		3, 0, 3, 0, 0, 3, 0, 3, 0, 0, 0, 3, 0, 3, 3, 0, 3, 0, 0, 0, 3, 0, 3, 0, 0, 3, 0, 3,
-		3, 0, 3, 3, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 3, 3, 0, 3,
-		3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3,
-		3, 0, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 0, 3,
-		3, 0, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 0, 3,
-		3, 0, 0, 0, 0, 0, 0, 3, 3, 0, 0, 0, 0, 3, 3, 0, 0, 0, 0, 3, 3, 0, 0, 0, 0, 0, 0, 3,
-		3, 3, 3, 3, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 3, 3, 3, 3,
-		0, 0, 0, 0, 0, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 0, 0, 0, 0, 0,
-		0, 0, 0, 0, 0, 3, 0, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 3, 0, 3, 0, 0, 0, 0, 0,
-		0, 0, 0, 0, 0, 3, 0, 3, 3, 0, 3, 3, 3, 1, 1, 3, 3, 3, 0, 3, 3, 0, 3, 0, 0, 0, 0, 0,
-		3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 0, 0, 0, 0, 0, 0, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3,
-		2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2,
-		3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 0, 0, 0, 0, 0, 0, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3,
-		0, 0, 0, 0, 0, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 0, 0, 0, 0, 0,
-		0, 0, 0, 0, 0, 3, 0, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 3, 0, 3, 0, 0, 0, 0, 0,
-		0, 0, 0, 0, 0, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 0, 0, 0, 0, 0,
-		3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3,
-		3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3,
-		3, 0, 3, 3, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 3, 3, 0, 3,
-		3, 0, 3, 3, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 3, 3, 0, 3,
-		3, 0, 0, 0, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 3, 0, 0, 0, 3,
-		3, 3, 3, 0, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 0, 3, 3, 3,
-		3, 3, 3, 0, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 0, 3, 3, 3,
-		3, 0, 0, 0, 0, 0, 0, 3, 3, 0, 0, 0, 0, 3, 3, 0, 0, 0, 0, 3, 3, 0, 0, 0, 0, 0, 0, 3,
-		3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3,
-		3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3,
-		3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3,
-		3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3
-	};
-	SDL_memcpy(this->collision_map, &collmap2, MAP_SIZE * sizeof(int));
+// First bit is player, second is ghost
+static const Uint8 default_collisions[MAP_SIZE] = {
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+	3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3,
+	3, 0, 3, 3, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 3, 3, 0, 3,
+	3, 0, 3, 0, 0, 3, 0, 3, 0, 0, 0, 3, 0, 3, 3, 0, 3, 0, 0, 0, 3, 0, 3, 0, 0, 3, 0, 3,
+	3, 0, 3, 3, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 3, 3, 0, 3,
+	3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3,
+	3, 0, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 0, 3,
+	3, 0, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 0, 3,
+	3, 0, 0, 0, 0, 0, 0, 3, 3, 0, 0, 0, 0, 3, 3, 0, 0, 0, 0, 3, 3, 0, 0, 0, 0, 0, 0, 3,
+	3, 3, 3, 3, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 3, 3, 3, 3,
+	0, 0, 0, 0, 0, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 3, 0, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 3, 0, 3, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 3, 0, 3, 3, 0, 3, 3, 3, 1, 1, 3, 3, 3, 0, 3, 3, 0, 3, 0, 0, 0, 0, 0,
+	3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 0, 0, 0, 0, 0, 0, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3,
+	2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2,
+	3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 0, 0, 0, 0, 0, 0, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3,
+	0, 0, 0, 0, 0, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 3, 0, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 3, 0, 3, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 0, 0, 0, 0, 0,
+	3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3,
+	3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3,
+	3, 0, 3, 3, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 3, 3, 0, 3,
+	3, 0, 3, 3, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 3, 3, 0, 3,
+	3, 0, 0, 0, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 3, 0, 0, 0, 3,
+	3, 3, 3, 0, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 0, 3, 3, 3,
+	3, 3, 3, 0, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 0, 3, 3, 3,
+	3, 0, 0, 0, 0, 0, 0, 3, 3, 0, 0, 0, 0, 3, 3, 0, 0, 0, 0, 3, 3, 0, 0, 0, 0, 0, 0, 3,
+	3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3,
+	3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3,
+	3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3
+};
+
+static const MapLayout default_layout = { MAP_WIDTH, MAP_HEIGHT, default_tiles, default_collisions };
+
+static size_t instance_size(const MapLayout *layout) {
+	return sizeof(Map) + PELLET_WORDS(layout->width * layout->height) * sizeof(Uint32);
+}
+
+Map *map_load() {
+	return map_create(&default_layout);
+}
 
+Map *map_create(const MapLayout *layout) {
+	Map *this = calloc(1, instance_size(layout));
+	this->layout = layout;
+	this->color = wall_color;
 	return this;
 }
 
 void reset_map(Map *this) {
-	TileMap map2 = {
-		00, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 01, 00, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 01,
-		05, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, 05, 05, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, 05,
-		05, -2, 00, 02, 02, 01, -2, 00, 02, 02, 02, 01, -2, 05, 05, -2, 00, 02, 02, 02, 01, -2, 00, 02, 02, 01, -2, 05,
-		05, -3, 05, -1, -1, 05, -2, 05, -1, -1, -1, 05, -2, 05, 05, -2, 05, -1, -1, -1, 05, -2, 05, -1, -1, 05, -3, 05,
-		05, -2, 03, 02, 02, 04, -2, 03, 02, 02, 02, 04, -2, 03, 04, -2, 03, 02, 02, 02, 04, -2, 03, 02, 02, 04, -2, 05,
-		05, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, 05,
-		05, -2, 00, 02, 02, 01, -2, 00, 01, -2, 00, 02, 02, 02, 02, 02, 02, 01, -2, 00, 01, -2, 00, 02, 02, 01, -2, 05,
-		05, -2, 03, 02, 02, 04, -2, 05, 05, -2, 03, 02, 02, 01, 00, 02, 02, 04, -2, 05, 05, -2, 03, 02, 02, 04, -2, 05,
-		05, -2, -2, -2, -2, -2, -2, 05, 05, -2, -2, -2, -2, 05, 05, -2, -2, -2, -2, 05, 05, -2, -2, -2, -2, -2, -2, 05,
-		03, 02, 02, 02, 02, 01, -2, 05, 03, 02, 02, 01, -1, 05, 05, -1, 00, 02, 02, 04, 05, -2, 00, 02, 02, 02, 02, 04,
-		-1, -1, -1, -1, -1, 05, -2, 05, 00, 02, 02, 04, -1, 03, 04, -1, 03, 02, 02, 01, 05, -2, 05, -1, -1, -1, -1, -1,
-		-1, -1, -1, -1, -1, 05, -2, 05, 05, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 05, 05, -2, 05, -1, -1, -1, -1, -1,
-		-1, -1, -1, -1, -1, 05, -2, 05, 05, -1, 00, 02, 02, 02, 02, 02, 02, 01, -1, 05, 05, -2, 05, -1, -1, -1, -1, -1,
-		02, 02, 02, 02, 02, 04, -2, 03, 04, -1, 05, -1, -1, -1, -1, -1, -1, 05, -1, 03, 04, -2, 03, 02, 02, 02, 02, 02,
-		-1, -1, -1, -1, -1, -1, -2, -1, -1, -1, 05, -1, -1, -1, -1, -1, -1, 05, -1, -1, -1, -2, -1, -1, -1, -1, -1, -1,
-		02, 02, 02, 02, 02, 01, -2, 00, 01, -1, 05, -1, -1, -1, -1, -1, -1, 05, -1, 00, 01, -2, 00, 02, 02, 02, 02, 02,
-		-1, -1, -1, -1, -1, 05, -2, 05, 05, -1, 03, 02, 02, 02, 02, 02, 02, 04, -1, 05, 05, -2, 05, -1, -1, -1, -1, -1,
-		-1, -1, -1, -1, -1, 05, -2, 05, 05, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 05, 05, -2, 05, -1, -1, -1, -1, -1,
-		-1, -1, -1, -1, -1, 05, -2, 05, 05, -1, 00, 02, 02, 02, 02, 02, 02, 01, -1, 05, 05, -2, 05, -1, -1, -1, -1, -1,
-		00, 02, 02, 02, 02, 04, -2, 03, 04, -1, 03, 02, 02, 01, 00, 02, 02, 04, -1, 03, 04, -2, 03, 02, 02, 02, 02, 01,
-		05, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, 05, 05, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, 05,
-		05, -2, 00, 02, 02, 01, -2, 00, 02, 02, 02, 01, -2, 05, 05, -2, 00, 02, 02, 02, 01, -2, 00, 02, 02, 01, -2, 05,
-		05, -2, 03, 02, 01, 05, -2, 03, 02, 02, 02, 04, -2, 03, 04, -2, 03, 02, 02, 02, 04, -2, 05, 00, 02, 04, -2, 05,
-		05, -3, -2, -2, 05, 05, -2, -2, -2, -2, -2, -2, -2, -1, -1, -2, -2, -2, -2, -2, -2, -2, 05, 05, -2, -2, -3, 05,
-		03, 02, 01, -2, 05, 05, -2, 00, 01, -2, 00, 02, 02, 02, 02, 02, 02, 01, -2, 00, 01, -2, 05, 05, -2, 00, 02, 04,
-		00, 02, 04, -2, 03, 04, -2, 05, 05, -2, 03, 02, 02, 01, 00, 02, 02, 04, -2, 05, 05, -2, 03, 04, -2, 03, 02, 01,
-		05, -2, -2, -2, -2, -2, -2, 05, 05, -2, -2, -2, -2, 05, 05, -2, -2, -2, -2, 05, 05, -2, -2, -2, -2, -2, -2, 05,
-		05, -2, 00, 02, 02, 02, 02, 04, 03, 02, 02, 01, -2, 05, 05, -2, 00, 02, 02, 04, 03, 02, 02, 02, 02, 01, -2, 05,
-		05, -2, 03, 02, 02, 02, 02, 02, 02, 02, 02, 04, -2, 03, 04, -2, 03, 02, 02, 02, 02, 02, 02, 02, 02, 04, -2, 05,
-		05, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, 05,
-		03, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 02, 04
-	};
-	SDL_memcpy(this->tile_map, &map2, MAP_SIZE * sizeof(Tile));
-}
-
-void map_draw(Map *this, SDL_Renderer *renderer, SDL_Point *camera_offset) {
+	int size = this->layout->width * this->layout->height;
+	SDL_memset(this->pellets, 0, PELLET_WORDS(size) * sizeof(Uint32));
+	for (int i = 0; i < size; i++) {
+		Tile tile = this->layout->tiles[i];
+		if (tile == PAC || tile == POWERUP)
+			this->pellets[i / 32] |= 1u << (i % 32);
+	}
+	this->hash = map_compute_hash(this);
+}
+
+// Walls only when texture is set
+static void draw_tiles(Map *this, SDL_Texture *texture, RenderQueue *queue, const SDL_Point *camera_offset) {
 	SDL_Rect src = { 0, 0, 16, 16 };
 	SDL_Rect dst = { 0, 0, 16, 16 };
 
-	for (Uint32 y = 0; y < this->rect.h; y++) {
-		for (Uint32 x = 0; x < this->rect.w; x++) {
-			Uint32 val = x + y * this->rect.h;
-
-			switch (this->tile_map[x + y * this->rect.w]) {
+	for (int y = 0; y < this->layout->height; y++) {
+		for (int x = 0; x < this->layout->width; x++) {
+			Tile tile = map_get_tile(this, x, y);
+			switch (tile) {
 				case EMPTY:
 					continue;
 					break;
 				case PAC: {
-					SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
 					SDL_Rect pac = { x * 16 + 6 + camera_offset->x, y * 16 + 6 + camera_offset->y, 4, 4 };
-					SDL_RenderFillRect(renderer, &pac);
+					render_queue_rect(queue, RENDER_LAYER_MAP, &pac, pellet_color);
 				} break;
 				case POWERUP: {
-					SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
 					SDL_Rect pup = { x * 16 + 2 + camera_offset->x, y * 16 + 2 + camera_offset->y, 14, 14 };
-					SDL_RenderFillRect(renderer, &pup);
+					render_queue_rect(queue, RENDER_LAYER_MAP, &pup, pellet_color);
 				} break;
 				default: {
-					src.x = this->tile_map[x + y * this->rect.w] % 3 * 16;
-					src.y = this->tile_map[x + y * this->rect.w] / 3 * 16;
+					if (texture == NULL)
+						continue;
+					src.x = tile % 3 * 16;
+					src.y = tile / 3 * 16;
 					dst.x = x * 16 + camera_offset->x;
 					dst.y = y * 16 + camera_offset->y;
-					SDL_RenderCopy(renderer, this->texture, &src, &dst);
+					render_queue_sprite(queue, RENDER_LAYER_MAP, texture, &src, &dst, 0, this->color);
 				} break;
 			}
 		}
 	}
 }
 
+void map_draw(Map *this, SDL_Texture *texture, RenderQueue *queue, SDL_Point *camera_offset) {
+	draw_tiles(this, texture, queue, camera_offset);
+}
+
+void map_draw_pellets(Map *this, RenderQueue *queue, const SDL_Point *camera_offset) {
+	draw_tiles(this, NULL, queue, camera_offset);
+}
+
+SDL_Surface *map_bake_walls(const Map *this, SDL_Surface *walls) {
+	const MapLayout *layout = this->layout;
+	SDL_Surface *baked = SDL_CreateRGBSurfaceWithFormat(0, layout->width * 16, layout->height * 16, 32, SDL_PIXELFORMAT_ARGB8888);
+	if (baked == NULL)
+		return NULL;
+	SDL_FillRect(baked, NULL, 0);
+	// Copies the texels as they are, alpha included
+	SDL_BlendMode blend = SDL_BLENDMODE_BLEND;
+	SDL_GetSurfaceBlendMode(walls, &blend);
+	SDL_SetSurfaceBlendMode(walls, SDL_BLENDMODE_NONE);
+
+	for (int i = 0; i < layout->width * layout->height; i++) {
+		Tile tile = layout->tiles[i];
+		if (tile < 0)
+			continue;
+		SDL_Rect src = { tile % 3 * 16, tile / 3 * 16, 16, 16 };
+		SDL_Rect dst = { i % layout->width * 16, i / layout->width * 16, 16, 16 };
+		SDL_BlitSurface(walls, &src, baked, &dst);
+	}
+	SDL_SetSurfaceBlendMode(walls, blend);
+	return baked;
+}
+
 void map_free(Map *this) {
-	SDL_DestroyTexture(this->texture);
 	free(this);
 }
 
-static Tile map_get_tile(const Map *this, const int x, const int y) {
-	if (x < 0 || x >= this->rect.w || y < 0 || y >= this->rect.h)
+Tile map_get_tile(const Map *this, const int x, const int y) {
+	if (x < 0 || x >= this->layout->width || y < 0 || y >= this->layout->height)
+		return EMPTY;
+
+	int i = x + y * this->layout->width;
+	Tile tile = this->layout->tiles[i];
+	if ((tile == PAC || tile == POWERUP) && !(this->pellets[i / 32] & (1u << (i % 32))))
 		return EMPTY;
+	return tile;
+}
+
+void map_copy(Map *dst, const Map *src) {
+	SDL_assert(dst->layout == src->layout);
+	SDL_memcpy(dst, src, instance_size(src->layout));
+}
+
+int map_get_width(const Map *this) {
+	return this->layout->width;
+}
+
+int map_get_height(const Map *this) {
+	return this->layout->height;
+}
+
+void map_mark_pellets(const Map *this, Uint8 *pellets, Uint8 *power_ups) {
+	int size = this->layout->width * this->layout->height;
+	for (int word = 0; word < PELLET_WORDS(size); word++) {
+		// Only pellet and power up tiles ever have a bit, most words run out after a few
+		for (Uint32 bits = this->pellets[word]; bits != 0; bits &= bits - 1) {
+			int i = word * 32 + SDL_MostSignificantBitIndex32(bits & (~bits + 1));
+			if (this->layout->tiles[i] == POWERUP)
+				power_ups[i] = 1;
+			else
+				pellets[i] = 1;
+		}
+	}
+}
+
+Uint64 map_get_hash(const Map *this) {
+	return this->hash;
+}
+
+Uint64 map_compute_hash(const Map *this) {
+	int size = this->layout->width * this->layout->height;
+	Uint64 hash = 0;
+	for (int i = 0; i < size; i++) {
+		if (this->pellets[i / 32] & (1u << (i % 32)))
+			hash ^= zobrist_key(ZOBRIST_PELLET, 0, i);
+	}
+	return hash;
+}
 
-	return this->tile_map[x + y * this->rect.w];
+size_t map_get_instance_size(const Map *this) {
+	return instance_size(this->layout);
 }
 
 bool map_get_collision(const Map *this, const int x, const int y, const CollisionMask bitmask) {
-	if (x < 0 || x >= MAP_WIDTH || y < 0 || y >= MAP_HEIGHT)
+	if (x < 0 || x >= this->layout->width || y < 0 || y >= this->layout->height)
 		return 3;
-	return bitmask & this->collision_map[x + y * MAP_WIDTH];
+	return bitmask & this->layout->collisions[x + y * this->layout->width];
 }
 
 Tile map_eat_at(Map *this, const int x, const int y) {
 	Tile tile = map_get_tile(this, x, y);
-	if (tile == PAC || tile == POWERUP)
-		this->tile_map[x + y * this->rect.w] = EMPTY;
+	if (tile == PAC || tile == POWERUP) {
+		int i = x + y * this->layout->width;
+		this->pellets[i / 32] &= ~(1u << (i % 32));
+		this->hash ^= zobrist_key(ZOBRIST_PELLET, 0, i);
+	}
 	return tile;
 }
 
 void map_toggle_color(Map *this) {
-	Uint8 r = 0;
-	SDL_GetTextureColorMod(this->texture, &r, NULL, NULL);
-
-	if (r == 255)
-		SDL_SetTextureColorMod(this->texture, 0, 0, 255);
+	if (this->color.r == 255)
+		this->color = wall_color;
 	else
-		SDL_SetTextureColorMod(this->texture, 255, 255, 255);
+		this->color = blink_color;
 }
 
 void map_reset_color(Map *this) {
-	SDL_SetTextureColorMod(this->texture, 0, 0, 255);
-}
\ No newline at end of file
+	this->color = wall_color;
+}
+
+int map_get_pellet_words(const Map *this) {
+	return PELLET_WORDS(this->layout->width * this->layout->height);
+}
+
+const Uint32 *map_get_pellet_bits(const Map *this) {
+	return this->pellets;
+}
+
+void map_set_pellet_bits(Map *this, const Uint32 *bits) {
+	SDL_memcpy(this->pellets, bits, map_get_pellet_words(this) * sizeof(Uint32));
+	this->hash = map_compute_hash(this);
+}
+
+SDL_Color map_get_color(const Map *this) {
+	return this->color;
+}
+
+bool map_is_blinking(const Map *this) {
+	return this->color.r == blink_color.r;
+}
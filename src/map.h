@@ -4,6 +4,7 @@
 #include "SDL2/SDL.h"
 #include "SDL2/SDL_image.h"
 
+#include "render_queue.h"
 #include "utils.h"
 
 #define MAP_WIDTH 28
@@ -28,16 +29,53 @@ enum Tile {
 
 } typedef Tile;
 
+// Read only and shared by every map built on it, see src/maze.h for generated ones
+typedef struct MapLayout {
+	int width;
+	int height;
+	const Sint8 *tiles; // Tile values, pellets included, width * height
+	const Uint8 *collisions; // CollisionMask bits, 1 = solid
+} MapLayout;
+
 struct Map_;
 typedef struct Map_ Map;
 
-Map *map_load(SDL_Renderer *renderer);
+// The shipped MAP_WIDTH x MAP_HEIGHT maze
+Map *map_load();
+// The layout must outlive the map
+Map *map_create(const MapLayout *layout);
 void reset_map(Map *map);
-void map_draw(Map *map, SDL_Renderer *renderer, SDL_Point *camera_offset);
+void map_draw(Map *map, SDL_Texture *texture, RenderQueue *queue, SDL_Point *camera_offset);
+// Pellets and power ups only, for walls baked with map_bake_walls()
+void map_draw_pellets(Map *map, RenderQueue *queue, const SDL_Point *camera_offset);
+// Every wall tile of walls (walls.png) drawn once into a new ARGB8888 surface the size of the maze,
+// unmodulated: draw it colored with map_get_color()
+SDL_Surface *map_bake_walls(const Map *map, SDL_Surface *walls);
 void map_free(Map *map);
+// Copies the pellets left and the wall color, both maps must share the layout
+void map_copy(Map *dst, const Map *src);
+int map_get_width(const Map *map);
+int map_get_height(const Map *map);
+// Bytes owned by one map, the layout excluded
+size_t map_get_instance_size(const Map *map);
 
 bool map_get_collision(const Map *map, const int x, const int y, const CollisionMask bitmask);
+Tile map_get_tile(const Map *map, const int x, const int y);
 Tile map_eat_at(Map *map, const int x, const int y);
+// Sets the byte of every tile whose pellet or power up is left to 1, width * height bytes each, the rest untouched
+void map_mark_pellets(const Map *map, Uint8 *pellets, Uint8 *power_ups);
+// Zobrist hash of the pellets left, kept up to date by map_eat_at()
+Uint64 map_get_hash(const Map *map);
+// The same hash from scratch, to check the incremental one
+Uint64 map_compute_hash(const Map *map);
 void map_toggle_color(Map *map);
 void map_reset_color(Map *map);
+
+// The pellet bits, one per tile in row major order, set while its pellet or power up is left. For spectators
+int map_get_pellet_words(const Map *map);
+const Uint32 *map_get_pellet_bits(const Map *map);
+void map_set_pellet_bits(Map *map, const Uint32 *bits);
+// What the walls are modulated with, blue or white while blinking
+SDL_Color map_get_color(const Map *map);
+bool map_is_blinking(const Map *map);
 #endif
\ No newline at end of file
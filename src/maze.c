@@ -0,0 +1,591 @@
+#include "maze.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "debug.h"
+
+#define WALL (COLLISION_PLAYER | COLLISION_GHOST)
+#define DOOR COLLISION_PLAYER // Ghosts walk through
+#define TUNNEL COLLISION_GHOST // Only the player wraps around
+#define OPEN 0
+
+#define LATTICE_STEP 3 // A corridor and a two tile wall
+#define EXTRA_LINK_CHANCE 0x3000 // Out of 0x10000, for each link the spanning tree left out
+#define HOUSE_WIDTH 8
+#define HOUSE_HEIGHT 5
+
+typedef struct Builder {
+	int width;
+	int height;
+	Sint8 *tiles;
+	Uint8 *collisions;
+	Uint32 rng;
+
+	// Over the left half, node (x, y) sits on tile (1 + 3x, 1 + 3y)
+	int columns;
+	int rows;
+	Uint8 *links; // One bit per Direction
+
+	SDL_Rect box; // House walls
+	SDL_Rect ring; // The box and the corridor around it
+	SDL_Rect reserved; // The ring and a wall around it, the lattice stays out
+} Builder;
+
+static const SDL_Point offsets[4] = {
+	[EAST] = { 1, 0 },
+	[SOUTH] = { 0, 1 },
+	[WEST] = { -1, 0 },
+	[NORTH] = { 0, -1 },
+};
+
+static Uint32 next_random(Uint32 *state) {
+	// xorshift32, zero is a fixed point
+	Uint32 x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static MapLayout *allocate_layout(int width, int height, Sint8 **tiles, Uint8 **collisions) {
+	int size = width * height;
+	MapLayout *layout = malloc(sizeof(MapLayout) + size * 2);
+	*tiles = (Sint8 *)(layout + 1);
+	*collisions = (Uint8 *)(*tiles + size);
+	layout->width = width;
+	layout->height = height;
+	layout->tiles = *tiles;
+	layout->collisions = *collisions;
+	return layout;
+}
+
+void maze_free(MapLayout *layout) {
+	free(layout);
+}
+
+/*
+ * WALL OUTLINES
+ */
+
+static bool is_solid(const Uint8 *collisions, int width, int height, int x, int y) {
+	if (x < 0 || x >= width || y < 0 || y >= height)
+		return true;
+	return collisions[x + y * width] & COLLISION_PLAYER;
+}
+
+// Same sprites as the shipped maze: walls are outlined where they face a corridor, insides stay empty
+static Tile wall_outline(const Uint8 *collisions, int width, int height, int x, int y) {
+	bool n = is_solid(collisions, width, height, x, y - 1);
+	bool s = is_solid(collisions, width, height, x, y + 1);
+	bool e = is_solid(collisions, width, height, x + 1, y);
+	bool w = is_solid(collisions, width, height, x - 1, y);
+	int open_sides = !n + !s + !e + !w;
+
+	if (open_sides == 0) {
+		// Inner corners, the outline joins the two sides next to the open diagonal
+		if (!is_solid(collisions, width, height, x + 1, y + 1))
+			return TURN_RIGHT;
+		if (!is_solid(collisions, width, height, x - 1, y + 1))
+			return TURN_DOWN;
+		if (!is_solid(collisions, width, height, x + 1, y - 1))
+			return TURN_UP;
+		if (!is_solid(collisions, width, height, x - 1, y - 1))
+			return TURN_LEFT;
+		return EMPTY;
+	}
+	if (open_sides == 1 || (open_sides == 2 && n == s))
+		return !n || !s ? STRAIGHT_HOR : STRAIGHT_VER;
+	if (open_sides == 2) {
+		if (!n && !w)
+			return TURN_RIGHT;
+		if (!n && !e)
+			return TURN_DOWN;
+		if (!s && !w)
+			return TURN_UP;
+		return TURN_LEFT;
+	}
+	if (open_sides == 3)
+		return n || s ? STRAIGHT_VER : STRAIGHT_HOR;
+	return EMPTY;
+}
+
+static void outline_walls(int width, int height, const Uint8 *collisions, Sint8 *tiles) {
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			if (collisions[x + y * width] & COLLISION_PLAYER)
+				tiles[x + y * width] = (Sint8)wall_outline(collisions, width, height, x, y);
+		}
+	}
+}
+
+/*
+ * GENERATION
+ */
+
+static bool in_bounds(const Builder *this, int x, int y) {
+	return x >= 0 && x < this->width && y >= 0 && y < this->height;
+}
+
+static Uint8 get(const Builder *this, int x, int y) {
+	if (!in_bounds(this, x, y))
+		return WALL;
+	return this->collisions[x + y * this->width];
+}
+
+static bool is_passable(const Builder *this, int x, int y) {
+	return !(get(this, x, y) & COLLISION_PLAYER);
+}
+
+// Every write lands on both halves
+static void set(Builder *this, int x, int y, Uint8 collision) {
+	this->collisions[x + y * this->width] = collision;
+	this->collisions[this->width - 1 - x + y * this->width] = collision;
+}
+
+// Axis aligned, both ends included
+static void carve_line(Builder *this, int x0, int y0, int x1, int y1) {
+	int dx = SDL_clamp(x1 - x0, -1, 1);
+	int dy = SDL_clamp(y1 - y0, -1, 1);
+	for (int x = x0, y = y0;; x += dx, y += dy) {
+		set(this, x, y, OPEN);
+		if (x == x1 && y == y1)
+			break;
+	}
+}
+
+static SDL_Point node_tile(int x, int y) {
+	SDL_Point tile = { 1 + LATTICE_STEP * x, 1 + LATTICE_STEP * y };
+	return tile;
+}
+
+static bool has_node(const Builder *this, int x, int y) {
+	return x >= 0 && x < this->columns && y >= 0 && y < this->rows;
+}
+
+// East of the last column is the mirrored node across the middle
+static bool can_link(const Builder *this, int x, int y, Direction direction) {
+	if (direction == EAST && x == this->columns - 1)
+		return true;
+	return has_node(this, x + offsets[direction].x, y + offsets[direction].y);
+}
+
+static void link_nodes(Builder *this, int x, int y, Direction direction) {
+	SDL_Point from = node_tile(x, y);
+	SDL_Point to;
+	if (direction == EAST && x == this->columns - 1) {
+		to.x = this->width - 1 - from.x;
+		to.y = from.y;
+	} else {
+		int next_x = x + offsets[direction].x;
+		int next_y = y + offsets[direction].y;
+		to = node_tile(next_x, next_y);
+		this->links[next_x + next_y * this->columns] |= 1 << ((direction + 2) % 4);
+	}
+	this->links[x + y * this->columns] |= 1 << direction;
+	carve_line(this, from.x, from.y, to.x, to.y);
+}
+
+// Depth first with random turns, every node ends up reachable
+static void build_tree(Builder *this) {
+	int count = this->columns * this->rows;
+	bool *visited = calloc(count, sizeof(bool));
+	int *stack = malloc(count * sizeof(int));
+	int length = 0;
+	stack[length++] = 0;
+	visited[0] = true;
+
+	while (length > 0) {
+		int x = stack[length - 1] % this->columns;
+		int y = stack[length - 1] / this->columns;
+		Direction options[4];
+		int option_count = 0;
+		for (Direction direction = EAST; direction <= NORTH; direction++) {
+			int next_x = x + offsets[direction].x;
+			int next_y = y + offsets[direction].y;
+			if (has_node(this, next_x, next_y) && !visited[next_x + next_y * this->columns])
+				options[option_count++] = direction;
+		}
+		if (option_count == 0) {
+			length--;
+			continue;
+		}
+
+		Direction direction = options[next_random(&this->rng) % option_count];
+		link_nodes(this, x, y, direction);
+		int next = x + offsets[direction].x + (y + offsets[direction].y) * this->columns;
+		visited[next] = true;
+		stack[length++] = next;
+	}
+
+	free(stack);
+	free(visited);
+}
+
+static int link_count(Uint8 links) {
+	return (links & 1) + (links >> 1 & 1) + (links >> 2 & 1) + (links >> 3 & 1);
+}
+
+static void add_loops(Builder *this) {
+	for (int y = 0; y < this->rows; y++) {
+		for (int x = 0; x < this->columns; x++) {
+			for (Direction direction = EAST; direction <= SOUTH; direction++) {
+				bool is_linked = this->links[x + y * this->columns] & (1 << direction);
+				if (!is_linked && can_link(this, x, y, direction) && (next_random(&this->rng) & 0xFFFF) < EXTRA_LINK_CHANCE)
+					link_nodes(this, x, y, direction);
+			}
+		}
+	}
+
+	// The top and bottom rows always cross the middle
+	for (int y = 0; y < this->rows; y += SDL_max(this->rows - 1, 1)) {
+		if (!(this->links[this->columns - 1 + y * this->columns] & (1 << EAST)))
+			link_nodes(this, this->columns - 1, y, EAST);
+	}
+
+	// Pac-Man mazes have no dead ends
+	for (int y = 0; y < this->rows; y++) {
+		for (int x = 0; x < this->columns; x++) {
+			Uint8 links = this->links[x + y * this->columns];
+			if (link_count(links) != 1)
+				continue;
+			Direction options[4];
+			int option_count = 0;
+			for (Direction direction = EAST; direction <= NORTH; direction++) {
+				if (!(links & (1 << direction)) && can_link(this, x, y, direction))
+					options[option_count++] = direction;
+			}
+			if (option_count > 0)
+				link_nodes(this, x, y, options[next_random(&this->rng) % option_count]);
+		}
+	}
+}
+
+static bool in_rect(const SDL_Rect *rect, int x, int y) {
+	return x >= rect->x && x < rect->x + rect->w && y >= rect->y && y < rect->y + rect->h;
+}
+
+// Carves from the edge of the reserved area outwards until it meets a corridor
+static void carve_spur(Builder *this, int x, int y, Direction direction) {
+	while (in_bounds(this, x, y) && x > 0 && y > 0 && y < this->height - 1 && !is_passable(this, x, y)) {
+		set(this, x, y, OPEN);
+		x += offsets[direction].x;
+		y += offsets[direction].y;
+	}
+}
+
+// Nearest lattice row to y
+static int lattice_row(int y) {
+	return 1 + (y - 1 + LATTICE_STEP / 2) / LATTICE_STEP * LATTICE_STEP;
+}
+
+static void place_house(Builder *this) {
+	int half = (this->width - 1) / 2; // Last column of the left half
+	this->box.x = this->width / 2 - HOUSE_WIDTH / 2;
+	this->box.y = this->height / 2 - (HOUSE_HEIGHT + 1) / 2;
+	this->box.w = this->width - 2 * this->box.x;
+	this->box.h = HOUSE_HEIGHT;
+	this->ring = (SDL_Rect){ this->box.x - 1, this->box.y - 1, this->box.w + 2, this->box.h + 2 };
+	this->reserved = (SDL_Rect){ this->ring.x - 1, this->ring.y - 1, this->ring.w + 2, this->ring.h + 2 };
+
+	const SDL_Rect *box = &this->box;
+	for (int y = this->reserved.y; y < this->reserved.y + this->reserved.h; y++) {
+		for (int x = this->reserved.x; x <= half; x++) {
+			Uint8 collision = OPEN;
+			if (!in_rect(&this->ring, x, y))
+				collision = WALL;
+			else if (!in_rect(box, x, y))
+				collision = OPEN;
+			else if (y == box->y && x >= this->width / 2 - 1)
+				collision = DOOR;
+			else if (x == box->x || y == box->y || y == box->y + box->h - 1)
+				collision = WALL;
+			set(this, x, y, collision);
+		}
+	}
+
+	// Opens the wall around the ring where a corridor runs straight into it
+	const SDL_Rect *reserved = &this->reserved;
+	int top = reserved->y;
+	int bottom = reserved->y + reserved->h - 1;
+	bool has_top = false;
+	bool has_bottom = false;
+	bool has_side = false;
+	for (int x = reserved->x + 1; x <= half; x++) {
+		if (is_passable(this, x, top - 1) && !is_passable(this, x - 1, top - 1) && !is_passable(this, x + 1, top - 1)) {
+			set(this, x, top, OPEN);
+			has_top = true;
+		}
+		if (is_passable(this, x, bottom + 1) && !is_passable(this, x - 1, bottom + 1) && !is_passable(this, x + 1, bottom + 1)) {
+			set(this, x, bottom, OPEN);
+			has_bottom = true;
+		}
+	}
+	for (int y = top + 1; y < bottom; y++) {
+		if (is_passable(this, reserved->x - 1, y) && !is_passable(this, reserved->x - 1, y - 1) && !is_passable(this, reserved->x - 1, y + 1)) {
+			set(this, reserved->x, y, OPEN);
+			has_side = true;
+		}
+	}
+
+	// Otherwise along the lattice lines closest to the middle, so they never run beside another corridor
+	int column = node_tile(this->columns - 1, 0).x;
+	if (!has_top)
+		carve_spur(this, column, top, NORTH);
+	if (!has_bottom)
+		carve_spur(this, column, bottom, SOUTH);
+	if (!has_side)
+		carve_spur(this, reserved->x, lattice_row(box->y + box->h / 2), WEST);
+}
+
+static int passable_neighbours(const Builder *this, int x, int y, Direction *last) {
+	int count = 0;
+	for (Direction direction = EAST; direction <= NORTH; direction++) {
+		if (is_passable(this, x + offsets[direction].x, y + offsets[direction].y)) {
+			*last = direction;
+			count++;
+		}
+	}
+	return count;
+}
+
+// Walks from a dead end until it meets a corridor, carves only if it does without running beside one
+static bool extend(Builder *this, int x, int y, Direction direction) {
+	Direction side = (direction + 1) % 4;
+	int length = 0;
+	for (;;) {
+		x += offsets[direction].x;
+		y += offsets[direction].y;
+		if (x <= 0 || x >= this->width - 1 || y <= 0 || y >= this->height - 1 || in_rect(&this->reserved, x, y))
+			return false;
+		if (is_passable(this, x, y))
+			break;
+		if (is_passable(this, x + offsets[side].x, y + offsets[side].y) || is_passable(this, x - offsets[side].x, y - offsets[side].y))
+			return false;
+		length++;
+	}
+	for (int i = 0; i < length; i++) {
+		x -= offsets[direction].x;
+		y -= offsets[direction].y;
+		set(this, x, y, OPEN);
+	}
+	return true;
+}
+
+// Cut lattice lines near the house leave a few, they're joined up or filled in
+static void remove_dead_ends(Builder *this) {
+	int half = (this->width - 1) / 2;
+	int capacity = (half + 1) * this->height;
+	SDL_Point *stack = malloc(capacity * sizeof(SDL_Point));
+	int length = 0;
+	for (int y = 1; y < this->height - 1; y++) {
+		for (int x = 1; x <= half; x++)
+			stack[length++] = (SDL_Point){ x, y };
+	}
+
+	while (length > 0) {
+		SDL_Point tile = stack[--length];
+		Direction back;
+		if (!is_passable(this, tile.x, tile.y) || in_rect(&this->reserved, tile.x, tile.y) || passable_neighbours(this, tile.x, tile.y, &back) != 1)
+			continue;
+
+		Direction ahead = (back + 2) % 4;
+		Direction turn = (back + 1 + 2 * (next_random(&this->rng) & 1)) % 4;
+		if (extend(this, tile.x, tile.y, ahead) || extend(this, tile.x, tile.y, turn) || extend(this, tile.x, tile.y, (turn + 2) % 4))
+			continue;
+
+		set(this, tile.x, tile.y, WALL);
+		SDL_Point next = { tile.x + offsets[back].x, tile.y + offsets[back].y };
+		if (next.x > half)
+			next.x = this->width - 1 - next.x;
+		if (length < capacity)
+			stack[length++] = next;
+	}
+	free(stack);
+}
+
+static void place_tunnel(Builder *this) {
+	// The lattice row closest to the house, or the next open one
+	int middle = lattice_row(this->box.y + this->box.h / 2);
+	for (int offset = 0; offset < this->height; offset += LATTICE_STEP) {
+		for (int sign = 1; sign >= -1; sign -= 2) {
+			int y = middle + sign * offset;
+			if (y > 0 && y < this->height - 1 && is_passable(this, 1, y)) {
+				set(this, 0, y, TUNNEL);
+				return;
+			}
+		}
+	}
+}
+
+// Whatever the player can't reach from the house becomes wall, the house itself excepted
+static void fill_unreachable(Builder *this) {
+	int size = this->width * this->height;
+	bool *reached = calloc(size, sizeof(bool));
+	int *queue = malloc(size * sizeof(int));
+	int head = 0;
+	int tail = 0;
+	queue[tail++] = this->ring.x + this->ring.y * this->width;
+	reached[queue[0]] = true;
+
+	while (head < tail) {
+		int index = queue[head++];
+		int x = index % this->width;
+		int y = index / this->width;
+		for (Direction direction = EAST; direction <= NORTH; direction++) {
+			int next_x = x + offsets[direction].x;
+			int next_y = y + offsets[direction].y;
+			if (!in_bounds(this, next_x, next_y) || !is_passable(this, next_x, next_y))
+				continue;
+			int next = next_x + next_y * this->width;
+			if (!reached[next]) {
+				reached[next] = true;
+				queue[tail++] = next;
+			}
+		}
+	}
+
+	for (int i = 0; i < size; i++) {
+		if (!reached[i] && !(this->collisions[i] & COLLISION_PLAYER) && !in_rect(&this->ring, i % this->width, i / this->width))
+			this->collisions[i] = WALL;
+	}
+	free(queue);
+	free(reached);
+}
+
+static void place_pellets(Builder *this) {
+	for (int y = 0; y < this->height; y++) {
+		for (int x = 0; x < this->width; x++) {
+			int i = x + y * this->width;
+			if (this->collisions[i] == OPEN && !in_rect(&this->ring, x, y))
+				this->tiles[i] = PAC;
+			else
+				this->tiles[i] = EMPTY;
+		}
+	}
+
+	// Second row from the top and from the bottom, on the outer column
+	int power_up_rows[2] = { node_tile(0, 1).y, node_tile(0, SDL_max(this->rows - 2, 0)).y };
+	for (int i = 0; i < 2; i++) {
+		SDL_Point tile = node_tile(0, 0);
+		tile.y = power_up_rows[i];
+		int index = tile.x + tile.y * this->width;
+		if (this->tiles[index] == PAC) {
+			this->tiles[index] = POWERUP;
+			this->tiles[this->width - 1 - tile.x + tile.y * this->width] = POWERUP;
+		}
+	}
+}
+
+MapLayout *maze_generate(const int width, const int height, const Uint32 seed) {
+	if (width < MAZE_MIN_WIDTH || height < MAZE_MIN_HEIGHT || width > MAZE_MAX_SIDE || height > MAZE_MAX_SIDE)
+		return NULL;
+
+	Builder builder;
+	SDL_zero(builder);
+	Builder *this = &builder;
+	MapLayout *layout = allocate_layout(width, height, &this->tiles, &this->collisions);
+	this->width = width;
+	this->height = height;
+	this->rng = seed != 0 ? seed : 0x9E3779B9;
+	this->columns = (width / 2 - 3) / LATTICE_STEP + 1;
+	this->rows = (height - 3) / LATTICE_STEP + 1;
+	this->links = calloc(this->columns * this->rows, 1);
+	SDL_memset(this->collisions, WALL, width * height);
+
+	build_tree(this);
+	add_loops(this);
+	place_house(this);
+	remove_dead_ends(this);
+	place_tunnel(this);
+	fill_unreachable(this);
+	place_pellets(this);
+	outline_walls(width, height, this->collisions, this->tiles);
+
+	free(this->links);
+	return layout;
+}
+
+/*
+ * FILES
+ */
+
+bool maze_write(const MapLayout *layout, const char *path) {
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		SDL_Log("Unable to write %s", path);
+		return false;
+	}
+
+	fprintf(file, "%d %d\n", layout->width, layout->height);
+	for (int y = 0; y < layout->height; y++) {
+		for (int x = 0; x < layout->width; x++) {
+			int i = x + y * layout->width;
+			char c = ' ';
+			switch (layout->collisions[i]) {
+				case WALL: c = '#'; break;
+				case DOOR: c = '-'; break;
+				case TUNNEL: c = '='; break;
+				default: c = layout->tiles[i] == PAC ? '.' : layout->tiles[i] == POWERUP ? 'o' : ' '; break;
+			}
+			fputc(c, file);
+		}
+		fputc('\n', file);
+	}
+
+	bool is_ok = !ferror(file);
+	fclose(file);
+	return is_ok;
+}
+
+MapLayout *maze_read(const char *path) {
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		SDL_Log("Unable to open %s", path);
+		return NULL;
+	}
+
+	int width = 0;
+	int height = 0;
+	if (fscanf(file, "%d %d", &width, &height) != 2 || width <= 0 || height <= 0 || width > MAZE_MAX_SIDE || height > MAZE_MAX_SIDE) {
+		SDL_Log("%s is not a maze", path);
+		fclose(file);
+		return NULL;
+	}
+
+	Sint8 *tiles;
+	Uint8 *collisions;
+	MapLayout *layout = allocate_layout(width, height, &tiles, &collisions);
+	int c = fgetc(file);
+	while (c == '\r' || c == '\n')
+		c = fgetc(file);
+
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			int i = x + y * width;
+			tiles[i] = EMPTY;
+			switch (c) {
+				case '#': collisions[i] = WALL; break;
+				case '-': collisions[i] = DOOR; break;
+				case '=': collisions[i] = TUNNEL; break;
+				case '.': collisions[i] = OPEN; tiles[i] = PAC; break;
+				case 'o': collisions[i] = OPEN; tiles[i] = POWERUP; break;
+				case ' ': collisions[i] = OPEN; break;
+				default: {
+					SDL_Log("%s: unexpected character at %d, %d", path, x, y);
+					fclose(file);
+					maze_free(layout);
+					return NULL;
+				}
+			}
+			c = fgetc(file);
+		}
+		while (c == '\r' || c == '\n')
+			c = fgetc(file);
+	}
+	fclose(file);
+
+	outline_walls(width, height, collisions, tiles);
+	return layout;
+}
@@ -0,0 +1,33 @@
+#ifndef MAZE_H
+#define MAZE_H
+
+#include "SDL2/SDL.h"
+
+#include "map.h"
+#include "utils.h"
+
+/*
+ * Seeded Pac-Man style mazes of any size, for scaling and stress runs. The left half is a
+ * spanning tree over a lattice of corridors three tiles apart, with extra links until no
+ * corridor dead ends, mirrored onto the right half. A ghost house sits in the middle with a
+ * ring corridor around it and a tunnel wraps around on the row closest to it.
+ *
+ * The layers are the ones the shipped maze uses: wall outlines, pellets and four power ups in
+ * the tiles, the player and ghost bits in the collisions, the house door only stopping the player
+ * and the tunnel only stopping ghosts.
+ */
+
+#define MAZE_MIN_WIDTH MAP_WIDTH
+#define MAZE_MIN_HEIGHT MAP_HEIGHT
+#define MAZE_MAX_SIDE 4096
+
+// NULL when the size is out of range. The same size and seed always give the same maze
+MapLayout *maze_generate(const int width, const int height, const Uint32 seed);
+void maze_free(MapLayout *layout);
+
+// One line per row, '#' wall, '.' pellet, 'o' power up, ' ' open, '-' house door, '=' tunnel.
+// Wall outlines are worked out again on read
+bool maze_write(const MapLayout *layout, const char *path);
+MapLayout *maze_read(const char *path);
+
+#endif
@@ -0,0 +1,357 @@
+#include "maze_bench.h"
+
+#include <stdio.h>
+
+#include "debug.h"
+
+#include "a_star.h"
+#include "bot.h"
+#include "game.h"
+#include "ghost.h"
+#include "map.h"
+#include "maze.h"
+#include "pack.h"
+#include "render_bench.h"
+#include "render_queue.h"
+
+#define MEASURE_MS 500 // Each measurement stops after this long, or its count
+#define MAX_SEARCHES 200
+#define MAX_FRAMES 60
+#define CHASE_TICKS 600
+#define TARGET_MOVE_TICKS 60
+#define LOD_TARGET_STEP_TICKS 4 // The target walks a tile every this many ticks, about the player's speed
+
+static const int lod_ghost_counts[] = { 4, 16, 64, 256 };
+#define LOD_COUNTS ((int)SDL_arraysize(lod_ghost_counts))
+
+typedef struct LodResult {
+	char name[64];
+	int ghosts;
+	double full_ms; // Per tick, every ghost
+	double lod_ms;
+	double near; // Share of ghost ticks simulated at full detail
+} LodResult;
+
+static const int default_sizes[][2] = {
+	{ 28, 31 },
+	{ 56, 62 },
+	{ 112, 124 },
+	{ 256, 256 },
+	{ 512, 512 },
+	{ 1024, 1024 },
+};
+
+void maze_bench_default_options(MazeBenchOptions *options) {
+	SDL_zero(*options);
+	for (int i = 0; i < (int)SDL_arraysize(default_sizes); i++) {
+		options->widths[i] = default_sizes[i][0];
+		options->heights[i] = default_sizes[i][1];
+	}
+	options->size_count = SDL_arraysize(default_sizes);
+	options->seed = 1;
+}
+
+bool maze_bench_parse_sizes(MazeBenchOptions *options, const char *list) {
+	options->size_count = 0;
+	while (*list != '\0') {
+		if (options->size_count == MAZE_BENCH_MAX_SIZES)
+			return false;
+		char *end = NULL;
+		int width = SDL_strtol(list, &end, 10);
+		if (*end != 'x')
+			return false;
+		int height = SDL_strtol(end + 1, &end, 10);
+		if (width <= 0 || height <= 0 || (*end != ',' && *end != '\0'))
+			return false;
+		options->widths[options->size_count] = width;
+		options->heights[options->size_count] = height;
+		options->size_count++;
+		list = *end == ',' ? end + 1 : end;
+	}
+	return options->size_count > 0;
+}
+
+static bool keep_measuring(Uint64 start, int done, int max) {
+	Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+	return done < max && (done == 0 || elapsed * 1000 < MEASURE_MS * SDL_GetPerformanceFrequency());
+}
+
+static double to_ms(Uint64 ticks) {
+	return ticks * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+static SDL_Point random_tile(const SDL_Point *tiles, int count, Uint32 *rng) {
+	return tiles[bot_random(rng) % count];
+}
+
+static void bench_map(const char *name, Map *map, size_t layout_bytes, double generate_ms, Uint32 seed, SDL_Renderer *renderer, SDL_Texture *walls) {
+	int width = map_get_width(map);
+	int height = map_get_height(map);
+	reset_map(map);
+
+	// Where ghosts can stand, for search ends and chase starts
+	SDL_Point *open = malloc(width * height * sizeof(SDL_Point));
+	int open_count = 0;
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			if (!map_get_collision(map, x, y, COLLISION_GHOST))
+				open[open_count++] = (SDL_Point){ x, y };
+		}
+	}
+	Uint32 rng = seed != 0 ? seed : 1;
+
+	// Searches across the maze
+	PathNode path[A_STAR_MAX_PATH];
+	int length = 0;
+	int searches = 0;
+	long long nodes = 0;
+	Uint64 start = SDL_GetPerformanceCounter();
+	while (keep_measuring(start, searches, MAX_SEARCHES)) {
+		SDL_Point a = random_tile(open, open_count, &rng);
+		SDL_Point b = random_tile(open, open_count, &rng);
+		nodes += a_star(map, &a, &b, path, &length);
+		searches++;
+	}
+	double search_ms = to_ms(SDL_GetPerformanceCounter() - start) / searches;
+
+	// The whole map every frame, as the game draws it
+	RenderQueue *queue = render_queue_create(renderer, NULL);
+	SDL_Point camera = { 0, 0 };
+	int frames = 0;
+	start = SDL_GetPerformanceCounter();
+	while (keep_measuring(start, frames, MAX_FRAMES)) {
+		SDL_RenderClear(renderer);
+		map_draw(map, walls, queue, &camera);
+		render_queue_flush(queue);
+		frames++;
+	}
+	double draw_ms = to_ms(SDL_GetPerformanceCounter() - start) / frames;
+	int sprites = render_queue_get_stats(queue).commands;
+	render_queue_destroy(queue);
+
+	// Every ghost hunting a target that jumps to another tile every second
+	Ghost *ghosts[GHOST_AMT];
+	for (int i = 0; i < GHOST_AMT; i++) {
+		SDL_Point tile = random_tile(open, open_count, &rng);
+		ghosts[i] = create_ghost((float)tile.x, (float)tile.y, 0, 0, 0);
+		ghost_reset(ghosts[i], GHOST_BASE_SPEED);
+		ghost_switch_state(ghosts[i], ATTACKING);
+	}
+	FixedPoint target = { 0, 0 };
+	start = SDL_GetPerformanceCounter();
+	for (int tick = 0; tick < CHASE_TICKS; tick++) {
+		if (tick % TARGET_MOVE_TICKS == 0) {
+			SDL_Point tile = random_tile(open, open_count, &rng);
+			target.x = FIXED_FROM_INT(tile.x);
+			target.y = FIXED_FROM_INT(tile.y);
+		}
+		for (int i = 0; i < GHOST_AMT; i++) {
+			update_ghost(ghosts[i], TICK_TIME, &target, map);
+		}
+	}
+	double tick_ms = to_ms(SDL_GetPerformanceCounter() - start) / CHASE_TICKS;
+	for (int i = 0; i < GHOST_AMT; i++) {
+		destroy_ghost(ghosts[i]);
+	}
+
+	printf("%-20s %9d %8.2f %10.1f %7d %10.3f %9.0f %9.3f %9d %9.4f\n", name, width * height, generate_ms,
+			layout_bytes / 1024.0, (int)map_get_instance_size(map), search_ms, (double)nodes / searches, draw_ms, sprites, tick_ms);
+	free(open);
+}
+
+/*
+ * CHASE
+ */
+
+struct MazeChase {
+	Map *map;
+	SDL_Point *open; // Where ghosts can stand
+	int open_count;
+	Uint32 rng;
+	Ghost **ghosts;
+	int ghost_count;
+	bool has_lod;
+	GhostLod lod;
+
+	PathNode path[A_STAR_MAX_PATH]; // The target's, to its current goal
+	int length;
+	int step;
+	int tick;
+	SDL_Point target_tile;
+	FixedPoint target;
+};
+
+MazeChase *maze_chase_create(Map *map, const Uint32 seed, const int ghosts, const GhostLod *lod) {
+	MazeChase *this = calloc(1, sizeof(MazeChase));
+	this->map = map;
+	int width = map_get_width(map);
+	int height = map_get_height(map);
+	this->open = malloc(width * height * sizeof(SDL_Point));
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			if (!map_get_collision(map, x, y, COLLISION_GHOST))
+				this->open[this->open_count++] = (SDL_Point){ x, y };
+		}
+	}
+
+	this->rng = seed != 0 ? seed : 1;
+	this->ghosts = malloc(ghosts * sizeof(Ghost *));
+	this->ghost_count = ghosts;
+	for (int i = 0; i < ghosts; i++) {
+		SDL_Point tile = random_tile(this->open, this->open_count, &this->rng);
+		this->ghosts[i] = create_ghost((float)tile.x, (float)tile.y, 0, 0, 0);
+		ghost_reset(this->ghosts[i], GHOST_BASE_SPEED);
+		ghost_switch_state(this->ghosts[i], ATTACKING);
+	}
+	this->has_lod = lod != NULL;
+	if (lod != NULL)
+		this->lod = *lod;
+
+	this->target_tile = random_tile(this->open, this->open_count, &this->rng);
+	this->target.x = FIXED_FROM_INT(this->target_tile.x);
+	this->target.y = FIXED_FROM_INT(this->target_tile.y);
+	return this;
+}
+
+void maze_chase_destroy(MazeChase *this) {
+	for (int i = 0; i < this->ghost_count; i++) {
+		destroy_ghost(this->ghosts[i]);
+	}
+	free(this->ghosts);
+	free(this->open);
+	free(this);
+}
+
+void maze_chase_move_target(MazeChase *this) {
+	if (this->tick++ % LOD_TARGET_STEP_TICKS == 0) {
+		if (this->step + 1 >= this->length) {
+			SDL_Point goal = random_tile(this->open, this->open_count, &this->rng);
+			this->length = 0;
+			a_star(this->map, &this->target_tile, &goal, this->path, &this->length);
+			this->step = 0;
+		}
+		if (this->step + 1 < this->length) {
+			this->step++;
+			this->target_tile.x = this->path[this->step].x;
+			this->target_tile.y = this->path[this->step].y;
+			this->target.x = FIXED_FROM_INT(this->target_tile.x);
+			this->target.y = FIXED_FROM_INT(this->target_tile.y);
+		}
+	}
+	this->lod.view.x = this->target_tile.x - this->lod.view.w / 2;
+	this->lod.view.y = this->target_tile.y - this->lod.view.h / 2;
+}
+
+int maze_chase_update_ghosts(MazeChase *this) {
+	int near = 0;
+	for (int i = 0; i < this->ghost_count; i++) {
+		Ghost *ghost = this->ghosts[i];
+		if (!this->has_lod)
+			update_ghost(ghost, TICK_TIME, &this->target, this->map);
+		else if (update_ghost_lod(ghost, TICK_TIME, &this->target, this->map, &this->lod) && ghost_is_near(ghost, &this->target, &this->lod))
+			near++;
+	}
+	return near;
+}
+
+// Ghost ticks per tick for count ghosts chasing a target that walks the maze, with or without LOD
+static double chase_ms(Map *map, Uint32 seed, int count, const GhostLod *lod, double *near) {
+	MazeChase *chase = maze_chase_create(map, seed, count, lod);
+	long long near_ticks = 0;
+	Uint64 elapsed = 0;
+	for (int tick = 0; tick < CHASE_TICKS; tick++) {
+		maze_chase_move_target(chase);
+		Uint64 start = SDL_GetPerformanceCounter();
+		near_ticks += maze_chase_update_ghosts(chase);
+		elapsed += SDL_GetPerformanceCounter() - start;
+	}
+	maze_chase_destroy(chase);
+	if (near != NULL)
+		*near = (double)near_ticks / ((double)count * CHASE_TICKS);
+	return to_ms(elapsed) / CHASE_TICKS;
+}
+
+static void bench_lod(const char *name, Map *map, Uint32 seed, LodResult *results) {
+	GhostLod lod;
+	ghost_default_lod(&lod);
+	lod.view.w = MAP_WIDTH;
+	lod.view.h = MAP_HEIGHT;
+	for (int i = 0; i < LOD_COUNTS; i++) {
+		LodResult *result = &results[i];
+		SDL_strlcpy(result->name, name, sizeof(result->name));
+		result->ghosts = lod_ghost_counts[i];
+		result->full_ms = chase_ms(map, seed, result->ghosts, NULL, NULL);
+		result->lod_ms = chase_ms(map, seed, result->ghosts, &lod, &result->near);
+	}
+}
+
+static void print_lod(const LodResult *results, int count) {
+	printf("\nGhost LOD, %d chase ticks after a walking target, near within %d tiles or a %dx%d view, far every %d ticks\n", CHASE_TICKS,
+			GHOST_LOD_NEAR_TILES, MAP_WIDTH, MAP_HEIGHT, GHOST_LOD_FAR_INTERVAL);
+	printf("%-20s %7s %12s %12s %8s %7s\n", "maze", "ghosts", "full ms", "lod ms", "speedup", "near %");
+	for (int i = 0; i < count; i++) {
+		const LodResult *r = &results[i];
+		printf("%-20s %7d %12.4f %12.4f %7.1fx %7.1f\n", r->name, r->ghosts, r->full_ms, r->lod_ms,
+				r->lod_ms > 0.0 ? r->full_ms / r->lod_ms : 0.0, r->near * 100.0);
+	}
+}
+
+int maze_bench_run(const MazeBenchOptions *options) {
+	SDL_Surface *frame = SDL_CreateRGBSurfaceWithFormat(0, RENDER_BENCH_WIDTH, RENDER_BENCH_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+	SDL_Renderer *renderer = SDL_CreateSoftwareRenderer(frame);
+	if (renderer == NULL) {
+		printf("Unable to create software renderer: %s\n", SDL_GetError());
+		return 1;
+	}
+	SDL_Texture *walls = pack_load_texture(renderer, "walls.png");
+
+	printf("Searches and frames for up to %dms each, %d chase ticks with %d ghosts, seed %u\n", MEASURE_MS, CHASE_TICKS, GHOST_AMT, options->seed);
+	printf("%-20s %9s %8s %10s %7s %10s %9s %9s %9s %9s\n", "maze", "tiles", "gen ms", "layout KB", "map B",
+			"search ms", "nodes", "draw ms", "sprites", "tick ms");
+
+	LodResult *lod_results = malloc((1 + SDL_max(options->file_count, options->size_count)) * LOD_COUNTS * sizeof(LodResult));
+	int lod_count = 0;
+	Map *shipped = map_load();
+	bench_map("shipped", shipped, MAP_SIZE * 2, 0.0, options->seed, renderer, walls);
+	bench_lod("shipped", shipped, options->seed, &lod_results[lod_count]);
+	lod_count += LOD_COUNTS;
+	map_free(shipped);
+
+	int exit_code = 0;
+	int count = options->file_count > 0 ? options->file_count : options->size_count;
+	for (int i = 0; i < count; i++) {
+		char name[64];
+		Uint64 start = SDL_GetPerformanceCounter();
+		MapLayout *layout;
+		if (options->file_count > 0) {
+			layout = maze_read(options->files[i]);
+			const char *base = SDL_strrchr(options->files[i], '/');
+			SDL_strlcpy(name, base != NULL ? base + 1 : options->files[i], sizeof(name));
+		} else {
+			layout = maze_generate(options->widths[i], options->heights[i], options->seed);
+			SDL_snprintf(name, sizeof(name), "%dx%d", options->widths[i], options->heights[i]);
+		}
+		double generate_ms = to_ms(SDL_GetPerformanceCounter() - start);
+		if (layout == NULL) {
+			printf("%-20s could not be %s\n", name, options->file_count > 0 ? "read" : "generated");
+			exit_code = 1;
+			continue;
+		}
+
+		Map *map = map_create(layout);
+		bench_map(name, map, layout->width * layout->height * 2, generate_ms, options->seed, renderer, walls);
+		bench_lod(name, map, options->seed, &lod_results[lod_count]);
+		lod_count += LOD_COUNTS;
+		map_free(map);
+		maze_free(layout);
+	}
+
+	print_lod(lod_results, lod_count);
+	free(lod_results);
+
+	a_star_free_scratch();
+	SDL_DestroyTexture(walls);
+	SDL_DestroyRenderer(renderer);
+	SDL_FreeSurface(frame);
+	return exit_code;
+}
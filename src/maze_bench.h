@@ -0,0 +1,49 @@
+#ifndef MAZE_BENCH_H
+#define MAZE_BENCH_H
+
+#include "SDL2/SDL.h"
+
+#include "ghost.h"
+#include "map.h"
+#include "utils.h"
+
+/*
+ * How the per map costs grow with the maze: generation, memory, a_star() between random tiles,
+ * map_draw() through the render queue into an off-screen window sized surface, and the ghosts
+ * chasing a moving target. The shipped maze comes first as the reference, then either generated
+ * mazes of each size or corpus files written by tools/mazegen.c.
+ *
+ * A second table follows with the ghost tick cost of every maze at 4 to 256 ghosts, each ghost
+ * updated every tick and then through update_ghost_lod() with a view following the target.
+ */
+
+#define MAZE_BENCH_MAX_SIZES 16
+#define MAZE_BENCH_MAX_FILES 16
+
+typedef struct MazeBenchOptions {
+	int widths[MAZE_BENCH_MAX_SIZES];
+	int heights[MAZE_BENCH_MAX_SIZES];
+	int size_count;
+	const char *files[MAZE_BENCH_MAX_FILES]; // Replace the generated mazes when given
+	int file_count;
+	Uint32 seed;
+} MazeBenchOptions;
+
+void maze_bench_default_options(MazeBenchOptions *options);
+// "28x31,256x256,...", false on a malformed list
+bool maze_bench_parse_sizes(MazeBenchOptions *options, const char *list);
+int maze_bench_run(const MazeBenchOptions *options);
+
+// Ghosts hunting a target that walks a tile every few ticks toward random goals, shared with the
+// regression suite. Ghosts and goals are drawn from seed
+struct MazeChase;
+typedef struct MazeChase MazeChase;
+
+// lod NULL updates every ghost every tick, otherwise its view follows the target
+MazeChase *maze_chase_create(Map *map, const Uint32 seed, const int ghosts, const GhostLod *lod);
+void maze_chase_destroy(MazeChase *chase);
+void maze_chase_move_target(MazeChase *chase);
+// Returns the ghosts updated at full detail near the target, 0 without LOD
+int maze_chase_update_ghosts(MazeChase *chase);
+
+#endif
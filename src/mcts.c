@@ -0,0 +1,356 @@
+#include "mcts.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bot.h"
+#include "debug.h"
+#include "metrics.h"
+#include "profiler.h"
+
+#define MCTS_REWARD_PELLETS 16.0f // Pellets eaten in a rollout for a full score
+#define MCTS_REWARD_DISTANCE 40.0f
+#define MCTS_ROLLOUT_RANDOMNESS 0.2f
+
+typedef struct MctsNode {
+	int children[4]; // Indexed by direction, -1 when closed by a wall or not expanded yet
+	int visits;
+	float value;
+	bool is_expanded;
+} MctsNode;
+
+struct Mcts {
+	MctsOptions options;
+	Game *sim;
+	MctsNode *nodes;
+	int node_count;
+	Uint32 rng_state;
+
+	Direction direction;
+	int ticks_until_think;
+	MctsStats stats;
+};
+
+/*
+ * SETUP
+ */
+
+void mcts_default_options(MctsOptions *options) {
+	options->rollouts = 0;
+	options->budget_ms = MCTS_PLAY_BUDGET_MS;
+	options->action_ticks = 8;
+	options->rollout_actions = 12;
+	options->exploration = 0.5f;
+	options->seed = 1;
+}
+
+Mcts *mcts_create(const MctsOptions *options) {
+	Mcts *this = calloc(1, sizeof(Mcts));
+	this->options = *options;
+	this->sim = game_create(NULL, NULL);
+	this->nodes = malloc(MCTS_MAX_NODES * sizeof(MctsNode));
+	this->rng_state = options->seed != 0 ? options->seed : 1;
+	this->direction = NONE;
+	return this;
+}
+
+void mcts_destroy(Mcts *this) {
+	game_destroy(this->sim);
+	free(this->nodes);
+	free(this);
+}
+
+/*
+ * SEARCH
+ */
+
+static int new_node(Mcts *this) {
+	MctsNode *node = &this->nodes[this->node_count];
+	for (int d = 0; d < 4; d++) {
+		node->children[d] = -1;
+	}
+	node->visits = 0;
+	node->value = 0.0f;
+	node->is_expanded = false;
+	return this->node_count++;
+}
+
+// Returns false once the player died
+static bool apply_action(Mcts *this, Direction direction) {
+	Game *sim = this->sim;
+	game_set_player_direction(sim, direction);
+	for (int i = 0; i < this->options.action_ticks; i++) {
+		game_update(sim, TICK_TIME);
+		this->stats.simulated_ticks++;
+		if (!game_is_player_alive(sim))
+			return false;
+	}
+	return true;
+}
+
+// The greedy bot with some noise plays on past the tree, it dies far less than a random walk
+static bool rollout(Mcts *this) {
+	Bot bot;
+	bot_init(&bot, bot_random(&this->rng_state), MCTS_ROLLOUT_RANDOMNESS);
+	int ticks = this->options.rollout_actions * this->options.action_ticks;
+	for (int i = 0; i < ticks; i++) {
+		// A cleared level waits out the next get ready countdown
+		i += game_fast_forward(this->sim, TICK_TIME, ticks - i);
+		if (i >= ticks)
+			break;
+		bot_update(&bot, this->sim);
+		game_update(this->sim, TICK_TIME);
+		this->stats.simulated_ticks++;
+		if (!game_is_player_alive(this->sim))
+			return false;
+	}
+	return true;
+}
+
+static float evaluate(Mcts *this, const GameStats *start, bool is_alive) {
+	if (!is_alive)
+		return 0.0f;
+	GameStats end = game_get_stats(this->sim);
+	if (end.level > start->level)
+		return 1.0f;
+
+	// Score would favour farming ghosts over clearing the level
+	float pellets = (float)(start->pellets_left - end.pellets_left);
+	float reward = 0.5f + 0.4f * SDL_min(pellets / MCTS_REWARD_PELLETS, 1.0f);
+
+	// Breaks ties when no rollout reaches a pellet
+	int distance = bot_get_pellet_distance(this->sim);
+	if (distance >= 0)
+		reward += 0.1f * (1.0f - SDL_min(distance, MCTS_REWARD_DISTANCE) / MCTS_REWARD_DISTANCE);
+	return reward;
+}
+
+static int select_child(Mcts *this, const MctsNode *node) {
+	float log_visits = logf((float)node->visits + 1.0f);
+	float best_score = -1.0f;
+	int best = -1;
+	for (int d = 0; d < 4; d++) {
+		if (node->children[d] < 0)
+			continue;
+		const MctsNode *child = &this->nodes[node->children[d]];
+		if (child->visits == 0)
+			return d;
+		float score = child->value / child->visits + this->options.exploration * sqrtf(log_visits / child->visits);
+		if (score > best_score) {
+			best_score = score;
+			best = d;
+		}
+	}
+	return best;
+}
+
+static void expand(Mcts *this, MctsNode *node) {
+	Direction open[4];
+	int open_count = bot_get_open_directions(this->sim, open);
+	node->is_expanded = true;
+	if (this->node_count + open_count > MCTS_MAX_NODES)
+		return;
+	for (int i = 0; i < open_count; i++) {
+		int child = new_node(this);
+		node->children[open[i]] = child;
+	}
+}
+
+static void iterate(Mcts *this, Game *root, const GameStats *start) {
+	int path[MCTS_MAX_DEPTH + 1];
+	int depth = 0;
+	path[depth] = 0;
+
+	game_copy(this->sim, root);
+	bool is_alive = true;
+
+	// Selection and expansion
+	while (is_alive && depth < MCTS_MAX_DEPTH) {
+		MctsNode *node = &this->nodes[path[depth]];
+		if (!node->is_expanded)
+			expand(this, node);
+		int d = select_child(this, node);
+		if (d < 0)
+			break;
+		bool was_new = this->nodes[node->children[d]].visits == 0;
+		path[++depth] = node->children[d];
+		is_alive = apply_action(this, d);
+		if (was_new)
+			break;
+	}
+
+	if (is_alive)
+		is_alive = rollout(this);
+
+	float reward = evaluate(this, start, is_alive);
+	for (int i = 0; i <= depth; i++) {
+		this->nodes[path[i]].visits++;
+		this->nodes[path[i]].value += reward;
+	}
+	this->stats.rollouts++;
+}
+
+Direction mcts_think(Mcts *this, Game *game) {
+	PROFILE_BEGIN("mcts_think");
+	// Rollouts are not part of the real game
+	metrics_set_paused(true);
+	PROFILE_PAUSE(true);
+
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	Uint64 start = SDL_GetPerformanceCounter();
+	Uint64 deadline = start + (Uint64)(this->options.budget_ms * frequency / 1000.0f);
+
+	SDL_zero(this->stats);
+	this->node_count = 0;
+	new_node(this);
+	GameStats start_stats = game_get_stats(game);
+
+	for (;;) {
+		iterate(this, game, &start_stats);
+		if (this->options.rollouts > 0) {
+			if (this->stats.rollouts >= this->options.rollouts)
+				break;
+		} else if (SDL_GetPerformanceCounter() >= deadline) {
+			break;
+		}
+		if (this->node_count + 4 > MCTS_MAX_NODES)
+			break;
+	}
+
+	// The most visited action is the most robust pick
+	const MctsNode *root = &this->nodes[0];
+	Direction best = NONE;
+	int best_visits = -1;
+	for (int d = 0; d < 4; d++) {
+		if (root->children[d] >= 0 && this->nodes[root->children[d]].visits > best_visits) {
+			best_visits = this->nodes[root->children[d]].visits;
+			best = d;
+		}
+	}
+
+	this->stats.elapsed_ms = (SDL_GetPerformanceCounter() - start) * 1000.0f / frequency;
+	PROFILE_PAUSE(false);
+	metrics_set_paused(false);
+	PROFILE_END();
+	return best;
+}
+
+void mcts_update(Mcts *this, Game *game) {
+	if (!game_is_in_play(game))
+		return;
+	if (--this->ticks_until_think <= 0) {
+		this->ticks_until_think = this->options.action_ticks;
+		this->direction = mcts_think(this, game);
+	}
+	if (this->direction != NONE)
+		game_set_player_direction(game, this->direction);
+}
+
+MctsStats mcts_get_stats(const Mcts *this) {
+	return this->stats;
+}
+
+/*
+ * BENCHMARK
+ */
+
+void mcts_bench_default_options(MctsBenchOptions *options) {
+	options->games = 20;
+	options->max_ticks = 60 * 60 * 10;
+	options->rollouts = 128;
+	options->seed = 1;
+}
+
+typedef struct BenchResult {
+	int wins; // Games that cleared the first level
+	double score;
+	double level;
+} BenchResult;
+
+static void add_result(BenchResult *result, Game *game) {
+	GameStats stats = game_get_stats(game);
+	result->wins += stats.level > 1;
+	result->score += stats.score;
+	result->level += stats.level;
+}
+
+static void print_result(const char *name, const BenchResult *result, int games) {
+	printf("%-8s win rate %5.1f%%, mean score %8.0f, mean level %.2f\n", name, 100.0 * result->wins / games, result->score / games, result->level / games);
+}
+
+int mcts_bench_run(const MctsBenchOptions *options) {
+	// Throughput: a minute of play, searching each frame for a full frame budget
+	MctsOptions mcts_options;
+	mcts_default_options(&mcts_options);
+	mcts_options.budget_ms = MCTS_FRAME_BUDGET_MS;
+	mcts_options.action_ticks = 1;
+	mcts_options.seed = options->seed;
+	Mcts *mcts = mcts_create(&mcts_options);
+	Game *game = game_create(NULL, NULL);
+
+	int frames = 0;
+	long long rollouts = 0;
+	Uint64 ticks = 0;
+	double elapsed_ms = 0.0;
+	for (int tick = 0; tick < 60 * 60 && !game_is_over(game); tick++) {
+		if (game_is_in_play(game)) {
+			mcts_update(mcts, game);
+			MctsStats stats = mcts_get_stats(mcts);
+			if (stats.rollouts > 0) {
+				frames++;
+				rollouts += stats.rollouts;
+				ticks += stats.simulated_ticks;
+				elapsed_ms += stats.elapsed_ms;
+			}
+		}
+		game_update(game, TICK_TIME);
+	}
+	game_destroy(game);
+	mcts_destroy(mcts);
+
+	if (frames > 0) {
+		printf("Rollouts per %.0fms frame: %.0f, %.0f simulated ticks/s\n", MCTS_FRAME_BUDGET_MS, (double)rollouts / frames, ticks / (elapsed_ms / 1000.0));
+	}
+
+	// Win rate against the greedy bot, with a fixed number of rollouts per decision
+	BenchResult search = { 0 };
+	BenchResult greedy = { 0 };
+	mcts_default_options(&mcts_options);
+	mcts_options.rollouts = options->rollouts;
+	for (int g = 0; g < options->games; g++) {
+		Uint32 seed = options->seed + g * 7919;
+
+		mcts_options.seed = seed;
+		mcts = mcts_create(&mcts_options);
+		game = game_create(NULL, NULL);
+		for (int tick = 0; tick < options->max_ticks && !game_is_over(game); tick++) {
+			tick += game_fast_forward(game, TICK_TIME, options->max_ticks - tick);
+			if (tick >= options->max_ticks)
+				break;
+			mcts_update(mcts, game);
+			game_update(game, TICK_TIME);
+		}
+		add_result(&search, game);
+		game_destroy(game);
+		mcts_destroy(mcts);
+
+		Bot bot;
+		bot_init(&bot, seed, 0.05f);
+		game = game_create(NULL, NULL);
+		for (int tick = 0; tick < options->max_ticks && !game_is_over(game); tick++) {
+			tick += game_fast_forward(game, TICK_TIME, options->max_ticks - tick);
+			if (tick >= options->max_ticks)
+				break;
+			bot_update(&bot, game);
+			game_update(game, TICK_TIME);
+		}
+		add_result(&greedy, game);
+		game_destroy(game);
+	}
+
+	printf("%d games, %d rollouts per decision\n", options->games, options->rollouts);
+	print_result("MCTS", &search, options->games);
+	print_result("Greedy", &greedy, options->games);
+	return 0;
+}
@@ -0,0 +1,64 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include "SDL2/SDL.h"
+
+#include "game.h"
+#include "utils.h"
+
+/*
+ * Autopilot built on Monte Carlo tree search. Each decision copies the live game into a
+ * headless one and plays many short rollouts from it: down the tree with UCB1, then the greedy
+ * bot of src/bot.h for rollout_actions * action_ticks ticks, picking a random direction on 20%
+ * of its new tiles. It survives far longer than a random walk, so a rollout says more, but each
+ * one costs a breadth first search every few ticks and its values lean toward what the bot would
+ * do. Actions hold a direction for a few ticks. Ghosts have no randomness, so a tree node
+ * always stands for the same state and no state has to be stored.
+ */
+
+#define MCTS_MAX_NODES 65536
+#define MCTS_MAX_DEPTH 8 // Actions in the tree, rollouts continue past it
+#define MCTS_FRAME_BUDGET_MS 16.0f
+#define MCTS_PLAY_BUDGET_MS 10.0f // Leaves time to draw the frame
+
+typedef struct MctsOptions {
+	int rollouts; // Per decision, 0 searches until budget_ms runs out
+	float budget_ms;
+	int action_ticks;
+	int rollout_actions;
+	float exploration;
+	Uint32 seed;
+} MctsOptions;
+
+typedef struct MctsStats {
+	int rollouts;
+	Uint64 simulated_ticks;
+	float elapsed_ms;
+} MctsStats;
+
+typedef struct MctsBenchOptions {
+	int games;
+	int max_ticks;
+	int rollouts; // Per decision in the win rate games, fixed so results replay
+	Uint32 seed;
+} MctsBenchOptions;
+
+struct Mcts;
+typedef struct Mcts Mcts;
+
+void mcts_default_options(MctsOptions *options);
+Mcts *mcts_create(const MctsOptions *options);
+void mcts_destroy(Mcts *mcts);
+
+// Searches from the current state and returns the best direction
+Direction mcts_think(Mcts *mcts, Game *game);
+// Call once per tick instead of player input, thinks again every action_ticks ticks
+void mcts_update(Mcts *mcts, Game *game);
+// Stats of the last search
+MctsStats mcts_get_stats(const Mcts *mcts);
+
+void mcts_bench_default_options(MctsBenchOptions *options);
+// Reports rollouts per frame and the win rate against the greedy bot, returns the exit code
+int mcts_bench_run(const MctsBenchOptions *options);
+
+#endif
@@ -0,0 +1,279 @@
+#include "metrics.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#define getpid GetCurrentProcessId
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+typedef struct Metrics {
+	MetricsSnapshot local;
+	MetricsSnapshot *shared;
+	char shared_name[64];
+#ifdef _WIN32
+	HANDLE mapping;
+#endif
+
+	Uint64 start_ms;
+	Uint64 last_publish_ms;
+	Uint64 last_dump_ms;
+	Uint64 last_counters[METRIC_COUNTER_COUNT];
+	MetricsSnapshot dumped; // Written out without holding the lock
+} Metrics;
+
+static Metrics metrics = { 0 };
+static SDL_SpinLock lock = 0;
+static THREAD_LOCAL bool is_recording_thread = false;
+static THREAD_LOCAL bool is_paused = false;
+
+static const char *counter_names[METRIC_COUNTER_COUNT] = {
+	"ticks",
+	"frames",
+	"searches",
+	"pellets_eaten",
+	"allocations",
+	// Same order as State in game.c
+	"state.new_game",
+	"state.start_level",
+	"state.wait",
+	"state.death",
+	"state.normal",
+	"state.win",
+	"state.gameover",
+	"state.unused",
+};
+
+static const char *histogram_names[METRIC_HISTOGRAM_COUNT] = {
+	"frame_time_us",
+	"update_time_us",
+	"search_nodes",
+	"path_length",
+	"allocations_per_tick",
+	"tick_interval_us",
+};
+
+/*
+ * SHARED MEMORY
+ */
+
+static MetricsSnapshot *map_shared(const char *name) {
+#ifdef _WIN32
+	char full_name[96];
+	SDL_snprintf(full_name, sizeof(full_name), "Local\\%s", name);
+	metrics.mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(MetricsSnapshot), full_name);
+	if (metrics.mapping == NULL)
+		return NULL;
+	return MapViewOfFile(metrics.mapping, FILE_MAP_WRITE, 0, 0, sizeof(MetricsSnapshot));
+#else
+	char full_name[96];
+	SDL_snprintf(full_name, sizeof(full_name), "/%s", name); // Shows up as /dev/shm/<name>
+	int fd = shm_open(full_name, O_CREAT | O_RDWR, 0644);
+	if (fd < 0)
+		return NULL;
+	if (ftruncate(fd, sizeof(MetricsSnapshot)) != 0) {
+		close(fd);
+		return NULL;
+	}
+	void *data = mmap(NULL, sizeof(MetricsSnapshot), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	return data == MAP_FAILED ? NULL : data;
+#endif
+}
+
+static void unmap_shared() {
+#ifdef _WIN32
+	UnmapViewOfFile(metrics.shared);
+	CloseHandle(metrics.mapping);
+#else
+	char full_name[96];
+	SDL_snprintf(full_name, sizeof(full_name), "/%s", metrics.shared_name);
+	munmap(metrics.shared, sizeof(MetricsSnapshot));
+	shm_unlink(full_name);
+#endif
+}
+
+/*
+ * RECORDING
+ */
+
+bool metrics_init() {
+	SDL_zero(metrics);
+	metrics.local.magic = METRICS_MAGIC;
+	metrics.local.version = METRICS_VERSION;
+	metrics.local.pid = (Uint32)getpid();
+	for (int i = 0; i < METRIC_HISTOGRAM_COUNT; i++) {
+		metrics.local.histograms[i].min = (Uint64)-1;
+	}
+	metrics.start_ms = SDL_GetTicks64();
+	metrics.last_publish_ms = metrics.start_ms;
+	metrics.last_dump_ms = metrics.start_ms;
+	is_recording_thread = true;
+
+	SDL_snprintf(metrics.shared_name, sizeof(metrics.shared_name), METRICS_SHM_PREFIX "%u", metrics.local.pid);
+	metrics.shared = map_shared(metrics.shared_name);
+	if (metrics.shared == NULL) {
+		SDL_Log("Unable to create metrics segment %s, only dumping text", metrics.shared_name);
+		return false;
+	}
+	SDL_memcpy(metrics.shared, &metrics.local, sizeof(MetricsSnapshot));
+	return true;
+}
+
+void metrics_shutdown() {
+	if (metrics.shared != NULL)
+		unmap_shared();
+	metrics.shared = NULL;
+	is_recording_thread = false;
+}
+
+void metrics_add_thread() {
+	is_recording_thread = true;
+}
+
+void metrics_set_paused(const bool paused) {
+	is_paused = paused;
+}
+
+void metrics_count(const MetricCounter counter, const Uint64 amount) {
+	if (!is_recording_thread || is_paused)
+		return;
+	SDL_AtomicLock(&lock);
+	metrics.local.counters[counter] += amount;
+	SDL_AtomicUnlock(&lock);
+}
+
+static int bucket_index(Uint64 value) {
+	if (value < METRICS_SUB_BUCKETS)
+		return (int)value;
+
+	int exponent = METRICS_SUB_BUCKET_BITS;
+	while ((value >> exponent) > 1) {
+		exponent++;
+	}
+	int sub_bucket = (int)(value >> (exponent - METRICS_SUB_BUCKET_BITS)) - METRICS_SUB_BUCKETS;
+	int index = (exponent - METRICS_SUB_BUCKET_BITS + 1) * METRICS_SUB_BUCKETS + sub_bucket;
+	return index < METRICS_BUCKETS ? index : METRICS_BUCKETS - 1;
+}
+
+static Uint64 bucket_value(int index) {
+	if (index < METRICS_SUB_BUCKETS)
+		return index;
+	int exponent = index / METRICS_SUB_BUCKETS + METRICS_SUB_BUCKET_BITS - 1;
+	Uint64 sub_bucket = index % METRICS_SUB_BUCKETS + METRICS_SUB_BUCKETS;
+	return sub_bucket << (exponent - METRICS_SUB_BUCKET_BITS);
+}
+
+void metrics_record(const MetricHistogram histogram, const Uint64 value) {
+	if (!is_recording_thread || is_paused)
+		return;
+
+	int bucket = bucket_index(value);
+	SDL_AtomicLock(&lock);
+	MetricsHistogram *this = &metrics.local.histograms[histogram];
+	this->count++;
+	this->sum += value;
+	if (value < this->min)
+		this->min = value;
+	if (value > this->max)
+		this->max = value;
+	this->buckets[bucket]++;
+	SDL_AtomicUnlock(&lock);
+}
+
+/*
+ * PUBLISHING
+ */
+
+void metrics_tick() {
+	if (!is_recording_thread)
+		return;
+
+	Uint64 now = SDL_GetTicks64();
+	SDL_AtomicLock(&lock);
+	metrics.local.uptime_ms = now - metrics.start_ms;
+
+	if (now - metrics.last_publish_ms >= METRICS_PUBLISH_INTERVAL) {
+		float seconds = (now - metrics.last_publish_ms) / 1000.0f;
+		for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+			metrics.local.rates[i] = (metrics.local.counters[i] - metrics.last_counters[i]) / seconds;
+			metrics.last_counters[i] = metrics.local.counters[i];
+		}
+		metrics.last_publish_ms = now;
+
+		if (metrics.shared != NULL) {
+			// Seqlock: readers retry when the sequence is odd or changed while they copied. SDL_AtomicSet()
+			// is a full barrier, the payload can't be seen written before the odd sequence or after the even one
+			int sequence = SDL_AtomicGet(&metrics.shared->sequence);
+			SDL_AtomicSet(&metrics.shared->sequence, sequence + 1);
+			SDL_memcpy(metrics.shared->counters, metrics.local.counters, sizeof(MetricsSnapshot) - offsetof(MetricsSnapshot, counters));
+			metrics.shared->uptime_ms = metrics.local.uptime_ms;
+			SDL_AtomicSet(&metrics.shared->sequence, sequence + 2);
+		}
+	}
+
+	bool is_dump_due = now - metrics.last_dump_ms >= METRICS_DUMP_INTERVAL;
+	if (is_dump_due) {
+		metrics.last_dump_ms = now;
+		SDL_memcpy(&metrics.dumped, &metrics.local, sizeof(MetricsSnapshot));
+	}
+	SDL_AtomicUnlock(&lock);
+
+	if (is_dump_due) {
+		char path[64];
+		SDL_snprintf(path, sizeof(path), "metrics-%u.txt", metrics.dumped.pid);
+		FILE *file = fopen(path, "w");
+		if (file != NULL) {
+			metrics_dump(file, &metrics.dumped);
+			fclose(file);
+		}
+	}
+}
+
+const char *metrics_counter_name(const int counter) {
+	return counter_names[counter];
+}
+
+const char *metrics_histogram_name(const int histogram) {
+	return histogram_names[histogram];
+}
+
+Uint64 metrics_histogram_percentile(const MetricsHistogram *this, const float percentile) {
+	if (this->count == 0)
+		return 0;
+
+	Uint64 target = (Uint64)(this->count * percentile / 100.0f);
+	if (target >= this->count)
+		target = this->count - 1;
+
+	Uint64 seen = 0;
+	for (int i = 0; i < METRICS_BUCKETS; i++) {
+		seen += this->buckets[i];
+		if (seen > target)
+			return SDL_min(SDL_max(bucket_value(i), this->min), this->max);
+	}
+	return this->max;
+}
+
+void metrics_dump(FILE *file, const MetricsSnapshot *snapshot) {
+	fprintf(file, "pid %u, uptime %.1fs\n", snapshot->pid, snapshot->uptime_ms / 1000.0);
+	fprintf(file, "%-24s %14s %12s\n", "counter", "total", "per second");
+	for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+		fprintf(file, "%-24s %14llu %12.1f\n", counter_names[i], (unsigned long long)snapshot->counters[i], snapshot->rates[i]);
+	}
+
+	fprintf(file, "\n%-24s %10s %10s %10s %10s %10s %10s\n", "histogram", "count", "mean", "p50", "p90", "p99", "max");
+	for (int i = 0; i < METRIC_HISTOGRAM_COUNT; i++) {
+		const MetricsHistogram *histogram = &snapshot->histograms[i];
+		double mean = histogram->count > 0 ? (double)histogram->sum / histogram->count : 0.0;
+		fprintf(file, "%-24s %10llu %10.1f %10llu %10llu %10llu %10llu\n", histogram_names[i],
+				(unsigned long long)histogram->count, mean,
+				(unsigned long long)metrics_histogram_percentile(histogram, 50.0f),
+				(unsigned long long)metrics_histogram_percentile(histogram, 90.0f),
+				(unsigned long long)metrics_histogram_percentile(histogram, 99.0f),
+				(unsigned long long)(histogram->count > 0 ? histogram->max : 0));
+	}
+}
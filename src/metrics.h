@@ -0,0 +1,89 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+
+#include "SDL2/SDL.h"
+
+#include "utils.h"
+
+/*
+ * Always-on aggregate metrics. Counters and log-linear histograms (16 sub buckets per power of two,
+ * ~6% precision) are published once per second to a shared memory segment that tools/metrics_cli.c
+ * reads, and dumped as text to metrics-<pid>.txt every METRICS_DUMP_INTERVAL ms.
+ *
+ * Only the thread that called metrics_init() and threads added with metrics_add_thread() record,
+ * calls from other threads are ignored. Recording threads share one spinlock.
+ */
+
+#define METRICS_MAGIC 0x4D434150 // "PACM"
+#define METRICS_VERSION 2
+#define METRICS_SHM_PREFIX "pacman-metrics-"
+#define METRICS_PUBLISH_INTERVAL 1000
+#define METRICS_DUMP_INTERVAL 10000
+
+#define METRICS_SUB_BUCKET_BITS 4
+#define METRICS_SUB_BUCKETS (1 << METRICS_SUB_BUCKET_BITS)
+#define METRICS_BUCKETS (40 * METRICS_SUB_BUCKETS)
+
+#define METRICS_MAX_STATES 8
+
+enum MetricCounter {
+	METRIC_TICKS,
+	METRIC_FRAMES,
+	METRIC_SEARCHES,
+	METRIC_PELLETS_EATEN,
+	METRIC_ALLOCATIONS,
+	METRIC_STATE_TRANSITIONS, // One counter per state, indexed by METRIC_STATE_TRANSITIONS + state
+	METRIC_COUNTER_COUNT = METRIC_STATE_TRANSITIONS + METRICS_MAX_STATES
+} typedef MetricCounter;
+
+enum MetricHistogram {
+	METRIC_FRAME_TIME_US,
+	METRIC_UPDATE_TIME_US,
+	METRIC_SEARCH_NODES,
+	METRIC_PATH_LENGTH,
+	METRIC_ALLOCATIONS_PER_TICK,
+	METRIC_TICK_INTERVAL_US, // Between the starts of simulation ticks, against TICK_TIME
+	METRIC_HISTOGRAM_COUNT
+} typedef MetricHistogram;
+
+typedef struct MetricsHistogram {
+	Uint64 count;
+	Uint64 sum;
+	Uint64 min;
+	Uint64 max;
+	Uint32 buckets[METRICS_BUCKETS];
+} MetricsHistogram;
+
+// Layout of the shared memory segment
+typedef struct MetricsSnapshot {
+	Uint32 magic;
+	Uint32 version;
+	SDL_atomic_t sequence; // Odd while the writer is publishing
+	Uint32 pid;
+	Uint64 uptime_ms;
+	Uint64 counters[METRIC_COUNTER_COUNT];
+	float rates[METRIC_COUNTER_COUNT]; // Per second, over the last publish interval
+	MetricsHistogram histograms[METRIC_HISTOGRAM_COUNT];
+} MetricsSnapshot;
+
+bool metrics_init();
+void metrics_shutdown();
+// Lets the calling thread record too, for the game's simulation thread
+void metrics_add_thread();
+
+// Pauses recording on the calling thread, for simulated games that shouldn't show up
+void metrics_set_paused(const bool paused);
+void metrics_count(const MetricCounter counter, const Uint64 amount);
+void metrics_record(const MetricHistogram histogram, const Uint64 value);
+
+// Publishes to shared memory and dumps text when the intervals have elapsed
+void metrics_tick();
+
+const char *metrics_counter_name(const int counter);
+const char *metrics_histogram_name(const int histogram);
+Uint64 metrics_histogram_percentile(const MetricsHistogram *histogram, const float percentile);
+void metrics_dump(FILE *file, const MetricsSnapshot *snapshot);
+
+#endif
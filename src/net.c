@@ -0,0 +1,269 @@
+#include "net.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+typedef SOCKET SocketHandle;
+#define close_socket closesocket
+#define would_block() (WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int SocketHandle;
+#define INVALID_SOCKET -1
+#define close_socket close
+#define would_block() (errno == EAGAIN || errno == EWOULDBLOCK)
+#endif
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL // A spectator closing its end mustn't kill the game with SIGPIPE
+#else
+#define SEND_FLAGS 0
+#endif
+
+#include <stdlib.h>
+
+#include "debug.h"
+
+typedef struct DelayedPacket {
+	Uint64 deliver_at; // 0 for a free slot
+	int length;
+	Uint8 data[NET_MAX_PACKET];
+} DelayedPacket;
+
+struct NetSocket {
+	SocketHandle handle;
+	struct sockaddr_in remote;
+	NetConditions conditions;
+	Uint32 rng_state;
+	DelayedPacket *delayed;
+};
+
+struct NetListener {
+	SocketHandle handle;
+};
+
+struct NetStream {
+	SocketHandle handle;
+};
+
+#ifdef _WIN32
+static int wsa_users = 0;
+#endif
+
+static void start_sockets() {
+#ifdef _WIN32
+	if (wsa_users++ == 0) {
+		WSADATA data;
+		WSAStartup(MAKEWORD(2, 2), &data);
+	}
+#endif
+}
+
+static void stop_sockets() {
+#ifdef _WIN32
+	if (--wsa_users == 0)
+		WSACleanup();
+#endif
+}
+
+static void set_non_blocking(SocketHandle handle) {
+#ifdef _WIN32
+	u_long non_blocking = 1;
+	ioctlsocket(handle, FIONBIO, &non_blocking);
+#else
+	fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+static struct sockaddr_in loopback(const Uint16 port) {
+	struct sockaddr_in address;
+	SDL_zero(address);
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+	return address;
+}
+
+NetSocket *net_open(const Uint16 local_port, const Uint16 remote_port, const NetConditions *conditions) {
+	start_sockets();
+	SocketHandle handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (handle == INVALID_SOCKET) {
+		stop_sockets();
+		return NULL;
+	}
+
+	struct sockaddr_in local = loopback(local_port);
+	if (bind(handle, (struct sockaddr *)&local, sizeof(local)) != 0) {
+		close_socket(handle);
+		stop_sockets();
+		return NULL;
+	}
+	set_non_blocking(handle);
+
+	NetSocket *this = calloc(1, sizeof(NetSocket));
+	this->handle = handle;
+	this->remote = loopback(remote_port);
+	this->conditions = *conditions;
+	this->rng_state = 0x9E3779B9 ^ local_port;
+	this->delayed = calloc(NET_SHIM_CAPACITY, sizeof(DelayedPacket));
+	return this;
+}
+
+void net_close(NetSocket *this) {
+	close_socket(this->handle);
+	free(this->delayed);
+	free(this);
+	stop_sockets();
+}
+
+static Uint32 next_random(NetSocket *this) {
+	Uint32 x = this->rng_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	this->rng_state = x;
+	return x;
+}
+
+static void send_now(NetSocket *this, const void *data, const int length) {
+	sendto(this->handle, data, length, 0, (struct sockaddr *)&this->remote, sizeof(this->remote));
+}
+
+void net_send(NetSocket *this, const void *data, const int length) {
+	if (length > NET_MAX_PACKET)
+		return;
+	if (this->conditions.loss_percent > 0 && (int)(next_random(this) % 100) < this->conditions.loss_percent)
+		return;
+
+	int delay = this->conditions.latency_ms;
+	if (this->conditions.jitter_ms > 0)
+		delay += next_random(this) % (this->conditions.jitter_ms + 1);
+	if (delay <= 0) {
+		send_now(this, data, length);
+		return;
+	}
+
+	for (int i = 0; i < NET_SHIM_CAPACITY; i++) {
+		DelayedPacket *packet = &this->delayed[i];
+		if (packet->deliver_at == 0) {
+			packet->deliver_at = SDL_GetTicks64() + delay;
+			packet->length = length;
+			SDL_memcpy(packet->data, data, length);
+			return;
+		}
+	}
+	// A full shim behaves like a congested link
+}
+
+int net_receive(NetSocket *this, void *buffer, const int capacity) {
+	Uint64 now = SDL_GetTicks64();
+	for (int i = 0; i < NET_SHIM_CAPACITY; i++) {
+		DelayedPacket *packet = &this->delayed[i];
+		if (packet->deliver_at != 0 && packet->deliver_at <= now) {
+			send_now(this, packet->data, packet->length);
+			packet->deliver_at = 0;
+		}
+	}
+
+	int length = recvfrom(this->handle, buffer, capacity, 0, NULL, NULL);
+	return length > 0 ? length : 0;
+}
+
+/*
+ * STREAMS
+ */
+
+NetListener *net_listen(const Uint16 port) {
+	start_sockets();
+	SocketHandle handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (handle == INVALID_SOCKET) {
+		stop_sockets();
+		return NULL;
+	}
+#ifndef _WIN32
+	// A restarted game can take the port back at once
+	int reuse = 1;
+	setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse, sizeof(reuse));
+#endif
+
+	struct sockaddr_in local = loopback(port);
+	if (bind(handle, (struct sockaddr *)&local, sizeof(local)) != 0 || listen(handle, SOMAXCONN) != 0) {
+		close_socket(handle);
+		stop_sockets();
+		return NULL;
+	}
+	set_non_blocking(handle);
+
+	NetListener *this = calloc(1, sizeof(NetListener));
+	this->handle = handle;
+	return this;
+}
+
+void net_listener_close(NetListener *this) {
+	close_socket(this->handle);
+	free(this);
+	stop_sockets();
+}
+
+static NetStream *wrap_stream(SocketHandle handle) {
+	// Small writes every tick, they shouldn't wait for more to come
+	int no_delay = 1;
+	setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, (const char *)&no_delay, sizeof(no_delay));
+	set_non_blocking(handle);
+
+	NetStream *this = calloc(1, sizeof(NetStream));
+	this->handle = handle;
+	return this;
+}
+
+NetStream *net_accept(NetListener *listener) {
+	SocketHandle handle = accept(listener->handle, NULL, NULL);
+	if (handle == INVALID_SOCKET)
+		return NULL;
+	start_sockets();
+	return wrap_stream(handle);
+}
+
+NetStream *net_connect(const Uint16 port) {
+	start_sockets();
+	SocketHandle handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (handle == INVALID_SOCKET) {
+		stop_sockets();
+		return NULL;
+	}
+	struct sockaddr_in remote = loopback(port);
+	if (connect(handle, (struct sockaddr *)&remote, sizeof(remote)) != 0) {
+		close_socket(handle);
+		stop_sockets();
+		return NULL;
+	}
+	return wrap_stream(handle);
+}
+
+void net_stream_close(NetStream *this) {
+	close_socket(this->handle);
+	free(this);
+	stop_sockets();
+}
+
+int net_stream_send(NetStream *this, const void *data, const int length) {
+	int sent = send(this->handle, data, length, SEND_FLAGS);
+	if (sent >= 0)
+		return sent;
+	return would_block() ? 0 : -1;
+}
+
+int net_stream_receive(NetStream *this, void *buffer, const int capacity) {
+	int length = recv(this->handle, buffer, capacity, 0);
+	if (length > 0)
+		return length;
+	if (length == 0)
+		return -1;
+	return would_block() ? 0 : -1;
+}
@@ -0,0 +1,53 @@
+#ifndef NET_H
+#define NET_H
+
+#include "SDL2/SDL.h"
+
+#include "utils.h"
+
+/*
+ * Non-blocking UDP between two processes on localhost. Outgoing datagrams go through a shim
+ * that delays, jitters and drops them, so netplay can be tested without a real network.
+ *
+ * Non-blocking TCP streams on localhost too, for spectators.
+ */
+
+#define NET_MAX_PACKET 256
+#define NET_SHIM_CAPACITY 1024
+
+typedef struct NetConditions {
+	int latency_ms; // One way
+	int jitter_ms; // Extra random delay, reorders packets
+	int loss_percent;
+} NetConditions;
+
+struct NetSocket;
+typedef struct NetSocket NetSocket;
+
+// Binds 127.0.0.1:local_port and sends to 127.0.0.1:remote_port, NULL on failure
+NetSocket *net_open(const Uint16 local_port, const Uint16 remote_port, const NetConditions *conditions);
+void net_close(NetSocket *socket);
+
+void net_send(NetSocket *socket, const void *data, const int length);
+// Also flushes delayed datagrams that are due. Returns the datagram length, 0 when there is none
+int net_receive(NetSocket *socket, void *buffer, const int capacity);
+
+struct NetListener;
+typedef struct NetListener NetListener;
+struct NetStream;
+typedef struct NetStream NetStream;
+
+// Accepts connections on 127.0.0.1:port, NULL on failure
+NetListener *net_listen(const Uint16 port);
+void net_listener_close(NetListener *listener);
+// NULL when nobody is waiting
+NetStream *net_accept(NetListener *listener);
+// Waits for the connection, then never blocks again. NULL when nobody listens on port
+NetStream *net_connect(const Uint16 port);
+void net_stream_close(NetStream *stream);
+// Bytes taken, 0 when the socket buffer is full, -1 once the other end is gone
+int net_stream_send(NetStream *stream, const void *data, const int length);
+// Bytes read, 0 when nothing is waiting, -1 once the other end is gone
+int net_stream_receive(NetStream *stream, void *buffer, const int capacity);
+
+#endif
@@ -0,0 +1,226 @@
+#include "pack.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+typedef struct Pack {
+	const Uint8 *data;
+	size_t size;
+	const PackEntry *entries;
+	Uint32 entry_count;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+} Pack;
+
+static Pack pack = { 0 };
+
+// Where loose files are looked for when they are not in the pack
+static char search_paths[3][512] = { "resources/" };
+static int search_path_count = 1;
+
+/*
+ * PLATFORM
+ */
+
+static bool map_file(const char *path) {
+#ifdef _WIN32
+	pack.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (pack.file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	GetFileSizeEx(pack.file, &size);
+	pack.size = (size_t)size.QuadPart;
+	pack.mapping = CreateFileMappingA(pack.file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (pack.mapping == NULL) {
+		CloseHandle(pack.file);
+		return false;
+	}
+	pack.data = MapViewOfFile(pack.mapping, FILE_MAP_READ, 0, 0, 0);
+	if (pack.data == NULL) {
+		CloseHandle(pack.mapping);
+		CloseHandle(pack.file);
+		return false;
+	}
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return false;
+	}
+	pack.size = (size_t)st.st_size;
+	void *data = mmap(NULL, pack.size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // The mapping keeps the file alive
+	if (data == MAP_FAILED)
+		return false;
+	pack.data = data;
+#endif
+	return true;
+}
+
+static void unmap_file() {
+#ifdef _WIN32
+	UnmapViewOfFile(pack.data);
+	CloseHandle(pack.mapping);
+	CloseHandle(pack.file);
+#else
+	munmap((void *)pack.data, pack.size);
+#endif
+}
+
+/*
+ * ARCHIVE
+ */
+
+bool pack_open(const char *file_name) {
+	char path[512];
+	char *base_path = SDL_GetBasePath();
+
+	// Resolve relative to the executable first, then fall back to the working directory
+	if (base_path != NULL) {
+		SDL_snprintf(search_paths[0], sizeof(search_paths[0]), "%sresources/", base_path);
+		SDL_snprintf(search_paths[1], sizeof(search_paths[1]), "%s../resources/", base_path);
+		SDL_snprintf(search_paths[2], sizeof(search_paths[2]), "resources/");
+		search_path_count = 3;
+		SDL_snprintf(path, sizeof(path), "%s%s", base_path, file_name);
+		SDL_free(base_path);
+	} else {
+		SDL_snprintf(path, sizeof(path), "%s", file_name);
+	}
+
+	if (!map_file(path)) {
+		SDL_Log("No asset pack at %s, using loose files", path);
+		return false;
+	}
+
+	const PackHeader *header = (const PackHeader *)pack.data;
+	if (pack.size < sizeof(PackHeader) || header->magic != PACK_MAGIC || header->version != PACK_VERSION ||
+			sizeof(PackHeader) + header->entry_count * sizeof(PackEntry) > pack.size) {
+		SDL_Log("Invalid asset pack %s, using loose files", path);
+		unmap_file();
+		SDL_zero(pack);
+		return false;
+	}
+
+	// Every blob must lie inside the file, a truncated pack would have the loaders read past the mapping
+	const PackEntry *entries = (const PackEntry *)(pack.data + sizeof(PackHeader));
+	for (Uint32 i = 0; i < header->entry_count; i++) {
+		const PackEntry *entry = &entries[i];
+		bool is_valid = (Uint64)entry->offset + entry->size <= pack.size;
+		if (entry->type == PACK_ENTRY_RGBA)
+			is_valid = is_valid && (Uint64)entry->width * entry->height * 4 <= entry->size;
+		if (!is_valid) {
+			SDL_Log("Asset pack %s entry %.*s is out of range, using loose files", path, PACK_NAME_LENGTH, entry->name);
+			unmap_file();
+			SDL_zero(pack);
+			return false;
+		}
+	}
+
+	pack.entries = entries;
+	pack.entry_count = header->entry_count;
+	SDL_Log("Mapped asset pack %s (%u entries)", path, pack.entry_count);
+	return true;
+}
+
+void pack_close() {
+	if (pack.data != NULL)
+		unmap_file();
+	SDL_zero(pack);
+}
+
+static const PackEntry *pack_find(const char *name) {
+	// Entries are sorted by the packer
+	int low = 0;
+	int high = (int)pack.entry_count - 1;
+	while (low <= high) {
+		int mid = (low + high) / 2;
+		int cmp = SDL_strncmp(name, pack.entries[mid].name, PACK_NAME_LENGTH);
+		if (cmp == 0)
+			return &pack.entries[mid];
+		if (cmp < 0)
+			high = mid - 1;
+		else
+			low = mid + 1;
+	}
+	return NULL;
+}
+
+/*
+ * LOADERS
+ */
+
+SDL_RWops *pack_open_rw(const char *name) {
+	const PackEntry *entry = pack_find(name);
+	if (entry != NULL)
+		return SDL_RWFromConstMem(pack.data + entry->offset, entry->size);
+
+	for (int i = 0; i < search_path_count; i++) {
+		char path[512];
+		SDL_snprintf(path, sizeof(path), "%s%s", search_paths[i], name);
+		SDL_RWops *rw = SDL_RWFromFile(path, "rb");
+		if (rw != NULL)
+			return rw;
+	}
+	SDL_Log("Unable to open asset %s", name);
+	return NULL;
+}
+
+// Points into the read only mapping, only for SDL calls that read it and freed right after
+static SDL_Surface *map_surface(const PackEntry *entry) {
+	return SDL_CreateRGBSurfaceWithFormatFrom((void *)(pack.data + entry->offset), entry->width, entry->height, 32, entry->width * 4, SDL_PIXELFORMAT_RGBA32);
+}
+
+SDL_Surface *pack_load_surface(const char *name) {
+	const PackEntry *entry = pack_find(name);
+	if (entry != NULL && entry->type == PACK_ENTRY_RGBA) {
+		// A copy, callers may write to it
+		SDL_Surface *mapped = map_surface(entry);
+		if (mapped == NULL)
+			return NULL;
+		SDL_Surface *surface = SDL_DuplicateSurface(mapped);
+		SDL_FreeSurface(mapped);
+		return surface;
+	}
+
+	SDL_RWops *rw = pack_open_rw(name);
+	if (rw == NULL)
+		return NULL;
+	return IMG_Load_RW(rw, 1);
+}
+
+SDL_Texture *pack_load_texture(SDL_Renderer *renderer, const char *name) {
+	const PackEntry *entry = pack_find(name);
+	if (entry == NULL || entry->type != PACK_ENTRY_RGBA) {
+		SDL_RWops *rw = pack_open_rw(name);
+		if (rw == NULL)
+			return NULL;
+		return IMG_LoadTexture_RW(renderer, rw, 1);
+	}
+
+	// Uploading only reads the pixels, no copy needed
+	SDL_Surface *surf = map_surface(entry);
+	SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surf);
+	SDL_FreeSurface(surf);
+	return texture;
+}
+
+TTF_Font *pack_load_font(const char *name, int point_size) {
+	SDL_RWops *rw = pack_open_rw(name);
+	if (rw == NULL)
+		return NULL;
+	return TTF_OpenFontRW(rw, 1, point_size);
+}
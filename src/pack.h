@@ -0,0 +1,55 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_image.h"
+#include "SDL2/SDL_ttf.h"
+
+#include "utils.h"
+
+/*
+ * Asset archive, built by tools/packer.c
+ *
+ * Layout: PackHeader | PackEntry[entry_count] (sorted by name) | data
+ * Every blob starts on a PACK_ALIGNMENT boundary so pre-decoded images can be
+ * handed to SDL straight from the mapped file. All fields are little endian.
+ */
+
+#define PACK_MAGIC 0x4B434150 // "PACK"
+#define PACK_VERSION 1
+#define PACK_ALIGNMENT 16
+#define PACK_NAME_LENGTH 48
+#define PACK_FILE_NAME "resources.pak"
+
+enum PackEntryType {
+	PACK_ENTRY_RAW = 0, // File copied as is
+	PACK_ENTRY_RGBA = 1 // Image decoded to SDL_PIXELFORMAT_RGBA32, pitch = width * 4
+} typedef PackEntryType;
+
+typedef struct PackHeader {
+	Uint32 magic;
+	Uint32 version;
+	Uint32 entry_count;
+	Uint32 reserved;
+} PackHeader;
+
+typedef struct PackEntry {
+	char name[PACK_NAME_LENGTH]; // Path relative to resources/, '/' separated
+	Uint32 type;
+	Uint32 offset;
+	Uint32 size;
+	Uint16 width;
+	Uint16 height;
+} PackEntry;
+
+// Maps the archive next to the executable. Without it, assets are read from the resources/ folder.
+bool pack_open(const char *file_name);
+void pack_close();
+
+SDL_RWops *pack_open_rw(const char *name);
+// The caller owns the surface and may write to it, packed images are copied out of the mapping
+SDL_Surface *pack_load_surface(const char *name);
+SDL_Texture *pack_load_texture(SDL_Renderer *renderer, const char *name);
+TTF_Font *pack_load_font(const char *name, int point_size);
+
+#endif
@@ -1,9 +1,9 @@
 #include "player.h"
 
 typedef struct Player {
-	SDL_FPoint pos;
-	SDL_Texture *texture;
+	FixedPoint pos;
 	Direction direction;
+	Fixed speed; // Per second
 
 	int animation_timer;
 	int current_frame;
@@ -11,78 +11,93 @@ typedef struct Player {
 
 } Player;
 
-Player *player_load(SDL_Renderer *renderer) {
+Player *player_load() {
 	Player *player = malloc(sizeof(Player));
-	player->texture = IMG_LoadTexture(renderer, "resources/pac_man.png");
+	player->speed = FIXED_FROM_FLOAT(PLAYER_SPEED);
 	player->animation_timer = 0;
 	player->current_frame = 0;
 	player->is_dead = false;
+	return player;
 }
 
 void player_free(Player *player) {
-	SDL_DestroyTexture(player->texture);
 	free(player);
 }
 
+void player_copy(Player *dst, const Player *src) {
+	*dst = *src;
+}
+
 void player_reset(Player *player) {
 	player->direction = WEST;
-	player->pos.x = 13.0f;
-	player->pos.y = 23.0f;
+	player->pos.x = FIXED_FROM_INT(13);
+	player->pos.y = FIXED_FROM_INT(23);
 	player->is_dead = false;
 	player->current_frame = 0;
 	player->animation_timer = 0;
 }
 
-void player_input(Player *player, SDL_Event *e) {
+Direction player_input_direction(const SDL_Event *e) {
 	if (e->type == SDL_KEYDOWN) {
 		switch (e->key.keysym.scancode) {
 			case SDL_SCANCODE_W:
-				player->direction = NORTH;
-				break;
+				return NORTH;
 			case SDL_SCANCODE_S:
-				player->direction = SOUTH;
-				break;
+				return SOUTH;
 			case SDL_SCANCODE_A:
-				player->direction = WEST;
-				break;
+				return WEST;
 			case SDL_SCANCODE_D:
-				player->direction = EAST;
-				break;
+				return EAST;
 		}
 	}
+	return NONE;
+}
+
+void player_input(Player *player, SDL_Event *e) {
+	Direction direction = player_input_direction(e);
+	if (direction != NONE)
+		player->direction = direction;
+}
+
+void player_set_direction(Player *player, const Direction direction) {
+	player->direction = direction;
+}
+
+void player_set_speed(Player *player, const float speed) {
+	player->speed = FIXED_FROM_FLOAT(speed);
 }
 
-void player_update(Player *player, int delta_time, Map *map, float min_x, float max_x) {
-	float speed = PLAYER_SPEED * delta_time / 1000.0f;
-	SDL_FPoint new_pos = player->pos;
-	SDL_FPoint bound_pos = player->pos;
-	bound_pos.x += .5f;
-	bound_pos.y += .5f; // .5 is the players' bound box
+void player_update(Player *player, int delta_time, Map *map, int min_x, int max_x) {
+	Fixed speed = fixed_step(player->speed, delta_time);
+	FixedPoint new_pos = player->pos;
+	FixedPoint bound_pos = player->pos;
+	bound_pos.x += FIXED_HALF;
+	bound_pos.y += FIXED_HALF; // .5 is the players' bound box
 
 	switch (player->direction) {
 		case NORTH:
 			new_pos.y += -speed;
-			bound_pos.y += -speed - .5f;
-			new_pos.x = round(new_pos.x);
+			bound_pos.y += -speed - FIXED_HALF;
+			new_pos.x = FIXED_ROUND(new_pos.x);
 			break;
 		case SOUTH:
 			new_pos.y += speed;
-			bound_pos.y += speed + .5f;
-			new_pos.x = round(new_pos.x);
+			bound_pos.y += speed + FIXED_HALF;
+			new_pos.x = FIXED_ROUND(new_pos.x);
 			break;
 		case EAST:
 			new_pos.x += speed;
-			bound_pos.x += speed + .5f;
-			new_pos.y = round(new_pos.y);
+			bound_pos.x += speed + FIXED_HALF;
+			new_pos.y = FIXED_ROUND(new_pos.y);
 			break;
 		case WEST:
 			new_pos.x += -speed;
-			bound_pos.x += -speed - .5f;
-			new_pos.y = round(new_pos.y);
+			bound_pos.x += -speed - FIXED_HALF;
+			new_pos.y = FIXED_ROUND(new_pos.y);
 			break;
 	}
 
-	if (!map_get_collision(map, (int)bound_pos.x, (int)bound_pos.y, COLLISION_PLAYER)) {
+	if (!map_get_collision(map, FIXED_TO_INT(bound_pos.x), FIXED_TO_INT(bound_pos.y), COLLISION_PLAYER)) {
 		player->pos = new_pos;
 		player->animation_timer += delta_time;
 		if (player->animation_timer >= ANIMATION_SPEED) {
@@ -93,24 +108,25 @@ void player_update(Player *player, int delta_time, Map *map, float min_x, float
 	}
 
 	// Wrap around
-	if (player->pos.x < min_x) {
-		player->pos.x = max_x;
+	if (player->pos.x < FIXED_FROM_INT(min_x)) {
+		player->pos.x = FIXED_FROM_INT(max_x);
 	}
-	if (player->pos.x > max_x) {
-		player->pos.x = min_x;
+	if (player->pos.x > FIXED_FROM_INT(max_x)) {
+		player->pos.x = FIXED_FROM_INT(min_x);
 	}
 }
 
-void player_draw(Player *player, SDL_Renderer *renderer, SDL_Point *camera_offset) {
+void player_draw(Player *player, SDL_Texture *texture, RenderQueue *queue, SDL_Point *camera_offset) {
 	SDL_Rect src = { player->current_frame * 16, 0, 16, 16 };
-	SDL_Rect dst = { (int)(player->pos.x * 16.0f) + camera_offset->x, (int)(player->pos.y * 16.0f) + camera_offset->y, 16, 16 };
-	float angle = player->direction * 90;
+	SDL_Rect dst = { (int)FIXED_TO_INT((Sint64)player->pos.x * 16) + camera_offset->x, (int)FIXED_TO_INT((Sint64)player->pos.y * 16) + camera_offset->y, 16, 16 };
+	SDL_Color white = { 255, 255, 255, 255 };
+	int quarter_turns = player->direction; // EAST is the unrotated frame, directions go clockwise
 
 	if (player->is_dead) {
 		src.y = 16;
-		angle = 0;
+		quarter_turns = 0;
 	}
-	SDL_RenderCopyEx(renderer, player->texture, &src, &dst, angle, NULL, 0);
+	render_queue_sprite(queue, RENDER_LAYER_PLAYER, texture, &src, &dst, quarter_turns, white);
 }
 
 void player_kill(Player *player) {
@@ -129,15 +145,39 @@ void player_play_death_animation(Player *player, int delta_time) {
 	}
 }
 
-const SDL_FPoint *player_get_pos(Player *player) {
+void player_skip_death_animation(Player *player, int delta_time, int ticks) {
+	while (ticks > 0 && player->current_frame < 4) {
+		// Ticks until the timer reaches the next frame, at least one
+		int to_next_frame = SDL_max((DEATH_ANIMATION_SPEED - player->animation_timer + delta_time - 1) / delta_time, 1);
+		if (to_next_frame > ticks) {
+			player->animation_timer += ticks * delta_time;
+			return;
+		}
+		ticks -= to_next_frame;
+		player->animation_timer = 0;
+		player->current_frame++;
+	}
+}
+
+const FixedPoint *player_get_pos(Player *player) {
 	return &player->pos;
 }
 
-const SDL_FRect player_get_box(Player *player) {
-	SDL_FRect rect = { player->pos.x - .5f, player->pos.y - .5f, 1.0f, 1.0f };
-	return rect;
+Direction player_get_direction(Player *player) {
+	return player->direction;
+}
+
+int player_get_frame(Player *player) {
+	return player->current_frame;
+}
+
+bool player_is_dead(Player *player) {
+	return player->is_dead;
 }
 
-SDL_Texture *player_get_texture(Player *player) {
-	return player->texture;
+void player_set_pose(Player *player, const FixedPoint *pos, const Direction direction, const int frame, const bool is_dead) {
+	player->pos = *pos;
+	player->direction = direction;
+	player->current_frame = frame;
+	player->is_dead = is_dead;
 }
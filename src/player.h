@@ -1,11 +1,10 @@
 #ifndef PLAYER_H
 #define PLAYER_H
 
-#include <math.h>
-
 #include "SDL2/SDL.h"
 
 #include "map.h"
+#include "render_queue.h"
 #include "utils.h"
 
 #define ANIMATION_SPEED 100 //MS
@@ -15,18 +14,31 @@
 struct Player;
 typedef struct Player Player;
 
-Player *player_load(SDL_Renderer *renderer);
+Player *player_load();
 void player_free(Player *player);
+// Players hold no pointers, a copy is a plain struct copy
+void player_copy(Player *dst, const Player *src);
 
 void player_reset(Player *player);
+// The direction a key press asks for, NONE for any other event
+Direction player_input_direction(const SDL_Event *e);
 void player_input(Player *player, SDL_Event *e);
-void player_update(Player *player, int delta_time, Map *map, float min_x, float max_x);
-void player_draw(Player *player, SDL_Renderer *renderer, SDL_Point *camera_offset);
+void player_set_direction(Player *player, const Direction direction);
+// Tiles per second
+void player_set_speed(Player *player, const float speed);
+// The player wraps around between min_x and max_x, in tiles
+void player_update(Player *player, int delta_time, Map *map, int min_x, int max_x);
+void player_draw(Player *player, SDL_Texture *texture, RenderQueue *queue, SDL_Point *camera_offset);
 
 void player_kill(Player *player);
 void player_play_death_animation(Player *player, int delta_time);
-const SDL_FPoint *player_get_pos(Player *player);
-const SDL_FRect player_get_box(Player *player);
-SDL_Texture *player_get_texture(Player *player);
+// Same frame and timer as calling player_play_death_animation() for each of the ticks
+void player_skip_death_animation(Player *player, int delta_time, int ticks);
+const FixedPoint *player_get_pos(Player *player);
+Direction player_get_direction(Player *player);
+int player_get_frame(Player *player);
+bool player_is_dead(Player *player);
+// Spectators draw the player as the broadcasting game did
+void player_set_pose(Player *player, const FixedPoint *pos, const Direction direction, const int frame, const bool is_dead);
 
 #endif
\ No newline at end of file
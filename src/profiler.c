@@ -0,0 +1,243 @@
+#include "profiler.h"
+
+#ifdef PROFILE
+
+#include <stdio.h>
+
+#include "debug.h"
+#include "game.h"
+
+typedef struct ProfilerEvent {
+	const char *name;
+	Uint64 start;
+	Uint64 duration;
+} ProfilerEvent;
+
+typedef struct ProfilerZone {
+	const char *name;
+	Uint64 frame_ticks;
+	float average_ms;
+} ProfilerZone;
+
+typedef struct ProfilerBuffer {
+	int thread_id;
+	struct ProfilerBuffer *next;
+
+	// Ring of completed zones, oldest ones are overwritten
+	ProfilerEvent *events;
+	Uint32 event_count;
+
+	// Open zones
+	const char *stack_names[PROFILER_MAX_DEPTH];
+	Uint64 stack_starts[PROFILER_MAX_DEPTH];
+	int depth;
+
+	// Per frame totals for the overlay
+	ProfilerZone zones[PROFILER_MAX_ZONES];
+	int zone_count;
+} ProfilerBuffer;
+
+static THREAD_LOCAL ProfilerBuffer *thread_buffer = NULL;
+static THREAD_LOCAL bool is_paused = false;
+
+static ProfilerBuffer *buffers = NULL;
+static SDL_SpinLock buffers_lock = 0;
+static int next_thread_id = 1;
+
+static bool overlay_visible = false;
+static float frame_history[PROFILER_HISTORY];
+static int frame_history_index = 0;
+static Uint64 last_frame_end = 0;
+
+static ProfilerBuffer *get_thread_buffer() {
+	if (thread_buffer != NULL)
+		return thread_buffer;
+
+	ProfilerBuffer *buffer = calloc(1, sizeof(ProfilerBuffer));
+	buffer->events = calloc(PROFILER_EVENTS_PER_THREAD, sizeof(ProfilerEvent));
+
+	SDL_AtomicLock(&buffers_lock);
+	buffer->thread_id = next_thread_id++;
+	buffer->next = buffers;
+	buffers = buffer;
+	SDL_AtomicUnlock(&buffers_lock);
+
+	thread_buffer = buffer;
+	return buffer;
+}
+
+void profiler_set_paused(const bool paused) {
+	is_paused = paused;
+}
+
+void profiler_begin(const char *name) {
+	if (is_paused)
+		return;
+	ProfilerBuffer *buffer = get_thread_buffer();
+	if (buffer->depth >= PROFILER_MAX_DEPTH) {
+		buffer->depth++; // Still counted so the matching end stays balanced
+		return;
+	}
+	buffer->stack_names[buffer->depth] = name;
+	buffer->stack_starts[buffer->depth] = SDL_GetPerformanceCounter();
+	buffer->depth++;
+}
+
+void profiler_end() {
+	if (is_paused)
+		return;
+	Uint64 now = SDL_GetPerformanceCounter();
+	ProfilerBuffer *buffer = get_thread_buffer();
+	buffer->depth--;
+	if (buffer->depth < 0 || buffer->depth >= PROFILER_MAX_DEPTH) {
+		if (buffer->depth < 0)
+			buffer->depth = 0;
+		return;
+	}
+
+	const char *name = buffer->stack_names[buffer->depth];
+	Uint64 duration = now - buffer->stack_starts[buffer->depth];
+
+	ProfilerEvent *event = &buffer->events[buffer->event_count % PROFILER_EVENTS_PER_THREAD];
+	event->name = name;
+	event->start = buffer->stack_starts[buffer->depth];
+	event->duration = duration;
+	buffer->event_count++;
+
+	// Names are string literals, the pointer is enough to identify the zone
+	for (int i = 0; i < buffer->zone_count; i++) {
+		if (buffer->zones[i].name == name) {
+			buffer->zones[i].frame_ticks += duration;
+			return;
+		}
+	}
+	if (buffer->zone_count < PROFILER_MAX_ZONES) {
+		buffer->zones[buffer->zone_count].name = name;
+		buffer->zones[buffer->zone_count].frame_ticks = duration;
+		buffer->zones[buffer->zone_count].average_ms = 0.0f;
+		buffer->zone_count++;
+	}
+}
+
+void profiler_frame_end() {
+	Uint64 now = SDL_GetPerformanceCounter();
+	float to_ms = 1000.0f / (float)SDL_GetPerformanceFrequency();
+
+	if (last_frame_end != 0) {
+		frame_history[frame_history_index] = (now - last_frame_end) * to_ms;
+		frame_history_index = (frame_history_index + 1) % PROFILER_HISTORY;
+	}
+	last_frame_end = now;
+
+	ProfilerBuffer *buffer = get_thread_buffer();
+	for (int i = 0; i < buffer->zone_count; i++) {
+		ProfilerZone *zone = &buffer->zones[i];
+		zone->average_ms += (zone->frame_ticks * to_ms - zone->average_ms) * 0.05f;
+		zone->frame_ticks = 0;
+	}
+}
+
+void profiler_toggle_overlay() {
+	overlay_visible = !overlay_visible;
+}
+
+bool profiler_is_overlay_visible() {
+	return overlay_visible;
+}
+
+void profiler_draw_overlay(SDL_Renderer *renderer, TTF_Font *font) {
+	if (!overlay_visible)
+		return;
+
+	const int graph_height = 64;
+	const float max_ms = 33.3f;
+	SDL_Rect background = { 0, 0, PROFILER_HISTORY, graph_height };
+	SDL_GetRendererOutputSize(renderer, NULL, &background.y);
+	background.y -= graph_height;
+
+	SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 192);
+	SDL_RenderFillRect(renderer, &background);
+	SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+	// 60 fps budget
+	int budget_y = background.y + graph_height - (int)(graph_height * (1000.0f / FPS) / max_ms);
+	SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
+	SDL_RenderDrawLine(renderer, 0, budget_y, PROFILER_HISTORY, budget_y);
+
+	// Frame times, oldest on the left
+	SDL_Point points[PROFILER_HISTORY];
+	float worst = 0.0f;
+	for (int i = 0; i < PROFILER_HISTORY; i++) {
+		float ms = frame_history[(frame_history_index + i) % PROFILER_HISTORY];
+		if (ms > worst)
+			worst = ms;
+		points[i].x = i;
+		points[i].y = background.y + graph_height - (int)(graph_height * SDL_min(ms, max_ms) / max_ms);
+	}
+	SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
+	SDL_RenderDrawLines(renderer, points, PROFILER_HISTORY);
+
+	char line[64];
+	float last = frame_history[(frame_history_index + PROFILER_HISTORY - 1) % PROFILER_HISTORY];
+	SDL_Point place = { PROFILER_HISTORY + 4, background.y };
+	SDL_snprintf(line, sizeof(line), "frame %.2fms max %.2fms", last, worst);
+	draw_text(renderer, font, line, &place, ALIGN_LEFT);
+
+	// Zones of the rendering thread, inclusive times
+	ProfilerBuffer *buffer = get_thread_buffer();
+	place.x = 0;
+	place.y = 16;
+	for (int i = 0; i < buffer->zone_count; i++) {
+		SDL_snprintf(line, sizeof(line), "%-18s %6.3fms", buffer->zones[i].name, buffer->zones[i].average_ms);
+		draw_text(renderer, font, line, &place, ALIGN_LEFT);
+		place.y += 16;
+	}
+}
+
+bool profiler_dump_trace(const char *path) {
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		SDL_Log("Unable to write trace to %s", path);
+		return false;
+	}
+
+	// Other threads may still be recording, their oldest events can be torn. Good enough for a debug dump.
+	double to_us = 1000000.0 / (double)SDL_GetPerformanceFrequency();
+	bool first = true;
+	fprintf(file, "{\"traceEvents\":[\n");
+
+	SDL_AtomicLock(&buffers_lock);
+	for (ProfilerBuffer *buffer = buffers; buffer != NULL; buffer = buffer->next) {
+		Uint32 count = SDL_min(buffer->event_count, PROFILER_EVENTS_PER_THREAD);
+		Uint32 start = buffer->event_count - count;
+		for (Uint32 i = 0; i < count; i++) {
+			const ProfilerEvent *event = &buffer->events[(start + i) % PROFILER_EVENTS_PER_THREAD];
+			fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+					first ? "" : ",\n", event->name, event->start * to_us, event->duration * to_us, buffer->thread_id);
+			first = false;
+		}
+	}
+	SDL_AtomicUnlock(&buffers_lock);
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	SDL_Log("Trace written to %s", path);
+	return true;
+}
+
+void profiler_shutdown() {
+	SDL_AtomicLock(&buffers_lock);
+	ProfilerBuffer *buffer = buffers;
+	while (buffer != NULL) {
+		ProfilerBuffer *next = buffer->next;
+		free(buffer->events);
+		free(buffer);
+		buffer = next;
+	}
+	buffers = NULL;
+	SDL_AtomicUnlock(&buffers_lock);
+	thread_buffer = NULL;
+}
+
+#endif
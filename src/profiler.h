@@ -0,0 +1,52 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_ttf.h"
+
+#include "utils.h"
+
+/*
+ * Scoped timers. Every PROFILE_BEGIN must be closed by a PROFILE_END on the same thread.
+ * Zones are recorded into a ring buffer per thread and can be dumped as a Chrome trace
+ * (chrome://tracing or ui.perfetto.dev). Everything compiles out without PROFILE.
+ */
+
+#define PROFILER_EVENTS_PER_THREAD 65536
+#define PROFILER_MAX_DEPTH 32
+#define PROFILER_MAX_ZONES 32
+#define PROFILER_HISTORY 240
+#define PROFILER_TRACE_FILE "trace.json"
+
+#ifdef PROFILE
+
+#define PROFILE_BEGIN(name) profiler_begin(name)
+#define PROFILE_END() profiler_end()
+#define PROFILE_FRAME_END() profiler_frame_end()
+#define PROFILE_DRAW_OVERLAY(renderer, font) profiler_draw_overlay(renderer, font)
+#define PROFILE_SHUTDOWN() profiler_shutdown()
+#define PROFILE_PAUSE(paused) profiler_set_paused(paused)
+
+void profiler_begin(const char *name);
+void profiler_end();
+void profiler_frame_end();
+void profiler_toggle_overlay();
+bool profiler_is_overlay_visible();
+void profiler_draw_overlay(SDL_Renderer *renderer, TTF_Font *font);
+bool profiler_dump_trace(const char *path);
+void profiler_shutdown();
+// Zones opened on the calling thread while paused are dropped, pause between zones only
+void profiler_set_paused(const bool paused);
+
+#else
+
+#define PROFILE_BEGIN(name)
+#define PROFILE_END()
+#define PROFILE_FRAME_END()
+#define PROFILE_DRAW_OVERLAY(renderer, font)
+#define PROFILE_SHUTDOWN()
+#define PROFILE_PAUSE(paused)
+
+#endif
+
+#endif
@@ -0,0 +1,673 @@
+#include "regress.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#elif !defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+#include "debug.h"
+
+#include "a_star.h"
+#include "bot.h"
+#include "map.h"
+#include "maze.h"
+#include "maze_bench.h"
+
+#define MAX_LINE 256
+#define MAX_SCENARIOS 64
+
+static const char direction_names[] = "ESWN";
+
+enum ScenarioKind {
+	SCENARIO_GAME,
+	SCENARIO_CHASE
+} typedef ScenarioKind;
+
+typedef struct ScenarioInput {
+	int tick;
+	Direction direction;
+} ScenarioInput;
+
+typedef struct Scenario {
+	char name[64];
+	ScenarioKind kind;
+	Uint32 seed;
+	int ticks;
+
+	// Game
+	GameConfig config;
+	float randomness;
+	ScenarioInput *inputs;
+	int input_count;
+	int input_capacity;
+	bool has_expected;
+	Uint64 expected_hash;
+
+	// Chase
+	int width; // 0 for the shipped maze
+	int height;
+	int ghosts;
+	bool lod;
+} Scenario;
+
+typedef struct RegressResult {
+	char name[64];
+	int ticks;
+	double ticks_per_sec;
+	double p50_us;
+	double p99_us;
+	double max_us;
+	Uint64 expanded;
+	Uint64 allocations;
+	Uint64 peak_kb;
+} RegressResult;
+
+// How each compared metric reads, in the baseline column order
+enum MetricRule {
+	RULE_HIGHER, // Within the tolerance below the baseline
+	RULE_LOWER, // Within the tolerance above it
+	RULE_EXACT, // Never above it
+	RULE_REPORTED
+} typedef MetricRule;
+
+typedef struct MetricColumn {
+	const char *name;
+	MetricRule rule;
+	double noise; // Changes this small are never reported, a sub-microsecond tick is near the timer's resolution
+} MetricColumn;
+
+static const MetricColumn columns[] = {
+	{ "ticks_per_sec", RULE_HIGHER, 0.0 },
+	{ "p50_us", RULE_LOWER, 1.0 },
+	{ "p99_us", RULE_LOWER, 1.0 },
+	{ "max_us", RULE_REPORTED, 0.0 },
+	{ "a_star_expanded", RULE_EXACT, 0.0 },
+	{ "allocations", RULE_EXACT, 0.0 },
+	{ "peak_kb", RULE_LOWER, 256.0 },
+};
+#define COLUMN_COUNT ((int)SDL_arraysize(columns))
+
+static double get_metric(const RegressResult *result, const int column) {
+	switch (column) {
+		case 0: return result->ticks_per_sec;
+		case 1: return result->p50_us;
+		case 2: return result->p99_us;
+		case 3: return result->max_us;
+		case 4: return (double)result->expanded;
+		case 5: return (double)result->allocations;
+		default: return (double)result->peak_kb;
+	}
+}
+
+/*
+ * MEMORY
+ */
+
+static void reset_peak_memory() {
+#ifdef __linux__
+	// Brings VmHWM down to the current resident size
+	FILE *file = fopen("/proc/self/clear_refs", "w");
+	if (file != NULL) {
+		fputs("5", file);
+		fclose(file);
+	}
+#endif
+}
+
+static Uint64 get_peak_memory_kb() {
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize / 1024;
+#elif defined(__linux__)
+	FILE *file = fopen("/proc/self/status", "r");
+	if (file == NULL)
+		return 0;
+	char line[MAX_LINE];
+	unsigned long long kb = 0;
+	while (fgets(line, sizeof(line), file) != NULL) {
+		if (SDL_sscanf(line, "VmHWM: %llu", &kb) == 1)
+			break;
+	}
+	fclose(file);
+	return kb;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return (Uint64)usage.ru_maxrss / 1024; // Bytes on macOS
+#endif
+}
+
+/*
+ * SCENARIOS
+ */
+
+static void free_scenario(Scenario *this) {
+	free(this->inputs);
+	this->inputs = NULL;
+}
+
+static void add_input(Scenario *this, const int tick, const Direction direction) {
+	if (this->input_count == this->input_capacity) {
+		this->input_capacity = SDL_max(this->input_capacity * 2, 256);
+		this->inputs = realloc(this->inputs, this->input_capacity * sizeof(ScenarioInput));
+	}
+	this->inputs[this->input_count++] = (ScenarioInput){ tick, direction };
+}
+
+static void strip_line_end(char *line) {
+	size_t length = SDL_strlen(line);
+	while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+		line[--length] = '\0';
+}
+
+static bool is_input_line(const char *line) {
+	return SDL_strncmp(line, "input ", 6) == 0 || SDL_strncmp(line, "expect ", 7) == 0;
+}
+
+// The file name without its directory and extension
+static void get_scenario_name(const char *path, char *name, const size_t size) {
+	const char *base = path;
+	for (const char *c = path; *c != '\0'; c++) {
+		if (*c == '/' || *c == '\\')
+			base = c + 1;
+	}
+	SDL_strlcpy(name, base, size);
+	char *extension = SDL_strrchr(name, '.');
+	if (extension != NULL)
+		*extension = '\0';
+}
+
+static bool parse_line(Scenario *this, const char *line) {
+	char key[32];
+	if (SDL_sscanf(line, "%31s", key) != 1 || key[0] == '#')
+		return true;
+	const char *value = line + SDL_strlen(key);
+	while (*value == ' ' || *value == '\t')
+		value++;
+
+	if (SDL_strcmp(key, "kind") == 0) {
+		if (SDL_strncmp(value, "game", 4) == 0)
+			this->kind = SCENARIO_GAME;
+		else if (SDL_strncmp(value, "chase", 5) == 0)
+			this->kind = SCENARIO_CHASE;
+		else
+			return false;
+	} else if (SDL_strcmp(key, "seed") == 0) {
+		this->seed = (Uint32)SDL_strtoul(value, NULL, 10);
+	} else if (SDL_strcmp(key, "ticks") == 0) {
+		this->ticks = SDL_atoi(value);
+	} else if (SDL_strcmp(key, "player_speed") == 0) {
+		this->config.player_speed = (float)SDL_atof(value);
+	} else if (SDL_strcmp(key, "ghost_base_speed") == 0) {
+		this->config.ghost_base_speed = (float)SDL_atof(value);
+	} else if (SDL_strcmp(key, "ghost_speed_per_level") == 0) {
+		this->config.ghost_speed_per_level = (float)SDL_atof(value);
+	} else if (SDL_strcmp(key, "power_up_time") == 0) {
+		this->config.power_up_time = SDL_atoi(value);
+	} else if (SDL_strcmp(key, "randomness") == 0) {
+		this->randomness = (float)SDL_atof(value);
+	} else if (SDL_strcmp(key, "maze") == 0) {
+		if (SDL_strncmp(value, "shipped", 7) == 0) {
+			this->width = 0;
+			this->height = 0;
+		} else if (SDL_sscanf(value, "%dx%d", &this->width, &this->height) != 2) {
+			return false;
+		}
+	} else if (SDL_strcmp(key, "ghosts") == 0) {
+		this->ghosts = SDL_atoi(value);
+	} else if (SDL_strcmp(key, "lod") == 0) {
+		this->lod = SDL_atoi(value) != 0;
+	} else if (SDL_strcmp(key, "input") == 0) {
+		int tick;
+		char direction;
+		if (SDL_sscanf(value, "%d %c", &tick, &direction) != 2 || direction == '\0' || SDL_strchr(direction_names, direction) == NULL)
+			return false;
+		add_input(this, tick, (Direction)(SDL_strchr(direction_names, direction) - direction_names));
+	} else if (SDL_strcmp(key, "expect") == 0) {
+		this->has_expected = true;
+		this->expected_hash = SDL_strtoull(value, NULL, 16);
+	} else {
+		return false;
+	}
+	return true;
+}
+
+static bool load_scenario(Scenario *this, const char *path) {
+	SDL_zero(*this);
+	get_scenario_name(path, this->name, sizeof(this->name));
+	game_default_config(&this->config);
+	this->seed = 1;
+	this->ghosts = GHOST_AMT;
+
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		SDL_Log("Unable to open scenario %s", path);
+		return false;
+	}
+	char line[MAX_LINE];
+	int number = 0;
+	bool is_valid = true;
+	while (is_valid && fgets(line, sizeof(line), file) != NULL) {
+		number++;
+		strip_line_end(line);
+		if (!parse_line(this, line)) {
+			SDL_Log("%s:%d: unexpected \"%s\"", path, number, line);
+			is_valid = false;
+		}
+	}
+	fclose(file);
+
+	if (is_valid && (this->ticks <= 0 || (this->kind == SCENARIO_CHASE && this->ghosts <= 0))) {
+		SDL_Log("%s: nothing to play", path);
+		is_valid = false;
+	}
+	if (!is_valid)
+		free_scenario(this);
+	return is_valid;
+}
+
+/*
+ * PLAYING
+ */
+
+static int compare_samples(const void *a, const void *b) {
+	Uint64 x = *(const Uint64 *)a;
+	Uint64 y = *(const Uint64 *)b;
+	return x < y ? -1 : x > y;
+}
+
+// Tick times in performance counter units, sorted here
+static void summarize(RegressResult *result, Uint64 *samples, const int ticks) {
+	Uint64 total = 0;
+	for (int i = 0; i < ticks; i++) {
+		total += samples[i];
+	}
+	SDL_qsort(samples, ticks, sizeof(Uint64), compare_samples);
+	double us = 1000000.0 / SDL_GetPerformanceFrequency();
+	result->ticks = ticks;
+	result->ticks_per_sec = total > 0 ? ticks / (total * us / 1000000.0) : 0.0;
+	result->p50_us = samples[ticks / 2] * us;
+	result->p99_us = samples[SDL_min(ticks * 99 / 100, ticks - 1)] * us;
+	result->max_us = samples[ticks - 1] * us;
+}
+
+// Replays the inputs, the game's hash after the last tick in hash
+static void play_game(const Scenario *this, RegressResult *result, Uint64 *hash) {
+	Game *game = game_create(NULL, &this->config);
+	Uint64 *samples = malloc(this->ticks * sizeof(Uint64));
+	reset_peak_memory();
+	Uint64 expanded = a_star_get_expanded();
+	Uint32 allocations = DBG_allocation_count();
+
+	int next = 0;
+	for (int tick = 0; tick < this->ticks; tick++) {
+		if (game_is_over(game))
+			game_restart(game);
+		for (; next < this->input_count && this->inputs[next].tick <= tick; next++) {
+			game_set_player_direction(game, this->inputs[next].direction);
+		}
+		Uint64 start = SDL_GetPerformanceCounter();
+		game_update(game, TICK_TIME);
+		samples[tick] = SDL_GetPerformanceCounter() - start;
+	}
+
+	result->expanded = a_star_get_expanded() - expanded;
+	result->allocations = (Uint32)(DBG_allocation_count() - allocations);
+	result->peak_kb = get_peak_memory_kb();
+	*hash = game_get_hash(game);
+	summarize(result, samples, this->ticks);
+	free(samples);
+	game_destroy(game);
+}
+
+static bool play_chase(const Scenario *this, RegressResult *result) {
+	// The map reads the layout until it's freed
+	MapLayout *layout = NULL;
+	Map *map;
+	if (this->width == 0) {
+		map = map_load();
+	} else {
+		layout = maze_generate(this->width, this->height, this->seed);
+		if (layout == NULL)
+			return false;
+		map = map_create(layout);
+	}
+	GhostLod lod;
+	ghost_default_lod(&lod);
+	lod.view.w = MAP_WIDTH;
+	lod.view.h = MAP_HEIGHT;
+	MazeChase *chase = maze_chase_create(map, this->seed, this->ghosts, this->lod ? &lod : NULL);
+	Uint64 *samples = malloc(this->ticks * sizeof(Uint64));
+	reset_peak_memory();
+	Uint64 expanded = a_star_get_expanded();
+	Uint32 allocations = DBG_allocation_count();
+
+	for (int tick = 0; tick < this->ticks; tick++) {
+		Uint64 start = SDL_GetPerformanceCounter();
+		maze_chase_move_target(chase);
+		maze_chase_update_ghosts(chase);
+		samples[tick] = SDL_GetPerformanceCounter() - start;
+	}
+
+	result->expanded = a_star_get_expanded() - expanded;
+	result->allocations = (Uint32)(DBG_allocation_count() - allocations);
+	result->peak_kb = get_peak_memory_kb();
+	summarize(result, samples, this->ticks);
+	free(samples);
+	maze_chase_destroy(chase);
+	map_free(map);
+	if (layout != NULL)
+		maze_free(layout);
+	a_star_free_scratch();
+	return true;
+}
+
+/*
+ * BASELINE
+ */
+
+static void write_baseline(const char *path, const RegressResult *results, const int count) {
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		printf("Unable to write %s\n", path);
+		return;
+	}
+	fprintf(file, "scenario,ticks");
+	for (int c = 0; c < COLUMN_COUNT; c++) {
+		fprintf(file, ",%s", columns[c].name);
+	}
+	fprintf(file, "\n");
+	for (int i = 0; i < count; i++) {
+		fprintf(file, "%s,%d", results[i].name, results[i].ticks);
+		for (int c = 0; c < COLUMN_COUNT; c++) {
+			fprintf(file, ",%.3f", get_metric(&results[i], c));
+		}
+		fprintf(file, "\n");
+	}
+	fclose(file);
+	printf("Baseline written to %s\n", path);
+}
+
+typedef struct BaselineRow {
+	char name[64];
+	int ticks;
+	double metrics[COLUMN_COUNT];
+} BaselineRow;
+
+// The rows read, -1 when there is no baseline
+static int read_baseline(const char *path, BaselineRow *rows, const int max) {
+	FILE *file = fopen(path, "r");
+	if (file == NULL)
+		return -1;
+	char line[MAX_LINE];
+	int count = 0;
+	// The header first
+	if (fgets(line, sizeof(line), file) != NULL) {
+		while (count < max && fgets(line, sizeof(line), file) != NULL) {
+			BaselineRow *row = &rows[count];
+			char *field = SDL_strchr(line, ',');
+			if (field == NULL || field - line >= (int)sizeof(row->name))
+				continue;
+			SDL_strlcpy(row->name, line, field - line + 1);
+			row->ticks = (int)SDL_strtol(field + 1, &field, 10);
+			for (int c = 0; c < COLUMN_COUNT && *field == ','; c++) {
+				row->metrics[c] = SDL_strtod(field + 1, &field);
+			}
+			count++;
+		}
+	}
+	fclose(file);
+	return count;
+}
+
+static bool is_regression(const MetricColumn *column, const double baseline, const double value, const float tolerance) {
+	if (SDL_fabs(value - baseline) <= column->noise)
+		return false;
+	// Allocations appearing where there were none count too
+	if (column->rule == RULE_EXACT)
+		return value > baseline;
+	if (baseline <= 0.0)
+		return false;
+	double change = (value - baseline) * 100.0 / baseline;
+	switch (column->rule) {
+		case RULE_HIGHER: return -change > tolerance;
+		case RULE_LOWER: return change > tolerance;
+		default: return false;
+	}
+}
+
+// Prints every metric past its limit, returns how many
+static int compare(const RegressResult *result, const BaselineRow *row, const float tolerance) {
+	int failures = 0;
+	for (int c = 0; c < COLUMN_COUNT; c++) {
+		const MetricColumn *column = &columns[c];
+		double baseline = row->metrics[c];
+		double value = get_metric(result, c);
+		if (!is_regression(column, baseline, value, tolerance))
+			continue;
+		char change[32] = "new";
+		if (baseline > 0.0)
+			SDL_snprintf(change, sizeof(change), "%+.1f%%", (value - baseline) * 100.0 / baseline);
+		printf("  %-20s %-16s %14.1f -> %14.1f  %9s  (limit %s%.0f%%)\n", result->name, column->name, baseline, value, change,
+				column->rule == RULE_HIGHER ? "-" : "+", column->rule == RULE_EXACT ? 0.0f : tolerance);
+		failures++;
+	}
+	return failures;
+}
+
+/*
+ * RUNNER
+ */
+
+void regress_default_options(RegressOptions *options) {
+	SDL_zero(*options);
+	options->tolerance = REGRESS_DEFAULT_TOLERANCE;
+	options->runs = REGRESS_DEFAULT_RUNS;
+}
+
+// Where paths in the suite file are relative to
+static void get_directory(const char *path, char *directory, const size_t size) {
+	SDL_strlcpy(directory, path, size);
+	char *end = directory;
+	for (char *c = directory; *c != '\0'; c++) {
+		if (*c == '/' || *c == '\\')
+			end = c + 1;
+	}
+	*end = '\0';
+}
+
+// Times from the fastest of the runs, the counts are the same every run
+static void keep_best(RegressResult *best, const RegressResult *run) {
+	best->ticks_per_sec = SDL_max(best->ticks_per_sec, run->ticks_per_sec);
+	best->p50_us = SDL_min(best->p50_us, run->p50_us);
+	best->p99_us = SDL_min(best->p99_us, run->p99_us);
+	best->max_us = SDL_min(best->max_us, run->max_us);
+	best->peak_kb = SDL_min(best->peak_kb, run->peak_kb);
+}
+
+static bool run_scenario(const char *path, const int runs, RegressResult *result, bool *is_diverged) {
+	Scenario scenario;
+	if (!load_scenario(&scenario, path))
+		return false;
+	*is_diverged = false;
+
+	bool is_played = true;
+	for (int i = 0; i < runs && is_played; i++) {
+		RegressResult run;
+		SDL_zero(run);
+		if (scenario.kind == SCENARIO_GAME) {
+			Uint64 hash;
+			play_game(&scenario, &run, &hash);
+			*is_diverged |= scenario.has_expected && hash != scenario.expected_hash;
+		} else {
+			is_played = play_chase(&scenario, &run);
+		}
+		if (i == 0)
+			*result = run;
+		else
+			keep_best(result, &run);
+	}
+	SDL_strlcpy(result->name, scenario.name, sizeof(result->name));
+	free_scenario(&scenario);
+	return is_played;
+}
+
+int regress_run(const RegressOptions *options) {
+	FILE *suite = fopen(options->suite_path, "r");
+	if (suite == NULL) {
+		printf("Unable to open suite %s\n", options->suite_path);
+		return 1;
+	}
+	char directory[MAX_LINE];
+	get_directory(options->suite_path, directory, sizeof(directory));
+	char baseline_path[MAX_LINE];
+	if (options->baseline_path != NULL)
+		SDL_strlcpy(baseline_path, options->baseline_path, sizeof(baseline_path));
+	else
+		SDL_snprintf(baseline_path, sizeof(baseline_path), "%s%s", directory, REGRESS_BASELINE_NAME);
+
+	printf("%-20s %8s %12s %10s %10s %10s %14s %12s %10s\n", "scenario", "ticks", "ticks/sec", "p50 us", "p99 us", "max us",
+			"a* expanded", "allocations", "peak KB");
+	RegressResult *results = malloc(MAX_SCENARIOS * sizeof(RegressResult));
+	int count = 0;
+	int exit_code = 0;
+	char line[MAX_LINE];
+	while (fgets(line, sizeof(line), suite) != NULL) {
+		strip_line_end(line);
+		if (line[0] == '\0' || line[0] == '#')
+			continue;
+		if (count == MAX_SCENARIOS) {
+			printf("Over %d scenarios, %s skipped\n", MAX_SCENARIOS, line);
+			continue;
+		}
+		char path[2 * MAX_LINE];
+		SDL_snprintf(path, sizeof(path), "%s%s", directory, line);
+		RegressResult *result = &results[count];
+		bool is_diverged;
+		if (!run_scenario(path, SDL_max(options->runs, 1), result, &is_diverged)) {
+			printf("%-20s could not be played\n", line);
+			exit_code = 1;
+			continue;
+		}
+		printf("%-20s %8d %12.0f %10.1f %10.1f %10.1f %14llu %12llu %10llu%s\n", result->name, result->ticks, result->ticks_per_sec,
+				result->p50_us, result->p99_us, result->max_us, (unsigned long long)result->expanded,
+				(unsigned long long)result->allocations, (unsigned long long)result->peak_kb,
+				is_diverged ? "  diverged from the recording" : "");
+		if (is_diverged)
+			exit_code = 1;
+		count++;
+	}
+	fclose(suite);
+
+	BaselineRow *rows = malloc(MAX_SCENARIOS * sizeof(BaselineRow));
+	int row_count = read_baseline(baseline_path, rows, MAX_SCENARIOS);
+	if (options->update || row_count < 0) {
+		if (row_count < 0)
+			printf("\nNo baseline at %s yet\n", baseline_path);
+		write_baseline(baseline_path, results, count);
+	} else {
+		printf("\nAgainst %s, times and memory within %.0f%%, expansions and allocations no higher\n", baseline_path, options->tolerance);
+		int failures = 0;
+		for (int i = 0; i < count; i++) {
+			const BaselineRow *row = NULL;
+			for (int r = 0; r < row_count && row == NULL; r++) {
+				if (SDL_strcmp(rows[r].name, results[i].name) == 0)
+					row = &rows[r];
+			}
+			if (row == NULL)
+				printf("  %-20s not in the baseline\n", results[i].name);
+			else if (row->ticks != results[i].ticks)
+				printf("  %-20s played %d ticks, the baseline %d, not compared\n", results[i].name, results[i].ticks, row->ticks);
+			else
+				failures += compare(&results[i], row, options->tolerance);
+		}
+		printf(failures > 0 ? "%d regressions\n" : "No regressions\n", failures);
+		if (failures > 0)
+			exit_code = 1;
+	}
+	free(rows);
+	free(results);
+	return exit_code;
+}
+
+int regress_record(const char *scenario_path) {
+	Scenario scenario;
+	if (!load_scenario(&scenario, scenario_path))
+		return 1;
+	if (scenario.kind != SCENARIO_GAME) {
+		printf("%s is not a game scenario, nothing to record\n", scenario_path);
+		free_scenario(&scenario);
+		return 1;
+	}
+
+	// Only the turns that changed the player's direction, setting the same one again does nothing
+	Game *game = game_create(NULL, &scenario.config);
+	Bot bot;
+	bot_init(&bot, scenario.seed, scenario.randomness);
+	scenario.input_count = 0;
+	int games = 1;
+	for (int tick = 0; tick < scenario.ticks; tick++) {
+		if (game_is_over(game)) {
+			game_restart(game);
+			games++;
+		}
+		Direction before = player_get_direction(game_get_player(game));
+		bot_update(&bot, game);
+		Direction after = player_get_direction(game_get_player(game));
+		if (after != before && after != NONE)
+			add_input(&scenario, tick, after);
+		game_update(game, TICK_TIME);
+	}
+	GameStats stats = game_get_stats(game);
+	Uint64 hash = game_get_hash(game);
+	game_destroy(game);
+
+	// Everything but the old recording stays as it was
+	FILE *file = fopen(scenario_path, "r");
+	char *kept = NULL;
+	size_t kept_length = 0;
+	if (file != NULL) {
+		char line[MAX_LINE];
+		while (fgets(line, sizeof(line), file) != NULL) {
+			if (is_input_line(line))
+				continue;
+			size_t length = SDL_strlen(line);
+			kept = realloc(kept, kept_length + length + 1);
+			SDL_memcpy(kept + kept_length, line, length + 1);
+			kept_length += length;
+		}
+		fclose(file);
+	}
+
+	file = fopen(scenario_path, "w");
+	if (file == NULL) {
+		printf("Unable to write %s\n", scenario_path);
+		free(kept);
+		free_scenario(&scenario);
+		return 1;
+	}
+	if (kept != NULL) {
+		fputs(kept, file);
+		if (kept_length > 0 && kept[kept_length - 1] != '\n')
+			fputs("\n", file);
+	}
+	fprintf(file, "expect %016llx\n", (unsigned long long)hash);
+	for (int i = 0; i < scenario.input_count; i++) {
+		fprintf(file, "input %d %c\n", scenario.inputs[i].tick, direction_names[scenario.inputs[i].direction]);
+	}
+	fclose(file);
+	printf("%s: %d ticks over %d games, %d turns, ended on level %d with %d points\n", scenario.name, scenario.ticks, games,
+			scenario.input_count, stats.level, stats.score);
+
+	free(kept);
+	free_scenario(&scenario);
+	return 0;
+}
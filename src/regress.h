@@ -0,0 +1,53 @@
+#ifndef REGRESS_H
+#define REGRESS_H
+
+#include "SDL2/SDL.h"
+
+#include "game.h"
+#include "utils.h"
+
+/*
+ * Performance regression suite. A suite file lists scenario files, one per line relative to it.
+ * Each scenario is played headless and measured: ticks/sec, p50, p99 and max tick time,
+ * a_star() nodes expanded, allocations and peak resident memory. The results are compared against
+ * a baseline CSV, and every metric worse than it by more than the tolerance is reported.
+ *
+ * Scenarios are text, one "key value" per line, # starts a comment:
+ *   kind game|chase
+ *   seed <n>, ticks <n>
+ *   game: player_speed, ghost_base_speed, ghost_speed_per_level, power_up_time, as GameConfig.
+ *     randomness <0..1> for the bot that records the inputs
+ *   chase: maze shipped|<W>x<H>, ghosts <n>, lod 0|1. The ghosts hunt a target walking the maze
+ *   input <tick> E|S|W|N: the player turns on that tick, written by regress_record()
+ *   expect <hash>: game_get_hash() after the last tick, the replay must end there
+ *
+ * A game scenario replays its inputs tick by tick. A game over starts a new game at once, as a
+ * key press would. A replay that doesn't end on the recorded hash played another game, and its
+ * numbers mean nothing, so it fails.
+ *
+ * Every scenario is played several times and the best times are kept, the others were
+ * disturbed by something else on the machine. Times, ticks/sec and memory may then be worse by
+ * the tolerance, in percent. Expansions and allocations are the same on every run and may not
+ * grow at all. The max tick time is one sample and is only reported. On Linux the peak memory is reset before each scenario, so it is
+ * that scenario's own peak. Elsewhere it is the process's peak so far.
+ */
+
+#define REGRESS_DEFAULT_TOLERANCE 40.0f // A twice as slow update() is far past it on a noisy machine
+#define REGRESS_DEFAULT_RUNS 3
+#define REGRESS_BASELINE_NAME "baseline.csv" // Next to the suite unless given
+
+typedef struct RegressOptions {
+	const char *suite_path;
+	const char *baseline_path; // NULL for REGRESS_BASELINE_NAME next to the suite
+	float tolerance; // Percent
+	int runs; // Per scenario, times and memory are the best of them
+	bool update; // Writes this run's results as the new baseline
+} RegressOptions;
+
+void regress_default_options(RegressOptions *options);
+// Writes the baseline when there is none yet. Returns the process exit code, 1 on a regression
+int regress_run(const RegressOptions *options);
+// Plays a game scenario with the bot and rewrites its inputs and expected hash, keeping the rest
+int regress_record(const char *scenario_path);
+
+#endif
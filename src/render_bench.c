@@ -0,0 +1,309 @@
+#include "render_bench.h"
+
+#include <stdio.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "debug.h"
+#include "game.h"
+#include "soft_render.h"
+
+typedef struct ScriptedKey {
+	int tick;
+	SDL_Scancode key;
+} ScriptedKey;
+
+// Deterministic input, the game leaves STATE_WAIT around tick 344
+static const ScriptedKey input_script[] = {
+	{ 360, SDL_SCANCODE_A },
+	{ 420, SDL_SCANCODE_W },
+	{ 470, SDL_SCANCODE_D },
+	{ 540, SDL_SCANCODE_S },
+	{ 600, SDL_SCANCODE_A },
+	{ 700, SDL_SCANCODE_W },
+	{ 760, SDL_SCANCODE_A },
+	{ 850, SDL_SCANCODE_S },
+	{ 940, SDL_SCANCODE_D },
+	{ 1100, SDL_SCANCODE_W },
+	{ 1250, SDL_SCANCODE_D },
+	{ 1400, SDL_SCANCODE_S },
+	{ 1600, SDL_SCANCODE_A },
+};
+
+static const int default_golden_ticks[] = { 1, 360, 600, 900, 1200, 1800 };
+
+void render_bench_default_options(RenderBenchOptions *options) {
+	SDL_zero(*options);
+	options->ticks = RENDER_BENCH_DEFAULT_TICKS;
+	options->golden_mode = GOLDEN_CHECK;
+	options->golden_dir = RENDER_BENCH_GOLDEN_DIR;
+	options->tolerance = 0;
+	for (int i = 0; i < (int)SDL_arraysize(default_golden_ticks); i++) {
+		options->golden_ticks[i] = default_golden_ticks[i];
+	}
+	options->golden_tick_count = SDL_arraysize(default_golden_ticks);
+}
+
+static bool is_golden_tick(const RenderBenchOptions *options, int tick) {
+	for (int i = 0; i < options->golden_tick_count; i++) {
+		if (options->golden_ticks[i] == tick)
+			return true;
+	}
+	return false;
+}
+
+// What SDL_UpdateWindowSurfaceRects() does with the window surface, copy it to the screen
+static void present(SDL_Surface *frame, SDL_Surface *screen, const SDL_Rect *rects, int count) {
+	if (rects == NULL) {
+		SDL_BlitSurface(frame, NULL, screen, NULL);
+		return;
+	}
+	for (int i = 0; i < count; i++) {
+		SDL_Rect rect = rects[i];
+		SDL_BlitSurface(frame, &rect, screen, &rect);
+	}
+}
+
+static void press_scripted_keys(Game *game, int tick, int *next_key) {
+	while (*next_key < (int)SDL_arraysize(input_script) && input_script[*next_key].tick == tick) {
+		SDL_Event e;
+		SDL_zero(e);
+		e.type = SDL_KEYDOWN;
+		e.key.keysym.scancode = input_script[*next_key].key;
+		game_input(game, &e);
+		(*next_key)++;
+	}
+}
+
+// Pixels of two surfaces of one size and format that differ by more than tolerance on a channel
+static int count_changed(SDL_Surface *a, SDL_Surface *b, int tolerance) {
+	int changed = 0;
+	for (int y = 0; y < a->h; y++) {
+		const Uint8 *row_a = (const Uint8 *)a->pixels + y * a->pitch;
+		const Uint8 *row_b = (const Uint8 *)b->pixels + y * b->pitch;
+		for (int x = 0; x < a->w; x++) {
+			// Alpha is ignored, the window has none
+			for (int c = 0; c < 3; c++) {
+				if (SDL_abs(row_a[x * 4 + c] - row_b[x * 4 + c]) > tolerance) {
+					changed++;
+					break;
+				}
+			}
+		}
+	}
+	return changed;
+}
+
+static bool write_golden(SDL_Surface *frame, const char *dir, const char *path) {
+	// Fails harmlessly when the folder is already there
+#ifdef _WIN32
+	_mkdir(dir);
+#else
+	mkdir(dir, 0755);
+#endif
+	if (SDL_SaveBMP(frame, path) != 0) {
+		printf("Unable to write %s: %s\n", path, SDL_GetError());
+		return false;
+	}
+	return true;
+}
+
+// A missing golden image is written from frame, the next runs check against it
+static bool check_golden(SDL_Surface *frame, const char *dir, const char *path, const char *actual_path, int tolerance) {
+	SDL_Surface *loaded = SDL_LoadBMP(path);
+	if (loaded == NULL) {
+		printf("No golden image %s yet, writing it\n", path);
+		return write_golden(frame, dir, path);
+	}
+	SDL_Surface *golden = SDL_ConvertSurfaceFormat(loaded, frame->format->format, 0);
+	SDL_FreeSurface(loaded);
+
+	if (golden->w != frame->w || golden->h != frame->h) {
+		printf("%s: size %dx%d, expected %dx%d\n", path, frame->w, frame->h, golden->w, golden->h);
+		SDL_FreeSurface(golden);
+		return false;
+	}
+
+	int changed = count_changed(frame, golden, tolerance);
+	SDL_FreeSurface(golden);
+
+	if (changed > 0) {
+		printf("%s: %d pixel(s) differ, frame saved to %s\n", path, changed, actual_path);
+		SDL_SaveBMP(frame, actual_path);
+		return false;
+	}
+	return true;
+}
+
+int render_bench_run(const RenderBenchOptions *options) {
+	SDL_Surface *frame = SDL_CreateRGBSurfaceWithFormat(0, RENDER_BENCH_WIDTH, RENDER_BENCH_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+	SDL_Renderer *renderer = SDL_CreateSoftwareRenderer(frame);
+	if (renderer == NULL) {
+		printf("Unable to create software renderer: %s\n", SDL_GetError());
+		return 1;
+	}
+	SDL_Surface *screen = SDL_CreateRGBSurfaceWithFormat(0, RENDER_BENCH_WIDTH, RENDER_BENCH_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+	SDL_SetSurfaceBlendMode(frame, SDL_BLENDMODE_NONE);
+
+	Game *game = game_create(renderer, NULL);
+	game_set_dirty_rects(game, options->dirty_rects);
+	SoftRenderer *soft = NULL;
+	if (options->soft_render) {
+		// Presents into screen on its own
+		soft = soft_renderer_create(RENDER_BENCH_WIDTH, RENDER_BENCH_HEIGHT, 1, screen);
+		game_set_soft_renderer(game, soft);
+	}
+
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	Uint64 total = 0;
+	Uint64 fastest = (Uint64)-1;
+	Uint64 slowest = 0;
+	int next_key = 0;
+	int failures = 0;
+	long long commands = 0;
+	long long batches = 0;
+	long long dirty_rects = 0;
+	long long dirty_pixels = 0;
+
+	for (int tick = 1; tick <= options->ticks; tick++) {
+		press_scripted_keys(game, tick, &next_key);
+		game_update(game, TICK_TIME);
+
+		Uint64 start = SDL_GetPerformanceCounter();
+		game_draw(game, renderer);
+		int count = 0;
+		const SDL_Rect *rects = game_get_dirty_rects(game, &count);
+		if (soft == NULL)
+			present(frame, screen, options->dirty_rects ? rects : NULL, count);
+		Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+		total += elapsed;
+		if (elapsed < fastest)
+			fastest = elapsed;
+		if (elapsed > slowest)
+			slowest = elapsed;
+		RenderQueueStats stats = game_get_render_stats(game);
+		commands += stats.immediate_calls;
+		batches += stats.batches;
+		dirty_rects += stats.dirty_rects;
+		dirty_pixels += stats.dirty_pixels;
+
+		if (options->golden_mode != GOLDEN_NONE && is_golden_tick(options, tick)) {
+			char path[512];
+			char actual_path[512];
+			SDL_snprintf(path, sizeof(path), "%s/tick_%05d.bmp", options->golden_dir, tick);
+			SDL_snprintf(actual_path, sizeof(actual_path), "%s/tick_%05d.actual.bmp", options->golden_dir, tick);
+
+			if (options->golden_mode == GOLDEN_WRITE) {
+				if (!write_golden(screen, options->golden_dir, path))
+					failures++;
+			} else if (!check_golden(screen, options->golden_dir, path, actual_path, options->tolerance)) {
+				failures++;
+			}
+		}
+	}
+
+	double to_ms = 1000.0 / frequency;
+	char backend[64];
+	if (soft != NULL)
+		SDL_snprintf(backend, sizeof(backend), "the %s blitter", soft_renderer_kernels_name(soft_renderer_best_kernels()));
+	else
+		SDL_snprintf(backend, sizeof(backend), "the software renderer");
+	printf("Rendered %d frames at %dx%d with %s, %s\n", options->ticks, RENDER_BENCH_WIDTH, RENDER_BENCH_HEIGHT, backend,
+			options->dirty_rects ? "dirty rectangles" : "full redraws");
+	printf("draw() and present: %.1f frames/s, mean %.3fms, min %.3fms, max %.3fms\n",
+			options->ticks / (total * to_ms / 1000.0), total * to_ms / options->ticks, fastest * to_ms, slowest * to_ms);
+	printf("Draw calls per frame: %.1f immediate, %.1f batched\n", (double)commands / options->ticks, (double)batches / options->ticks);
+	printf("Repainted per frame: %.1f rectangle(s), %.1f%% of the pixels\n", (double)dirty_rects / options->ticks,
+			100.0 * dirty_pixels / ((double)options->ticks * RENDER_BENCH_WIDTH * RENDER_BENCH_HEIGHT));
+	if (options->golden_mode == GOLDEN_CHECK)
+		printf("Golden images: %d of %d failed\n", failures, options->golden_tick_count);
+
+	game_destroy(game);
+	if (soft != NULL)
+		soft_renderer_destroy(soft);
+	SDL_DestroyRenderer(renderer);
+	SDL_FreeSurface(screen);
+	SDL_FreeSurface(frame);
+
+	return failures > 0 ? 1 : 0;
+}
+
+/*
+ * BACKEND COMPARISON
+ */
+
+// Mean milliseconds per frame presented into screen, by SDL's software renderer when kernels is negative
+static double time_backend(const RenderBenchOptions *options, int scale, int kernels, SDL_Surface *screen) {
+	SDL_Surface *frame = NULL;
+	SDL_Renderer *renderer = NULL;
+	SoftRenderer *soft = NULL;
+	if (kernels < 0) {
+		frame = SDL_CreateRGBSurfaceWithFormat(0, screen->w, screen->h, 32, SDL_PIXELFORMAT_ARGB8888);
+		SDL_SetSurfaceBlendMode(frame, SDL_BLENDMODE_NONE);
+		renderer = SDL_CreateSoftwareRenderer(frame);
+		SDL_RenderSetScale(renderer, (float)scale, (float)scale);
+	} else {
+		// Only makes the textures
+		renderer = SDL_CreateSoftwareRenderer(screen);
+		soft = soft_renderer_create(RENDER_BENCH_WIDTH, RENDER_BENCH_HEIGHT, scale, screen);
+		soft_renderer_set_kernels(soft, (SoftKernels)kernels);
+	}
+	Game *game = game_create(renderer, NULL);
+	if (soft != NULL)
+		game_set_soft_renderer(game, soft);
+
+	Uint64 total = 0;
+	int next_key = 0;
+	for (int tick = 1; tick <= options->ticks; tick++) {
+		press_scripted_keys(game, tick, &next_key);
+		game_update(game, TICK_TIME);
+
+		Uint64 start = SDL_GetPerformanceCounter();
+		game_draw(game, renderer);
+		if (frame != NULL)
+			present(frame, screen, NULL, 0);
+		total += SDL_GetPerformanceCounter() - start;
+	}
+
+	game_destroy(game);
+	if (soft != NULL)
+		soft_renderer_destroy(soft);
+	SDL_DestroyRenderer(renderer);
+	if (frame != NULL)
+		SDL_FreeSurface(frame);
+	return total * 1000.0 / SDL_GetPerformanceFrequency() / options->ticks;
+}
+
+int render_bench_compare(const RenderBenchOptions *options) {
+	static const int scales[] = { 1, 4 };
+
+	printf("%d frames, full redraws, drawing and presenting timed\n", options->ticks);
+	printf("%-6s %-16s %10s %10s %8s %10s\n", "Scale", "Backend", "Frames/s", "Mean ms", "Speedup", "Differing");
+	for (int i = 0; i < (int)SDL_arraysize(scales); i++) {
+		int scale = scales[i];
+		int w = RENDER_BENCH_WIDTH * scale;
+		int h = RENDER_BENCH_HEIGHT * scale;
+		SDL_Surface *reference = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+		SDL_Surface *screen = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+		char label[8];
+		SDL_snprintf(label, sizeof(label), "%dx", scale);
+
+		double sdl_ms = time_backend(options, scale, -1, reference);
+		printf("%-6s %-16s %10.1f %10.3f %7.2fx %10s\n", label, "SDL software", 1000.0 / sdl_ms, sdl_ms, 1.0, "-");
+		for (int kernels = SOFT_KERNELS_SCALAR; kernels <= (int)soft_renderer_best_kernels(); kernels++) {
+			double ms = time_backend(options, scale, kernels, screen);
+			// Of the last frame
+			int changed = count_changed(screen, reference, options->tolerance);
+			char backend[32];
+			SDL_snprintf(backend, sizeof(backend), "Blitter %s", soft_renderer_kernels_name(kernels));
+			printf("%-6s %-16s %10.1f %10.3f %7.2fx %9.2f%%\n", label, backend, 1000.0 / ms, ms, sdl_ms / ms, 100.0 * changed / ((double)w * h));
+		}
+
+		SDL_FreeSurface(screen);
+		SDL_FreeSurface(reference);
+	}
+	return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef RENDER_BENCH_H
+#define RENDER_BENCH_H
+
+#include "SDL2/SDL.h"
+
+#include "utils.h"
+
+/*
+ * Headless rendering: the game is drawn by SDL's software renderer into an off-screen surface,
+ * under the dummy video driver. A deterministic run (fixed TICK_TIME steps, scripted input) is
+ * timed frame by frame and, at chosen ticks, compared against or saved as golden images.
+ * By default every run checks the goldens in RENDER_BENCH_GOLDEN_DIR. One missing there is
+ * written from the frame instead, so the first run on a machine records them and the ones after
+ * check against it. None ship with the repository.
+ *
+ * Each frame is then presented by copying it into a second surface standing in for the window,
+ * the whole of it, or with dirty_rects only the rectangles the render queue repainted. The timing
+ * covers drawing and presenting, and goldens are compared against the presented copy, so goldens
+ * written by full redraws check the dirty rectangle path.
+ *
+ * The comparison plays the same run at 1x and 4x integer scale, drawn by SDL's software renderer
+ * scaling on its own, then by src/soft_render.c with each kernel set the build has, which draws at
+ * 1x and scales up while presenting. Every frame is redrawn whole. It reports the frame times and how many pixels of the last
+ * presented frame differ from SDL's.
+ */
+
+#define RENDER_BENCH_WIDTH (16 * 28)
+#define RENDER_BENCH_HEIGHT (16 * 32)
+#define RENDER_BENCH_DEFAULT_TICKS 3600
+#define RENDER_BENCH_MAX_GOLDEN_TICKS 32
+#define RENDER_BENCH_GOLDEN_DIR "golden" // Relative to the working directory
+
+enum GoldenMode {
+	GOLDEN_NONE,
+	GOLDEN_WRITE,
+	GOLDEN_CHECK
+} typedef GoldenMode;
+
+typedef struct RenderBenchOptions {
+	int ticks;
+	GoldenMode golden_mode; // GOLDEN_CHECK unless told otherwise
+	const char *golden_dir;
+	int golden_ticks[RENDER_BENCH_MAX_GOLDEN_TICKS];
+	int golden_tick_count;
+	int tolerance; // Max difference per channel before a pixel counts as changed
+	bool dirty_rects;
+	bool soft_render; // Drawn by src/soft_render.c, presented straight into the window stand-in
+} RenderBenchOptions;
+
+void render_bench_default_options(RenderBenchOptions *options);
+// Returns the process exit code, non zero when a golden image doesn't match
+int render_bench_run(const RenderBenchOptions *options);
+// Returns the process exit code
+int render_bench_compare(const RenderBenchOptions *options);
+
+#endif
@@ -0,0 +1,530 @@
+#include "render_queue.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "debug.h"
+#include "soft_render.h"
+
+typedef struct RenderCommand {
+	Uint64 key; // layer | texture | blend mode | submission order
+	SDL_Texture *texture;
+	SDL_FRect dst;
+	SDL_FRect uv;
+	SDL_Color color;
+	int quarter_turns;
+} RenderCommand;
+
+typedef struct QueueTexture {
+	SDL_Texture *texture;
+	float w;
+	float h;
+} QueueTexture;
+
+struct RenderQueue {
+	SDL_Renderer *renderer;
+
+	RenderCommand *commands;
+	int command_count;
+	int command_capacity;
+	Uint32 sequence;
+	int immediate_calls; // RenderQueueStats.immediate_calls of the frame being recorded
+
+	SDL_Vertex *vertices;
+	int *indices;
+	int quad_capacity;
+
+	// Index 0 is reserved for untextured commands
+	QueueTexture textures[RENDER_QUEUE_MAX_TEXTURES];
+	int texture_count;
+
+	// Monospaced glyphs laid out on one row
+	SDL_Texture *font_atlas;
+	SDL_Surface *font_surface; // Its pixels, for the software renderer
+	int glyph_width;
+	int glyph_height;
+
+	// render_queue_set_transform(), applied as commands are pushed
+	SDL_FPoint origin;
+	float scale;
+
+	RenderQueueStats stats;
+	SDL_Rect target; // render_queue_get_size() at the last flush
+	SoftRenderer *soft; // Draws instead of the renderer when set
+
+	// Dirty tracking, both frames ordered by content to diff them
+	bool track_dirty;
+	bool is_invalid; // The next flush repaints everything
+	RenderCommand *previous;
+	int previous_count;
+	int previous_capacity;
+	RenderCommand *current;
+	int current_capacity;
+	SDL_Rect dirty[RENDER_QUEUE_MAX_DIRTY_RECTS];
+	int dirty_count;
+	bool is_full_redraw;
+};
+
+/*
+ * SETUP
+ */
+
+static void build_font_atlas(RenderQueue *this, TTF_Font *font) {
+	int advance = 0;
+	TTF_GlyphMetrics(font, 'W', NULL, NULL, NULL, NULL, &advance);
+	this->glyph_width = advance;
+	this->glyph_height = TTF_FontHeight(font);
+
+	int glyph_count = RENDER_QUEUE_LAST_GLYPH - RENDER_QUEUE_FIRST_GLYPH + 1;
+	SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(0, glyph_count * this->glyph_width, this->glyph_height, 32, SDL_PIXELFORMAT_ARGB8888);
+	SDL_FillRect(atlas, NULL, 0);
+
+	SDL_Color white = { 255, 255, 255, 255 };
+	for (int c = RENDER_QUEUE_FIRST_GLYPH; c <= RENDER_QUEUE_LAST_GLYPH; c++) {
+		SDL_Surface *glyph = TTF_RenderGlyph_Solid(font, (Uint16)c, white);
+		if (glyph == NULL)
+			continue;
+		// The colorkey becomes transparent alpha
+		SDL_Surface *converted = SDL_ConvertSurfaceFormat(glyph, SDL_PIXELFORMAT_ARGB8888, 0);
+		SDL_FreeSurface(glyph);
+		SDL_SetSurfaceBlendMode(converted, SDL_BLENDMODE_NONE);
+		SDL_Rect dst = { (c - RENDER_QUEUE_FIRST_GLYPH) * this->glyph_width, 0, this->glyph_width, this->glyph_height };
+		SDL_BlitSurface(converted, NULL, atlas, &dst);
+		SDL_FreeSurface(converted);
+	}
+
+	this->font_atlas = SDL_CreateTextureFromSurface(this->renderer, atlas);
+	SDL_SetTextureBlendMode(this->font_atlas, SDL_BLENDMODE_BLEND);
+	this->font_surface = atlas;
+}
+
+RenderQueue *render_queue_create(SDL_Renderer *renderer, TTF_Font *font) {
+	RenderQueue *this = calloc(1, sizeof(RenderQueue));
+	this->renderer = renderer;
+	this->texture_count = 1;
+	this->scale = 1.0f;
+	if (font != NULL)
+		build_font_atlas(this, font);
+	return this;
+}
+
+void render_queue_destroy(RenderQueue *this) {
+	if (this->font_atlas != NULL)
+		SDL_DestroyTexture(this->font_atlas);
+	if (this->font_surface != NULL)
+		SDL_FreeSurface(this->font_surface);
+	free(this->commands);
+	free(this->previous);
+	free(this->current);
+	free(this->vertices);
+	free(this->indices);
+	free(this);
+}
+
+static int get_texture_index(RenderQueue *this, SDL_Texture *texture) {
+	if (texture == NULL)
+		return 0;
+	for (int i = 1; i < this->texture_count; i++) {
+		if (this->textures[i].texture == texture)
+			return i;
+	}
+	if (this->texture_count == RENDER_QUEUE_MAX_TEXTURES) {
+		SDL_Log("Render queue texture table full");
+		return 0;
+	}
+
+	int w = 0, h = 0;
+	SDL_QueryTexture(texture, NULL, NULL, &w, &h);
+	QueueTexture *entry = &this->textures[this->texture_count];
+	entry->texture = texture;
+	entry->w = (float)w;
+	entry->h = (float)h;
+	return this->texture_count++;
+}
+
+/*
+ * RECORDING
+ */
+
+static RenderCommand *push_command(RenderQueue *this, RenderLayer layer, SDL_Texture *texture, SDL_BlendMode blend) {
+	if (this->command_count == this->command_capacity) {
+		this->command_capacity = this->command_capacity == 0 ? 1024 : this->command_capacity * 2;
+		this->commands = realloc(this->commands, this->command_capacity * sizeof(RenderCommand));
+	}
+	RenderCommand *command = &this->commands[this->command_count++];
+	Uint64 texture_index = get_texture_index(this, texture);
+	command->key = ((Uint64)layer << 56) | (texture_index << 48) | ((Uint64)blend << 40) | this->sequence++;
+	command->texture = texture;
+	command->quarter_turns = 0;
+	return command;
+}
+
+static void transform_rect(const RenderQueue *this, const SDL_Rect *dst, SDL_FRect *placed) {
+	placed->x = this->origin.x + dst->x * this->scale;
+	placed->y = this->origin.y + dst->y * this->scale;
+	placed->w = dst->w * this->scale;
+	placed->h = dst->h * this->scale;
+}
+
+void render_queue_sprite(RenderQueue *this, RenderLayer layer, SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst, int quarter_turns, SDL_Color color) {
+	RenderCommand *command = push_command(this, layer, texture, SDL_BLENDMODE_BLEND);
+	const QueueTexture *entry = &this->textures[(command->key >> 48) & 0xFF];
+	transform_rect(this, dst, &command->dst);
+	this->immediate_calls++;
+	command->uv.x = src->x / entry->w;
+	command->uv.y = src->y / entry->h;
+	command->uv.w = src->w / entry->w;
+	command->uv.h = src->h / entry->h;
+	command->color = color;
+	command->quarter_turns = quarter_turns & 3;
+}
+
+void render_queue_rect(RenderQueue *this, RenderLayer layer, const SDL_Rect *dst, SDL_Color color) {
+	RenderCommand *command = push_command(this, layer, NULL, SDL_BLENDMODE_NONE);
+	transform_rect(this, dst, &command->dst);
+	this->immediate_calls++;
+	SDL_zero(command->uv);
+	command->color = color;
+}
+
+int render_queue_text(RenderQueue *this, RenderLayer layer, const char *text, const SDL_Point *position, Alignement align) {
+	int length = (int)SDL_strlen(text);
+	int w = length * this->glyph_width;
+	int h = this->glyph_height;
+
+	SDL_Point place = *position;
+	switch (align) {
+		case ALIGN_CENTERED:
+			place.x -= w / 2;
+			place.y -= h / 2;
+			break;
+		case ALIGN_LEFT:
+			break;
+		case ALIGN_RIGHT:
+			place.x -= w;
+			break;
+	}
+
+	if (this->font_atlas != NULL) {
+		// Drawn immediately the string was one TTF surface and texture, not one per glyph
+		int immediate_calls = this->immediate_calls + 1;
+		SDL_Color white = { 255, 255, 255, 255 };
+		for (int i = 0; i < length; i++) {
+			int c = (unsigned char)text[i];
+			if (c == ' ' || c < RENDER_QUEUE_FIRST_GLYPH || c > RENDER_QUEUE_LAST_GLYPH)
+				continue;
+			SDL_Rect src = { (c - RENDER_QUEUE_FIRST_GLYPH) * this->glyph_width, 0, this->glyph_width, this->glyph_height };
+			SDL_Rect dst = { place.x + i * this->glyph_width, place.y, this->glyph_width, this->glyph_height };
+			render_queue_sprite(this, layer, this->font_atlas, &src, &dst, 0, white);
+		}
+		this->immediate_calls = immediate_calls;
+	}
+
+	return w + position->x;
+}
+
+/*
+ * SUBMISSION
+ */
+
+static int compare_commands(const void *a, const void *b) {
+	Uint64 key_a = ((const RenderCommand *)a)->key;
+	Uint64 key_b = ((const RenderCommand *)b)->key;
+	return key_a < key_b ? -1 : (key_a > key_b ? 1 : 0);
+}
+
+static void reserve_quads(RenderQueue *this, int quads) {
+	if (quads <= this->quad_capacity)
+		return;
+	while (this->quad_capacity < quads) {
+		this->quad_capacity = this->quad_capacity == 0 ? 1024 : this->quad_capacity * 2;
+	}
+	this->vertices = realloc(this->vertices, this->quad_capacity * 4 * sizeof(SDL_Vertex));
+	this->indices = realloc(this->indices, this->quad_capacity * 6 * sizeof(int));
+}
+
+static void write_quad(SDL_Vertex *vertices, int *indices, int base, const RenderCommand *command) {
+	// Corners clockwise from the top left
+	const SDL_FRect *d = &command->dst;
+	const SDL_FRect *t = &command->uv;
+	SDL_FPoint positions[4] = { { d->x, d->y }, { d->x + d->w, d->y }, { d->x + d->w, d->y + d->h }, { d->x, d->y + d->h } };
+	SDL_FPoint uvs[4] = { { t->x, t->y }, { t->x + t->w, t->y }, { t->x + t->w, t->y + t->h }, { t->x, t->y + t->h } };
+
+	for (int i = 0; i < 4; i++) {
+		vertices[i].position = positions[i];
+		vertices[i].color = command->color;
+		vertices[i].tex_coord = uvs[(i - command->quarter_turns + 4) & 3];
+	}
+
+	indices[0] = base;
+	indices[1] = base + 1;
+	indices[2] = base + 2;
+	indices[3] = base;
+	indices[4] = base + 2;
+	indices[5] = base + 3;
+}
+
+static bool overlaps(const SDL_FRect *bounds, const SDL_Rect *clip) {
+	return bounds->x < clip->x + clip->w && bounds->x + bounds->w > clip->x && bounds->y < clip->y + clip->h && bounds->y + bounds->h > clip->y;
+}
+
+// Sorted commands inside clip, everything without one
+static void submit(RenderQueue *this, const SDL_Rect *clip) {
+	int start = 0;
+	while (start < this->command_count) {
+		// A batch is every following command with the same texture and blend mode
+		Uint64 state = this->commands[start].key & 0x00FFFF0000000000;
+		int end = start;
+		int quads = 0;
+		while (end < this->command_count && (this->commands[end].key & 0x00FFFF0000000000) == state) {
+			if (clip == NULL || overlaps(&this->commands[end].dst, clip)) {
+				write_quad(&this->vertices[quads * 4], &this->indices[quads * 6], quads * 4, &this->commands[end]);
+				quads++;
+			}
+			end++;
+		}
+
+		if (quads > 0) {
+			SDL_Texture *texture = this->commands[start].texture;
+			SDL_BlendMode blend = (SDL_BlendMode)((state >> 40) & 0xFF);
+			if (texture != NULL)
+				SDL_SetTextureBlendMode(texture, blend);
+			else
+				SDL_SetRenderDrawBlendMode(this->renderer, blend);
+			SDL_RenderGeometry(this->renderer, texture, this->vertices, quads * 4, this->indices, quads * 6);
+			this->stats.batches++;
+		}
+		start = end;
+	}
+}
+
+// The pixels whose centres the quad covers, what SDL_RenderGeometry fills for it
+static void snap_rect(const SDL_FRect *bounds, SDL_Rect *rect) {
+	rect->x = (int)SDL_floorf(bounds->x + 0.5f);
+	rect->y = (int)SDL_floorf(bounds->y + 0.5f);
+	rect->w = (int)SDL_floorf(bounds->x + bounds->w + 0.5f) - rect->x;
+	rect->h = (int)SDL_floorf(bounds->y + bounds->h + 0.5f) - rect->y;
+}
+
+// The same commands one by one through the software renderer, a batch is still a run of one state
+static void submit_soft(RenderQueue *this, const SDL_Rect *clip) {
+	soft_renderer_set_clip(this->soft, clip);
+	Uint64 state = 0;
+	bool is_first = true;
+	for (int i = 0; i < this->command_count; i++) {
+		const RenderCommand *command = &this->commands[i];
+		if (clip != NULL && !overlaps(&command->dst, clip))
+			continue;
+		if (is_first || (command->key & 0x00FFFF0000000000) != state) {
+			state = command->key & 0x00FFFF0000000000;
+			is_first = false;
+			this->stats.batches++;
+		}
+
+		SDL_Rect dst;
+		snap_rect(&command->dst, &dst);
+		if (command->texture == NULL) {
+			soft_renderer_fill(this->soft, &dst, command->color);
+			continue;
+		}
+		const QueueTexture *entry = &this->textures[(command->key >> 48) & 0xFF];
+		SDL_Rect src = {
+			(int)(command->uv.x * entry->w + 0.5f),
+			(int)(command->uv.y * entry->h + 0.5f),
+			(int)(command->uv.w * entry->w + 0.5f),
+			(int)(command->uv.h * entry->h + 0.5f)
+		};
+		soft_renderer_copy(this->soft, command->texture, &src, &dst, command->quarter_turns, command->color);
+	}
+	soft_renderer_set_clip(this->soft, NULL);
+}
+
+/*
+ * DIRTY RECTS
+ */
+
+// Layer, texture and blend mode first, then what's drawn where. The submission order is left out
+static int compare_content(const void *a, const void *b) {
+	const RenderCommand *x = a;
+	const RenderCommand *y = b;
+	Uint64 state_x = x->key & 0xFFFFFF0000000000;
+	Uint64 state_y = y->key & 0xFFFFFF0000000000;
+	if (state_x != state_y)
+		return state_x < state_y ? -1 : 1;
+	return SDL_memcmp(&x->dst, &y->dst, offsetof(RenderCommand, quarter_turns) + sizeof(int) - offsetof(RenderCommand, dst));
+}
+
+static void add_dirty(RenderQueue *this, const SDL_FRect *bounds) {
+	if (this->is_full_redraw)
+		return;
+
+	SDL_Rect rect = { (int)SDL_floorf(bounds->x), (int)SDL_floorf(bounds->y), 0, 0 };
+	rect.w = (int)SDL_ceilf(bounds->x + bounds->w) - rect.x;
+	rect.h = (int)SDL_ceilf(bounds->y + bounds->h) - rect.y;
+	if (!SDL_IntersectRect(&rect, &this->target, &rect))
+		return;
+
+	// Swallows every rect it overlaps or touches, the union may then reach earlier ones
+	for (int i = 0; i < this->dirty_count;) {
+		const SDL_Rect *other = &this->dirty[i];
+		SDL_Rect grown = { other->x - 1, other->y - 1, other->w + 2, other->h + 2 };
+		if (SDL_HasIntersection(&grown, &rect)) {
+			SDL_UnionRect(other, &rect, &rect);
+			this->dirty[i] = this->dirty[--this->dirty_count];
+			i = 0;
+		} else {
+			i++;
+		}
+	}
+
+	if (this->dirty_count == RENDER_QUEUE_MAX_DIRTY_RECTS)
+		this->is_full_redraw = true;
+	else
+		this->dirty[this->dirty_count++] = rect;
+}
+
+// Walks both frames in content order, a command without a match in the other frame changed
+static void find_dirty_rects(RenderQueue *this) {
+	if (this->current_capacity < this->command_count) {
+		this->current_capacity = this->command_capacity;
+		this->current = realloc(this->current, this->current_capacity * sizeof(RenderCommand));
+	}
+	int count = this->command_count;
+	SDL_memcpy(this->current, this->commands, count * sizeof(RenderCommand));
+	SDL_qsort(this->current, count, sizeof(RenderCommand), compare_content);
+
+	this->dirty_count = 0;
+	this->is_full_redraw = this->is_invalid;
+	this->is_invalid = false;
+	int i = 0;
+	int j = 0;
+	while (i < this->previous_count || j < count) {
+		int order = i == this->previous_count ? 1 : (j == count ? -1 : compare_content(&this->previous[i], &this->current[j]));
+		if (order == 0) {
+			i++;
+			j++;
+		} else if (order < 0) {
+			add_dirty(this, &this->previous[i++].dst);
+		} else {
+			add_dirty(this, &this->current[j++].dst);
+		}
+	}
+
+	int area = 0;
+	for (int k = 0; k < this->dirty_count; k++) {
+		area += this->dirty[k].w * this->dirty[k].h;
+	}
+	if (this->is_full_redraw || area * 2 > this->target.w * this->target.h) {
+		this->is_full_redraw = true;
+		this->dirty[0] = this->target;
+		this->dirty_count = 1;
+	}
+
+	// This frame is the next one's reference
+	RenderCommand *swap = this->previous;
+	this->previous = this->current;
+	this->current = swap;
+	int swap_capacity = this->previous_capacity;
+	this->previous_capacity = this->current_capacity;
+	this->current_capacity = swap_capacity;
+	this->previous_count = count;
+}
+
+void render_queue_flush(RenderQueue *this) {
+	this->stats.commands = this->command_count;
+	this->stats.immediate_calls = this->immediate_calls;
+	this->immediate_calls = 0;
+	this->stats.batches = 0;
+	this->target.x = 0;
+	this->target.y = 0;
+	render_queue_get_size(this, &this->target.w, &this->target.h);
+
+	SDL_qsort(this->commands, this->command_count, sizeof(RenderCommand), compare_commands);
+	if (this->soft == NULL)
+		reserve_quads(this, this->command_count);
+
+	if (!this->track_dirty) {
+		if (this->soft != NULL)
+			submit_soft(this, NULL);
+		else
+			submit(this, NULL);
+		this->stats.dirty_rects = 1;
+		this->stats.dirty_pixels = this->target.w * this->target.h;
+	} else {
+		find_dirty_rects(this);
+		this->stats.dirty_rects = 0;
+		this->stats.dirty_pixels = 0;
+		SDL_SetRenderDrawBlendMode(this->renderer, SDL_BLENDMODE_NONE);
+		SDL_Color black = { 0, 0, 0, 0 };
+		for (int i = 0; i < this->dirty_count; i++) {
+			const SDL_Rect *rect = &this->dirty[i];
+			if (this->soft != NULL) {
+				soft_renderer_set_clip(this->soft, rect);
+				soft_renderer_fill(this->soft, rect, black);
+				submit_soft(this, rect);
+			} else {
+				SDL_RenderSetClipRect(this->renderer, rect);
+				SDL_SetRenderDrawColor(this->renderer, 0, 0, 0, 0);
+				SDL_RenderFillRect(this->renderer, rect);
+				submit(this, rect);
+			}
+			this->stats.dirty_rects++;
+			this->stats.dirty_pixels += rect->w * rect->h;
+		}
+		SDL_RenderSetClipRect(this->renderer, NULL);
+	}
+
+	this->command_count = 0;
+	this->sequence = 0;
+}
+
+RenderQueueStats render_queue_get_stats(const RenderQueue *this) {
+	return this->stats;
+}
+
+void render_queue_get_size(const RenderQueue *this, int *w, int *h) {
+	if (this->soft != NULL) {
+		soft_renderer_get_size(this->soft, w, h);
+		return;
+	}
+	int output_w = 0, output_h = 0;
+	float scale_x = 1.0f, scale_y = 1.0f;
+	SDL_GetRendererOutputSize(this->renderer, &output_w, &output_h);
+	SDL_RenderGetScale(this->renderer, &scale_x, &scale_y);
+	if (w != NULL)
+		*w = (int)(output_w / scale_x);
+	if (h != NULL)
+		*h = (int)(output_h / scale_y);
+}
+
+void render_queue_set_soft_renderer(RenderQueue *this, SoftRenderer *soft) {
+	this->soft = soft;
+	this->is_invalid = true;
+	if (soft != NULL && this->font_atlas != NULL)
+		soft_renderer_add_texture(soft, this->font_atlas, this->font_surface);
+}
+
+void render_queue_set_transform(RenderQueue *this, float x, float y, float scale) {
+	this->origin.x = x;
+	this->origin.y = y;
+	this->scale = scale;
+}
+
+void render_queue_set_dirty_tracking(RenderQueue *this, const bool is_enabled) {
+	this->track_dirty = is_enabled;
+	this->is_invalid = true;
+	this->previous_count = 0;
+}
+
+void render_queue_invalidate(RenderQueue *this) {
+	this->is_invalid = true;
+}
+
+const SDL_Rect *render_queue_get_dirty_rects(const RenderQueue *this, int *count) {
+	if (!this->track_dirty) {
+		*count = 1;
+		return &this->target;
+	}
+	*count = this->dirty_count;
+	return this->dirty;
+}
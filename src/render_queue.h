@@ -0,0 +1,79 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_ttf.h"
+
+#include "utils.h"
+
+/*
+ * Deferred drawing. Gameplay code appends quads during the frame, render_queue_flush() sorts them
+ * by layer, texture and blend mode and submits each run of identical state with one
+ * SDL_RenderGeometry call. Layers keep the painter's order between overlapping groups,
+ * inside a layer the order is only kept for commands sharing a texture.
+ *
+ * With dirty tracking the queue diffs each frame against the last one: a quad drawn in only one
+ * of them, moved, recolored or animated, marks its bounds dirty. Only the dirty rects are cleared
+ * to black and drawn again, clipped, so the target must keep its pixels between frames.
+ *
+ * With a software renderer set the same sorted commands are drawn by it instead, one call each.
+ * Every texture drawn must be registered with it, the queue registers its font atlas itself.
+ */
+
+#define RENDER_QUEUE_MAX_TEXTURES 16
+#define RENDER_QUEUE_FIRST_GLYPH 32
+#define RENDER_QUEUE_LAST_GLYPH 126
+#define RENDER_QUEUE_MAX_DIRTY_RECTS 32 // More, or over half the target, and the whole frame is redrawn
+
+enum RenderLayer {
+	RENDER_LAYER_MAP = 0,
+	RENDER_LAYER_PLAYER,
+	RENDER_LAYER_GHOSTS,
+	RENDER_LAYER_UI
+} typedef RenderLayer;
+
+enum Alignement {
+	ALIGN_LEFT = 0,
+	ALIGN_CENTERED,
+	ALIGN_RIGHT
+} typedef Alignement;
+
+typedef struct RenderQueueStats {
+	int commands; // Quads, one per glyph of text
+	int immediate_calls; // SDL_Render* calls drawing them immediately would take, one per string of text
+	int batches; // SDL_RenderGeometry calls
+	int dirty_rects; // Repainted regions, the whole target counts as one
+	int dirty_pixels;
+} RenderQueueStats;
+
+struct RenderQueue;
+typedef struct RenderQueue RenderQueue;
+
+struct SoftRenderer;
+
+RenderQueue *render_queue_create(SDL_Renderer *renderer, TTF_Font *font);
+void render_queue_destroy(RenderQueue *queue);
+
+// quarter_turns rotates the sprite clockwise by 90° steps by permuting texture coordinates
+void render_queue_sprite(RenderQueue *queue, RenderLayer layer, SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst, int quarter_turns, SDL_Color color);
+void render_queue_rect(RenderQueue *queue, RenderLayer layer, const SDL_Rect *dst, SDL_Color color);
+// Returns the x coordinate of the end of the text
+int render_queue_text(RenderQueue *queue, RenderLayer layer, const char *text, const SDL_Point *position, Alignement align);
+
+void render_queue_flush(RenderQueue *queue);
+RenderQueueStats render_queue_get_stats(const RenderQueue *queue);
+// What the queue draws on: the software renderer's framebuffer, or the output before SDL_RenderSetScale()
+void render_queue_get_size(const RenderQueue *queue, int *w, int *h);
+// NULL goes back to the renderer. The next flush repaints everything
+void render_queue_set_soft_renderer(RenderQueue *queue, struct SoftRenderer *soft);
+// Scales by scale, then moves by x, y, everything pushed from now on, to draw several games on one target.
+// 0, 0, 1 undoes it. render_queue_text() still returns the untransformed end
+void render_queue_set_transform(RenderQueue *queue, float x, float y, float scale);
+
+void render_queue_set_dirty_tracking(RenderQueue *queue, const bool is_enabled);
+// The next flush repaints the whole target, for when something else drew on it or it was exposed
+void render_queue_invalidate(RenderQueue *queue);
+// What the last flush repainted, for SDL_UpdateWindowSurfaceRects(). Empty when nothing changed
+const SDL_Rect *render_queue_get_dirty_rects(const RenderQueue *queue, int *count);
+
+#endif
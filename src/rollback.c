@@ -0,0 +1,324 @@
+#include "rollback.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "debug.h"
+#include "metrics.h"
+#include "profiler.h"
+
+#define ROLLBACK_MAGIC 0x4B424C52 // "RLBK"
+#define HISTORY_MASK (ROLLBACK_HISTORY - 1)
+#define SNAPSHOT_COUNT (ROLLBACK_MAX_FRAMES + 1)
+
+typedef struct InputPacket {
+	Uint32 magic;
+	Sint32 last_tick; // Tick of inputs[count - 1]
+	Uint64 hash; // game_get_hash() after hash_tick, the sender's latest tick simulated with confirmed inputs only
+	Sint32 hash_tick; // -1 before the first one
+	Uint8 count;
+	Uint8 inputs[ROLLBACK_REDUNDANCY];
+} InputPacket;
+
+struct RollbackSession {
+	RollbackOptions options;
+	Game *game;
+	NetSocket *socket;
+
+	int tick; // Next tick to simulate, the live game holds the state before it
+	Direction pending_input;
+
+	// Indexed by tick & HISTORY_MASK, a slot is valid when its tick matches
+	Uint8 local_inputs[ROLLBACK_HISTORY];
+	Uint8 remote_inputs[ROLLBACK_HISTORY];
+	Sint32 remote_ticks[ROLLBACK_HISTORY];
+	Uint8 predicted[ROLLBACK_HISTORY]; // Remote input each tick was simulated with
+	int confirmed_tick; // Every remote input up to it has arrived
+	bool is_connected;
+
+	// snapshots[tick % SNAPSHOT_COUNT] is the state before tick
+	Game *snapshots[SNAPSHOT_COUNT];
+
+	// State hash after each simulated tick, indexed like the inputs
+	Uint64 hashes[ROLLBACK_HISTORY];
+	Sint32 hash_ticks[ROLLBACK_HISTORY];
+	Uint64 remote_hash; // Latest from the other side
+	int remote_hash_tick;
+	int checked_tick; // Last tick compared
+
+	RollbackStats stats;
+};
+
+/*
+ * SETUP
+ */
+
+void rollback_default_options(RollbackOptions *options) {
+	SDL_zero(*options);
+	options->side = SIDE_PLAYER;
+	options->local_port = ROLLBACK_DEFAULT_PORT;
+	options->remote_port = ROLLBACK_DEFAULT_PORT + 1;
+	options->input_delay = ROLLBACK_DEFAULT_INPUT_DELAY;
+	options->max_rollback = ROLLBACK_DEFAULT_FRAMES;
+}
+
+RollbackSession *rollback_create(Game *game, const RollbackOptions *options) {
+	NetSocket *socket = net_open(options->local_port, options->remote_port, &options->conditions);
+	if (socket == NULL)
+		return NULL;
+
+	RollbackSession *this = calloc(1, sizeof(RollbackSession));
+	this->options = *options;
+	this->options.max_rollback = SDL_clamp(options->max_rollback, 1, ROLLBACK_MAX_FRAMES);
+	this->options.input_delay = SDL_clamp(options->input_delay, 0, ROLLBACK_REDUNDANCY - 1);
+	this->game = game;
+	this->socket = socket;
+	this->pending_input = NONE;
+	this->confirmed_tick = -1;
+	this->remote_hash_tick = -1;
+	this->checked_tick = -1;
+	this->stats.first_desync_tick = -1;
+
+	for (int i = 0; i < ROLLBACK_HISTORY; i++) {
+		this->local_inputs[i] = NONE;
+		this->remote_ticks[i] = -1;
+		this->hash_ticks[i] = -1;
+	}
+	for (int i = 0; i < SNAPSHOT_COUNT; i++) {
+		this->snapshots[i] = game_create(NULL, NULL);
+	}
+
+	game_set_versus(game, true);
+	return this;
+}
+
+void rollback_destroy(RollbackSession *this) {
+	for (int i = 0; i < SNAPSHOT_COUNT; i++) {
+		game_destroy(this->snapshots[i]);
+	}
+	net_close(this->socket);
+	free(this);
+}
+
+void rollback_set_local_input(RollbackSession *this, const Direction direction) {
+	if (direction != NONE)
+		this->pending_input = direction;
+}
+
+/*
+ * NETWORK
+ */
+
+// Ticks up to it were simulated with the remote inputs that really arrived, they won't be rolled back
+static int final_tick(const RollbackSession *this) {
+	return SDL_min(this->confirmed_tick, this->tick - 1);
+}
+
+static void send_inputs(RollbackSession *this, int last_tick) {
+	InputPacket packet;
+	SDL_zero(packet);
+	packet.magic = ROLLBACK_MAGIC;
+	packet.last_tick = last_tick;
+	packet.hash_tick = final_tick(this);
+	if (packet.hash_tick >= 0)
+		packet.hash = this->hashes[packet.hash_tick & HISTORY_MASK];
+	packet.count = (Uint8)SDL_min(last_tick + 1, ROLLBACK_REDUNDANCY);
+	for (int i = 0; i < packet.count; i++) {
+		int tick = last_tick - packet.count + 1 + i;
+		packet.inputs[i] = this->local_inputs[tick & HISTORY_MASK];
+	}
+	net_send(this->socket, &packet, sizeof(packet));
+}
+
+// Returns the first already simulated tick whose prediction was wrong, or this->tick
+static int receive_inputs(RollbackSession *this) {
+	int rollback_tick = this->tick;
+	InputPacket packet;
+	while (net_receive(this->socket, &packet, sizeof(packet)) == sizeof(packet)) {
+		if (packet.magic != ROLLBACK_MAGIC || packet.count > ROLLBACK_REDUNDANCY)
+			continue;
+		this->is_connected = true;
+		if (packet.hash_tick > this->remote_hash_tick) {
+			this->remote_hash_tick = packet.hash_tick;
+			this->remote_hash = packet.hash;
+		}
+
+		for (int i = 0; i < packet.count; i++) {
+			int tick = packet.last_tick - packet.count + 1 + i;
+			// Too old to matter, or so far ahead the ring would overwrite unconfirmed ticks
+			if (tick <= this->confirmed_tick || tick >= this->confirmed_tick + ROLLBACK_HISTORY / 2)
+				continue;
+			int slot = tick & HISTORY_MASK;
+			if (this->remote_ticks[slot] == tick)
+				continue;
+			this->remote_ticks[slot] = tick;
+			this->remote_inputs[slot] = packet.inputs[i];
+			if (tick < this->tick && this->predicted[slot] != packet.inputs[i])
+				rollback_tick = SDL_min(rollback_tick, tick);
+		}
+
+		while (this->remote_ticks[(this->confirmed_tick + 1) & HISTORY_MASK] == this->confirmed_tick + 1) {
+			this->confirmed_tick++;
+		}
+	}
+	return rollback_tick;
+}
+
+/*
+ * SIMULATION
+ */
+
+static void simulate_tick(RollbackSession *this) {
+	int slot = this->tick & HISTORY_MASK;
+	game_copy(this->snapshots[this->tick % SNAPSHOT_COUNT], this->game);
+
+	// The remote side usually pressed nothing, that is also what NONE means
+	Direction remote = this->remote_ticks[slot] == this->tick ? this->remote_inputs[slot] : NONE;
+	this->predicted[slot] = remote;
+	Direction local = this->local_inputs[slot];
+
+	GameInput input;
+	input.player = this->options.side == SIDE_PLAYER ? local : remote;
+	input.ghost = this->options.side == SIDE_PLAYER ? remote : local;
+	game_apply_input(this->game, &input);
+	game_update(this->game, TICK_TIME);
+	this->hashes[slot] = game_get_hash(this->game);
+	this->hash_ticks[slot] = this->tick;
+	this->tick++;
+}
+
+// Both sides must reach the same state with the same inputs, anything else is a desync
+static void check_hash(RollbackSession *this) {
+	int tick = this->remote_hash_tick;
+	int slot = tick & HISTORY_MASK;
+	if (tick <= this->checked_tick || tick > final_tick(this) || this->hash_ticks[slot] != tick)
+		return;
+	this->checked_tick = tick;
+	this->stats.hash_checks++;
+	if (this->hashes[slot] == this->remote_hash)
+		return;
+
+	if (this->stats.desyncs == 0) {
+		this->stats.first_desync_tick = tick;
+		SDL_Log("Desync at tick %d: state hash %016llx here, %016llx on the other side", tick,
+				(unsigned long long)this->hashes[slot], (unsigned long long)this->remote_hash);
+	}
+	this->stats.desyncs++;
+}
+
+static void roll_back(RollbackSession *this, int to_tick) {
+	PROFILE_BEGIN("rollback");
+	Uint64 start = SDL_GetPerformanceCounter();
+	int end_tick = this->tick;
+
+	// Replayed ticks were already heard and counted once
+	game_set_silent(this->game, true);
+	metrics_set_paused(true);
+	game_copy(this->game, this->snapshots[to_tick % SNAPSHOT_COUNT]);
+	this->tick = to_tick;
+	while (this->tick < end_tick) {
+		simulate_tick(this);
+	}
+	metrics_set_paused(false);
+	game_set_silent(this->game, false);
+
+	double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+	int depth = end_tick - to_tick;
+	this->stats.rollbacks++;
+	this->stats.resimulated_ticks += depth;
+	this->stats.max_depth = SDL_max(this->stats.max_depth, depth);
+	this->stats.resimulation_ms += ms;
+	if (ms > this->stats.max_resimulation_ms)
+		this->stats.max_resimulation_ms = ms;
+	PROFILE_END();
+}
+
+bool rollback_advance(RollbackSession *this) {
+	int rollback_tick = receive_inputs(this);
+	if (rollback_tick < this->tick)
+		roll_back(this, rollback_tick);
+	check_hash(this);
+
+	// Keep announcing ourselves until the other side answers
+	int input_tick = this->tick + this->options.input_delay;
+	if (!this->is_connected || this->tick - this->confirmed_tick > this->options.max_rollback) {
+		send_inputs(this, input_tick - 1);
+		this->stats.stalls++;
+		return false;
+	}
+
+	this->local_inputs[input_tick & HISTORY_MASK] = this->pending_input;
+	this->pending_input = NONE;
+	send_inputs(this, input_tick);
+
+	simulate_tick(this);
+	this->stats.ticks++;
+	return true;
+}
+
+RollbackStats rollback_get_stats(const RollbackSession *this) {
+	return this->stats;
+}
+
+void rollback_log_stats(const RollbackStats *stats) {
+	SDL_Log("Rollback: %d ticks, %d stalled frames, %d rollbacks, max depth %d",
+			stats->ticks, stats->stalls, stats->rollbacks, stats->max_depth);
+	if (stats->desyncs > 0)
+		SDL_Log("Rollback desynced: %d of %d compared ticks differed, first at tick %d", stats->desyncs, stats->hash_checks, stats->first_desync_tick);
+	else
+		SDL_Log("Rollback state hashes agreed on all %d compared ticks", stats->hash_checks);
+	if (stats->rollbacks > 0 && stats->resimulated_ticks > 0) {
+		double per_tick = stats->resimulation_ms / stats->resimulated_ticks;
+		SDL_Log("Rollback cost: %.3fms per rollback, %.4fms per resimulated tick, worst %.3fms, %d ticks fit in %dms",
+				stats->resimulation_ms / stats->rollbacks, per_tick, stats->max_resimulation_ms, (int)(TICK_TIME / per_tick), TICK_TIME);
+	}
+}
+
+/*
+ * BENCHMARK
+ */
+
+int rollback_bench_run() {
+	const int repeats = 200;
+	Game *game = game_create(NULL, NULL);
+	game_set_versus(game, true);
+	Game *base = game_create(NULL, NULL);
+	Game *snapshot = game_create(NULL, NULL);
+
+	// Into the chase, past the intro wait
+	GameInput input = { NONE, NONE };
+	for (int tick = 0; tick < 600; tick++) {
+		input.ghost = (tick / 40) % 4;
+		game_apply_input(game, &input);
+		game_update(game, TICK_TIME);
+	}
+
+	printf("Restore and resimulate, mean of %d runs\n", repeats);
+	printf("%6s %12s %14s\n", "ticks", "ms", "ms per tick");
+	double frequency = (double)SDL_GetPerformanceFrequency();
+	double per_tick = 0.0;
+	for (int depth = 1; depth <= ROLLBACK_MAX_FRAMES; depth++) {
+		Uint64 total = 0;
+		game_copy(base, game);
+		for (int r = 0; r < repeats; r++) {
+			Uint64 start = SDL_GetPerformanceCounter();
+			game_copy(game, base);
+			for (int i = 0; i < depth; i++) {
+				game_copy(snapshot, game); // Every replayed tick saves its snapshot again
+				game_apply_input(game, &input);
+				game_update(game, TICK_TIME);
+			}
+			total += SDL_GetPerformanceCounter() - start;
+		}
+		game_copy(game, base);
+		double ms = total * 1000.0 / frequency / repeats;
+		per_tick = ms / depth;
+		printf("%6d %12.4f %14.5f\n", depth, ms, per_tick);
+	}
+	printf("About %d ticks can be resimulated within a %dms frame\n", (int)(TICK_TIME / per_tick), TICK_TIME);
+
+	game_destroy(snapshot);
+	game_destroy(base);
+	game_destroy(game);
+	return 0;
+}
@@ -0,0 +1,73 @@
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include "SDL2/SDL.h"
+
+#include "game.h"
+#include "net.h"
+#include "utils.h"
+
+/*
+ * Rollback netcode for versus mode, one side plays Pac-Man and the other steers a ghost.
+ * Local input is scheduled input_delay ticks ahead and sent with the last few inputs for
+ * redundancy. Ticks run ahead on a prediction that the remote player pressed nothing. When a
+ * remote input contradicts it, the game is restored from the snapshot taken before that tick
+ * and every later tick is simulated again. The session stalls instead of running further
+ * ahead than max_rollback ticks. Packets also carry the state hash of the sender's latest
+ * tick that can no longer roll back, both sides compare it to detect desyncs.
+ */
+
+#define ROLLBACK_MAX_FRAMES 16
+#define ROLLBACK_DEFAULT_FRAMES 8
+#define ROLLBACK_DEFAULT_INPUT_DELAY 2
+#define ROLLBACK_DEFAULT_PORT 7000
+#define ROLLBACK_HISTORY 256 // Input ring, a power of two
+#define ROLLBACK_REDUNDANCY 8 // Inputs repeated in every packet
+
+enum RollbackSide {
+	SIDE_PLAYER,
+	SIDE_GHOST
+} typedef RollbackSide;
+
+typedef struct RollbackOptions {
+	RollbackSide side;
+	Uint16 local_port;
+	Uint16 remote_port;
+	int input_delay;
+	int max_rollback;
+	NetConditions conditions;
+} RollbackOptions;
+
+typedef struct RollbackStats {
+	int ticks;
+	int stalls; // Frames spent waiting on the remote side
+	int rollbacks;
+	int resimulated_ticks;
+	int max_depth;
+	double resimulation_ms;
+	double max_resimulation_ms;
+	int hash_checks; // Ticks whose state hash was compared with the other side's
+	int desyncs;
+	int first_desync_tick; // -1 without desyncs
+} RollbackStats;
+
+struct RollbackSession;
+typedef struct RollbackSession RollbackSession;
+
+void rollback_default_options(RollbackOptions *options);
+// Takes over the ticking of game, NULL when the socket can't be opened
+RollbackSession *rollback_create(Game *game, const RollbackOptions *options);
+void rollback_destroy(RollbackSession *session);
+
+// The local side's latest key press, sent with the next tick
+void rollback_set_local_input(RollbackSession *session, const Direction direction);
+// Runs at most one tick, false while waiting for the remote side
+bool rollback_advance(RollbackSession *session);
+
+RollbackStats rollback_get_stats(const RollbackSession *session);
+void rollback_log_stats(const RollbackStats *stats);
+
+// Times restoring a snapshot and simulating again 1 to ROLLBACK_MAX_FRAMES ticks, returns the exit code
+int rollback_bench_run();
+
+#endif
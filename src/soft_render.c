@@ -0,0 +1,742 @@
+#include "soft_render.h"
+
+#include <stdlib.h>
+
+#include "debug.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFT_SSE2
+#include <emmintrin.h>
+#endif
+
+// MSVC defines it for /arch:AVX2, GCC and Clang for -mavx2
+#if defined(SOFT_SSE2) && defined(__AVX2__)
+#define SOFT_AVX2
+#include <immintrin.h>
+#endif
+
+#define OPAQUE_WHITE 0xFFFFFFFF
+#define ALPHA_MASK 0xFF000000
+
+// Every kernel works on one row of count pixels
+typedef struct Kernels {
+	void (*fill)(Uint32 *dst, int count, Uint32 color);
+	void (*copy)(Uint32 *dst, const Uint32 *src, int count);
+	void (*modulate)(Uint32 *dst, const Uint32 *src, int count, Uint32 color);
+	void (*keyed)(Uint32 *dst, const Uint32 *src, int count, Uint32 color);
+	void (*blend)(Uint32 *dst, const Uint32 *src, int count, Uint32 color);
+	// Writes a size * size block rotated clockwise, pitch in pixels
+	void (*rotate)(Uint32 *dst, const Uint32 *src, int pitch, int size, int quarter_turns);
+	void (*upscale)(Uint32 *dst, const Uint32 *src, int count, int scale);
+} Kernels;
+
+typedef struct SoftTexture {
+	SDL_Texture *texture;
+	Uint32 *pixels; // ARGB8888, pitch w
+	int w;
+	int h;
+	bool is_opaque; // Every alpha is 255
+	bool is_keyed; // Every alpha is 0 or 255
+} SoftTexture;
+
+enum CopyPath {
+	PATH_COPY,
+	PATH_MODULATE,
+	PATH_KEYED,
+	PATH_BLEND
+} typedef CopyPath;
+
+struct SoftRenderer {
+	Uint32 *pixels;
+	int w;
+	int h;
+	int scale;
+	SDL_Rect clip;
+	const Kernels *kernels;
+
+	SoftTexture textures[SOFT_RENDER_MAX_TEXTURES];
+	int texture_count;
+
+	// Rotated or resampled sprites
+	Uint32 *scratch;
+	int scratch_capacity;
+
+	SDL_Surface *screen;
+	SDL_Texture *streaming; // Made on the first present without a screen
+	Uint32 *row; // One scaled row, for screens in another format
+};
+
+/*
+ * SCALAR KERNELS
+ */
+
+// a * b / 255 rounded, exact for every pair of bytes
+static inline Uint32 mul_div_255(Uint32 a, Uint32 b) {
+	Uint32 t = a * b + 128;
+	return ((t >> 8) + t) >> 8;
+}
+
+static Uint32 modulate_pixel(Uint32 s, Uint32 m) {
+	return mul_div_255(s >> 24, m >> 24) << 24 | mul_div_255((s >> 16) & 0xFF, (m >> 16) & 0xFF) << 16
+		| mul_div_255((s >> 8) & 0xFF, (m >> 8) & 0xFF) << 8 | mul_div_255(s & 0xFF, m & 0xFF);
+}
+
+// SDL_BLENDMODE_BLEND: dstRGB = srcRGB * srcA + dstRGB * (1 - srcA), dstA = srcA + dstA * (1 - srcA)
+static Uint32 blend_pixel(Uint32 s, Uint32 d) {
+	Uint32 a = s >> 24;
+	Uint32 inv = 255 - a;
+	Uint32 out = (a + mul_div_255(d >> 24, inv)) << 24;
+	for (int shift = 0; shift < 24; shift += 8) {
+		Uint32 c = mul_div_255((s >> shift) & 0xFF, a) + mul_div_255((d >> shift) & 0xFF, inv);
+		out |= SDL_min(c, 255) << shift;
+	}
+	return out;
+}
+
+static void fill_scalar(Uint32 *dst, int count, Uint32 color) {
+	for (int i = 0; i < count; i++) {
+		dst[i] = color;
+	}
+}
+
+static void copy_scalar(Uint32 *dst, const Uint32 *src, int count) {
+	SDL_memcpy(dst, src, count * sizeof(Uint32));
+}
+
+static void modulate_scalar(Uint32 *dst, const Uint32 *src, int count, Uint32 color) {
+	for (int i = 0; i < count; i++) {
+		dst[i] = modulate_pixel(src[i], color);
+	}
+}
+
+static void keyed_scalar(Uint32 *dst, const Uint32 *src, int count, Uint32 color) {
+	for (int i = 0; i < count; i++) {
+		if (src[i] & ALPHA_MASK)
+			dst[i] = color == OPAQUE_WHITE ? src[i] : modulate_pixel(src[i], color);
+	}
+}
+
+static void blend_scalar(Uint32 *dst, const Uint32 *src, int count, Uint32 color) {
+	for (int i = 0; i < count; i++) {
+		dst[i] = blend_pixel(color == OPAQUE_WHITE ? src[i] : modulate_pixel(src[i], color), dst[i]);
+	}
+}
+
+// Clockwise: the top left corner of the result is the bottom left one of the source after one turn
+static void rotate_scalar(Uint32 *dst, const Uint32 *src, int pitch, int size, int quarter_turns) {
+	int last = size - 1;
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			int sx = x, sy = y;
+			switch (quarter_turns) {
+				case 1: sx = y; sy = last - x; break;
+				case 2: sx = last - x; sy = last - y; break;
+				case 3: sx = last - y; sy = x; break;
+			}
+			dst[y * size + x] = src[sy * pitch + sx];
+		}
+	}
+}
+
+static void upscale_scalar(Uint32 *dst, const Uint32 *src, int count, int scale) {
+	for (int i = 0; i < count; i++) {
+		for (int k = 0; k < scale; k++) {
+			*dst++ = src[i];
+		}
+	}
+}
+
+static const Kernels scalar_kernels = {
+	fill_scalar, copy_scalar, modulate_scalar, keyed_scalar, blend_scalar, rotate_scalar, upscale_scalar
+};
+
+/*
+ * SSE2 KERNELS
+ */
+
+#ifdef SOFT_SSE2
+
+// mul_div_255() on 16-bit lanes, the product of two bytes plus 128 still fits
+static inline __m128i mul_div_255_sse2(__m128i a, __m128i b) {
+	__m128i t = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// Four pixels, m holds the color widened to two pixels of 16-bit lanes
+static inline __m128i modulate_sse2(__m128i s, __m128i m) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i lo = mul_div_255_sse2(_mm_unpacklo_epi8(s, zero), m);
+	__m128i hi = mul_div_255_sse2(_mm_unpackhi_epi8(s, zero), m);
+	return _mm_packus_epi16(lo, hi);
+}
+
+// Two pixels widened to 16-bit lanes, B G R A each. The sum may round up to 256, packing saturates it
+static inline __m128i blend_half_sse2(__m128i s, __m128i d) {
+	__m128i alpha_lanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+	__m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m128i source_weight = _mm_or_si128(_mm_andnot_si128(alpha_lanes, a), _mm_and_si128(alpha_lanes, _mm_set1_epi16(255)));
+	__m128i dest_weight = _mm_sub_epi16(_mm_set1_epi16(255), a);
+	return _mm_add_epi16(mul_div_255_sse2(s, source_weight), mul_div_255_sse2(d, dest_weight));
+}
+
+static inline __m128i blend_sse2(__m128i s, __m128i d) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i lo = blend_half_sse2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+	__m128i hi = blend_half_sse2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+	return _mm_packus_epi16(lo, hi);
+}
+
+static inline __m128i widen_color_sse2(Uint32 color) {
+	return _mm_unpacklo_epi8(_mm_set1_epi32((int)color), _mm_setzero_si128());
+}
+
+static void fill_sse2(Uint32 *dst, int count, Uint32 color) {
+	__m128i c = _mm_set1_epi32((int)color);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_si128((__m128i *)(dst + i), c);
+	}
+	fill_scalar(dst + i, count - i, color);
+}
+
+static void copy_sse2(Uint32 *dst, const Uint32 *src, int count) {
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_loadu_si128((const __m128i *)(src + i)));
+	}
+	copy_scalar(dst + i, src + i, count - i);
+}
+
+static void modulate_sse2_row(Uint32 *dst, const Uint32 *src, int count, Uint32 color) {
+	__m128i m = widen_color_sse2(color);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *)(dst + i), modulate_sse2(s, m));
+	}
+	modulate_scalar(dst + i, src + i, count - i, color);
+}
+
+static void keyed_sse2(Uint32 *dst, const Uint32 *src, int count, Uint32 color) {
+	__m128i m = widen_color_sse2(color);
+	__m128i alpha = _mm_set1_epi32((int)ALPHA_MASK);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+		__m128i hole = _mm_cmpeq_epi32(_mm_and_si128(s, alpha), _mm_setzero_si128());
+		if (color != OPAQUE_WHITE)
+			s = modulate_sse2(s, m);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_and_si128(hole, d), _mm_andnot_si128(hole, s)));
+	}
+	keyed_scalar(dst + i, src + i, count - i, color);
+}
+
+static void blend_sse2_row(Uint32 *dst, const Uint32 *src, int count, Uint32 color) {
+	__m128i m = widen_color_sse2(color);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+		if (color != OPAQUE_WHITE)
+			s = modulate_sse2(s, m);
+		_mm_storeu_si128((__m128i *)(dst + i), blend_sse2(s, d));
+	}
+	blend_scalar(dst + i, src + i, count - i, color);
+}
+
+static inline void transpose_sse2(__m128i *r) {
+	__m128i t0 = _mm_unpacklo_epi32(r[0], r[1]);
+	__m128i t1 = _mm_unpacklo_epi32(r[2], r[3]);
+	__m128i t2 = _mm_unpackhi_epi32(r[0], r[1]);
+	__m128i t3 = _mm_unpackhi_epi32(r[2], r[3]);
+	r[0] = _mm_unpacklo_epi64(t0, t1);
+	r[1] = _mm_unpackhi_epi64(t0, t1);
+	r[2] = _mm_unpacklo_epi64(t2, t3);
+	r[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+#define REVERSE_SSE2(v) _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3))
+
+// In 4x4 blocks: one turn is the transpose mirrored left to right, three turns top to bottom
+static void rotate_sse2(Uint32 *dst, const Uint32 *src, int pitch, int size, int quarter_turns) {
+	if (size % 4 != 0 || quarter_turns == 0) {
+		rotate_scalar(dst, src, pitch, size, quarter_turns);
+		return;
+	}
+
+	for (int by = 0; by < size; by += 4) {
+		for (int bx = 0; bx < size; bx += 4) {
+			__m128i r[4];
+			if (quarter_turns == 2) {
+				for (int j = 0; j < 4; j++) {
+					__m128i v = _mm_loadu_si128((const __m128i *)(src + (size - 1 - by - j) * pitch + size - 4 - bx));
+					_mm_storeu_si128((__m128i *)(dst + (by + j) * size + bx), REVERSE_SSE2(v));
+				}
+				continue;
+			}
+
+			int column = quarter_turns == 1 ? by : size - 4 - by;
+			int first_row = quarter_turns == 1 ? size - 4 - bx : bx;
+			for (int k = 0; k < 4; k++) {
+				r[k] = _mm_loadu_si128((const __m128i *)(src + (first_row + k) * pitch + column));
+			}
+			transpose_sse2(r);
+			for (int j = 0; j < 4; j++) {
+				__m128i v = quarter_turns == 1 ? REVERSE_SSE2(r[j]) : r[3 - j];
+				_mm_storeu_si128((__m128i *)(dst + (by + j) * size + bx), v);
+			}
+		}
+	}
+}
+
+static void upscale_sse2(Uint32 *dst, const Uint32 *src, int count, int scale) {
+	int i = 0;
+	if (scale == 1) {
+		copy_sse2(dst, src, count);
+		return;
+	} else if (scale == 2) {
+		for (; i + 4 <= count; i += 4) {
+			__m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+			_mm_storeu_si128((__m128i *)(dst + i * 2), _mm_unpacklo_epi32(v, v));
+			_mm_storeu_si128((__m128i *)(dst + i * 2 + 4), _mm_unpackhi_epi32(v, v));
+		}
+	} else if (scale == 4) {
+		for (; i + 4 <= count; i += 4) {
+			__m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+			_mm_storeu_si128((__m128i *)(dst + i * 4), _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 0, 0, 0)));
+			_mm_storeu_si128((__m128i *)(dst + i * 4 + 4), _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 1, 1, 1)));
+			_mm_storeu_si128((__m128i *)(dst + i * 4 + 8), _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 2, 2, 2)));
+			_mm_storeu_si128((__m128i *)(dst + i * 4 + 12), _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3)));
+		}
+	} else {
+		for (; i < count; i++) {
+			__m128i v = _mm_set1_epi32((int)src[i]);
+			int k = 0;
+			for (; k + 4 <= scale; k += 4) {
+				_mm_storeu_si128((__m128i *)(dst + i * scale + k), v);
+			}
+			fill_scalar(dst + i * scale + k, scale - k, src[i]);
+		}
+	}
+	upscale_scalar(dst + i * scale, src + i, count - i, scale);
+}
+
+static const Kernels sse2_kernels = {
+	fill_sse2, copy_sse2, modulate_sse2_row, keyed_sse2, blend_sse2_row, rotate_sse2, upscale_sse2
+};
+
+#endif
+
+/*
+ * AVX2 KERNELS
+ */
+
+#ifdef SOFT_AVX2
+
+// The same as the SSE2 ones on each 128-bit half, unpacking and packing never cross them
+static inline __m256i mul_div_255_avx2(__m256i a, __m256i b) {
+	__m256i t = _mm256_add_epi16(_mm256_mullo_epi16(a, b), _mm256_set1_epi16(128));
+	return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+static inline __m256i modulate_avx2(__m256i s, __m256i m) {
+	__m256i zero = _mm256_setzero_si256();
+	__m256i lo = mul_div_255_avx2(_mm256_unpacklo_epi8(s, zero), m);
+	__m256i hi = mul_div_255_avx2(_mm256_unpackhi_epi8(s, zero), m);
+	return _mm256_packus_epi16(lo, hi);
+}
+
+static inline __m256i blend_half_avx2(__m256i s, __m256i d) {
+	__m256i alpha_lanes = _mm256_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0);
+	__m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m256i source_weight = _mm256_or_si256(_mm256_andnot_si256(alpha_lanes, a), _mm256_and_si256(alpha_lanes, _mm256_set1_epi16(255)));
+	__m256i dest_weight = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+	return _mm256_add_epi16(mul_div_255_avx2(s, source_weight), mul_div_255_avx2(d, dest_weight));
+}
+
+static inline __m256i blend_avx2(__m256i s, __m256i d) {
+	__m256i zero = _mm256_setzero_si256();
+	__m256i lo = blend_half_avx2(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero));
+	__m256i hi = blend_half_avx2(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero));
+	return _mm256_packus_epi16(lo, hi);
+}
+
+static inline __m256i widen_color_avx2(Uint32 color) {
+	return _mm256_unpacklo_epi8(_mm256_set1_epi32((int)color), _mm256_setzero_si256());
+}
+
+// The rest of each row goes to the SSE2 kernels
+static void fill_avx2(Uint32 *dst, int count, Uint32 color) {
+	__m256i c = _mm256_set1_epi32((int)color);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		_mm256_storeu_si256((__m256i *)(dst + i), c);
+	}
+	fill_sse2(dst + i, count - i, color);
+}
+
+static void copy_avx2(Uint32 *dst, const Uint32 *src, int count) {
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_loadu_si256((const __m256i *)(src + i)));
+	}
+	copy_sse2(dst + i, src + i, count - i);
+}
+
+static void modulate_avx2_row(Uint32 *dst, const Uint32 *src, int count, Uint32 color) {
+	__m256i m = widen_color_avx2(color);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_si256((__m256i *)(dst + i), modulate_avx2(s, m));
+	}
+	modulate_sse2_row(dst + i, src + i, count - i, color);
+}
+
+static void keyed_avx2(Uint32 *dst, const Uint32 *src, int count, Uint32 color) {
+	__m256i m = widen_color_avx2(color);
+	__m256i alpha = _mm256_set1_epi32((int)ALPHA_MASK);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+		__m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+		__m256i hole = _mm256_cmpeq_epi32(_mm256_and_si256(s, alpha), _mm256_setzero_si256());
+		if (color != OPAQUE_WHITE)
+			s = modulate_avx2(s, m);
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_blendv_epi8(s, d, hole));
+	}
+	keyed_sse2(dst + i, src + i, count - i, color);
+}
+
+static void blend_avx2_row(Uint32 *dst, const Uint32 *src, int count, Uint32 color) {
+	__m256i m = widen_color_avx2(color);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+		__m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+		if (color != OPAQUE_WHITE)
+			s = modulate_avx2(s, m);
+		_mm256_storeu_si256((__m256i *)(dst + i), blend_avx2(s, d));
+	}
+	blend_sse2_row(dst + i, src + i, count - i, color);
+}
+
+static void upscale_avx2(Uint32 *dst, const Uint32 *src, int count, int scale) {
+	if (scale != 2 && scale != 4) {
+		upscale_sse2(dst, src, count, scale);
+		return;
+	}
+
+	// Each output vector repeats a run of input pixels, picked by lane index
+	int step = 8 / scale;
+	__m256i first = scale == 2 ? _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3) : _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+	__m256i second = scale == 2 ? _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7) : _mm256_setr_epi32(2, 2, 2, 2, 3, 3, 3, 3);
+	int i = 0;
+	for (; i + step * 2 <= count; i += step * 2) {
+		__m256i v = scale == 2 ? _mm256_loadu_si256((const __m256i *)(src + i)) : _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(src + i)));
+		_mm256_storeu_si256((__m256i *)(dst + i * scale), _mm256_permutevar8x32_epi32(v, first));
+		_mm256_storeu_si256((__m256i *)(dst + i * scale + 8), _mm256_permutevar8x32_epi32(v, second));
+	}
+	upscale_sse2(dst + i * scale, src + i, count - i, scale);
+}
+
+static const Kernels avx2_kernels = {
+	fill_avx2, copy_avx2, modulate_avx2_row, keyed_avx2, blend_avx2_row, rotate_sse2, upscale_avx2
+};
+
+#endif
+
+SoftKernels soft_renderer_best_kernels() {
+#if defined(SOFT_AVX2)
+	return SOFT_KERNELS_AVX2;
+#elif defined(SOFT_SSE2)
+	return SOFT_KERNELS_SSE2;
+#else
+	return SOFT_KERNELS_SCALAR;
+#endif
+}
+
+const char *soft_renderer_kernels_name(SoftKernels kernels) {
+	switch (kernels) {
+		case SOFT_KERNELS_SCALAR: return "scalar";
+		case SOFT_KERNELS_SSE2: return "SSE2";
+		case SOFT_KERNELS_AVX2: return "AVX2";
+	}
+	return "?";
+}
+
+void soft_renderer_set_kernels(SoftRenderer *this, SoftKernels kernels) {
+	kernels = SDL_min(kernels, soft_renderer_best_kernels());
+	this->kernels = &scalar_kernels;
+#ifdef SOFT_SSE2
+	if (kernels == SOFT_KERNELS_SSE2)
+		this->kernels = &sse2_kernels;
+#endif
+#ifdef SOFT_AVX2
+	if (kernels == SOFT_KERNELS_AVX2)
+		this->kernels = &avx2_kernels;
+#endif
+}
+
+/*
+ * SETUP
+ */
+
+SoftRenderer *soft_renderer_create(int w, int h, int scale, SDL_Surface *screen) {
+	SoftRenderer *this = calloc(1, sizeof(SoftRenderer));
+	this->w = w;
+	this->h = h;
+	this->scale = SDL_max(scale, 1);
+	this->pixels = calloc((size_t)w * h, sizeof(Uint32));
+	this->screen = screen;
+	this->row = malloc((size_t)w * this->scale * sizeof(Uint32));
+	soft_renderer_set_kernels(this, soft_renderer_best_kernels());
+	soft_renderer_set_clip(this, NULL);
+	return this;
+}
+
+void soft_renderer_destroy(SoftRenderer *this) {
+	for (int i = 0; i < this->texture_count; i++) {
+		free(this->textures[i].pixels);
+	}
+	if (this->streaming != NULL)
+		SDL_DestroyTexture(this->streaming);
+	free(this->scratch);
+	free(this->row);
+	free(this->pixels);
+	free(this);
+}
+
+bool soft_renderer_add_texture(SoftRenderer *this, SDL_Texture *texture, SDL_Surface *surface) {
+	if (texture == NULL || surface == NULL)
+		return false;
+	for (int i = 0; i < this->texture_count; i++) {
+		if (this->textures[i].texture == texture)
+			return true;
+	}
+	if (this->texture_count == SOFT_RENDER_MAX_TEXTURES) {
+		SDL_Log("Software renderer texture table full");
+		return false;
+	}
+
+	SoftTexture *entry = &this->textures[this->texture_count++];
+	entry->texture = texture;
+	entry->w = surface->w;
+	entry->h = surface->h;
+	entry->pixels = malloc((size_t)surface->w * surface->h * sizeof(Uint32));
+	SDL_ConvertPixels(surface->w, surface->h, surface->format->format, surface->pixels, surface->pitch,
+			SDL_PIXELFORMAT_ARGB8888, entry->pixels, surface->w * sizeof(Uint32));
+
+	entry->is_opaque = true;
+	entry->is_keyed = true;
+	for (int i = 0; i < surface->w * surface->h; i++) {
+		Uint32 alpha = entry->pixels[i] >> 24;
+		if (alpha != 255)
+			entry->is_opaque = false;
+		if (alpha != 0 && alpha != 255)
+			entry->is_keyed = false;
+	}
+	return true;
+}
+
+void soft_renderer_get_size(const SoftRenderer *this, int *w, int *h) {
+	if (w != NULL)
+		*w = this->w;
+	if (h != NULL)
+		*h = this->h;
+}
+
+const Uint32 *soft_renderer_get_pixels(const SoftRenderer *this) {
+	return this->pixels;
+}
+
+/*
+ * DRAWING
+ */
+
+static Uint32 pack_color(SDL_Color color) {
+	return (Uint32)color.a << 24 | (Uint32)color.r << 16 | (Uint32)color.g << 8 | color.b;
+}
+
+static Uint32 *reserve_scratch(SoftRenderer *this, int pixels) {
+	if (pixels > this->scratch_capacity) {
+		this->scratch_capacity = pixels;
+		this->scratch = realloc(this->scratch, pixels * sizeof(Uint32));
+	}
+	return this->scratch;
+}
+
+// Nearest texel under the center of each destination pixel
+static void resample(Uint32 *out, const SoftTexture *texture, const SDL_Rect *src, const SDL_Rect *dst, int quarter_turns) {
+	for (int y = 0; y < dst->h; y++) {
+		float v = (y + 0.5f) / dst->h;
+		for (int x = 0; x < dst->w; x++) {
+			float u = (x + 0.5f) / dst->w;
+			float su = u, sv = v;
+			switch (quarter_turns) {
+				case 1: su = v; sv = 1.0f - u; break;
+				case 2: su = 1.0f - u; sv = 1.0f - v; break;
+				case 3: su = 1.0f - v; sv = u; break;
+			}
+			int sx = SDL_min((int)(su * src->w), src->w - 1);
+			int sy = SDL_min((int)(sv * src->h), src->h - 1);
+			out[y * dst->w + x] = texture->pixels[(src->y + sy) * texture->w + src->x + sx];
+		}
+	}
+}
+
+void soft_renderer_set_clip(SoftRenderer *this, const SDL_Rect *rect) {
+	SDL_Rect all = { 0, 0, this->w, this->h };
+	this->clip = all;
+	if (rect != NULL && !SDL_IntersectRect(rect, &all, &this->clip))
+		SDL_zero(this->clip);
+}
+
+void soft_renderer_fill(SoftRenderer *this, const SDL_Rect *dst, SDL_Color color) {
+	SDL_Rect rect = this->clip;
+	if (dst != NULL && !SDL_IntersectRect(dst, &this->clip, &rect))
+		return;
+	Uint32 packed = pack_color(color);
+	for (int y = rect.y; y < rect.y + rect.h; y++) {
+		this->kernels->fill(this->pixels + y * this->w + rect.x, rect.w, packed);
+	}
+}
+
+void soft_renderer_copy(SoftRenderer *this, SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst, int quarter_turns, SDL_Color color) {
+	const SoftTexture *entry = NULL;
+	for (int i = 0; i < this->texture_count; i++) {
+		if (this->textures[i].texture == texture)
+			entry = &this->textures[i];
+	}
+	if (entry == NULL)
+		return;
+	SDL_Rect bounds = { 0, 0, entry->w, entry->h };
+	SDL_Rect inside;
+	if (!SDL_IntersectRect(src, &bounds, &inside) || !SDL_RectEquals(&inside, src))
+		return;
+	SDL_Rect rect;
+	if (!SDL_IntersectRect(dst, &this->clip, &rect))
+		return;
+
+	// The texels for the whole destination, pitch in pixels
+	const Uint32 *block = entry->pixels + src->y * entry->w + src->x;
+	int pitch = entry->w;
+	quarter_turns &= 3;
+	bool is_same_size = src->w == dst->w && src->h == dst->h;
+	if (quarter_turns != 0 && is_same_size && src->w == src->h) {
+		Uint32 *rotated = reserve_scratch(this, dst->w * dst->h);
+		this->kernels->rotate(rotated, block, pitch, src->w, quarter_turns);
+		block = rotated;
+		pitch = dst->w;
+	} else if (quarter_turns != 0 || !is_same_size) {
+		Uint32 *sampled = reserve_scratch(this, dst->w * dst->h);
+		resample(sampled, entry, src, dst, quarter_turns);
+		block = sampled;
+		pitch = dst->w;
+	}
+
+	Uint32 packed = pack_color(color);
+	CopyPath path = PATH_BLEND;
+	if (color.a == 255 && entry->is_opaque)
+		path = packed == OPAQUE_WHITE ? PATH_COPY : PATH_MODULATE;
+	else if (color.a == 255 && entry->is_keyed)
+		path = PATH_KEYED;
+
+	for (int y = rect.y; y < rect.y + rect.h; y++) {
+		Uint32 *out = this->pixels + y * this->w + rect.x;
+		const Uint32 *in = block + (y - dst->y) * pitch + rect.x - dst->x;
+		switch (path) {
+			case PATH_COPY: this->kernels->copy(out, in, rect.w); break;
+			case PATH_MODULATE: this->kernels->modulate(out, in, rect.w, packed); break;
+			case PATH_KEYED: this->kernels->keyed(out, in, rect.w, packed); break;
+			case PATH_BLEND: this->kernels->blend(out, in, rect.w, packed); break;
+		}
+	}
+}
+
+/*
+ * PRESENTING
+ */
+
+// Writes rect scaled up at out, its top left corner, pitch in bytes
+static void scale_rect(SoftRenderer *this, const SDL_Rect *rect, Uint8 *out, int pitch) {
+	int bytes = rect->w * this->scale * sizeof(Uint32);
+	for (int y = 0; y < rect->h; y++) {
+		Uint8 *first = out + y * this->scale * pitch;
+		this->kernels->upscale((Uint32 *)first, this->pixels + (rect->y + y) * this->w + rect->x, rect->w, this->scale);
+		for (int k = 1; k < this->scale; k++) {
+			SDL_memcpy(first + k * pitch, first, bytes);
+		}
+	}
+}
+
+// Same rows as scale_rect(), converted one at a time for screens that aren't 32-bit RGB
+static void scale_rect_converted(SoftRenderer *this, const SDL_Rect *rect, Uint8 *out, int pitch) {
+	Uint32 format = this->screen->format->format;
+	int w = rect->w * this->scale;
+	for (int y = 0; y < rect->h; y++) {
+		this->kernels->upscale(this->row, this->pixels + (rect->y + y) * this->w + rect->x, rect->w, this->scale);
+		for (int k = 0; k < this->scale; k++) {
+			Uint8 *line = out + (y * this->scale + k) * pitch;
+			SDL_ConvertPixels(w, 1, SDL_PIXELFORMAT_ARGB8888, this->row, w * sizeof(Uint32), format, line, pitch);
+		}
+	}
+}
+
+static void present_screen(SoftRenderer *this, const SDL_Rect *rects, int count) {
+	SDL_Surface *screen = this->screen;
+	SDL_Rect visible = { 0, 0, SDL_min(this->w, screen->w / this->scale), SDL_min(this->h, screen->h / this->scale) };
+	// The window has no alpha, X stands for the channel's bits
+	Uint32 format = screen->format->format;
+	bool is_direct = format == SDL_PIXELFORMAT_ARGB8888 || format == SDL_PIXELFORMAT_RGB888;
+
+	if (SDL_MUSTLOCK(screen))
+		SDL_LockSurface(screen);
+	for (int i = 0; i < count; i++) {
+		SDL_Rect rect;
+		if (!SDL_IntersectRect(&rects[i], &visible, &rect))
+			continue;
+		Uint8 *out = (Uint8 *)screen->pixels + rect.y * this->scale * screen->pitch + rect.x * this->scale * screen->format->BytesPerPixel;
+		if (is_direct)
+			scale_rect(this, &rect, out, screen->pitch);
+		else
+			scale_rect_converted(this, &rect, out, screen->pitch);
+	}
+	if (SDL_MUSTLOCK(screen))
+		SDL_UnlockSurface(screen);
+}
+
+void soft_renderer_present(SoftRenderer *this, SDL_Renderer *target, const SDL_Rect *rects, int count) {
+	SDL_Rect all = { 0, 0, this->w, this->h };
+	if (rects == NULL) {
+		rects = &all;
+		count = 1;
+	}
+	if (this->screen != NULL) {
+		present_screen(this, rects, count);
+		return;
+	}
+
+	if (this->streaming == NULL) {
+		this->streaming = SDL_CreateTexture(target, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, this->w * this->scale, this->h * this->scale);
+		if (this->streaming == NULL) {
+			SDL_Log("Unable to create the streaming texture: %s", SDL_GetError());
+			return;
+		}
+	}
+	for (int i = 0; i < count; i++) {
+		SDL_Rect rect;
+		if (!SDL_IntersectRect(&rects[i], &all, &rect))
+			continue;
+		// Locked pixels are write only, every one of them is written
+		SDL_Rect scaled = { rect.x * this->scale, rect.y * this->scale, rect.w * this->scale, rect.h * this->scale };
+		void *pixels = NULL;
+		int pitch = 0;
+		if (SDL_LockTexture(this->streaming, &scaled, &pixels, &pitch) != 0)
+			continue;
+		scale_rect(this, &rect, pixels, pitch);
+		SDL_UnlockTexture(this->streaming);
+	}
+	SDL_RenderCopy(target, this->streaming, NULL, NULL);
+}
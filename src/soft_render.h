@@ -0,0 +1,62 @@
+#ifndef SOFT_RENDER_H
+#define SOFT_RENDER_H
+
+#include "SDL2/SDL.h"
+
+#include "utils.h"
+
+/*
+ * Software drawing backend for machines without a GPU. It only does what draw() needs: rect fills,
+ * tile copies, colour modulated copies (the maze blinks), alpha keyed sprites, alpha blended ones
+ * and 90° rotations, all 1:1 in size, row by row with SSE2 or AVX2 kernels and a scalar fallback.
+ * Scaled sprites are sampled nearest first, draw() has none.
+ *
+ * Everything is drawn into a 32-bit ARGB8888 framebuffer at the game's resolution. Presenting
+ * scales it up by a whole factor into the window surface, or into a streaming texture copied over
+ * the renderer's output when there is no surface. Only the given rectangles are scaled and copied.
+ *
+ * The backend keeps its own copy of every texture it draws, registered with the surface it was
+ * made from. Texture pixels fully opaque or fully transparent are copied or skipped, the alpha keyed
+ * path, the rest blended as SDL_BLENDMODE_BLEND does.
+ */
+
+#define SOFT_RENDER_MAX_TEXTURES 16
+
+enum SoftKernels {
+	SOFT_KERNELS_SCALAR = 0,
+	SOFT_KERNELS_SSE2,
+	SOFT_KERNELS_AVX2
+} typedef SoftKernels;
+
+struct SoftRenderer;
+typedef struct SoftRenderer SoftRenderer;
+
+// screen is the window surface presented into, NULL to present through a streaming texture
+SoftRenderer *soft_renderer_create(int w, int h, int scale, SDL_Surface *screen);
+void soft_renderer_destroy(SoftRenderer *renderer);
+
+// The best kernels the build has, AVX2 needs it compiled for, SSE2 comes with every x64 compiler
+SoftKernels soft_renderer_best_kernels();
+const char *soft_renderer_kernels_name(SoftKernels kernels);
+// Kernels the build lacks fall back to the best it has
+void soft_renderer_set_kernels(SoftRenderer *renderer, SoftKernels kernels);
+
+// Copies the pixels of surface, drawing texture uses them. Once per texture, adding it again keeps the
+// first pixels. Returns false when the table is full
+bool soft_renderer_add_texture(SoftRenderer *renderer, SDL_Texture *texture, SDL_Surface *surface);
+void soft_renderer_get_size(const SoftRenderer *renderer, int *w, int *h);
+
+// Drawing is clipped to rect, NULL for the whole framebuffer
+void soft_renderer_set_clip(SoftRenderer *renderer, const SDL_Rect *rect);
+// Writes color as is, SDL_BLENDMODE_NONE. dst NULL fills the clip rect
+void soft_renderer_fill(SoftRenderer *renderer, const SDL_Rect *dst, SDL_Color color);
+// quarter_turns rotates clockwise, as render_queue_sprite(). color modulates, SDL_BLENDMODE_BLEND
+void soft_renderer_copy(SoftRenderer *renderer, SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst, int quarter_turns, SDL_Color color);
+
+// Scales rects of the framebuffer up to the screen or the streaming texture, rects NULL for all of it.
+// The texture is then copied over the output of renderer, which may be NULL with a screen
+void soft_renderer_present(SoftRenderer *renderer, SDL_Renderer *target, const SDL_Rect *rects, int count);
+// The framebuffer, w * h pixels
+const Uint32 *soft_renderer_get_pixels(const SoftRenderer *renderer);
+
+#endif
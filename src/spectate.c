@@ -0,0 +1,812 @@
+#include "spectate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bot.h"
+#include "debug.h"
+
+#define HEADER_SIZE 3 // u16 payload length, u8 SpectateMessage
+#define ENTITY_COUNT (1 + GHOST_AMT) // The player, then the ghosts
+#define MOVE_ABSOLUTE -128 // In place of dx, an absolute position follows
+#define BROADCAST_POLL_MS 10 // Newcomers wait at most this long while the game is paused
+#define CLIENT_READ_BUFFER (4 * SPECTATE_MAX_MESSAGE)
+
+// What a delta carries, in this order
+enum DeltaField {
+	DELTA_STATE = 1 << 0, // u8
+	DELTA_SCORE = 1 << 1, // s16 score and s16 new life points, both differences
+	DELTA_LIVES = 1 << 2, // u8
+	DELTA_LEVEL = 1 << 3, // u16
+	DELTA_BLINK = 1 << 4, // u8
+	DELTA_MOVE = 1 << 5, // One bit per entity: s8 dx and dy, or MOVE_ABSOLUTE then s16 x and y
+	DELTA_POSE = 1 << 10, // One bit per entity: u8 pose
+	DELTA_PELLETS = 1 << 15 // u8 count, u16 tile index of each pellet eaten
+} typedef DeltaField;
+
+/*
+ * ENCODING
+ */
+
+typedef struct Writer {
+	Uint8 *at;
+} Writer;
+
+typedef struct Reader {
+	const Uint8 *at;
+	const Uint8 *end;
+	bool is_valid; // Cleared by any read past the end
+} Reader;
+
+static void put_u8(Writer *this, const Uint8 value) {
+	*this->at++ = value;
+}
+
+static void put_u16(Writer *this, const Uint16 value) {
+	put_u8(this, (Uint8)value);
+	put_u8(this, (Uint8)(value >> 8));
+}
+
+static void put_u32(Writer *this, const Uint32 value) {
+	put_u16(this, (Uint16)value);
+	put_u16(this, (Uint16)(value >> 16));
+}
+
+static Uint8 get_u8(Reader *this) {
+	if (this->at >= this->end) {
+		this->is_valid = false;
+		return 0;
+	}
+	return *this->at++;
+}
+
+static Uint16 get_u16(Reader *this) {
+	Uint16 low = get_u8(this);
+	return low | (Uint16)get_u8(this) << 8;
+}
+
+static Uint32 get_u32(Reader *this) {
+	Uint32 low = get_u16(this);
+	return low | (Uint32)get_u16(this) << 16;
+}
+
+static SpectateEntity *get_entity(SpectateFrame *frame, const int index) {
+	return index == 0 ? &frame->player : &frame->ghosts[index - 1];
+}
+
+static const SpectateEntity *get_const_entity(const SpectateFrame *frame, const int index) {
+	return index == 0 ? &frame->player : &frame->ghosts[index - 1];
+}
+
+// Direction up to NONE, frame up to 7, state up to 3
+static Uint8 pack_pose(const SpectateEntity *entity) {
+	return (entity->direction & 7) | (entity->frame & 7) << 3 | (entity->state & 3) << 6;
+}
+
+static void unpack_pose(SpectateEntity *entity, const Uint8 pose) {
+	entity->direction = pose & 7;
+	entity->frame = pose >> 3 & 7;
+	entity->state = pose >> 6;
+}
+
+// Payload written after the header, returns the whole message length
+static int finish_message(Uint8 *message, const SpectateMessage type, const Writer *writer) {
+	int length = (int)(writer->at - message);
+	Writer header = { message };
+	put_u16(&header, (Uint16)(length - HEADER_SIZE));
+	put_u8(&header, (Uint8)type);
+	return length;
+}
+
+static int encode_keyframe(const SpectateFrame *frame, Uint8 *message) {
+	Writer writer = { message + HEADER_SIZE };
+	put_u32(&writer, frame->tick);
+	put_u8(&writer, frame->state);
+	put_u8(&writer, frame->lives);
+	put_u8(&writer, frame->is_blinking);
+	put_u16(&writer, frame->level);
+	put_u32(&writer, (Uint32)frame->score);
+	put_u32(&writer, (Uint32)frame->new_life_pts);
+	for (int i = 0; i < ENTITY_COUNT; i++) {
+		const SpectateEntity *entity = get_const_entity(frame, i);
+		put_u16(&writer, (Uint16)entity->x);
+		put_u16(&writer, (Uint16)entity->y);
+		put_u8(&writer, pack_pose(entity));
+	}
+	for (int i = 0; i < SPECTATE_PELLET_WORDS; i++) {
+		put_u32(&writer, frame->pellets[i]);
+	}
+	return finish_message(message, SPECTATE_KEYFRAME, &writer);
+}
+
+static bool fits_s16(const Sint32 value) {
+	return value >= SDL_MIN_SINT16 && value <= SDL_MAX_SINT16;
+}
+
+// 0 when a delta can't express the change and a keyframe must be sent
+static int encode_delta(const SpectateFrame *last, const SpectateFrame *frame, Uint8 *message) {
+	Uint32 ticks = frame->tick - last->tick;
+	Sint32 score = frame->score - last->score;
+	Sint32 new_life_pts = frame->new_life_pts - last->new_life_pts;
+	if (ticks == 0 || ticks > 255 || !fits_s16(score) || !fits_s16(new_life_pts))
+		return 0;
+
+	int eaten = 0;
+	for (int i = 0; i < SPECTATE_PELLET_WORDS; i++) {
+		// Pellets only come back with a new level, which deserves a keyframe anyway
+		if (frame->pellets[i] & ~last->pellets[i])
+			return 0;
+		for (Uint32 bits = last->pellets[i] & ~frame->pellets[i]; bits != 0; bits &= bits - 1) {
+			eaten++;
+		}
+	}
+	if (eaten > 255)
+		return 0;
+
+	Uint16 mask = 0;
+	mask |= frame->state != last->state ? DELTA_STATE : 0;
+	mask |= score != 0 || new_life_pts != 0 ? DELTA_SCORE : 0;
+	mask |= frame->lives != last->lives ? DELTA_LIVES : 0;
+	mask |= frame->level != last->level ? DELTA_LEVEL : 0;
+	mask |= frame->is_blinking != last->is_blinking ? DELTA_BLINK : 0;
+	for (int i = 0; i < ENTITY_COUNT; i++) {
+		const SpectateEntity *before = get_const_entity(last, i);
+		const SpectateEntity *after = get_const_entity(frame, i);
+		if (after->x != before->x || after->y != before->y)
+			mask |= DELTA_MOVE << i;
+		if (pack_pose(after) != pack_pose(before))
+			mask |= DELTA_POSE << i;
+	}
+	mask |= eaten > 0 ? DELTA_PELLETS : 0;
+
+	Writer writer = { message + HEADER_SIZE };
+	put_u8(&writer, (Uint8)ticks);
+	put_u16(&writer, mask);
+	if (mask & DELTA_STATE)
+		put_u8(&writer, frame->state);
+	if (mask & DELTA_SCORE) {
+		put_u16(&writer, (Uint16)score);
+		put_u16(&writer, (Uint16)new_life_pts);
+	}
+	if (mask & DELTA_LIVES)
+		put_u8(&writer, frame->lives);
+	if (mask & DELTA_LEVEL)
+		put_u16(&writer, frame->level);
+	if (mask & DELTA_BLINK)
+		put_u8(&writer, frame->is_blinking);
+	for (int i = 0; i < ENTITY_COUNT; i++) {
+		if (!(mask & DELTA_MOVE << i))
+			continue;
+		const SpectateEntity *before = get_const_entity(last, i);
+		const SpectateEntity *after = get_const_entity(frame, i);
+		int dx = after->x - before->x;
+		int dy = after->y - before->y;
+		// Through the side tunnels and back into the house as eyes
+		if (dx <= MOVE_ABSOLUTE || dx > 127 || dy <= MOVE_ABSOLUTE || dy > 127) {
+			put_u8(&writer, (Uint8)MOVE_ABSOLUTE);
+			put_u16(&writer, (Uint16)after->x);
+			put_u16(&writer, (Uint16)after->y);
+		} else {
+			put_u8(&writer, (Uint8)dx);
+			put_u8(&writer, (Uint8)dy);
+		}
+	}
+	for (int i = 0; i < ENTITY_COUNT; i++) {
+		if (mask & DELTA_POSE << i)
+			put_u8(&writer, pack_pose(get_const_entity(frame, i)));
+	}
+	if (mask & DELTA_PELLETS) {
+		put_u8(&writer, (Uint8)eaten);
+		for (int i = 0; i < SPECTATE_PELLET_WORDS; i++) {
+			for (Uint32 bits = last->pellets[i] & ~frame->pellets[i]; bits != 0; bits &= bits - 1) {
+				put_u16(&writer, (Uint16)(i * 32 + SDL_MostSignificantBitIndex32(bits & (~bits + 1))));
+			}
+		}
+	}
+	return finish_message(message, SPECTATE_DELTA, &writer);
+}
+
+static void decode_keyframe(Reader *reader, SpectateFrame *frame) {
+	frame->tick = get_u32(reader);
+	frame->state = get_u8(reader);
+	frame->lives = get_u8(reader);
+	frame->is_blinking = get_u8(reader);
+	frame->level = get_u16(reader);
+	frame->score = (Sint32)get_u32(reader);
+	frame->new_life_pts = (Sint32)get_u32(reader);
+	for (int i = 0; i < ENTITY_COUNT; i++) {
+		SpectateEntity *entity = get_entity(frame, i);
+		entity->x = (Sint16)get_u16(reader);
+		entity->y = (Sint16)get_u16(reader);
+		unpack_pose(entity, get_u8(reader));
+	}
+	for (int i = 0; i < SPECTATE_PELLET_WORDS; i++) {
+		frame->pellets[i] = get_u32(reader);
+	}
+}
+
+static void decode_delta(Reader *reader, SpectateFrame *frame) {
+	frame->tick += get_u8(reader);
+	Uint16 mask = get_u16(reader);
+	if (mask & DELTA_STATE)
+		frame->state = get_u8(reader);
+	if (mask & DELTA_SCORE) {
+		frame->score += (Sint16)get_u16(reader);
+		frame->new_life_pts += (Sint16)get_u16(reader);
+	}
+	if (mask & DELTA_LIVES)
+		frame->lives = get_u8(reader);
+	if (mask & DELTA_LEVEL)
+		frame->level = get_u16(reader);
+	if (mask & DELTA_BLINK)
+		frame->is_blinking = get_u8(reader);
+	for (int i = 0; i < ENTITY_COUNT; i++) {
+		if (!(mask & DELTA_MOVE << i))
+			continue;
+		SpectateEntity *entity = get_entity(frame, i);
+		Sint8 dx = (Sint8)get_u8(reader);
+		if (dx == MOVE_ABSOLUTE) {
+			entity->x = (Sint16)get_u16(reader);
+			entity->y = (Sint16)get_u16(reader);
+		} else {
+			entity->x += dx;
+			entity->y += (Sint8)get_u8(reader);
+		}
+	}
+	for (int i = 0; i < ENTITY_COUNT; i++) {
+		if (mask & DELTA_POSE << i)
+			unpack_pose(get_entity(frame, i), get_u8(reader));
+	}
+	if (mask & DELTA_PELLETS) {
+		int eaten = get_u8(reader);
+		for (int i = 0; i < eaten; i++) {
+			Uint16 tile = get_u16(reader);
+			if (tile < SPECTATE_PELLET_WORDS * 32)
+				frame->pellets[tile / 32] &= ~(1u << (tile % 32));
+			else
+				reader->is_valid = false;
+		}
+	}
+}
+
+/*
+ * SERVER
+ */
+
+typedef struct Viewer {
+	NetStream *stream;
+	Uint8 *backlog; // client_buffer bytes not sent yet
+	int length;
+	bool is_waiting; // Joined too far from the last keyframe, sent nothing until the next one
+} Viewer;
+
+struct SpectateServer {
+	NetListener *listener;
+	int client_buffer;
+	SDL_Thread *thread;
+	SDL_sem *pushed;
+	SDL_atomic_t is_running;
+
+	// Single producer, single consumer ring from the simulation thread
+	SpectateFrame queue[SPECTATE_QUEUE_SIZE];
+	SDL_atomic_t head;
+	SDL_atomic_t tail;
+	SDL_atomic_t frames_dropped;
+
+	// Broadcast thread only
+	SpectateFrame last;
+	bool has_last;
+	Uint32 keyframe_tick;
+	Uint8 *catch_up; // The last keyframe and every delta since, what a newcomer is sent first
+	int catch_up_length;
+	int catch_up_capacity;
+	Viewer *viewers;
+	int viewer_count;
+	int viewer_capacity;
+
+	SDL_SpinLock lock;
+	SpectateStats stats;
+};
+
+static void remove_viewer(SpectateServer *this, const int index) {
+	Viewer *viewer = &this->viewers[index];
+	net_stream_close(viewer->stream);
+	free(viewer->backlog);
+	this->viewers[index] = this->viewers[--this->viewer_count];
+}
+
+static void accept_viewers(SpectateServer *this) {
+	NetStream *stream;
+	while ((stream = net_accept(this->listener)) != NULL) {
+		if (this->viewer_count == this->viewer_capacity) {
+			this->viewer_capacity = SDL_max(this->viewer_capacity * 2, 16);
+			this->viewers = realloc(this->viewers, this->viewer_capacity * sizeof(Viewer));
+		}
+		Viewer *viewer = &this->viewers[this->viewer_count++];
+		viewer->stream = stream;
+		viewer->backlog = malloc(this->client_buffer);
+		// Too far from the last keyframe, it picks up at the next one. A delta before it would mean nothing
+		viewer->is_waiting = this->catch_up_length > this->client_buffer;
+		viewer->length = viewer->is_waiting ? 0 : this->catch_up_length;
+		SDL_memcpy(viewer->backlog, this->catch_up, viewer->length);
+
+		SDL_AtomicLock(&this->lock);
+		this->stats.peak_viewers = SDL_max(this->stats.peak_viewers, this->viewer_count);
+		SDL_AtomicUnlock(&this->lock);
+	}
+}
+
+static void broadcast_frame(SpectateServer *this, const SpectateFrame *frame) {
+	Uint8 message[SPECTATE_MAX_MESSAGE];
+	bool is_keyframe = !this->has_last || frame->tick - this->keyframe_tick >= SPECTATE_KEYFRAME_TICKS;
+	int length = is_keyframe ? 0 : encode_delta(&this->last, frame, message);
+	if (length == 0) {
+		length = encode_keyframe(frame, message);
+		is_keyframe = true;
+		this->keyframe_tick = frame->tick;
+		this->catch_up_length = 0;
+	}
+	this->last = *frame;
+	this->has_last = true;
+
+	if (this->catch_up_length + length > this->catch_up_capacity) {
+		this->catch_up_capacity = SDL_max(this->catch_up_capacity * 2, this->catch_up_length + length);
+		this->catch_up = realloc(this->catch_up, this->catch_up_capacity);
+	}
+	SDL_memcpy(this->catch_up + this->catch_up_length, message, length);
+	this->catch_up_length += length;
+
+	int dropped = 0;
+	for (int i = this->viewer_count - 1; i >= 0; i--) {
+		Viewer *viewer = &this->viewers[i];
+		if (viewer->is_waiting && !is_keyframe)
+			continue;
+		viewer->is_waiting = false;
+		if (viewer->length + length > this->client_buffer) {
+			remove_viewer(this, i);
+			dropped++;
+			continue;
+		}
+		SDL_memcpy(viewer->backlog + viewer->length, message, length);
+		viewer->length += length;
+	}
+
+	SDL_AtomicLock(&this->lock);
+	this->stats.frames++;
+	if (is_keyframe) {
+		this->stats.keyframes++;
+		this->stats.keyframe_bytes += length;
+	} else {
+		this->stats.delta_bytes += length;
+	}
+	this->stats.viewers_dropped += dropped;
+	SDL_AtomicUnlock(&this->lock);
+}
+
+static void flush_viewers(SpectateServer *this) {
+	Uint64 sent = 0;
+	for (int i = this->viewer_count - 1; i >= 0; i--) {
+		Viewer *viewer = &this->viewers[i];
+		if (viewer->length == 0)
+			continue;
+		int length = net_stream_send(viewer->stream, viewer->backlog, viewer->length);
+		if (length < 0) {
+			remove_viewer(this, i);
+			continue;
+		}
+		SDL_memmove(viewer->backlog, viewer->backlog + length, viewer->length - length);
+		viewer->length -= length;
+		sent += length;
+	}
+
+	SDL_AtomicLock(&this->lock);
+	this->stats.bytes_sent += sent;
+	this->stats.viewers = this->viewer_count;
+	SDL_AtomicUnlock(&this->lock);
+}
+
+static int broadcast(void *data) {
+	SpectateServer *this = data;
+	while (SDL_AtomicGet(&this->is_running)) {
+		SDL_SemWaitTimeout(this->pushed, BROADCAST_POLL_MS);
+		Uint64 start = SDL_GetPerformanceCounter();
+
+		accept_viewers(this);
+		int head = SDL_AtomicGet(&this->head);
+		int tail = SDL_AtomicGet(&this->tail);
+		for (; tail != head; tail++) {
+			broadcast_frame(this, &this->queue[tail & (SPECTATE_QUEUE_SIZE - 1)]);
+			SDL_AtomicSet(&this->tail, tail + 1);
+		}
+		flush_viewers(this);
+
+		double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+		SDL_AtomicLock(&this->lock);
+		this->stats.broadcast_ms += ms;
+		SDL_AtomicUnlock(&this->lock);
+	}
+	return 0;
+}
+
+SpectateServer *spectate_server_create(const Uint16 port, const int client_buffer) {
+	NetListener *listener = net_listen(port);
+	if (listener == NULL)
+		return NULL;
+
+	SpectateServer *this = calloc(1, sizeof(SpectateServer));
+	this->listener = listener;
+	this->client_buffer = client_buffer;
+	this->pushed = SDL_CreateSemaphore(0);
+	SDL_AtomicSet(&this->is_running, true);
+	this->thread = SDL_CreateThread(broadcast, "spectate", this);
+	return this;
+}
+
+void spectate_server_destroy(SpectateServer *this) {
+	SDL_AtomicSet(&this->is_running, false);
+	SDL_SemPost(this->pushed);
+	SDL_WaitThread(this->thread, NULL);
+	SDL_DestroySemaphore(this->pushed);
+
+	while (this->viewer_count > 0) {
+		remove_viewer(this, this->viewer_count - 1);
+	}
+	net_listener_close(this->listener);
+	free(this->viewers);
+	free(this->catch_up);
+	free(this);
+}
+
+void spectate_server_push(SpectateServer *this, Game *game) {
+	int head = SDL_AtomicGet(&this->head);
+	if (head - SDL_AtomicGet(&this->tail) >= SPECTATE_QUEUE_SIZE) {
+		// The next delta spans the gap
+		SDL_AtomicAdd(&this->frames_dropped, 1);
+		return;
+	}
+	game_get_spectate_frame(game, &this->queue[head & (SPECTATE_QUEUE_SIZE - 1)]);
+	SDL_AtomicSet(&this->head, head + 1);
+	SDL_SemPost(this->pushed);
+}
+
+SpectateStats spectate_server_get_stats(SpectateServer *this) {
+	SDL_AtomicLock(&this->lock);
+	SpectateStats stats = this->stats;
+	SDL_AtomicUnlock(&this->lock);
+	stats.frames_dropped = SDL_AtomicGet(&this->frames_dropped);
+	return stats;
+}
+
+void spectate_log_stats(const SpectateStats *stats) {
+	if (stats->frames == 0)
+		return;
+	int deltas = stats->frames - stats->keyframes;
+	SDL_Log("Spectators: %d frames, %d keyframes of %.0f bytes, deltas of %.1f bytes, %llu bytes sent, at most %d watching, %d dropped as too slow, "
+			"%d frames dropped, %.3fms broadcasting per frame",
+			stats->frames, stats->keyframes, stats->keyframes > 0 ? (double)stats->keyframe_bytes / stats->keyframes : 0.0,
+			deltas > 0 ? (double)stats->delta_bytes / deltas : 0.0, (unsigned long long)stats->bytes_sent, stats->peak_viewers,
+			stats->viewers_dropped, stats->frames_dropped, stats->broadcast_ms / stats->frames);
+}
+
+/*
+ * CLIENT
+ */
+
+struct SpectateClient {
+	NetStream *stream;
+	bool is_connected;
+	bool has_keyframe;
+	SpectateFrame frame;
+	Uint64 bytes;
+	Uint8 buffer[CLIENT_READ_BUFFER];
+	int length;
+};
+
+SpectateClient *spectate_connect(const Uint16 port) {
+	NetStream *stream = net_connect(port);
+	if (stream == NULL)
+		return NULL;
+	SpectateClient *this = calloc(1, sizeof(SpectateClient));
+	this->stream = stream;
+	this->is_connected = true;
+	return this;
+}
+
+void spectate_client_close(SpectateClient *this) {
+	net_stream_close(this->stream);
+	free(this);
+}
+
+// False on a malformed message
+static bool decode_message(SpectateClient *this, const SpectateMessage type, const Uint8 *payload, const int length) {
+	Reader reader = { payload, payload + length, true };
+	if (type == SPECTATE_KEYFRAME) {
+		decode_keyframe(&reader, &this->frame);
+		this->has_keyframe = reader.is_valid;
+	} else if (type == SPECTATE_DELTA) {
+		// Against a frame not seen yet, skipped until a keyframe comes
+		if (!this->has_keyframe)
+			return true;
+		decode_delta(&reader, &this->frame);
+	} else {
+		return false;
+	}
+	return reader.is_valid && reader.at == reader.end;
+}
+
+bool spectate_client_poll(SpectateClient *this, SpectateFrame *frame) {
+	bool is_updated = false;
+	while (this->is_connected) {
+		int received = net_stream_receive(this->stream, this->buffer + this->length, CLIENT_READ_BUFFER - this->length);
+		if (received <= 0) {
+			this->is_connected = received == 0;
+			break;
+		}
+		this->length += received;
+		this->bytes += received;
+
+		int offset = 0;
+		while (this->length - offset >= HEADER_SIZE) {
+			const Uint8 *header = this->buffer + offset;
+			int payload_length = header[0] | header[1] << 8;
+			if (HEADER_SIZE + payload_length > SPECTATE_MAX_MESSAGE) {
+				this->is_connected = false;
+				break;
+			}
+			if (this->length - offset < HEADER_SIZE + payload_length)
+				break;
+			if (!decode_message(this, header[2], header + HEADER_SIZE, payload_length)) {
+				this->is_connected = false;
+				break;
+			}
+			is_updated |= this->has_keyframe;
+			offset += HEADER_SIZE + payload_length;
+		}
+		SDL_memmove(this->buffer, this->buffer + offset, this->length - offset);
+		this->length -= offset;
+	}
+	if (is_updated)
+		*frame = this->frame;
+	return is_updated;
+}
+
+bool spectate_client_is_connected(const SpectateClient *this) {
+	return this->is_connected;
+}
+
+Uint64 spectate_client_get_bytes(const SpectateClient *this) {
+	return this->bytes;
+}
+
+int spectate_run(SDL_Renderer *renderer, const Uint16 port) {
+	SpectateClient *client = spectate_connect(port);
+	if (client == NULL) {
+		SDL_Log("No game broadcasts on port %d", port);
+		return 1;
+	}
+
+	Game *game = game_create(renderer, NULL);
+	SpectateFrame frame;
+	bool is_running = true;
+	while (is_running && spectate_client_is_connected(client)) {
+		SDL_Event e;
+		while (SDL_PollEvent(&e)) {
+			if (e.type == SDL_QUIT)
+				is_running = false;
+		}
+		if (spectate_client_poll(client, &frame)) {
+			game_apply_spectate_frame(game, &frame);
+			game_draw(game, renderer);
+		} else {
+			SDL_Delay(1);
+		}
+	}
+	if (is_running)
+		SDL_Log("The game stopped broadcasting");
+	SDL_Log("%llu bytes received", (unsigned long long)spectate_client_get_bytes(client));
+
+	game_destroy(game);
+	spectate_client_close(client);
+	return 0;
+}
+
+/*
+ * BENCH
+ */
+
+#define BENCH_CONNECT_MS 5000
+#define BENCH_DRAIN_MS 2000
+#define BENCH_LATE_BUFFER 1024 // Less than the catch-up BENCH_LATE_JOIN ticks after a keyframe
+#define BENCH_LATE_JOIN (SPECTATE_KEYFRAME_TICKS * 3 / 4)
+
+typedef struct BenchViewers {
+	SpectateClient **clients;
+	SpectateFrame *frames;
+	int count;
+	SDL_atomic_t is_running;
+} BenchViewers;
+
+void spectate_bench_default_options(SpectateBenchOptions *options) {
+	SDL_zero(*options);
+	options->port = SPECTATE_DEFAULT_PORT;
+	options->ticks = SPECTATE_DEFAULT_BENCH_TICKS;
+	options->max_viewers = SPECTATE_DEFAULT_MAX_VIEWERS;
+	options->seed = 1;
+}
+
+static bool same_frame(const SpectateFrame *a, const SpectateFrame *b) {
+	if (a->tick != b->tick || a->state != b->state || a->lives != b->lives || a->is_blinking != b->is_blinking ||
+			a->level != b->level || a->score != b->score || a->new_life_pts != b->new_life_pts)
+		return false;
+	for (int i = 0; i < ENTITY_COUNT; i++) {
+		const SpectateEntity *x = get_const_entity(a, i);
+		const SpectateEntity *y = get_const_entity(b, i);
+		if (x->x != y->x || x->y != y->y || pack_pose(x) != pack_pose(y))
+			return false;
+	}
+	return SDL_memcmp(a->pellets, b->pellets, sizeof(a->pellets)) == 0;
+}
+
+// From the first tick the player steers
+static Game *create_bench_game(Bot *bot, const Uint32 seed) {
+	Game *game = game_create(NULL, NULL);
+	bot_init(bot, seed, 0.05f);
+	while (!game_is_in_play(game)) {
+		if (game_fast_forward(game, TICK_TIME, SDL_MAX_SINT32) == 0)
+			game_update(game, TICK_TIME);
+	}
+	return game;
+}
+
+// Waits for the broadcast thread to go through every tick pushed
+static void drain_server(SpectateServer *server, const int ticks) {
+	Uint64 deadline = SDL_GetTicks64() + BENCH_DRAIN_MS;
+	while (SDL_GetTicks64() < deadline && spectate_server_get_stats(server).frames + spectate_server_get_stats(server).frames_dropped < ticks) {
+		SDL_Delay(10);
+	}
+	SDL_Delay(100);
+}
+
+// Stands in for the viewer processes, polling every socket in turn
+static int read_viewers(void *data) {
+	BenchViewers *this = data;
+	while (SDL_AtomicGet(&this->is_running)) {
+		for (int i = 0; i < this->count; i++) {
+			spectate_client_poll(this->clients[i], &this->frames[i]);
+		}
+		SDL_Delay(1);
+	}
+	return 0;
+}
+
+static bool bench_viewers(const SpectateBenchOptions *options, const int count) {
+	SpectateServer *server = spectate_server_create(options->port, SPECTATE_CLIENT_BUFFER);
+	if (server == NULL) {
+		printf("Unable to listen on port %d\n", options->port);
+		return false;
+	}
+
+	BenchViewers viewers;
+	SDL_zero(viewers);
+	viewers.clients = malloc(count * sizeof(SpectateClient *));
+	viewers.frames = calloc(count, sizeof(SpectateFrame));
+	for (; viewers.count < count; viewers.count++) {
+		viewers.clients[viewers.count] = spectate_connect(options->port);
+		if (viewers.clients[viewers.count] == NULL)
+			break;
+	}
+	Uint64 deadline = SDL_GetTicks64() + BENCH_CONNECT_MS;
+	while (spectate_server_get_stats(server).peak_viewers < viewers.count && SDL_GetTicks64() < deadline) {
+		SDL_Delay(1);
+	}
+	SDL_AtomicSet(&viewers.is_running, true);
+	SDL_Thread *reader = SDL_CreateThread(read_viewers, "viewers", &viewers);
+
+	Bot bot;
+	Game *game = create_bench_game(&bot, options->seed);
+
+	Uint64 push_ticks = 0;
+	for (int tick = 0; tick < options->ticks; tick++) {
+		bot_update(&bot, game);
+		game_update(game, TICK_TIME);
+		Uint64 start = SDL_GetPerformanceCounter();
+		spectate_server_push(server, game);
+		push_ticks += SDL_GetPerformanceCounter() - start;
+		// Faster than real time, but the broadcast and viewer threads get their turn
+		SDL_Delay(1);
+	}
+	SpectateFrame expected;
+	game_get_spectate_frame(game, &expected);
+	game_destroy(game);
+
+	// Everything sent and read
+	drain_server(server, options->ticks);
+	SDL_AtomicSet(&viewers.is_running, false);
+	SDL_WaitThread(reader, NULL);
+	SpectateStats stats = spectate_server_get_stats(server);
+
+	int synced = 0;
+	for (int i = 0; i < viewers.count; i++) {
+		spectate_client_poll(viewers.clients[i], &viewers.frames[i]);
+		synced += same_frame(&viewers.frames[i], &expected);
+		spectate_client_close(viewers.clients[i]);
+	}
+	spectate_server_destroy(server);
+	free(viewers.frames);
+	free(viewers.clients);
+
+	double frequency = (double)SDL_GetPerformanceFrequency();
+	int deltas = stats.frames - stats.keyframes;
+	double bytes_per_tick = stats.frames > 0 ? (double)(stats.keyframe_bytes + stats.delta_bytes) / stats.frames : 0.0;
+	double broadcast_us = stats.frames > 0 ? stats.broadcast_ms * 1000.0 / stats.frames : 0.0;
+	printf("%8d %10.1f %10.1f %10.1f %10.2f %12.2f %12.3f %8d %8d %6d/%d\n", count, bytes_per_tick,
+			stats.keyframes > 0 ? (double)stats.keyframe_bytes / stats.keyframes : 0.0, deltas > 0 ? (double)stats.delta_bytes / deltas : 0.0,
+			push_ticks * 1e6 / frequency / options->ticks, broadcast_us, broadcast_us / SDL_max(count, 1), stats.frames_dropped,
+			stats.viewers_dropped, synced, count);
+	return viewers.count == count && synced == count;
+}
+
+// One viewer joining with a backlog too small for the catch-up, which has to wait for the next keyframe
+static bool bench_late_viewer(const SpectateBenchOptions *options) {
+	SpectateServer *server = spectate_server_create(options->port, BENCH_LATE_BUFFER);
+	if (server == NULL) {
+		printf("Unable to listen on port %d\n", options->port);
+		return false;
+	}
+
+	Bot bot;
+	Game *game = create_bench_game(&bot, options->seed);
+	SpectateClient *client = NULL;
+	SpectateFrame frame;
+	SDL_zero(frame);
+	int ticks = SDL_max(options->ticks, BENCH_LATE_JOIN + SPECTATE_KEYFRAME_TICKS);
+	for (int tick = 0; tick < ticks; tick++) {
+		bot_update(&bot, game);
+		game_update(game, TICK_TIME);
+		spectate_server_push(server, game);
+		if (tick == BENCH_LATE_JOIN)
+			client = spectate_connect(options->port);
+		if (client != NULL)
+			spectate_client_poll(client, &frame);
+		SDL_Delay(1);
+	}
+	SpectateFrame expected;
+	game_get_spectate_frame(game, &expected);
+	game_destroy(game);
+
+	drain_server(server, ticks);
+	SpectateStats stats = spectate_server_get_stats(server);
+	bool is_synced = false;
+	if (client != NULL) {
+		spectate_client_poll(client, &frame);
+		is_synced = spectate_client_is_connected(client) && same_frame(&frame, &expected);
+		spectate_client_close(client);
+	}
+	spectate_server_destroy(server);
+
+	printf("Late viewer, %d byte backlog, joining %d ticks in: %s, %d dropped\n", BENCH_LATE_BUFFER, BENCH_LATE_JOIN,
+			is_synced ? "synced" : "not synced", stats.viewers_dropped);
+	return is_synced;
+}
+
+int spectate_bench_run(const SpectateBenchOptions *options) {
+	if (options->ticks <= 0 || options->max_viewers <= 0) {
+		printf("Nothing to broadcast\n");
+		return 1;
+	}
+	printf("%d ticks broadcast on port %d to 1 to %d in-process viewers, keyframe every %d ticks, seed %u\n", options->ticks,
+			options->port, options->max_viewers, SPECTATE_KEYFRAME_TICKS, options->seed);
+	printf("%8s %10s %10s %10s %10s %12s %12s %8s %8s %8s\n", "viewers", "bytes/tick", "keyframe", "delta", "push us",
+			"broadcast us", "us/viewer", "frames-", "viewers-", "synced");
+
+	int exit_code = 0;
+	for (int count = 1; count <= options->max_viewers; count *= 4) {
+		if (!bench_viewers(options, count))
+			exit_code = 1;
+		if (count < options->max_viewers && count * 4 > options->max_viewers && !bench_viewers(options, options->max_viewers))
+			exit_code = 1;
+	}
+	if (!bench_late_viewer(options))
+		exit_code = 1;
+	return exit_code;
+}
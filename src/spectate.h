@@ -0,0 +1,111 @@
+#ifndef SPECTATE_H
+#define SPECTATE_H
+
+#include "SDL2/SDL.h"
+
+#include "game.h"
+#include "net.h"
+#include "utils.h"
+
+/*
+ * Spectators: a running game broadcasts itself over loopback TCP to any number of viewer
+ * processes, which draw it with the game's own draw().
+ *
+ * After every tick the simulation thread copies what draw() needs into a SpectateFrame ring and
+ * goes on, positions quantised to a sixteenth of a tile, which is a pixel. A broadcast thread
+ * encodes each frame against the one before: a mask of what changed, moves as a signed byte per
+ * axis, the tile indices of the pellets eaten. A keyframe carrying everything goes out every
+ * SPECTATE_KEYFRAME_TICKS and whenever a delta can't say what changed, a new level refilling
+ * the maze for one. A newcomer is sent the last keyframe and every delta since, so it's in sync
+ * at once, or when that is more than its backlog holds, sent nothing until the next keyframe.
+ * Sends never block: each viewer has a client_buffer byte backlog, SPECTATE_CLIENT_BUFFER for the
+ * game, and one that lets it fill up is disconnected.
+ *
+ * Messages are a little endian u16 payload length, a u8 SpectateMessage, then the payload.
+ */
+
+#define SPECTATE_DEFAULT_PORT 7100
+#define SPECTATE_KEYFRAME_TICKS 300
+#define SPECTATE_QUEUE_SIZE 64 // Frames between the simulation and the broadcast thread, a power of two
+#define SPECTATE_CLIENT_BUFFER 65536
+#define SPECTATE_MAX_MESSAGE 1024
+#define SPECTATE_PELLET_WORDS ((MAP_SIZE + 31) / 32) // The shipped maze, the only one run() plays
+#define SPECTATE_DEFAULT_BENCH_TICKS 600
+#define SPECTATE_DEFAULT_MAX_VIEWERS 256
+
+enum SpectateMessage {
+	SPECTATE_KEYFRAME,
+	SPECTATE_DELTA
+} typedef SpectateMessage;
+
+typedef struct SpectateEntity {
+	Sint16 x; // Sixteenths of a tile
+	Sint16 y;
+	Uint8 direction; // The player's
+	Uint8 frame; // The player's animation frame
+	Uint8 state; // GhostState, for the player whether it's dead
+} SpectateEntity;
+
+typedef struct SpectateFrame {
+	Uint32 tick;
+	Uint8 state; // Named by game_state_name()
+	Uint8 lives;
+	Uint8 is_blinking;
+	Uint16 level;
+	Sint32 score;
+	Sint32 new_life_pts;
+	SpectateEntity player;
+	SpectateEntity ghosts[GHOST_AMT];
+	Uint32 pellets[SPECTATE_PELLET_WORDS];
+} SpectateFrame;
+
+typedef struct SpectateStats {
+	int frames; // Encoded and sent
+	int keyframes;
+	Uint64 keyframe_bytes;
+	Uint64 delta_bytes;
+	Uint64 bytes_sent; // To every viewer together
+	int viewers; // Connected now
+	int peak_viewers;
+	int viewers_dropped; // Too slow to keep up
+	int frames_dropped; // The broadcast thread was a whole queue behind
+	double broadcast_ms; // Time the broadcast thread spent working
+} SpectateStats;
+
+struct SpectateServer;
+typedef struct SpectateServer SpectateServer;
+struct SpectateClient;
+typedef struct SpectateClient SpectateClient;
+
+// Listens on port and starts the broadcast thread, NULL when the port is taken. Each viewer gets client_buffer bytes
+SpectateServer *spectate_server_create(const Uint16 port, const int client_buffer);
+void spectate_server_destroy(SpectateServer *server);
+// Simulation thread, after each tick. Never waits
+void spectate_server_push(SpectateServer *server, Game *game);
+SpectateStats spectate_server_get_stats(SpectateServer *server);
+void spectate_log_stats(const SpectateStats *stats);
+
+// NULL when no game broadcasts on port
+SpectateClient *spectate_connect(const Uint16 port);
+void spectate_client_close(SpectateClient *client);
+// Reads whatever arrived, true when it brought frame up to date. Nothing until the first keyframe
+bool spectate_client_poll(SpectateClient *client, SpectateFrame *frame);
+bool spectate_client_is_connected(const SpectateClient *client);
+// Payload bytes received so far
+Uint64 spectate_client_get_bytes(const SpectateClient *client);
+
+// A window drawing the game broadcast on port until it's closed or the game goes away
+int spectate_run(SDL_Renderer *renderer, const Uint16 port);
+
+typedef struct SpectateBenchOptions {
+	Uint16 port;
+	int ticks; // Per viewer count
+	int max_viewers; // Counts go 1, 4, 16... up to it
+	Uint32 seed;
+} SpectateBenchOptions;
+
+void spectate_bench_default_options(SpectateBenchOptions *options);
+// A headless bot game broadcast to in-process viewers, bytes per tick and broadcast time per viewer
+int spectate_bench_run(const SpectateBenchOptions *options);
+
+#endif
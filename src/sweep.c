@@ -0,0 +1,285 @@
+#include "sweep.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bot.h"
+#include "brain_host.h"
+#include "debug.h"
+
+static const char *param_names[SWEEP_PARAM_COUNT] = {
+	[SWEEP_PLAYER_SPEED] = "player_speed",
+	[SWEEP_GHOST_BASE_SPEED] = "ghost_base_speed",
+	[SWEEP_GHOST_SPEED_PER_LEVEL] = "ghost_speed_per_level",
+	[SWEEP_POWER_UP_TIME] = "power_up_time",
+	[SWEEP_GHOST_EXIT_SCALE] = "ghost_exit_scale",
+};
+
+typedef struct GameResult {
+	int ticks;
+	int skipped_ticks;
+	int score;
+	int level;
+	bool survived;
+	int deaths_by_ghost[GHOST_AMT];
+} GameResult;
+
+typedef struct SweepRun {
+	const SweepOptions *options;
+	GameConfig *configs;
+	int config_count;
+	GameResult *results; // config_count * games, each slot written by exactly one worker
+	SDL_atomic_t next_job;
+} SweepRun;
+
+void sweep_default_options(SweepOptions *options) {
+	SDL_zero(*options);
+	options->games = SWEEP_DEFAULT_GAMES;
+	options->threads = 0;
+	options->max_ticks = SWEEP_DEFAULT_MAX_TICKS;
+	options->seed = 1;
+	options->randomness = 0.05f;
+	options->fast_forward = true;
+	options->out_path = "sweep.csv";
+	options->brain_budget_us = BRAIN_DEFAULT_BUDGET_US;
+}
+
+bool sweep_parse(SweepOptions *options, const char *spec) {
+	options->param_count = 0;
+	while (*spec != '\0') {
+		if (options->param_count == SWEEP_MAX_PARAMS)
+			return false;
+
+		const char *equals = SDL_strchr(spec, '=');
+		if (equals == NULL)
+			return false;
+
+		SweepParam *param = &options->params[options->param_count];
+		param->id = SWEEP_PARAM_COUNT;
+		for (int i = 0; i < SWEEP_PARAM_COUNT; i++) {
+			if (SDL_strlen(param_names[i]) == (size_t)(equals - spec) && SDL_strncmp(spec, param_names[i], equals - spec) == 0)
+				param->id = i;
+		}
+		if (param->id == SWEEP_PARAM_COUNT)
+			return false;
+
+		char *end = NULL;
+		param->start = (float)SDL_strtod(equals + 1, &end);
+		param->end = param->start;
+		param->step = 1.0f;
+		if (*end == ':') {
+			param->end = (float)SDL_strtod(end + 1, &end);
+			if (*end == ':')
+				param->step = (float)SDL_strtod(end + 1, &end);
+		}
+		if (param->step <= 0.0f || param->end < param->start)
+			return false;
+
+		options->param_count++;
+		if (*end == ',')
+			end++;
+		else if (*end != '\0')
+			return false;
+		spec = end;
+	}
+	return true;
+}
+
+static int param_steps(const SweepParam *param) {
+	// The small epsilon keeps the end inclusive despite float steps
+	return (int)((param->end - param->start) / param->step + 1e-4f) + 1;
+}
+
+static float param_value(const SweepOptions *options, int config_index, int param_index) {
+	for (int i = options->param_count - 1; i > param_index; i--) {
+		config_index /= param_steps(&options->params[i]);
+	}
+	const SweepParam *param = &options->params[param_index];
+	return param->start + (config_index % param_steps(param)) * param->step;
+}
+
+static void build_config(const SweepOptions *options, int config_index, GameConfig *config) {
+	game_default_config(config);
+	for (int i = 0; i < options->param_count; i++) {
+		float value = param_value(options, config_index, i);
+		switch (options->params[i].id) {
+			case SWEEP_PLAYER_SPEED:
+				config->player_speed = value;
+				break;
+			case SWEEP_GHOST_BASE_SPEED:
+				config->ghost_base_speed = value;
+				break;
+			case SWEEP_GHOST_SPEED_PER_LEVEL:
+				config->ghost_speed_per_level = value;
+				break;
+			case SWEEP_POWER_UP_TIME:
+				config->power_up_time = (int)value;
+				break;
+			case SWEEP_GHOST_EXIT_SCALE:
+				for (int g = 0; g < GHOST_AMT; g++) {
+					config->ghost_exit_times[g] = (int)(config->ghost_exit_times[g] * value);
+				}
+				break;
+			case SWEEP_PARAM_COUNT:
+				// Not a parameter, sweep_parse() rejects unknown names
+				break;
+		}
+	}
+}
+
+static Uint32 job_seed(Uint32 seed, int job) {
+	// Spread consecutive jobs over the whole seed space
+	Uint32 x = seed ^ ((Uint32)job * 0x9E3779B9);
+	x ^= x >> 16;
+	x *= 0x85EBCA6B;
+	x ^= x >> 13;
+	return x;
+}
+
+static void play(const SweepOptions *options, const GameConfig *config, Uint32 seed, GameResult *result) {
+	Game *game = game_create(NULL, config);
+	for (int i = 0; i < GHOST_AMT; i++) {
+		if (options->brains[i] != NULL)
+			game_set_ghost_brain(game, i, options->brains[i], options->brain_budget_us);
+	}
+	Bot bot;
+	bot_init(&bot, seed, options->randomness);
+
+	int ticks = 0;
+	int skipped_ticks = 0;
+	while (!game_is_over(game) && ticks < options->max_ticks) {
+		if (options->fast_forward) {
+			int skipped = game_fast_forward(game, TICK_TIME, options->max_ticks - ticks);
+			ticks += skipped;
+			skipped_ticks += skipped;
+			if (ticks >= options->max_ticks)
+				break;
+		}
+		bot_update(&bot, game);
+		game_update(game, TICK_TIME);
+		ticks++;
+	}
+
+	GameStats stats = game_get_stats(game);
+	result->ticks = stats.ticks;
+	result->skipped_ticks = skipped_ticks;
+	result->score = stats.score;
+	result->level = stats.level;
+	result->survived = !game_is_over(game);
+	for (int i = 0; i < GHOST_AMT; i++) {
+		result->deaths_by_ghost[i] = stats.deaths_by_ghost[i];
+	}
+	game_destroy(game);
+}
+
+static int worker(void *data) {
+	SweepRun *run = data;
+	int job_count = run->config_count * run->options->games;
+	for (;;) {
+		int job = SDL_AtomicAdd(&run->next_job, 1);
+		if (job >= job_count)
+			break;
+		play(run->options, &run->configs[job / run->options->games], job_seed(run->options->seed, job), &run->results[job]);
+	}
+	return 0;
+}
+
+static void write_csv(FILE *file, const SweepRun *run) {
+	const SweepOptions *options = run->options;
+	for (int i = 0; i < options->param_count; i++) {
+		fprintf(file, "%s,", param_names[options->params[i].id]);
+	}
+	fprintf(file, "games,mean_survival_s,min_survival_s,max_survival_s,mean_score,mean_level,max_level,survivors");
+	for (int g = 0; g < GHOST_AMT; g++) {
+		fprintf(file, ",deaths_ghost_%d", g);
+	}
+	fprintf(file, "\n");
+
+	for (int c = 0; c < run->config_count; c++) {
+		const GameResult *results = &run->results[c * options->games];
+		double ticks = 0, score = 0, level = 0;
+		int min_ticks = results[0].ticks, max_ticks = results[0].ticks, max_level = 0, survivors = 0;
+		long long deaths[GHOST_AMT] = { 0 };
+		for (int i = 0; i < options->games; i++) {
+			const GameResult *r = &results[i];
+			ticks += r->ticks;
+			score += r->score;
+			level += r->level;
+			min_ticks = SDL_min(min_ticks, r->ticks);
+			max_ticks = SDL_max(max_ticks, r->ticks);
+			max_level = SDL_max(max_level, r->level);
+			survivors += r->survived;
+			for (int g = 0; g < GHOST_AMT; g++) {
+				deaths[g] += r->deaths_by_ghost[g];
+			}
+		}
+
+		for (int i = 0; i < options->param_count; i++) {
+			fprintf(file, "%g,", param_value(options, c, i));
+		}
+		double to_s = TICK_TIME / 1000.0;
+		fprintf(file, "%d,%.2f,%.2f,%.2f,%.1f,%.3f,%d,%d", options->games, ticks / options->games * to_s, min_ticks * to_s,
+				max_ticks * to_s, score / options->games, level / options->games, max_level, survivors);
+		for (int g = 0; g < GHOST_AMT; g++) {
+			fprintf(file, ",%lld", deaths[g]);
+		}
+		fprintf(file, "\n");
+	}
+}
+
+int sweep_run(const SweepOptions *options) {
+	SweepRun run;
+	SDL_zero(run);
+	run.options = options;
+	run.config_count = 1;
+	for (int i = 0; i < options->param_count; i++) {
+		run.config_count *= param_steps(&options->params[i]);
+	}
+	if (options->games <= 0) {
+		printf("Nothing to play\n");
+		return 1;
+	}
+
+	run.configs = malloc(run.config_count * sizeof(GameConfig));
+	for (int c = 0; c < run.config_count; c++) {
+		build_config(options, c, &run.configs[c]);
+	}
+	run.results = calloc((size_t)run.config_count * options->games, sizeof(GameResult));
+
+	int thread_count = options->threads > 0 ? options->threads : SDL_GetCPUCount();
+	SDL_Thread **threads = malloc(thread_count * sizeof(SDL_Thread *));
+	printf("Sweeping %d configuration(s) x %d games on %d thread(s)\n", run.config_count, options->games, thread_count);
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < thread_count; i++) {
+		threads[i] = SDL_CreateThread(worker, "sweep", &run);
+	}
+	for (int i = 0; i < thread_count; i++) {
+		SDL_WaitThread(threads[i], NULL);
+	}
+	double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+	long long total_ticks = 0, skipped_ticks = 0;
+	for (int i = 0; i < run.config_count * options->games; i++) {
+		total_ticks += run.results[i].ticks;
+		skipped_ticks += run.results[i].skipped_ticks;
+	}
+	printf("Simulated %lld ticks in %.2fs, %.0f ticks/s, %.1f%% fast forwarded\n", total_ticks, seconds, total_ticks / seconds,
+			total_ticks > 0 ? 100.0 * skipped_ticks / total_ticks : 0.0);
+
+	int exit_code = 0;
+	FILE *file = fopen(options->out_path, "w");
+	if (file != NULL) {
+		write_csv(file, &run);
+		fclose(file);
+		printf("Results written to %s\n", options->out_path);
+	} else {
+		printf("Unable to write %s\n", options->out_path);
+		exit_code = 1;
+	}
+
+	free(threads);
+	free(run.results);
+	free(run.configs);
+	return exit_code;
+}
@@ -0,0 +1,55 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "SDL2/SDL.h"
+
+#include "game.h"
+#include "utils.h"
+
+/*
+ * Balance sweeps: every combination of the swept GameConfig parameters plays a batch of
+ * headless games driven by the bot, spread over worker threads. One CSV row per configuration
+ * aggregates survival time, score, level reached and deaths per ghost.
+ */
+
+#define SWEEP_MAX_PARAMS 8
+#define SWEEP_DEFAULT_GAMES 1000
+#define SWEEP_DEFAULT_MAX_TICKS (60 * 60 * 30) // Half an hour of play
+
+enum SweepParamId {
+	SWEEP_PLAYER_SPEED,
+	SWEEP_GHOST_BASE_SPEED,
+	SWEEP_GHOST_SPEED_PER_LEVEL,
+	SWEEP_POWER_UP_TIME,
+	SWEEP_GHOST_EXIT_SCALE, // Multiplies the default ghost exit times
+	SWEEP_PARAM_COUNT
+} typedef SweepParamId;
+
+typedef struct SweepParam {
+	SweepParamId id;
+	float start;
+	float end;
+	float step;
+} SweepParam;
+
+typedef struct SweepOptions {
+	SweepParam params[SWEEP_MAX_PARAMS];
+	int param_count;
+	int games; // Per configuration
+	int threads; // 0 uses every core
+	int max_ticks; // Games still running are cut off and counted as survivors
+	Uint32 seed;
+	float randomness; // See Bot
+	bool fast_forward; // Skips over idle ticks, same results as stepping through them
+	const char *out_path;
+	struct BrainPlugin *brains[GHOST_AMT]; // NULL for the built-in brain. Plugins make results timing dependent
+	int brain_budget_us;
+} SweepOptions;
+
+void sweep_default_options(SweepOptions *options);
+// Parses "name=start:end:step,name=start:end:step", returns false on a malformed spec
+bool sweep_parse(SweepOptions *options, const char *spec);
+// Returns the process exit code
+int sweep_run(const SweepOptions *options);
+
+#endif
@@ -1,7 +1,5 @@
 #include "utils.h"
 
-#include <math.h>
-
 unsigned int SDL_Point_Distance(const SDL_Point *a, const SDL_Point *b) {
 	int x = a->x - b->x;
 	int y = a->y - b->y;
@@ -10,34 +8,23 @@ unsigned int SDL_Point_Distance(const SDL_Point *a, const SDL_Point *b) {
 	return ux + uy;
 }
 
-float SDL_2FPoint_Distance(const SDL_FPoint *a, const SDL_FPoint *b) {
-	float x = a->x - b->x;
-	float y = a->y - b->y;
-	float ux = x < 0 ? x * -1 : x;
-	float uy = y < 0 ? y * -1 : y;
-	return ux + uy;
-}
-
-float SDL_1FPoint_Distance(const SDL_Point *a, const SDL_FPoint *b) {
-	float x = a->x - b->x;
-	float y = a->y - b->y;
-	float ux = x < 0 ? x * -1 : x;
-	float uy = y < 0 ? y * -1 : y;
-	return ux + uy;
-}
-
-void SDL_FPoint_Normalize(SDL_FPoint *vec) {
-	float length = sqrt(vec->x * vec->x + vec->y * vec->y);
-	if (length == 0)
-		return;
-	vec->x /= length;
-	vec->y /= length;
+Fixed fixed_step(const Fixed speed, const int delta_time) {
+	return (Fixed)((Sint64)speed * delta_time / 1000);
 }
 
 bool SDL_Point_Equals(const SDL_Point *a, const SDL_Point *b) {
 	return (a->x == b->x && a->y == b->y);
 }
 
-bool SDL_FPoint_Equals(const SDL_FPoint *a, const SDL_FPoint *b) {
-	return abs(a->x - b->x) < 0.001f && abs(a->y - b->y) < 0.001f;
+Uint64 zobrist_key(const ZobristFeature feature, const int slot, const Sint32 value) {
+	// splitmix64 finalizer
+	Uint64 x = ((Uint64)feature << 56) ^ ((Uint64)(Uint8)slot << 48) ^ (Uint32)value;
+	x += 0x9E3779B97F4A7C15ull;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+Sint32 zobrist_tile(const int x, const int y) {
+	return (Sint32)(((Uint32)y << 16) | (Uint16)x);
 }
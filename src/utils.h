@@ -7,6 +7,12 @@
 #define false 0
 #define bool unsigned int
 
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
 #define CLAMP(min, x, max) (x > max) ? (max) : ((x < min) ? min : x)
 
 enum Direction {
@@ -17,12 +23,51 @@ enum Direction {
 	NONE
 } typedef Direction;
 
+/*
+ * 16.16 fixed point, one tile is FIXED_ONE. Simulation positions and speeds use it so every
+ * compiler, flag set and thread steps the game bit for bit the same. Floats only appear when
+ * converting configuration values at setup.
+ */
+typedef Sint32 Fixed;
+
+typedef struct FixedPoint {
+	Fixed x;
+	Fixed y;
+} FixedPoint;
+
+#define FIXED_SHIFT 16
+#define FIXED_ONE (1 << FIXED_SHIFT)
+#define FIXED_HALF (FIXED_ONE / 2)
+#define FIXED_FROM_INT(i) ((Fixed)(i) * FIXED_ONE)
+#define FIXED_FROM_FLOAT(f) ((Fixed)SDL_floor((double)(f) * FIXED_ONE + 0.5))
+// Truncates toward zero, like the float to int casts it replaces
+#define FIXED_TO_INT(f) ((f) / FIXED_ONE)
+// Nearest tile, for positions that can't go negative
+#define FIXED_ROUND(f) FIXED_FROM_INT(FIXED_TO_INT((f) + FIXED_HALF))
+
+// Distance covered in delta_time MS at a speed in fixed units per second
+Fixed fixed_step(const Fixed speed, const int delta_time);
+
+/*
+ * Zobrist hashing: every hashed feature of a state has a 64 bit key and the state hash is the
+ * XOR of the keys of the features present, so a change XORs one key out and another in.
+ * Keys are mixed from the feature, slot and value instead of drawn into a random table, every
+ * process and build agrees on them without sharing anything.
+ */
+enum ZobristFeature {
+	ZOBRIST_PELLET, // Value is the tile index
+	ZOBRIST_GAME_STATE,
+	ZOBRIST_ENTITY_TILE, // Slot 0 is the player, ghosts follow, value from zobrist_tile()
+	ZOBRIST_GHOST_STATE, // Slot is the ghost
+	ZOBRIST_COUNTER, // Slot tells apart the score, lives, level...
+} typedef ZobristFeature;
+
+Uint64 zobrist_key(const ZobristFeature feature, const int slot, const Sint32 value);
+// Tile coordinates as one value, positions in the side tunnels included
+Sint32 zobrist_tile(const int x, const int y);
+
 unsigned int SDL_Point_Distance(const SDL_Point *a, const SDL_Point *b);
-float SDL_2FPoint_Distance(const SDL_FPoint *a, const SDL_FPoint *b);
-float SDL_1FPoint_Distance(const SDL_Point *a, const SDL_FPoint *b);
 
 bool SDL_Point_Equals(const SDL_Point *a, const SDL_Point *b);
-bool SDL_FPoint_Equals(const SDL_FPoint *a, const SDL_FPoint *b);
-void SDL_FPoint_Normalize(SDL_FPoint *vec);
 
 #endif
@@ -0,0 +1,309 @@
+#include "vec_env.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bot.h"
+#include "debug.h"
+#include "ghost.h"
+#include "map.h"
+#include "player.h"
+
+#define ENVS_PER_CHUNK 16 // Games a thread claims at once
+
+struct VecEnv {
+	VecEnvOptions options;
+	Game **games;
+	int *scores; // When the current step started
+	Uint8 *walls; // Every game shares the maze, so the plane is built once
+	int width;
+	int height;
+
+	// The call being worked on
+	const Uint8 *actions;
+	float *rewards;
+	Uint8 *dones;
+	Uint8 *observations;
+	bool is_reset;
+	SDL_atomic_t next_chunk;
+
+	SDL_Thread **threads;
+	int thread_count; // Workers, the calling thread not included
+	SDL_sem *start;
+	SDL_sem *finished;
+	SDL_atomic_t is_quitting;
+};
+
+/*
+ * STEPPING
+ */
+
+static void mark_tile(const VecEnv *this, Uint8 *plane, const FixedPoint *pos) {
+	int x = FIXED_TO_INT(pos->x + FIXED_HALF);
+	int y = FIXED_TO_INT(pos->y + FIXED_HALF);
+	// Off the maze in the side tunnels
+	if (x >= 0 && x < this->width && y >= 0 && y < this->height)
+		plane[x + y * this->width] = 1;
+}
+
+static void observe(const VecEnv *this, Game *game, Uint8 *out) {
+	int size = this->width * this->height;
+	SDL_memcpy(out + VEC_ENV_WALLS * size, this->walls, size);
+	SDL_memset(out + VEC_ENV_PELLETS * size, 0, (VEC_ENV_PLANE_COUNT - VEC_ENV_PELLETS) * size);
+
+	map_mark_pellets(game_get_map(game), out + VEC_ENV_PELLETS * size, out + VEC_ENV_POWER_UPS * size);
+	mark_tile(this, out + VEC_ENV_PLAYER * size, player_get_pos(game_get_player(game)));
+	for (int i = 0; i < GHOST_AMT; i++) {
+		Ghost *ghost = game_get_ghost(game, i);
+		mark_tile(this, out + (VEC_ENV_GHOST + i) * size, ghost_get_pos(ghost));
+		if (ghost_get_state(ghost) == FLEEING)
+			mark_tile(this, out + VEC_ENV_FRIGHTENED * size, ghost_get_pos(ghost));
+	}
+}
+
+// Up to the next tick where the player steers, or the game over
+static void skip_idle(Game *game) {
+	while (!game_is_in_play(game) && !game_is_over(game)) {
+		if (game_fast_forward(game, TICK_TIME, SDL_MAX_SINT32) == 0)
+			game_update(game, TICK_TIME);
+	}
+}
+
+static void step_env(VecEnv *this, int index) {
+	Game *game = this->games[index];
+	if (this->is_reset) {
+		game_restart(game);
+	} else {
+		Direction action = this->actions[index] < NONE ? this->actions[index] : NONE;
+		for (int tick = 0; tick < this->options.ticks_per_step && !game_is_over(game); tick++) {
+			if (action != NONE)
+				game_set_player_direction(game, action);
+			game_update(game, TICK_TIME);
+		}
+		skip_idle(game);
+
+		bool is_done = game_is_over(game);
+		this->rewards[index] = (float)(game_get_stats(game).score - this->scores[index]);
+		this->dones[index] = is_done;
+		if (is_done)
+			game_restart(game);
+	}
+	skip_idle(game);
+	this->scores[index] = game_get_stats(game).score;
+
+	if (this->observations != NULL)
+		observe(this, game, this->observations + index * vec_env_get_observation_size(this));
+}
+
+static void run_chunks(VecEnv *this) {
+	int chunk_count = (this->options.envs + ENVS_PER_CHUNK - 1) / ENVS_PER_CHUNK;
+	for (;;) {
+		int chunk = SDL_AtomicAdd(&this->next_chunk, 1);
+		if (chunk >= chunk_count)
+			break;
+		int end = SDL_min((chunk + 1) * ENVS_PER_CHUNK, this->options.envs);
+		for (int i = chunk * ENVS_PER_CHUNK; i < end; i++) {
+			step_env(this, i);
+		}
+	}
+}
+
+static int worker(void *data) {
+	VecEnv *this = data;
+	// Millions of ticks, the profiler would only drown
+	PROFILE_PAUSE(true);
+	for (;;) {
+		SDL_SemWait(this->start);
+		if (SDL_AtomicGet(&this->is_quitting))
+			break;
+		run_chunks(this);
+		SDL_SemPost(this->finished);
+	}
+	return 0;
+}
+
+// Steps every game once, the calling thread takes chunks too
+static void dispatch(VecEnv *this) {
+	SDL_AtomicSet(&this->next_chunk, 0);
+	for (int i = 0; i < this->thread_count; i++) {
+		SDL_SemPost(this->start);
+	}
+
+	metrics_set_paused(true);
+	PROFILE_PAUSE(true);
+	run_chunks(this);
+	PROFILE_PAUSE(false);
+	metrics_set_paused(false);
+
+	// A worker only reports once it ran out of chunks, so every game is done after all have reported
+	for (int i = 0; i < this->thread_count; i++) {
+		SDL_SemWait(this->finished);
+	}
+}
+
+/*
+ * CORE
+ */
+
+void vec_env_default_options(VecEnvOptions *options) {
+	SDL_zero(*options);
+	options->envs = VEC_ENV_DEFAULT_ENVS;
+	options->threads = 0;
+	options->ticks_per_step = VEC_ENV_DEFAULT_TICKS_PER_STEP;
+	game_default_config(&options->config);
+}
+
+VecEnv *vec_env_create(const VecEnvOptions *options) {
+	if (options->envs <= 0 || options->ticks_per_step <= 0)
+		return NULL;
+
+	VecEnv *this = calloc(1, sizeof(VecEnv));
+	this->options = *options;
+	this->games = malloc(options->envs * sizeof(Game *));
+	this->scores = calloc(options->envs, sizeof(int));
+	for (int i = 0; i < options->envs; i++) {
+		this->games[i] = game_create(NULL, &options->config);
+	}
+
+	Map *map = game_get_map(this->games[0]);
+	this->width = map_get_width(map);
+	this->height = map_get_height(map);
+	this->walls = malloc(this->width * this->height);
+	for (int y = 0; y < this->height; y++) {
+		for (int x = 0; x < this->width; x++) {
+			this->walls[x + y * this->width] = map_get_collision(map, x, y, COLLISION_PLAYER);
+		}
+	}
+
+	int thread_count = options->threads > 0 ? options->threads : SDL_GetCPUCount();
+	int chunk_count = (options->envs + ENVS_PER_CHUNK - 1) / ENVS_PER_CHUNK;
+	this->thread_count = SDL_min(thread_count, chunk_count) - 1;
+	this->start = SDL_CreateSemaphore(0);
+	this->finished = SDL_CreateSemaphore(0);
+	this->threads = malloc(SDL_max(this->thread_count, 1) * sizeof(SDL_Thread *));
+	for (int i = 0; i < this->thread_count; i++) {
+		this->threads[i] = SDL_CreateThread(worker, "vec_env", this);
+	}
+	return this;
+}
+
+void vec_env_destroy(VecEnv *this) {
+	SDL_AtomicSet(&this->is_quitting, 1);
+	for (int i = 0; i < this->thread_count; i++) {
+		SDL_SemPost(this->start);
+	}
+	for (int i = 0; i < this->thread_count; i++) {
+		SDL_WaitThread(this->threads[i], NULL);
+	}
+	SDL_DestroySemaphore(this->start);
+	SDL_DestroySemaphore(this->finished);
+
+	for (int i = 0; i < this->options.envs; i++) {
+		game_destroy(this->games[i]);
+	}
+	free(this->threads);
+	free(this->walls);
+	free(this->scores);
+	free(this->games);
+	free(this);
+}
+
+int vec_env_get_count(const VecEnv *this) {
+	return this->options.envs;
+}
+
+size_t vec_env_get_observation_size(const VecEnv *this) {
+	return (size_t)VEC_ENV_PLANE_COUNT * this->width * this->height;
+}
+
+void vec_env_reset(VecEnv *this, Uint8 *observations) {
+	this->observations = observations;
+	this->is_reset = true;
+	dispatch(this);
+}
+
+void vec_env_step(VecEnv *this, const Uint8 *actions, float *rewards, Uint8 *dones, Uint8 *observations) {
+	this->actions = actions;
+	this->rewards = rewards;
+	this->dones = dones;
+	this->observations = observations;
+	this->is_reset = false;
+	dispatch(this);
+}
+
+/*
+ * BENCH
+ */
+
+void vec_env_bench_default_options(VecEnvBenchOptions *options) {
+	SDL_zero(*options);
+	vec_env_default_options(&options->env);
+	options->steps = VEC_ENV_DEFAULT_BENCH_STEPS;
+	options->seed = 1;
+	options->observe = true;
+}
+
+// Random actions, steps/s and the episodes finished meanwhile
+static bool bench_threads(const VecEnvBenchOptions *options, int threads, Uint8 *actions, float *rewards, Uint8 *dones, Uint8 *observations) {
+	VecEnvOptions env_options = options->env;
+	env_options.threads = threads;
+	VecEnv *env = vec_env_create(&env_options);
+	if (env == NULL)
+		return false;
+
+	Uint32 rng = options->seed != 0 ? options->seed : 1;
+	vec_env_reset(env, observations);
+	long long episodes = 0;
+	double reward = 0.0;
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int step = 0; step < options->steps; step++) {
+		for (int i = 0; i < env_options.envs; i++) {
+			actions[i] = (Uint8)(bot_random(&rng) % NONE);
+		}
+		vec_env_step(env, actions, rewards, dones, options->observe ? observations : NULL);
+		for (int i = 0; i < env_options.envs; i++) {
+			episodes += dones[i];
+			reward += rewards[i];
+		}
+	}
+	double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+	vec_env_destroy(env);
+
+	double env_steps = (double)options->steps * env_options.envs;
+	printf("%7d %14.0f %14.0f %12.2f %9lld %11.2f\n", threads, env_steps / seconds, env_steps * env_options.ticks_per_step / seconds,
+			seconds * 1e6 / options->steps, episodes, reward / env_steps);
+	return true;
+}
+
+int vec_env_bench_run(const VecEnvBenchOptions *options) {
+	const VecEnvOptions *env = &options->env;
+	if (env->envs <= 0 || env->ticks_per_step <= 0 || options->steps <= 0) {
+		printf("Nothing to step\n");
+		return 1;
+	}
+
+	int max_threads = env->threads > 0 ? env->threads : SDL_GetCPUCount();
+	size_t observation_size = (size_t)VEC_ENV_PLANE_COUNT * MAP_WIDTH * MAP_HEIGHT;
+	Uint8 *actions = malloc(env->envs);
+	float *rewards = malloc(env->envs * sizeof(float));
+	Uint8 *dones = malloc(env->envs);
+	Uint8 *observations = malloc(env->envs * observation_size);
+
+	printf("%d envs x %d steps, %d ticks per step, observations %s (%zu bytes each), random actions, seed %u\n", env->envs,
+			options->steps, env->ticks_per_step, options->observe ? "on" : "off", observation_size, options->seed);
+	printf("%7s %14s %14s %12s %9s %11s\n", "threads", "env steps/s", "ticks/s", "us/batch", "episodes", "reward/step");
+
+	int exit_code = 0;
+	for (int threads = 1; threads <= max_threads; threads *= 2) {
+		if (!bench_threads(options, threads, actions, rewards, dones, observations))
+			exit_code = 1;
+		if (threads < max_threads && threads * 2 > max_threads && !bench_threads(options, max_threads, actions, rewards, dones, observations))
+			exit_code = 1;
+	}
+
+	free(observations);
+	free(dones);
+	free(rewards);
+	free(actions);
+	return exit_code;
+}
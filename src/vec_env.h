@@ -0,0 +1,70 @@
+#ifndef VEC_ENV_H
+#define VEC_ENV_H
+
+#include "SDL2/SDL.h"
+
+#include "game.h"
+#include "utils.h"
+
+/*
+ * Batched headless games for reinforcement learning. One vec_env_step() call plays an action in
+ * each of N independent games and writes back a reward, a done flag and an observation per game,
+ * spread over worker threads that live as long as the batch. Nothing is allocated per step.
+ *
+ * An action is a Direction, NONE keeps the current one. A step repeats it for ticks_per_step
+ * ticks, then jumps over the countdowns where the player cannot steer, so every step is a
+ * decision. The reward is the score gained during the step. A game that ends reports done and
+ * restarts on the spot, the observation returned with it is the first of the new game.
+ *
+ * Observations are VEC_ENV_PLANE_COUNT planes of width * height bytes per game, row major,
+ * 1 where the plane's feature is and 0 elsewhere, games one after the other.
+ */
+
+#define VEC_ENV_DEFAULT_ENVS 256
+#define VEC_ENV_DEFAULT_TICKS_PER_STEP 4
+#define VEC_ENV_DEFAULT_BENCH_STEPS 2000
+
+enum VecEnvPlane {
+	VEC_ENV_WALLS,
+	VEC_ENV_PELLETS,
+	VEC_ENV_POWER_UPS,
+	VEC_ENV_PLAYER,
+	VEC_ENV_GHOST, // One plane per ghost, VEC_ENV_GHOST + index
+	VEC_ENV_FRIGHTENED = VEC_ENV_GHOST + GHOST_AMT, // Ghosts the player can eat
+	VEC_ENV_PLANE_COUNT
+} typedef VecEnvPlane;
+
+typedef struct VecEnvOptions {
+	int envs;
+	int threads; // 0 uses every core, the calling thread counts as one
+	int ticks_per_step; // The action is repeated this many ticks
+	GameConfig config;
+} VecEnvOptions;
+
+typedef struct VecEnvBenchOptions {
+	VecEnvOptions env;
+	int steps; // Batched steps, each steps every env once
+	Uint32 seed; // Random actions
+	bool observe; // Writes observations, off times the simulation alone
+} VecEnvBenchOptions;
+
+struct VecEnv;
+typedef struct VecEnv VecEnv;
+
+void vec_env_default_options(VecEnvOptions *options);
+VecEnv *vec_env_create(const VecEnvOptions *options);
+void vec_env_destroy(VecEnv *env);
+int vec_env_get_count(const VecEnv *env);
+// Bytes of one game's observation, the buffers passed in hold get_count() of them
+size_t vec_env_get_observation_size(const VecEnv *env);
+
+// Restarts every game, observations may be NULL
+void vec_env_reset(VecEnv *env, Uint8 *observations);
+// One action per game in, one reward, done flag and observation per game out. Observations may be NULL
+void vec_env_step(VecEnv *env, const Uint8 *actions, float *rewards, Uint8 *dones, Uint8 *observations);
+
+void vec_env_bench_default_options(VecEnvBenchOptions *options);
+// Reports env steps/s for 1 thread up to options->env.threads, returns the exit code
+int vec_env_bench_run(const VecEnvBenchOptions *options);
+
+#endif
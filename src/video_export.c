@@ -0,0 +1,326 @@
+#include "video_export.h"
+
+#include <stdio.h>
+
+#include "SDL2/SDL_image.h"
+
+#include "bot.h"
+#include "debug.h"
+#include "game.h"
+#include "render_bench.h"
+
+#define VIDEO_WIDTH RENDER_BENCH_WIDTH
+#define VIDEO_HEIGHT RENDER_BENCH_HEIGHT
+
+enum VideoFormat {
+	VIDEO_Y4M,
+	VIDEO_PNG
+} typedef VideoFormat;
+
+typedef struct VideoFrame {
+	int index;
+	SDL_Surface *surface; // A copy of what was drawn, alpha dropped
+	Uint8 *planes; // Y, then U and V at half the size. Y4M only
+} VideoFrame;
+
+typedef struct VideoExport {
+	const VideoExportOptions *options;
+	VideoFormat format;
+	FILE *file; // Y4M only
+
+	VideoFrame *frames;
+	int frame_count;
+
+	// Everything below is shared with the workers, under the mutex
+	SDL_mutex *mutex;
+	SDL_cond *changed; // A frame was queued, written or handed back
+	VideoFrame **free_frames;
+	int free_count;
+	VideoFrame **queue; // Ring of frame_count, oldest first
+	int queue_head;
+	int queue_count;
+	int next_write; // The stream is written in frame order
+	bool is_done; // Nothing more will be queued
+	bool has_failed;
+
+	Uint64 convert_ticks;
+	Uint64 write_ticks;
+	long long bytes;
+} VideoExport;
+
+void video_export_default_options(VideoExportOptions *options) {
+	SDL_zero(*options);
+	options->out_path = "export.y4m";
+	options->ticks = VIDEO_EXPORT_DEFAULT_TICKS;
+	options->seed = 1;
+	options->randomness = 0.05f;
+	options->threads = 0;
+	options->queue_frames = VIDEO_EXPORT_DEFAULT_QUEUE;
+	options->is_serial = false;
+}
+
+/*
+ * ENCODING
+ */
+
+// Full range BT.601, chroma averaged over each 2x2 block. PNGs are encoded while writing
+static void convert_frame(VideoExport *this, VideoFrame *frame) {
+	if (this->format != VIDEO_Y4M)
+		return;
+
+	const SDL_Surface *surface = frame->surface;
+	int w = surface->w;
+	Uint8 *y_plane = frame->planes;
+	Uint8 *u_plane = y_plane + w * surface->h;
+	Uint8 *v_plane = u_plane + (w / 2) * (surface->h / 2);
+	for (int y = 0; y < surface->h; y += 2) {
+		const Uint32 *rows[2] = {
+			(const Uint32 *)((const Uint8 *)surface->pixels + y * surface->pitch),
+			(const Uint32 *)((const Uint8 *)surface->pixels + (y + 1) * surface->pitch),
+		};
+		for (int x = 0; x < w; x += 2) {
+			int r = 0, g = 0, b = 0;
+			for (int i = 0; i < 4; i++) {
+				Uint32 pixel = rows[i >> 1][x + (i & 1)];
+				int pr = (pixel >> 16) & 0xFF;
+				int pg = (pixel >> 8) & 0xFF;
+				int pb = pixel & 0xFF;
+				y_plane[(y + (i >> 1)) * w + x + (i & 1)] = (Uint8)((77 * pr + 150 * pg + 29 * pb + 128) >> 8);
+				r += pr;
+				g += pg;
+				b += pb;
+			}
+			// Sums of four pixels, the two extra bits go in the shift
+			int chroma = (y / 2) * (w / 2) + x / 2;
+			u_plane[chroma] = (Uint8)SDL_min((-43 * r - 85 * g + 128 * b + 4 * 32896) >> 10, 255);
+			v_plane[chroma] = (Uint8)SDL_min((128 * r - 107 * g - 21 * b + 4 * 32896) >> 10, 255);
+		}
+	}
+}
+
+static bool write_frame(VideoExport *this, VideoFrame *frame) {
+	if (this->format == VIDEO_Y4M) {
+		size_t size = (size_t)frame->surface->w * frame->surface->h * 3 / 2;
+		bool is_written = fputs("FRAME\n", this->file) >= 0 && fwrite(frame->planes, 1, size, this->file) == size;
+		this->bytes += 6 + size;
+		return is_written;
+	}
+
+	char path[512];
+	SDL_snprintf(path, sizeof(path), "%s/frame_%05d.png", this->options->out_path, frame->index);
+	if (IMG_SavePNG(frame->surface, path) != 0) {
+		printf("Unable to write %s: %s\n", path, IMG_GetError());
+		return false;
+	}
+	return true;
+}
+
+static int worker(void *data) {
+	VideoExport *this = data;
+	SDL_LockMutex(this->mutex);
+	for (;;) {
+		while (this->queue_count == 0 && !this->is_done) {
+			SDL_CondWait(this->changed, this->mutex);
+		}
+		if (this->queue_count == 0)
+			break;
+		VideoFrame *frame = this->queue[this->queue_head];
+		this->queue_head = (this->queue_head + 1) % this->frame_count;
+		this->queue_count--;
+		SDL_UnlockMutex(this->mutex);
+
+		Uint64 start = SDL_GetPerformanceCounter();
+		convert_frame(this, frame);
+		Uint64 converted = SDL_GetPerformanceCounter();
+
+		// PNGs go to their own files, in any order
+		SDL_LockMutex(this->mutex);
+		while (this->format == VIDEO_Y4M && this->next_write != frame->index) {
+			SDL_CondWait(this->changed, this->mutex);
+		}
+		SDL_UnlockMutex(this->mutex);
+
+		Uint64 write_start = SDL_GetPerformanceCounter();
+		bool is_written = write_frame(this, frame);
+		Uint64 written = SDL_GetPerformanceCounter();
+
+		SDL_LockMutex(this->mutex);
+		this->convert_ticks += converted - start;
+		this->write_ticks += written - write_start;
+		this->has_failed |= !is_written;
+		this->next_write++;
+		this->free_frames[this->free_count++] = frame;
+		SDL_CondBroadcast(this->changed);
+	}
+	SDL_UnlockMutex(this->mutex);
+	return 0;
+}
+
+/*
+ * SIMULATION SIDE
+ */
+
+// Waits for the workers to hand one back, NULL once writing failed
+static VideoFrame *acquire_frame(VideoExport *this) {
+	SDL_LockMutex(this->mutex);
+	while (this->free_count == 0) {
+		SDL_CondWait(this->changed, this->mutex);
+	}
+	VideoFrame *frame = this->has_failed ? NULL : this->free_frames[--this->free_count];
+	SDL_UnlockMutex(this->mutex);
+	return frame;
+}
+
+static void queue_frame(VideoExport *this, VideoFrame *frame) {
+	SDL_LockMutex(this->mutex);
+	this->queue[(this->queue_head + this->queue_count) % this->frame_count] = frame;
+	this->queue_count++;
+	SDL_CondBroadcast(this->changed);
+	SDL_UnlockMutex(this->mutex);
+}
+
+static bool has_extension(const char *path, const char *extension) {
+	size_t length = SDL_strlen(path);
+	size_t extension_length = SDL_strlen(extension);
+	return length >= extension_length && SDL_strcasecmp(path + length - extension_length, extension) == 0;
+}
+
+int video_export_run(const VideoExportOptions *options) {
+	VideoExport this;
+	SDL_zero(this);
+	this.options = options;
+	this.format = has_extension(options->out_path, ".y4m") ? VIDEO_Y4M : VIDEO_PNG;
+	if (this.format == VIDEO_Y4M) {
+		this.file = fopen(options->out_path, "wb");
+		if (this.file == NULL) {
+			printf("Unable to write %s\n", options->out_path);
+			return 1;
+		}
+		// One frame per tick
+		fprintf(this.file, "YUV4MPEG2 W%d H%d F1000:%d Ip A1:1 C420jpeg\n", VIDEO_WIDTH, VIDEO_HEIGHT, TICK_TIME);
+	}
+
+	SDL_Surface *target = SDL_CreateRGBSurfaceWithFormat(0, VIDEO_WIDTH, VIDEO_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+	SDL_Renderer *renderer = SDL_CreateSoftwareRenderer(target);
+	if (renderer == NULL) {
+		printf("Unable to create software renderer: %s\n", SDL_GetError());
+		if (this.file != NULL)
+			fclose(this.file);
+		SDL_FreeSurface(target);
+		return 1;
+	}
+
+	int thread_count = options->threads > 0 ? options->threads : SDL_max(SDL_GetCPUCount() - 1, 1);
+	this.frame_count = options->is_serial ? 1 : SDL_max(options->queue_frames, 2);
+	this.frames = calloc(this.frame_count, sizeof(VideoFrame));
+	this.free_frames = malloc(this.frame_count * sizeof(VideoFrame *));
+	this.queue = malloc(this.frame_count * sizeof(VideoFrame *));
+	for (int i = 0; i < this.frame_count; i++) {
+		// Same layout as the target without its alpha, cleared pixels have none
+		this.frames[i].surface = SDL_CreateRGBSurfaceWithFormat(0, VIDEO_WIDTH, VIDEO_HEIGHT, 32, SDL_PIXELFORMAT_RGB888);
+		if (this.format == VIDEO_Y4M)
+			this.frames[i].planes = malloc(VIDEO_WIDTH * VIDEO_HEIGHT * 3 / 2);
+		this.free_frames[this.free_count++] = &this.frames[i];
+	}
+
+	SDL_Thread **threads = NULL;
+	if (!options->is_serial) {
+		this.mutex = SDL_CreateMutex();
+		this.changed = SDL_CreateCond();
+		threads = malloc(thread_count * sizeof(SDL_Thread *));
+		for (int i = 0; i < thread_count; i++) {
+			threads[i] = SDL_CreateThread(worker, "video", &this);
+		}
+	}
+
+	Game *game = game_create(renderer, NULL);
+	game_set_silent(game, true);
+	Bot bot;
+	bot_init(&bot, options->seed, options->randomness);
+
+	Uint64 simulate_ticks = 0;
+	Uint64 wait_ticks = 0;
+	int frames = 0;
+	int tail = VIDEO_EXPORT_TAIL_TICKS;
+	Uint64 start = SDL_GetPerformanceCounter();
+	while (frames < options->ticks && tail > 0) {
+		Uint64 frame_start = SDL_GetPerformanceCounter();
+		bot_update(&bot, game);
+		game_update(game, TICK_TIME);
+		game_draw(game, renderer);
+		if (game_is_over(game))
+			tail--;
+		Uint64 drawn = SDL_GetPerformanceCounter();
+
+		VideoFrame *frame = options->is_serial ? &this.frames[0] : acquire_frame(&this);
+		if (frame == NULL)
+			break;
+		Uint64 acquired = SDL_GetPerformanceCounter();
+		simulate_ticks += drawn - frame_start;
+		wait_ticks += acquired - drawn;
+
+		// Both surfaces are 32 bits at the same size, so they share a pitch
+		SDL_memcpy(frame->surface->pixels, target->pixels, target->h * target->pitch);
+		frame->index = frames++;
+
+		if (options->is_serial) {
+			convert_frame(&this, frame);
+			Uint64 converted = SDL_GetPerformanceCounter();
+			bool is_written = write_frame(&this, frame);
+			this.convert_ticks += converted - acquired;
+			this.write_ticks += SDL_GetPerformanceCounter() - converted;
+			if (!is_written) {
+				this.has_failed = true;
+				break;
+			}
+		} else {
+			queue_frame(&this, frame);
+		}
+	}
+
+	if (!options->is_serial) {
+		SDL_LockMutex(this.mutex);
+		this.is_done = true;
+		SDL_CondBroadcast(this.changed);
+		SDL_UnlockMutex(this.mutex);
+		for (int i = 0; i < thread_count; i++) {
+			SDL_WaitThread(threads[i], NULL);
+		}
+	}
+	double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+	if (this.file != NULL && fclose(this.file) != 0)
+		this.has_failed = true;
+
+	double to_ms = 1000.0 / SDL_GetPerformanceFrequency();
+	int count = SDL_max(frames, 1);
+	printf("Exported %d frames of %dx%d to %s, seed %u\n", frames, VIDEO_WIDTH, VIDEO_HEIGHT, options->out_path, options->seed);
+	if (options->is_serial)
+		printf("Encoded on the simulation thread\n");
+	else
+		printf("%d encoding thread(s), %d frames in flight\n", thread_count, this.frame_count);
+	printf("%.2fs, %.1f frames/s, %.1fx real time\n", seconds, frames / seconds, frames * TICK_TIME / 1000.0 / seconds);
+	printf("Simulation thread per frame: %.3fms simulating and drawing, %.3fms waiting for a free frame\n",
+			simulate_ticks * to_ms / count, wait_ticks * to_ms / count);
+	printf("Encoding per frame: %.3fms converting, %.3fms writing\n", this.convert_ticks * to_ms / count, this.write_ticks * to_ms / count);
+	if (this.format == VIDEO_Y4M)
+		printf("%.1f MB written\n", this.bytes / (1024.0 * 1024.0));
+
+	game_destroy(game);
+	free(threads);
+	if (this.mutex != NULL) {
+		SDL_DestroyCond(this.changed);
+		SDL_DestroyMutex(this.mutex);
+	}
+	for (int i = 0; i < this.frame_count; i++) {
+		SDL_FreeSurface(this.frames[i].surface);
+		free(this.frames[i].planes);
+	}
+	free(this.queue);
+	free(this.free_frames);
+	free(this.frames);
+	SDL_DestroyRenderer(renderer);
+	SDL_FreeSurface(target);
+
+	return this.has_failed ? 1 : 0;
+}
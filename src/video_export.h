@@ -0,0 +1,40 @@
+#ifndef VIDEO_EXPORT_H
+#define VIDEO_EXPORT_H
+
+#include "SDL2/SDL.h"
+
+#include "utils.h"
+
+/*
+ * Headless video export of a bot played session, at whatever speed the machine manages. The
+ * session is seeded like the sweep games, so the same seed exports the same game again.
+ *
+ * The main thread simulates a tick and draws it with game_draw() into an off-screen surface,
+ * then copies the pixels into a free frame of a fixed pool and queues it. Worker threads take
+ * queued frames, convert and encode them, write them out in order and hand the frame back to
+ * the pool. The next tick is simulated while earlier ones are still being encoded, the main
+ * thread only waits when every frame of the pool is in flight.
+ *
+ * A path ending in .y4m gets one YUV4MPEG2 stream (4:2:0, full range BT.601), anything else is
+ * taken as an existing directory for a PNG per frame.
+ */
+
+#define VIDEO_EXPORT_DEFAULT_TICKS 3600
+#define VIDEO_EXPORT_DEFAULT_QUEUE 8
+#define VIDEO_EXPORT_TAIL_TICKS 120 // Still exported after the game over
+
+typedef struct VideoExportOptions {
+	const char *out_path;
+	int ticks; // One frame each, fewer when the game ends first
+	Uint32 seed;
+	float randomness; // See Bot
+	int threads; // Encoding workers, 0 uses every core but the simulation's
+	int queue_frames; // Frames in flight between the simulation and the workers
+	bool is_serial; // Encodes on the simulation thread instead, for comparison
+} VideoExportOptions;
+
+void video_export_default_options(VideoExportOptions *options);
+// Returns the process exit code
+int video_export_run(const VideoExportOptions *options);
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * Example ghost brain plugin (see src/ghost_brain.h), built as a shared object:
+ *   --ghost-brain 2:brain_ambush.dll
+ *
+ * Aims four tiles ahead of the player like the arcade's pink ghost, choosing at every tile the
+ * open direction whose next tile is closest to the target, and never turning back unless
+ * cornered. Fleeing, it picks the farthest instead. Keeps no state.
+ */
+
+#include <stddef.h>
+
+#include "../src/ghost_brain.h"
+
+#define AMBUSH_TILES 4
+
+static const int offsets[4][2] = {
+	[GHOST_BRAIN_EAST] = { 1, 0 },
+	[GHOST_BRAIN_SOUTH] = { 0, 1 },
+	[GHOST_BRAIN_WEST] = { -1, 0 },
+	[GHOST_BRAIN_NORTH] = { 0, -1 },
+};
+
+static int to_tile(int32_t fixed) {
+	return (fixed + 32768) / 65536;
+}
+
+static int is_open(const GhostBrainView *view, int x, int y) {
+	if (x < 0 || x >= view->width || y < 0 || y >= view->height)
+		return 0;
+	return !view->walls[x + y * view->width];
+}
+
+static int32_t think(void *state, const GhostBrainView *view) {
+	(void)state; // Stateless, every decision comes from the view
+	const GhostBrainEntity *self = &view->ghosts[view->self];
+	int x = to_tile(self->x);
+	int y = to_tile(self->y);
+
+	int target_x = to_tile(view->player.x);
+	int target_y = to_tile(view->player.y);
+	if (view->player.direction >= GHOST_BRAIN_EAST && view->player.direction <= GHOST_BRAIN_NORTH) {
+		target_x += offsets[view->player.direction][0] * AMBUSH_TILES;
+		target_y += offsets[view->player.direction][1] * AMBUSH_TILES;
+	}
+	int is_fleeing = self->state == GHOST_BRAIN_FLEEING;
+
+	int32_t best = GHOST_BRAIN_KEEP;
+	long best_distance = 0;
+	int32_t back = self->direction <= GHOST_BRAIN_NORTH ? (self->direction + 2) % 4 : GHOST_BRAIN_KEEP;
+	for (int32_t direction = GHOST_BRAIN_EAST; direction <= GHOST_BRAIN_NORTH; direction++) {
+		int next_x = x + offsets[direction][0];
+		int next_y = y + offsets[direction][1];
+		if (direction == back || !is_open(view, next_x, next_y))
+			continue;
+		long dx = next_x - target_x;
+		long dy = next_y - target_y;
+		long distance = dx * dx + dy * dy;
+		if (best == GHOST_BRAIN_KEEP || (is_fleeing ? distance > best_distance : distance < best_distance)) {
+			best = direction;
+			best_distance = distance;
+		}
+	}
+	// Cornered, the way back is the only one left
+	return best != GHOST_BRAIN_KEEP ? best : back;
+}
+
+static const GhostBrain brain = {
+	GHOST_BRAIN_ABI_VERSION,
+	"ambush",
+	NULL,
+	NULL,
+	think,
+};
+
+GHOST_BRAIN_EXPORT const GhostBrain *ghost_brain_entry(void) {
+	return &brain;
+}
@@ -0,0 +1,61 @@
+/*
+ * Writes a corpus of generated mazes (see src/maze.h) for the game's --maze-bench --maze-file
+ *
+ * Usage: mazegen <out_dir> [WxH,WxH,...] [count] [seed]
+ *   Writes count mazes (4) of every size as <out_dir>/maze_<W>x<H>_<seed>.txt, seeds counting
+ *   up from seed (1). The directory must exist.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SDL2/SDL.h"
+
+#include "../src/maze.h"
+
+static const char *default_sizes = "28x31,64x64,256x256,1024x1024,4096x4096";
+
+int main(int argc, char *args[]) {
+	if (argc < 2) {
+		printf("Usage: mazegen <out_dir> [WxH,WxH,...] [count] [seed]\n");
+		return 1;
+	}
+	const char *dir = args[1];
+	const char *sizes = argc > 2 ? args[2] : default_sizes;
+	int count = argc > 3 ? SDL_atoi(args[3]) : 4;
+	Uint32 seed = argc > 4 ? (Uint32)SDL_strtoul(args[4], NULL, 10) : 1;
+
+	int written = 0;
+	while (*sizes != '\0') {
+		char *end = NULL;
+		int width = SDL_strtol(sizes, &end, 10);
+		int height = *end == 'x' ? SDL_strtol(end + 1, &end, 10) : 0;
+		if (*end != ',' && *end != '\0') {
+			printf("Invalid size list %s\n", sizes);
+			return 1;
+		}
+		sizes = *end == ',' ? end + 1 : end;
+
+		for (int i = 0; i < count; i++) {
+			Uint64 start = SDL_GetPerformanceCounter();
+			MapLayout *layout = maze_generate(width, height, seed + i);
+			double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+			if (layout == NULL) {
+				printf("%dx%d is out of range, %dx%d to %dx%d\n", width, height, MAZE_MIN_WIDTH, MAZE_MIN_HEIGHT, MAZE_MAX_SIDE, MAZE_MAX_SIDE);
+				return 1;
+			}
+
+			char path[512];
+			SDL_snprintf(path, sizeof(path), "%s/maze_%dx%d_%u.txt", dir, width, height, seed + i);
+			bool is_written = maze_write(layout, path);
+			maze_free(layout);
+			if (!is_written)
+				return 1;
+			printf("%s, generated in %.2fms\n", path, ms);
+			written++;
+		}
+	}
+
+	printf("%d mazes written\n", written);
+	return 0;
+}
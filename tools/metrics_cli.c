@@ -0,0 +1,113 @@
+/*
+ * Reads the metrics a running game publishes to shared memory (see src/metrics.h)
+ *
+ * Usage: metrics_cli [pid] [interval_ms]
+ *   Without a pid, lists the running instances (POSIX only).
+ *   With an interval, prints a fresh report every interval_ms until interrupted.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SDL2/SDL.h"
+
+#include "../src/metrics.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static const MetricsSnapshot *open_segment(unsigned int pid) {
+	char name[96];
+#ifdef _WIN32
+	SDL_snprintf(name, sizeof(name), "Local\\" METRICS_SHM_PREFIX "%u", pid);
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+	if (mapping == NULL)
+		return NULL;
+	return MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(MetricsSnapshot));
+#else
+	SDL_snprintf(name, sizeof(name), "/" METRICS_SHM_PREFIX "%u", pid);
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		return NULL;
+	void *data = mmap(NULL, sizeof(MetricsSnapshot), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	return data == MAP_FAILED ? NULL : data;
+#endif
+}
+
+// The segment is mapped read only, SDL_AtomicGet() may write to it
+static int load_sequence(const MetricsSnapshot *shared) {
+	int sequence = *(volatile const int *)&shared->sequence.value;
+	SDL_MemoryBarrierAcquire();
+	return sequence;
+}
+
+static bool read_snapshot(const MetricsSnapshot *shared, MetricsSnapshot *snapshot) {
+	for (int attempt = 0; attempt < 100; attempt++) {
+		int before = load_sequence(shared);
+		if (before & 1) {
+			SDL_Delay(1);
+			continue;
+		}
+		SDL_memcpy(snapshot, (const void *)shared, sizeof(MetricsSnapshot));
+		SDL_MemoryBarrierAcquire();
+		if (load_sequence(shared) == before)
+			return snapshot->magic == METRICS_MAGIC && snapshot->version == METRICS_VERSION;
+	}
+	return false;
+}
+
+static void list_instances() {
+#ifdef _WIN32
+	printf("Pass the pid of the game to inspect\n");
+#else
+	DIR *dir = opendir("/dev/shm");
+	if (dir == NULL)
+		return;
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (SDL_strncmp(entry->d_name, METRICS_SHM_PREFIX, SDL_strlen(METRICS_SHM_PREFIX)) == 0)
+			printf("%s\n", entry->d_name + SDL_strlen(METRICS_SHM_PREFIX));
+	}
+	closedir(dir);
+#endif
+}
+
+int main(int argc, char *args[]) {
+	if (argc < 2) {
+		list_instances();
+		return 0;
+	}
+
+	unsigned int pid = (unsigned int)SDL_strtol(args[1], NULL, 10);
+	int interval = argc > 2 ? SDL_atoi(args[2]) : 0;
+
+	const MetricsSnapshot *shared = open_segment(pid);
+	if (shared == NULL) {
+		printf("No metrics for pid %u\n", pid);
+		return 1;
+	}
+
+	MetricsSnapshot *snapshot = malloc(sizeof(MetricsSnapshot));
+	do {
+		if (!read_snapshot(shared, snapshot)) {
+			printf("Unable to read a consistent snapshot\n");
+			return 1;
+		}
+		metrics_dump(stdout, snapshot);
+		printf("\n");
+		fflush(stdout);
+		if (interval > 0)
+			SDL_Delay(interval);
+	} while (interval > 0);
+
+	free(snapshot);
+	return 0;
+}
@@ -0,0 +1,168 @@
+/*
+ * Asset packer: bundles files into the archive read by src/pack.c
+ *
+ * Usage: packer [-rgba] <output.pak> <resources_dir> <name>...
+ *   -rgba   Store .png files decoded to raw RGBA so the game skips PNG inflate at startup
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_image.h"
+
+#include "../src/pack.h"
+
+typedef struct Blob {
+	PackEntry entry;
+	void *data;
+	SDL_Surface *surface; // Owns data when the image was decoded
+} Blob;
+
+static int compare_blobs(const void *a, const void *b) {
+	return SDL_strncmp(((const Blob *)a)->entry.name, ((const Blob *)b)->entry.name, PACK_NAME_LENGTH);
+}
+
+static bool is_png(const char *name) {
+	size_t length = SDL_strlen(name);
+	return length > 4 && SDL_strcmp(name + length - 4, ".png") == 0;
+}
+
+static bool load_blob(Blob *blob, const char *root, const char *name, bool decode_images) {
+	char path[512];
+	SDL_snprintf(path, sizeof(path), "%s/%s", root, name);
+
+	if (SDL_strlen(name) >= PACK_NAME_LENGTH) {
+		printf("Name too long: %s\n", name);
+		return false;
+	}
+	SDL_zero(*blob);
+	SDL_strlcpy(blob->entry.name, name, PACK_NAME_LENGTH);
+
+	if (decode_images && is_png(name)) {
+		SDL_Surface *surf = IMG_Load(path);
+		if (surf == NULL) {
+			printf("Unable to decode %s: %s\n", path, IMG_GetError());
+			return false;
+		}
+		blob->surface = SDL_ConvertSurfaceFormat(surf, SDL_PIXELFORMAT_RGBA32, 0);
+		SDL_FreeSurface(surf);
+		if (blob->surface->pitch != blob->surface->w * 4) {
+			printf("Unexpected pitch for %s\n", path);
+			return false;
+		}
+		blob->entry.type = PACK_ENTRY_RGBA;
+		blob->entry.width = blob->surface->w;
+		blob->entry.height = blob->surface->h;
+		blob->entry.size = blob->surface->pitch * blob->surface->h;
+		blob->data = blob->surface->pixels;
+		return true;
+	}
+
+	size_t size = 0;
+	blob->data = SDL_LoadFile(path, &size);
+	if (blob->data == NULL) {
+		printf("Unable to read %s: %s\n", path, SDL_GetError());
+		return false;
+	}
+	blob->entry.type = PACK_ENTRY_RAW;
+	blob->entry.size = (Uint32)size;
+	return true;
+}
+
+static void free_blob(Blob *blob) {
+	if (blob->surface != NULL)
+		SDL_FreeSurface(blob->surface);
+	else
+		SDL_free(blob->data);
+}
+
+static void free_blobs(Blob *blobs, int count) {
+	for (int i = 0; i < count; i++) {
+		free_blob(&blobs[i]);
+	}
+	free(blobs);
+}
+
+// False on a short write, a full disk for one
+static bool write_pack(SDL_RWops *out, const Blob *blobs, int count) {
+	PackHeader header = { PACK_MAGIC, PACK_VERSION, count, 0 };
+	if (SDL_RWwrite(out, &header, sizeof(header), 1) != 1)
+		return false;
+	for (int i = 0; i < count; i++) {
+		if (SDL_RWwrite(out, &blobs[i].entry, sizeof(PackEntry), 1) != 1)
+			return false;
+	}
+
+	static const Uint8 padding[PACK_ALIGNMENT] = { 0 };
+	for (int i = 0; i < count; i++) {
+		Sint64 position = SDL_RWtell(out);
+		if (position < 0)
+			return false;
+		size_t gap = (size_t)(blobs[i].entry.offset - position);
+		if (SDL_RWwrite(out, padding, 1, gap) != gap || SDL_RWwrite(out, blobs[i].data, 1, blobs[i].entry.size) != blobs[i].entry.size)
+			return false;
+		printf("%-32s %s %8u bytes\n", blobs[i].entry.name, blobs[i].entry.type == PACK_ENTRY_RGBA ? "rgba" : "raw ", blobs[i].entry.size);
+	}
+	return true;
+}
+
+int main(int argc, char *args[]) {
+	int arg = 1;
+	bool decode_images = false;
+	if (arg < argc && SDL_strcmp(args[arg], "-rgba") == 0) {
+		decode_images = true;
+		arg++;
+	}
+	if (argc - arg < 3) {
+		printf("Usage: packer [-rgba] <output.pak> <resources_dir> <name>...\n");
+		return 1;
+	}
+	const char *output = args[arg++];
+	const char *root = args[arg++];
+
+	IMG_Init(IMG_INIT_PNG);
+
+	int count = argc - arg;
+	Blob *blobs = calloc(count, sizeof(Blob));
+	for (int i = 0; i < count; i++) {
+		if (!load_blob(&blobs[i], root, args[arg + i], decode_images)) {
+			free_blobs(blobs, count);
+			IMG_Quit();
+			return 1;
+		}
+	}
+	qsort(blobs, count, sizeof(Blob), compare_blobs);
+
+	// Data starts after the index, each blob aligned so it can be used in place
+	Uint32 offset = sizeof(PackHeader) + count * sizeof(PackEntry);
+	for (int i = 0; i < count; i++) {
+		offset = (offset + PACK_ALIGNMENT - 1) & ~(PACK_ALIGNMENT - 1);
+		blobs[i].entry.offset = offset;
+		offset += blobs[i].entry.size;
+	}
+
+	SDL_RWops *out = SDL_RWFromFile(output, "wb");
+	if (out == NULL) {
+		printf("Unable to create %s: %s\n", output, SDL_GetError());
+		free_blobs(blobs, count);
+		IMG_Quit();
+		return 1;
+	}
+
+	bool is_written = write_pack(out, blobs, count);
+	if (SDL_RWclose(out) != 0)
+		is_written = false;
+	free_blobs(blobs, count);
+	if (!is_written) {
+		// Never leave a truncated pack for the game to find
+		printf("Unable to write %s: %s\n", output, SDL_GetError());
+		remove(output);
+		IMG_Quit();
+		return 1;
+	}
+
+	printf("Wrote %s: %d entries, %u bytes\n", output, count, offset);
+	IMG_Quit();
+	return 0;
+}